@@ -1,7 +1,9 @@
 #include "board.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 // RGB color definitions
@@ -12,6 +14,56 @@ const RGBColor COLOR_BLOCKED = {50, 50, 50};
 const RGBColor COLOR_GRID = {100, 100, 100};
 const RGBColor COLOR_BACKGROUND = {0, 0, 0};
 
+#define ANIMATION_FRAMES 6                      // Keyframes of a transition; the last one shows the new board
+#define ANIMATION_FRAME_MS 40                   // Time between keyframes, so a transition takes 200 ms
+#define CANVAS_POOL_SIZE (ANIMATION_FRAMES + 1) // Every keyframe of a transition plus the canvas on display
+#define CELL_UNKNOWN '\001'                     // Contents of a cell drawn in the middle of a transition
+
+// Canvases are created once in initialize_matrix(), since the library never frees a canvas
+// before the matrix is deleted. A frame is drawn into a canvas that is not on display and
+// swapped in on vsync. Each canvas remembers the board it shows, so the next frame drawn
+// into it only touches the cells that differ.
+typedef struct
+{
+    struct LedCanvas *canvas;
+    char board[BOARD_ROWS][BOARD_COLS + 1];
+    int valid; // 0: contents unknown, the next frame is drawn in full
+} CanvasContents;
+
+static CanvasContents canvas_pool[CANVAS_POOL_SIZE];
+static int front_canvas = -1;    // Pool index of the canvas on display (-1: the matrix's own)
+static int previous_canvas = -1; // The one before; static frames alternate between these two
+static char shown_board[BOARD_ROWS][BOARD_COLS + 1]; // The last board fully on display
+static int shown_board_valid = 0;
+
+// Helper function to forget what all canvases show (after a clear)
+static void forget_canvas_contents(void)
+{
+    for (int i = 0; i < CANVAS_POOL_SIZE; ++i)
+        canvas_pool[i].valid = 0;
+    shown_board_valid = 0;
+}
+
+// Helper function to show a pool canvas on the next vsync (blocks until then)
+static void show_canvas(struct RGBLedMatrix *matrix, int index)
+{
+    led_matrix_swap_on_vsync(matrix, canvas_pool[index].canvas);
+    if (index != front_canvas)
+    {
+        previous_canvas = front_canvas;
+        front_canvas = index;
+    }
+}
+
+// Helper function to pick the canvas for the next static frame: the one shown before the
+// current front, whose contents are only one board behind
+static int back_canvas(void)
+{
+    if (previous_canvas >= 0 && previous_canvas != front_canvas)
+        return previous_canvas;
+    return front_canvas == 0 ? 1 : 0;
+}
+
 struct RGBLedMatrix *initialize_matrix(int *argc, char ***argv)
 {
     struct RGBLedMatrixOptions matrix_options;
@@ -32,41 +84,46 @@ struct RGBLedMatrix *initialize_matrix(int *argc, char ***argv)
         return NULL;
     }
 
+    for (int i = 0; i < CANVAS_POOL_SIZE; ++i)
+    {
+        canvas_pool[i].canvas = led_matrix_create_offscreen_canvas(matrix);
+        canvas_pool[i].valid = 0;
+        if (!canvas_pool[i].canvas)
+        {
+            fprintf(stderr, "Error: Could not create offscreen canvas.\n");
+            led_matrix_delete(matrix);
+            memset(canvas_pool, 0, sizeof(canvas_pool));
+            return NULL;
+        }
+    }
+    front_canvas = -1;
+    previous_canvas = -1;
+
     clear_matrix_display(matrix);
     return matrix;
 }
 
 void clear_matrix_display(struct RGBLedMatrix *matrix)
 {
-    if (!matrix)
+    if (!matrix || !canvas_pool[0].canvas)
         return;
 
-    // Create an offscreen canvas to draw the cleared state
-    struct LedCanvas *canvas = led_matrix_create_offscreen_canvas(matrix);
-    if (!canvas)
-    {
-        fprintf(stderr, "Error: Could not create offscreen canvas in clear_matrix_display.\n");
-        return;
-    }
-
-    led_canvas_fill(canvas, COLOR_BACKGROUND.r, COLOR_BACKGROUND.g, COLOR_BACKGROUND.b);
-
-    // Swap the cleared canvas to the display.
-    // led_matrix_swap_on_vsync takes ownership of 'canvas' and returns the PREVIOUS front buffer.
-    // This previous buffer should be deleted if not reused.
-    struct LedCanvas *previous_front_buffer = led_matrix_swap_on_vsync(matrix, canvas);
-    if (previous_front_buffer)
-    { // It might be NULL if this is the very first swap
-        led_canvas_clear(previous_front_buffer);
-    }
+    int index = back_canvas();
+    led_canvas_fill(canvas_pool[index].canvas, COLOR_BACKGROUND.r, COLOR_BACKGROUND.g, COLOR_BACKGROUND.b);
+    forget_canvas_contents(); // Every canvas is drawn in full again
+    show_canvas(matrix, index);
 }
 
 void cleanup_matrix(struct RGBLedMatrix *matrix)
 {
     if (!matrix)
         return;
+    stop_board_renderer();        // Its thread must not draw on a deleted matrix
     clear_matrix_display(matrix); // Optional: clear before deleting
-    led_matrix_delete(matrix);
+    led_matrix_delete(matrix);    // Also deletes the canvas pool
+    memset(canvas_pool, 0, sizeof(canvas_pool));
+    front_canvas = -1;
+    previous_canvas = -1;
 }
 
 #define MATRIX_SIZE 64
@@ -74,109 +131,503 @@ void cleanup_matrix(struct RGBLedMatrix *matrix)
 #define GRID_LINE_WIDTH 1
 #define PIECE_AREA_SIZE (CELL_SIZE - GRID_LINE_WIDTH)
 
-// Helper function to draw a filled rectangle
-static void draw_filled_rect(struct LedCanvas *canvas, int x_start, int y_start, int width, int height, RGBColor color)
+#define PIECE_RENDER_SIZE (CELL_SIZE - 2 * GRID_LINE_WIDTH)
+#define CELL_SPRITE_COUNT 5 // 'R', 'B', '.', '#' and anything else (background)
+
+// Pre-rasterised images: one sprite per cell type and the empty grid, built once by build_sprites().
+// A cell is then written with one led_canvas_set_pixels() call, and a full frame is composed by
+// copying rows into frame_image and written with one more, instead of a call per pixel.
+static struct Color cell_sprites[CELL_SPRITE_COUNT][PIECE_RENDER_SIZE * PIECE_RENDER_SIZE];
+static struct Color grid_image[MATRIX_SIZE * MATRIX_SIZE];
+static struct Color frame_image[MATRIX_SIZE * MATRIX_SIZE];
+static int sprites_built = 0;
+
+// Helper function to fill a rectangle of an image 'image_size' pixels wide and high, clipped to it
+static void fill_image_rect(struct Color *image, int image_size, int x_start, int y_start, int width, int height, RGBColor color)
 {
-    if (!canvas)
-        return;
+    struct Color led_color = {color.r, color.g, color.b};
     for (int y = y_start; y < y_start + height; ++y)
     {
         for (int x = x_start; x < x_start + width; ++x)
         {
-            if (x >= 0 && x < MATRIX_SIZE && y >= 0 && y < MATRIX_SIZE)
+            if (x >= 0 && x < image_size && y >= 0 && y < image_size)
             {
-                led_canvas_set_pixel(canvas, x, y, color.r, color.g, color.b);
+                image[y * image_size + x] = led_color;
             }
         }
     }
 }
 
-void render_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1])
+// Helper function to map a board character to its sprite
+static int sprite_index(char piece_char)
 {
-    if (!matrix)
-        return;
-
-    struct LedCanvas *offscreen_canvas = led_matrix_create_offscreen_canvas(matrix);
-    if (!offscreen_canvas)
+    switch (piece_char)
     {
-        fprintf(stderr, "Failed to create offscreen canvas.\n");
-        return;
+    case 'R':
+        return 0;
+    case 'B':
+        return 1;
+    case '.':
+        return 2;
+    case '#':
+        return 3;
+    default:
+        return 4;
     }
+}
 
-    led_canvas_fill(offscreen_canvas, COLOR_BACKGROUND.r, COLOR_BACKGROUND.g, COLOR_BACKGROUND.b);
-
-    // Draw grid lines
+// Helper function to rasterise the grid and the cell sprites
+static void build_sprites(void)
+{
+    fill_image_rect(grid_image, MATRIX_SIZE, 0, 0, MATRIX_SIZE, MATRIX_SIZE, COLOR_BACKGROUND);
     for (int i = 0; i <= BOARD_ROWS; ++i)
     {
         int y_coord = i * CELL_SIZE;
         if (y_coord >= MATRIX_SIZE)
             y_coord = MATRIX_SIZE - GRID_LINE_WIDTH;
-        draw_filled_rect(offscreen_canvas, 0, y_coord, MATRIX_SIZE, GRID_LINE_WIDTH, COLOR_GRID);
+        fill_image_rect(grid_image, MATRIX_SIZE, 0, y_coord, MATRIX_SIZE, GRID_LINE_WIDTH, COLOR_GRID);
 
         int x_coord = i * CELL_SIZE;
         if (x_coord >= MATRIX_SIZE)
             x_coord = MATRIX_SIZE - GRID_LINE_WIDTH;
-        draw_filled_rect(offscreen_canvas, x_coord, 0, GRID_LINE_WIDTH, MATRIX_SIZE, COLOR_GRID);
+        fill_image_rect(grid_image, MATRIX_SIZE, x_coord, 0, GRID_LINE_WIDTH, MATRIX_SIZE, COLOR_GRID);
     }
 
-    // Draw pieces
+    // Pieces fill their area; an empty cell is a dot in its middle, anything else stays background
+    const RGBColor piece_colors[CELL_SPRITE_COUNT] = {COLOR_RED, COLOR_BLUE, COLOR_BACKGROUND, COLOR_BLOCKED, COLOR_BACKGROUND};
+    for (int i = 0; i < CELL_SPRITE_COUNT; ++i)
+    {
+        fill_image_rect(cell_sprites[i], PIECE_RENDER_SIZE, 0, 0, PIECE_RENDER_SIZE, PIECE_RENDER_SIZE, piece_colors[i]);
+    }
+    int dot_size = 2;
+    int dot_start = (PIECE_RENDER_SIZE / 2) - (dot_size / 2);
+    fill_image_rect(cell_sprites[sprite_index('.')], PIECE_RENDER_SIZE, dot_start, dot_start, dot_size, dot_size, COLOR_EMPTY);
+    sprites_built = 1;
+}
+
+// Helper function to copy a 6x6 cell image into frame_image
+static void compose_cell(int r, int c, const struct Color *image)
+{
+    struct Color *row = frame_image + (r * CELL_SIZE + GRID_LINE_WIDTH) * MATRIX_SIZE + c * CELL_SIZE + GRID_LINE_WIDTH;
+    for (int y = 0; y < PIECE_RENDER_SIZE; ++y)
+    {
+        memcpy(row, image + y * PIECE_RENDER_SIZE, sizeof(struct Color) * PIECE_RENDER_SIZE);
+        row += MATRIX_SIZE;
+    }
+}
+
+// How a cell changes during a transition
+typedef enum
+{
+    CELL_STILL, // Shown as in the new board from the first keyframe on
+    CELL_FLIP,  // A piece changes colour: it narrows to an edge and widens again in the new colour
+    CELL_GROW,  // A piece appears (clone or jump target) and grows from the middle
+    CELL_SHRINK, // A piece leaves (jump source) and shrinks away
+    CELL_TRAIL  // The empty cell a jump passes over glows in the player's colour for the first half
+} CellTransition;
+
+typedef struct
+{
+    CellTransition kind;
+    char from; // Board character before
+    char to;   // Board character after
+} CellAnimation;
+
+// Helper function to check for a player's piece
+static int is_piece(char cell)
+{
+    return cell == 'R' || cell == 'B';
+}
+
+// Helper function to plan the transition between two boards; returns the number of animated cells
+static int plan_transition(const char from[BOARD_ROWS][BOARD_COLS + 1], const char to[BOARD_ROWS][BOARD_COLS + 1],
+                           CellAnimation plan[BOARD_ROWS][BOARD_COLS])
+{
+    int animated = 0;
     for (int r = 0; r < BOARD_ROWS; ++r)
     {
         for (int c = 0; c < BOARD_COLS; ++c)
         {
-            char piece_char = octaflip_board[r][c];
-            RGBColor piece_color;
+            CellAnimation *cell = &plan[r][c];
+            cell->from = from[r][c];
+            cell->to = to[r][c];
+            if (cell->from == cell->to)
+                cell->kind = CELL_STILL;
+            else if (is_piece(cell->from) && is_piece(cell->to))
+                cell->kind = CELL_FLIP;
+            else if (is_piece(cell->to))
+                cell->kind = CELL_GROW;
+            else if (is_piece(cell->from))
+                cell->kind = CELL_SHRINK;
+            else
+                cell->kind = CELL_STILL;
+            animated += cell->kind != CELL_STILL;
+        }
+    }
 
-            switch (piece_char)
+    // A jump leaves one cell and fills one two cells away; the empty cell between them gets a trail
+    for (int r = 0; r < BOARD_ROWS; ++r)
+    {
+        for (int c = 0; c < BOARD_COLS; ++c)
+        {
+            if (plan[r][c].kind != CELL_SHRINK)
+                continue;
+            for (int tr = r - 2; tr <= r + 2; tr += 2)
             {
-            case 'R':
-                piece_color = COLOR_RED;
-                break;
-            case 'B':
-                piece_color = COLOR_BLUE;
-                break;
-            case '.':
-                piece_color = COLOR_EMPTY;
-                break;
-            case '#':
-                piece_color = COLOR_BLOCKED;
-                break;
-            default:
-                piece_color = COLOR_BACKGROUND;
-                break;
+                for (int tc = c - 2; tc <= c + 2; tc += 2)
+                {
+                    if (tr < 0 || tr >= BOARD_ROWS || tc < 0 || tc >= BOARD_COLS || (tr == r && tc == c))
+                        continue;
+                    CellAnimation *mid = &plan[(r + tr) / 2][(c + tc) / 2];
+                    if (plan[tr][tc].kind == CELL_GROW && plan[tr][tc].to == plan[r][c].from &&
+                        mid->kind == CELL_STILL && mid->from == '.')
+                    {
+                        mid->kind = CELL_TRAIL;
+                        mid->to = plan[r][c].from; // Colour of the trail; the cell stays empty
+                        animated++;
+                    }
+                }
             }
+        }
+    }
+    return animated;
+}
 
-            int piece_x_start = c * CELL_SIZE + GRID_LINE_WIDTH;
-            int piece_y_start = r * CELL_SIZE + GRID_LINE_WIDTH;
-            int piece_render_size = CELL_SIZE - (2 * GRID_LINE_WIDTH);
-            if (piece_render_size < 1)
-                piece_render_size = 1;
+// Helper function to map a piece character to its colour
+static RGBColor piece_color(char piece_char)
+{
+    return piece_char == 'R' ? COLOR_RED : COLOR_BLUE;
+}
+
+// Helper function to draw keyframe 'frame' (1..ANIMATION_FRAMES - 1) of a cell's transition into a 6x6 image
+static void draw_transition_cell(const CellAnimation *cell, int frame, struct Color *image)
+{
+    int size;
+    switch (cell->kind)
+    {
+    case CELL_FLIP:
+        // Narrows to nothing at half time, then widens again in the new colour
+        size = PIECE_RENDER_SIZE * abs(ANIMATION_FRAMES - 2 * frame) / ANIMATION_FRAMES;
+        memcpy(image, cell_sprites[CELL_SPRITE_COUNT - 1], sizeof(cell_sprites[0])); // Background
+        fill_image_rect(image, PIECE_RENDER_SIZE, (PIECE_RENDER_SIZE - size) / 2, 0, size, PIECE_RENDER_SIZE,
+                        piece_color(2 * frame < ANIMATION_FRAMES ? cell->from : cell->to));
+        break;
+    case CELL_GROW:
+    case CELL_SHRINK:
+    {
+        int grow = cell->kind == CELL_GROW;
+        // Steps of two pixels keep it centred; a growing piece shows from the first keyframe on
+        if (grow)
+            size = 2 * ((PIECE_RENDER_SIZE / 2 * frame + ANIMATION_FRAMES - 1) / ANIMATION_FRAMES);
+        else
+            size = 2 * (PIECE_RENDER_SIZE / 2 * (ANIMATION_FRAMES - frame) / ANIMATION_FRAMES);
+        memcpy(image, cell_sprites[sprite_index(grow ? cell->from : cell->to)], sizeof(cell_sprites[0]));
+        fill_image_rect(image, PIECE_RENDER_SIZE, (PIECE_RENDER_SIZE - size) / 2, (PIECE_RENDER_SIZE - size) / 2, size, size,
+                        piece_color(grow ? cell->to : cell->from));
+        break;
+    }
+    case CELL_TRAIL:
+    {
+        memcpy(image, cell_sprites[sprite_index('.')], sizeof(cell_sprites[0]));
+        if (2 * frame <= ANIMATION_FRAMES)
+        {
+            RGBColor color = piece_color(cell->to);
+            RGBColor dim = {color.r / 3, color.g / 3, color.b / 3};
+            fill_image_rect(image, PIECE_RENDER_SIZE, 1, 1, PIECE_RENDER_SIZE - 2, PIECE_RENDER_SIZE - 2, dim);
+        }
+        break;
+    }
+    case CELL_STILL:
+        memcpy(image, cell_sprites[sprite_index(cell->to)], sizeof(cell_sprites[0]));
+        break;
+    }
+}
+
+// Helper function to draw a board into a pool canvas without showing it; returns the pixels written.
+// With a plan, cells in transition are drawn as keyframe 'frame' of it instead.
+static int draw_board_into(int index, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1],
+                           const CellAnimation plan[BOARD_ROWS][BOARD_COLS], int frame)
+{
+    CanvasContents *contents = &canvas_pool[index];
+    struct Color transition_image[PIECE_RENDER_SIZE * PIECE_RENDER_SIZE];
+    int full = !contents->valid;
+    int pixels = 0;
+
+    if (!sprites_built)
+        build_sprites();
+    if (full)
+        memcpy(frame_image, grid_image, sizeof(frame_image));
+
+    for (int r = 0; r < BOARD_ROWS; ++r)
+    {
+        for (int c = 0; c < BOARD_COLS; ++c)
+        {
+            const struct Color *image;
+            char shows = octaflip_board[r][c];
+            if (plan && plan[r][c].kind != CELL_STILL)
+            {
+                draw_transition_cell(&plan[r][c], frame, transition_image);
+                image = transition_image;
+                shows = CELL_UNKNOWN;
+            }
+            else if (!full && contents->board[r][c] == shows)
+            {
+                continue; // Already on this canvas
+            }
+            else
+            {
+                image = cell_sprites[sprite_index(shows)];
+            }
 
-            if (piece_char == 'R' || piece_char == 'B' || piece_char == '#')
+            if (full)
             {
-                draw_filled_rect(offscreen_canvas, piece_x_start, piece_y_start,
-                                 piece_render_size, piece_render_size, piece_color);
+                compose_cell(r, c, image);
             }
-            else if (piece_char == '.')
+            else
             {
-                int dot_size = 2;
-                int dot_x_start = piece_x_start + (piece_render_size / 2) - (dot_size / 2);
-                int dot_y_start = piece_y_start + (piece_render_size / 2) - (dot_size / 2);
-                draw_filled_rect(offscreen_canvas, dot_x_start, dot_y_start,
-                                 dot_size, dot_size, piece_color);
+                led_canvas_set_pixels(contents->canvas, c * CELL_SIZE + GRID_LINE_WIDTH, r * CELL_SIZE + GRID_LINE_WIDTH,
+                                      PIECE_RENDER_SIZE, PIECE_RENDER_SIZE, (struct Color *)image);
+                pixels += PIECE_RENDER_SIZE * PIECE_RENDER_SIZE;
             }
+            contents->board[r][c] = shows;
         }
     }
 
-    struct LedCanvas *previous_front_buffer = led_matrix_swap_on_vsync(matrix, offscreen_canvas);
-    if (previous_front_buffer)
+    if (full)
+    {
+        // Fresh canvas: the whole frame was composed in frame_image and is written at once
+        led_canvas_set_pixels(contents->canvas, 0, 0, MATRIX_SIZE, MATRIX_SIZE, frame_image);
+        pixels = MATRIX_SIZE * MATRIX_SIZE;
+        contents->valid = 1;
+    }
+    return pixels;
+}
+
+int render_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1])
+{
+    if (!matrix || !canvas_pool[0].canvas)
+        return 0;
+
+    int index = back_canvas();
+    int pixels = draw_board_into(index, octaflip_board, NULL, 0);
+    show_canvas(matrix, index);
+    memcpy(shown_board, octaflip_board, sizeof(shown_board));
+    shown_board_valid = 1;
+    return pixels;
+}
+
+// --- Render Thread ---
+// A latest-value mailbox: post_octaflip_board() only copies the board and returns, the render
+// thread draws the newest one and waits for vsync. Boards posted while it draws replace each
+// other, so a burst of updates costs one frame, and the poster never waits for the display.
+//
+// The render thread animates the change from the board on display to the posted one: all
+// keyframes are drawn into the canvas pool first, then swapped in ANIMATION_FRAME_MS apart.
+// A board posted during a transition cuts it short and is shown as is, without animation,
+// so the newest board is on display at most one keyframe interval plus one frame after it
+// was posted, and never more than (ANIMATION_FRAMES - 1) * ANIMATION_FRAME_MS plus one frame.
+
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_wake; // Initialised on CLOCK_MONOTONIC by start_board_renderer()
+static pthread_t render_thread;
+static int render_thread_running = 0;
+static int render_stopping = 0;
+static struct RGBLedMatrix *render_matrix = NULL;
+static char render_mailbox[BOARD_ROWS][BOARD_COLS + 1]; // Newest posted board
+static int render_mailbox_full = 0;
+
+// Helper function to wait until a keyframe is due; returns 1 if a newer board or a stop came first
+static int wait_for_keyframe(const struct timespec *due)
+{
+    int interrupted;
+    pthread_mutex_lock(&render_lock);
+    while (!render_mailbox_full && !render_stopping)
+    {
+        if (pthread_cond_timedwait(&render_wake, &render_lock, due) != 0)
+            break; // Timed out: the keyframe is due
+    }
+    interrupted = render_mailbox_full || render_stopping;
+    pthread_mutex_unlock(&render_lock);
+    return interrupted;
+}
+
+// Helper function to show a board, animated from the one on display when there is one
+static void present_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1])
+{
+    static int last_transition_cut = 0;
+    CellAnimation plan[BOARD_ROWS][BOARD_COLS];
+    int keyframe_canvas[ANIMATION_FRAMES];
+
+    // A board that cut the previous transition short is shown at once
+    if (!shown_board_valid || last_transition_cut || plan_transition(shown_board, octaflip_board, plan) == 0)
     {
-        led_canvas_clear(previous_front_buffer);
+        last_transition_cut = 0;
+        render_octaflip_board(matrix, octaflip_board);
+        return;
     }
+
+    // Draw every keyframe up front, into all canvases but the one on display; the last
+    // keyframe is the new board itself and goes into the canvas the static frames use
+    int next = 0;
+    keyframe_canvas[ANIMATION_FRAMES - 1] = back_canvas();
+    for (int i = 0; i < CANVAS_POOL_SIZE && next < ANIMATION_FRAMES - 1; ++i)
+    {
+        if (i != front_canvas && i != keyframe_canvas[ANIMATION_FRAMES - 1])
+            keyframe_canvas[next++] = i;
+    }
+    for (int frame = 1; frame < ANIMATION_FRAMES; ++frame)
+        draw_board_into(keyframe_canvas[frame - 1], octaflip_board, plan, frame);
+    draw_board_into(keyframe_canvas[ANIMATION_FRAMES - 1], octaflip_board, NULL, 0);
+
+    // Play them; the vsync wait in show_canvas() keeps each swap on a frame boundary
+    struct timespec due;
+    clock_gettime(CLOCK_MONOTONIC, &due);
+    for (int frame = 1; frame <= ANIMATION_FRAMES; ++frame)
+    {
+        if (frame > 1 && wait_for_keyframe(&due))
+        {
+            last_transition_cut = 1;
+            break;
+        }
+        show_canvas(matrix, keyframe_canvas[frame - 1]);
+        due.tv_nsec += ANIMATION_FRAME_MS * 1000000L;
+        if (due.tv_nsec >= 1000000000L)
+        {
+            due.tv_sec++;
+            due.tv_nsec -= 1000000000L;
+        }
+    }
+    memcpy(shown_board, octaflip_board, sizeof(shown_board));
+}
+
+static void *render_thread_main(void *arg)
+{
+    (void)arg;
+    char board[BOARD_ROWS][BOARD_COLS + 1];
+    pthread_mutex_lock(&render_lock);
+    while (1)
+    {
+        while (!render_mailbox_full && !render_stopping)
+        {
+            pthread_cond_wait(&render_wake, &render_lock);
+        }
+        if (render_stopping)
+        {
+            break;
+        }
+        memcpy(board, render_mailbox, sizeof(board));
+        render_mailbox_full = 0;
+        pthread_mutex_unlock(&render_lock);
+
+        present_board(render_matrix, board); // Blocks until the last frame is on display
+
+        pthread_mutex_lock(&render_lock);
+    }
+    pthread_mutex_unlock(&render_lock);
+    return NULL;
+}
+
+int start_board_renderer(struct RGBLedMatrix *matrix)
+{
+    pthread_condattr_t wake_attr;
+    if (!matrix || render_thread_running)
+        return -1;
+    render_matrix = matrix;
+    render_stopping = 0;
+    render_mailbox_full = 0;
+    pthread_condattr_init(&wake_attr);
+    pthread_condattr_setclock(&wake_attr, CLOCK_MONOTONIC); // Keyframe pacing ignores wall clock changes
+    pthread_cond_init(&render_wake, &wake_attr);
+    pthread_condattr_destroy(&wake_attr);
+    if (pthread_create(&render_thread, NULL, render_thread_main, NULL) != 0)
+    {
+        fprintf(stderr, "Error: Could not start the render thread, rendering inline.\n");
+        pthread_cond_destroy(&render_wake);
+        return -1;
+    }
+    render_thread_running = 1;
+    return 0;
+}
+
+void post_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1])
+{
+    if (!render_thread_running)
+    {
+        render_octaflip_board(matrix, octaflip_board);
+        return;
+    }
+    pthread_mutex_lock(&render_lock);
+    memcpy(render_mailbox, octaflip_board, sizeof(render_mailbox));
+    render_mailbox_full = 1;
+    pthread_cond_signal(&render_wake);
+    pthread_mutex_unlock(&render_lock);
+}
+
+void stop_board_renderer(void)
+{
+    if (!render_thread_running)
+        return;
+    pthread_mutex_lock(&render_lock);
+    render_stopping = 1;
+    pthread_cond_signal(&render_wake);
+    pthread_mutex_unlock(&render_lock);
+    pthread_join(render_thread, NULL); // Waits for at most the frame being drawn
+    pthread_cond_destroy(&render_wake);
+    render_thread_running = 0;
 }
 
 // Conditionally compile the main function for standalone testing
 #ifdef STANDALONE_BOARD_TEST
+// Resident set size of this process in kB, from /proc/self/status; -1 if unavailable
+static long resident_kb(void)
+{
+    FILE *status = fopen("/proc/self/status", "r");
+    char line[128];
+    long kb = -1;
+    if (!status)
+        return -1;
+    while (fgets(line, sizeof(line), status))
+    {
+        if (strncmp(line, "VmRSS:", 6) == 0)
+        {
+            kb = strtol(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return kb;
+}
+
+// Soak test: renders 'renders' changing boards and reports the resident memory every tenth of the way.
+// Memory must stay flat, since rendering reuses the canvas pool. Each render waits for a vsync.
+static int run_soak(struct RGBLedMatrix *matrix, long renders)
+{
+    char board[BOARD_ROWS][BOARD_COLS + 1];
+    const char cells[] = "RB.#";
+    long report_every = renders >= 10 ? renders / 10 : 1;
+    long start_kb = resident_kb();
+    long long pixels = 0;
+
+    for (int r = 0; r < BOARD_ROWS; ++r)
+    {
+        memset(board[r], '.', BOARD_COLS);
+        board[r][BOARD_COLS] = '\0';
+    }
+    printf("Soak: %ld renders, resident %ld kB at start\n", renders, start_kb);
+    for (long n = 1; n <= renders; ++n)
+    {
+        board[n % BOARD_ROWS][(n / BOARD_ROWS) % BOARD_COLS] = cells[(n / (BOARD_ROWS * BOARD_COLS)) % 4]; // One new cell per frame
+        pixels += render_octaflip_board(matrix, board);
+        if (n % report_every == 0)
+            printf("Soak: %ld renders, resident %ld kB\n", n, resident_kb());
+    }
+    long end_kb = resident_kb();
+    printf("Soak: resident memory grew by %ld kB over %ld renders\n", end_kb - start_kb, renders);
+    printf("Soak: %.1f pixels written per frame on average\n", (double)pixels / renders);
+    cleanup_matrix(matrix);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     char input_board[BOARD_ROWS][BOARD_COLS + 1]; // +1 for null terminator
@@ -189,6 +640,12 @@ int main(int argc, char *argv[])
         return 1; // Initialization failed
     }
 
+    // '-soak N' renders N boards instead of reading one (the matrix library has taken its options out of argv)
+    if (argc == 3 && strcmp(argv[1], "-soak") == 0)
+    {
+        return run_soak(matrix, atol(argv[2]) > 0 ? atol(argv[2]) : 100000);
+    }
+
     // 2. Read 8x8 board from stdin [cite: 24]
     //    Assignment 1 format: 8 lines of 8 characters each [cite: 24]
     printf("Enter 8x8 board configuration (8 lines, 8 chars each, e.g., R B . #):\n");
@@ -212,7 +669,7 @@ int main(int argc, char *argv[])
 
     // 3. Render the board
     printf("Rendering board...\n");
-    render_octaflip_board(matrix, input_board);
+    printf("%d pixels written.\n", render_octaflip_board(matrix, input_board));
 
     // 4. Keep display on for a bit (e.g., 10 seconds) or until key press
     printf("Displaying for 10 seconds. Press Ctrl+C to exit earlier.\n");
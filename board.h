@@ -34,11 +34,44 @@ struct RGBLedMatrix *initialize_matrix(int *argc, char ***argv);
 /**
  * @brief Renders the given 8x8 OctaFlip board state onto the LED matrix.
  *
+ * Only the cells that differ from what the drawn-into canvas already shows are redrawn;
+ * the first frames after initialization or a clear are drawn in full.
+ *
  * @param matrix The initialized RGBLedMatrix object.
  * @param octaflip_board A 2D char array representing the 8x8 OctaFlip board
  * (e.g., char board[BOARD_ROWS][BOARD_COLS+1], using 'R', 'B', '.', '#').
+ * @return The number of pixels written for this frame.
+ */
+int render_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1]);
+
+/**
+ * @brief Starts a thread that renders the boards given to post_octaflip_board().
+ *
+ * Rendering waits for the display's vsync; on this thread it no longer holds up the caller.
+ * cleanup_matrix() stops the thread.
+ *
+ * @param matrix The initialized RGBLedMatrix object.
+ * @return 0 on success, -1 if the thread could not be started (boards are then rendered inline).
+ */
+int start_board_renderer(struct RGBLedMatrix *matrix);
+
+/**
+ * @brief Hands a board to the render thread and returns without waiting for the display.
+ *
+ * Only the newest board is kept: one posted before the thread picked up the previous one
+ * replaces it. The thread animates the change from the board on display; a board posted
+ * during an animation cuts it short and is shown at once. Without a running render thread
+ * this renders inline like render_octaflip_board(), without animation.
+ *
+ * @param matrix The initialized RGBLedMatrix object.
+ * @param octaflip_board The 8x8 board, copied before returning.
+ */
+void post_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1]);
+
+/**
+ * @brief Stops the render thread after the frame it is drawing. Does nothing if none runs.
  */
-void render_octaflip_board(struct RGBLedMatrix *matrix, const char octaflip_board[BOARD_ROWS][BOARD_COLS + 1]);
+void stop_board_renderer(void);
 
 /**
  * @brief Clears the LED matrix display.
@@ -0,0 +1,66 @@
+#include "board_delta.h"
+#include <stdio.h>
+#include <string.h>
+
+uint64_t board_delta_diff(const char before[8][9], const char after[8][9])
+{
+    uint64_t changed = 0;
+    for (int cell = 0; cell < 64; cell++)
+    {
+        if (before[cell / 8][cell % 8] != after[cell / 8][cell % 8])
+            changed |= (uint64_t)1 << cell;
+    }
+    return changed;
+}
+
+void board_delta_format(const char board[8][9], uint64_t changed_cells, char *out)
+{
+    char *p = out;
+    while (changed_cells != 0)
+    {
+        int cell = __builtin_ctzll(changed_cells);
+        changed_cells &= changed_cells - 1;
+        *p++ = (char)('1' + cell / 8);
+        *p++ = (char)('1' + cell % 8);
+        *p++ = board[cell / 8][cell % 8];
+    }
+    *p = '\0';
+}
+
+static int is_cell_value(char c)
+{
+    return c == '.' || c == 'R' || c == 'B' || c == '#';
+}
+
+int board_delta_apply(char board[8][9], const char *changes)
+{
+    size_t len = strlen(changes);
+    if (len % 3 != 0 || len > BOARD_CHANGES_LEN - 1)
+        return -1;
+
+    // Checked in full first, so a malformed string leaves the board alone
+    for (size_t i = 0; i < len; i += 3)
+    {
+        if (changes[i] < '1' || changes[i] > '8' || changes[i + 1] < '1' || changes[i + 1] > '8' || !is_cell_value(changes[i + 2]))
+            return -1;
+    }
+    for (size_t i = 0; i < len; i += 3)
+    {
+        board[changes[i] - '1'][changes[i + 1] - '1'] = changes[i + 2];
+    }
+    return (int)(len / 3);
+}
+
+void board_delta_checksum(const char board[8][9], char *out)
+{
+    uint32_t hash = 2166136261u;
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            hash ^= (unsigned char)board[row][col];
+            hash *= 16777619u;
+        }
+    }
+    snprintf(out, BOARD_CHECKSUM_LEN, "%08x", (unsigned)hash);
+}
@@ -0,0 +1,48 @@
+#ifndef BOARD_DELTA_H
+#define BOARD_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental board updates ("board_updates":"delta"), shared by the server and the client.
+// Instead of all 8 rows, a message carries the cells that changed since the last board its
+// receiver was sent, as one string of 3-character groups: row and column (1-8, like moves)
+// followed by the new cell. "34R45B" means cell (3,4) is now 'R' and (4,5) is now 'B'.
+// Every few updates also carry a checksum of the whole board, so a receiver that applied
+// something wrong notices it.
+
+#define BOARD_CHANGES_LEN (64 * 3 + 1) // Every cell changed, and the NUL
+#define BOARD_CHECKSUM_LEN 9           // 8 hex digits and the NUL
+#define BOARD_UPDATES_DELTA "delta"
+#define BOARD_DELTA_CHECKSUM_INTERVAL 4  // Every 4th update carries a checksum
+#define BOARD_DELTA_KEYFRAME_INTERVAL 32 // and every 32nd the full board again
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Returns a mask with bit (row * 8 + col) set for each cell that differs.
+ */
+uint64_t board_delta_diff(const char before[8][9], const char after[8][9]);
+
+/**
+ * @brief Writes the cells in 'changed_cells' with their values in 'board' as a changes string.
+ *
+ * @param out At least BOARD_CHANGES_LEN bytes.
+ */
+void board_delta_format(const char board[8][9], uint64_t changed_cells, char *out);
+
+/**
+ * @brief Applies a changes string to a board.
+ *
+ * @return int Number of cells changed, or -1 if the string is malformed (board unchanged).
+ */
+int board_delta_apply(char board[8][9], const char *changes);
+
+/**
+ * @brief Writes the checksum of a board (FNV-1a over the 64 cells) as 8 hex digits.
+ *
+ * @param out At least BOARD_CHECKSUM_LEN bytes.
+ */
+void board_delta_checksum(const char board[8][9], char *out);
+
+#endif // BOARD_DELTA_H
@@ -45,6 +45,15 @@
 #include <ctype.h>
 #include <float.h>
 
+/* 16-byte vector scanning of strings and whitespace; CJSON_SCALAR_SCAN forces the byte loops */
+#if !defined(CJSON_SCALAR_SCAN) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CJSON_SCAN_SSE2
+#elif !defined(CJSON_SCALAR_SCAN) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CJSON_SCAN_NEON
+#endif
+
 #ifdef ENABLE_LOCALES
 #include <locale.h>
 #endif
@@ -303,6 +312,102 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+#ifdef CJSON_SCAN_REFERENCE
+/* json_fuzz: when set, parse with the original byte-by-byte loops to compare against */
+int cJSON_scan_reference = 0;
+#endif
+
+#if defined(CJSON_SCAN_NEON)
+/* bit 4*i of the result is set if byte i of the comparison result is set */
+static unsigned long long neon_byte_mask(uint8x16_t matches)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+}
+#endif
+
+/* number of bytes from start before the first '\"' or '\\', or end - start if there is none */
+static size_t scan_string_special(const unsigned char *start, const unsigned char *end)
+{
+    const unsigned char *pointer = start;
+#if defined(CJSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while ((end - pointer) >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)pointer);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return (size_t)(pointer - start) + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+        pointer += 16;
+    }
+#elif defined(CJSON_SCAN_NEON)
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    while ((end - pointer) >= 16)
+    {
+        uint8x16_t chunk = vld1q_u8(pointer);
+        unsigned long long mask = neon_byte_mask(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return (size_t)(pointer - start) + (size_t)(__builtin_ctzll(mask) >> 2);
+        }
+        pointer += 16;
+    }
+#endif
+    while ((pointer < end) && (*pointer != '\"') && (*pointer != '\\'))
+    {
+        pointer++;
+    }
+    return (size_t)(pointer - start);
+}
+
+/* number of bytes from start before the first one above 32 (cJSON's whitespace), or end - start if there is none */
+static size_t scan_whitespace(const unsigned char *start, const unsigned char *end)
+{
+    const unsigned char *pointer = start;
+    if ((pointer < end) && (*pointer > 32))
+    {
+        /* compact JSON has no whitespace at all */
+        return 0;
+    }
+#if defined(CJSON_SCAN_SSE2)
+    {
+        const __m128i space = _mm_set1_epi8(32);
+        while ((end - pointer) >= 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)pointer);
+            /* max(byte, 32) == 32 exactly for the (unsigned) whitespace bytes */
+            int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space)) & 0xFFFF;
+            if (mask != 0)
+            {
+                return (size_t)(pointer - start) + (size_t)__builtin_ctz((unsigned int)mask);
+            }
+            pointer += 16;
+        }
+    }
+#elif defined(CJSON_SCAN_NEON)
+    {
+        const uint8x16_t space = vdupq_n_u8(32);
+        while ((end - pointer) >= 16)
+        {
+            unsigned long long mask = neon_byte_mask(vcgtq_u8(vld1q_u8(pointer), space));
+            if (mask != 0)
+            {
+                return (size_t)(pointer - start) + (size_t)(__builtin_ctzll(mask) >> 2);
+            }
+            pointer += 16;
+        }
+    }
+#endif
+    while ((pointer < end) && (*pointer <= 32))
+    {
+        pointer++;
+    }
+    return (size_t)(pointer - start);
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -815,8 +920,9 @@ fail:
     return 0;
 }
 
-/* Parse the input text into an unescaped cinput, and populate item. */
-static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+#ifdef CJSON_SCAN_REFERENCE
+/* parse_string() as it was before the vector scanning, for json_fuzz */
+static cJSON_bool parse_string_reference(cJSON * const item, parse_buffer * const input_buffer)
 {
     const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
@@ -930,6 +1036,150 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
     return true;
 
+fail:
+    if (output != NULL)
+    {
+        input_buffer->hooks.deallocate(output);
+        output = NULL;
+    }
+
+    if (input_pointer != NULL)
+    {
+        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+    }
+
+    return false;
+}
+#endif
+
+/* Parse the input text into an unescaped cinput, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
+    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
+    unsigned char *output_pointer = NULL;
+    unsigned char *output = NULL;
+
+    const unsigned char *buffer_end = input_buffer->content + input_buffer->length;
+    size_t skipped_bytes = 0;
+
+#ifdef CJSON_SCAN_REFERENCE
+    if (cJSON_scan_reference)
+    {
+        return parse_string_reference(item, input_buffer);
+    }
+#endif
+
+    /* not a string */
+    if (buffer_at_offset(input_buffer)[0] != '\"')
+    {
+        goto fail;
+    }
+
+    {
+        /* calculate approximate size of the output (overestimate) */
+        size_t allocation_length = 0;
+        for (;;)
+        {
+            input_end += scan_string_special(input_end, buffer_end);
+            if ((input_end >= buffer_end) || (*input_end == '\"'))
+            {
+                break;
+            }
+            /* is escape sequence */
+            if ((input_end + 1) >= buffer_end)
+            {
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
+            }
+            skipped_bytes++;
+            input_end += 2;
+        }
+        if (input_end >= buffer_end)
+        {
+            goto fail; /* string ended unexpectedly */
+        }
+
+        /* This is at most how much we need for the output */
+        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (output == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+    }
+
+    output_pointer = output;
+    /* loop through the string literal */
+    while (input_pointer < input_end)
+    {
+        /* copy everything up to the next escape sequence at once */
+        const unsigned char *escape = (skipped_bytes == 0) ? NULL : (const unsigned char *)memchr(input_pointer, '\\', (size_t)(input_end - input_pointer));
+        size_t literal_length = (size_t)(((escape != NULL) ? escape : input_end) - input_pointer);
+        memcpy(output_pointer, input_pointer, literal_length);
+        output_pointer += literal_length;
+        input_pointer += literal_length;
+
+        /* escape sequence */
+        if (input_pointer < input_end)
+        {
+            unsigned char sequence_length = 2;
+            if ((input_end - input_pointer) < 1)
+            {
+                goto fail;
+            }
+
+            switch (input_pointer[1])
+            {
+                case 'b':
+                    *output_pointer++ = '\b';
+                    break;
+                case 'f':
+                    *output_pointer++ = '\f';
+                    break;
+                case 'n':
+                    *output_pointer++ = '\n';
+                    break;
+                case 'r':
+                    *output_pointer++ = '\r';
+                    break;
+                case 't':
+                    *output_pointer++ = '\t';
+                    break;
+                case '\"':
+                case '\\':
+                case '/':
+                    *output_pointer++ = input_pointer[1];
+                    break;
+
+                /* UTF-16 literal */
+                case 'u':
+                    sequence_length = utf16_literal_to_utf8(input_pointer, input_end, &output_pointer);
+                    if (sequence_length == 0)
+                    {
+                        /* failed to convert UTF16-literal to UTF-8 */
+                        goto fail;
+                    }
+                    break;
+
+                default:
+                    goto fail;
+            }
+            input_pointer += sequence_length;
+        }
+    }
+
+    /* zero terminate the output */
+    *output_pointer = '\0';
+
+    item->type = cJSON_String;
+    item->valuestring = (char*)output;
+
+    input_buffer->offset = (size_t) (input_end - input_buffer->content);
+    input_buffer->offset++;
+
+    return true;
+
 fail:
     if (output != NULL)
     {
@@ -1094,10 +1344,17 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+#ifdef CJSON_SCAN_REFERENCE
+    if (cJSON_scan_reference)
     {
-       buffer->offset++;
+        while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+        {
+           buffer->offset++;
+        }
     }
+    else
+#endif
+    buffer->offset += scan_whitespace(buffer_at_offset(buffer), buffer->content + buffer->length);
 
     if (buffer->offset == buffer->length)
     {
@@ -1229,6 +1486,501 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
     return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
 }
 
+/* states of a cJSON_Stream */
+enum
+{
+    stream_root = 0,     /* expecting the document's value */
+    stream_bom,          /* inside a UTF-8 byte order mark at the start of the line */
+    stream_value,        /* expecting a value after ':' or ',' */
+    stream_array_first,  /* after '[': a value or ']' */
+    stream_object_first, /* after '{': a name or '}' */
+    stream_name,         /* expecting a name after ',' in an object */
+    stream_colon,        /* expecting ':' after a name */
+    stream_after_value,  /* expecting ',' or the end of the innermost array or object */
+    stream_string,       /* inside a string (a name or a value) */
+    stream_number,       /* inside a number */
+    stream_literal,      /* inside null, true or false */
+    stream_trailing,     /* the document is complete, the rest of the line is ignored */
+    stream_skip          /* the line is invalid, skipping to its end */
+};
+
+CJSON_PUBLIC(void) cJSON_InitStream(cJSON_Stream * const stream, size_t max_length)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->state = stream_root;
+    stream->max_length = max_length;
+}
+
+/* forget the partial document and start over at the next byte */
+static void stream_restart(cJSON_Stream * const stream, int state)
+{
+    if (stream->root != NULL)
+    {
+        cJSON_Delete(stream->root);
+    }
+    stream->root = NULL;
+    stream->item = NULL;
+    stream->depth = 0;
+    stream->token_length = 0;
+    stream->escaped = false;
+    stream->state = state;
+}
+
+CJSON_PUBLIC(void) cJSON_ResetStream(cJSON_Stream * const stream)
+{
+    stream_restart(stream, stream_root);
+    stream->line_length = 0;
+    stream->has_bom = false;
+    stream->too_long = false;
+}
+
+CJSON_PUBLIC(void) cJSON_FreeStream(cJSON_Stream * const stream)
+{
+    cJSON_ResetStream(stream);
+    free(stream->stack);
+    free(stream->token);
+    stream->stack = NULL;
+    stream->stack_size = 0;
+    stream->token = NULL;
+    stream->token_size = 0;
+}
+
+/* keep the bytes of a token that goes on in the next feed */
+static cJSON_bool stream_carry(cJSON_Stream * const stream, const unsigned char *start, const unsigned char *end)
+{
+    size_t length = (size_t)(end - start);
+    if (length > (stream->token_size - stream->token_length))
+    {
+        size_t size = (stream->token_size != 0) ? stream->token_size : 64;
+        unsigned char *grown = NULL;
+        while ((size - stream->token_length) < length)
+        {
+            size *= 2;
+        }
+        grown = (unsigned char*)realloc(stream->token, size);
+        if (grown == NULL)
+        {
+            return false;
+        }
+        stream->token = grown;
+        stream->token_size = size;
+    }
+    if (length > 0)
+    {
+        memcpy(stream->token + stream->token_length, start, length);
+        stream->token_length += length;
+    }
+    return true;
+}
+
+/* the text of a finished token: in place, or the carried bytes followed by [start, end) */
+static cJSON_bool stream_token(cJSON_Stream * const stream, const unsigned char *start, const unsigned char *end, parse_buffer * const buffer)
+{
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->hooks = global_hooks;
+    if (stream->token_length == 0)
+    {
+        buffer->content = start;
+        buffer->length = (size_t)(end - start);
+        return true;
+    }
+    if (!stream_carry(stream, start, end))
+    {
+        return false;
+    }
+    buffer->content = stream->token;
+    buffer->length = stream->token_length;
+    stream->token_length = 0;
+    return true;
+}
+
+static void stream_value_done(cJSON_Stream * const stream)
+{
+    stream->item = NULL;
+    stream->state = (stream->depth == 0) ? stream_trailing : stream_after_value;
+}
+
+static void stream_append(cJSON * const container, cJSON * const item)
+{
+    if (container->child == NULL)
+    {
+        container->child = item;
+        item->prev = item;
+    }
+    else
+    {
+        cJSON *tail = container->child->prev;
+        tail->next = item;
+        item->prev = tail;
+        container->child->prev = item;
+    }
+}
+
+/* the item that receives the next value: the root, the member whose name was read, or a new array element */
+static cJSON *stream_begin_value(cJSON_Stream * const stream)
+{
+    if (stream->item != NULL)
+    {
+        return stream->item;
+    }
+    stream->item = cJSON_New_Item(&global_hooks);
+    if (stream->item == NULL)
+    {
+        return NULL;
+    }
+    if (stream->depth == 0)
+    {
+        stream->root = stream->item;
+    }
+    else
+    {
+        stream_append(stream->stack[stream->depth - 1], stream->item);
+    }
+    return stream->item;
+}
+
+static cJSON_bool stream_open(cJSON_Stream * const stream, int type)
+{
+    cJSON *item = NULL;
+    if (stream->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* too deeply nested */
+    }
+    if (stream->depth == stream->stack_size)
+    {
+        size_t size = (stream->stack_size != 0) ? (stream->stack_size * 2) : 16;
+        cJSON **grown = (cJSON**)realloc((void*)stream->stack, size * sizeof(cJSON*));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        stream->stack = grown;
+        stream->stack_size = size;
+    }
+    item = stream_begin_value(stream);
+    if (item == NULL)
+    {
+        return false;
+    }
+    item->type = type;
+    stream->stack[stream->depth++] = item;
+    stream->item = NULL;
+    stream->state = (type == cJSON_Array) ? stream_array_first : stream_object_first;
+    return true;
+}
+
+static void stream_close(cJSON_Stream * const stream)
+{
+    stream->depth--;
+    stream_value_done(stream);
+}
+
+static cJSON_bool stream_finish_string(cJSON_Stream * const stream, const unsigned char *start, const unsigned char *end)
+{
+    parse_buffer buffer;
+    cJSON *item = stream->item;
+    if (!stream_token(stream, start, end, &buffer) || !parse_string(item, &buffer))
+    {
+        return false;
+    }
+    if (stream->token_is_name)
+    {
+        /* swap valuestring and string, because we parsed the name */
+        item->string = item->valuestring;
+        item->valuestring = NULL;
+        stream->state = stream_colon;
+    }
+    else
+    {
+        stream_value_done(stream);
+    }
+    return true;
+}
+
+static cJSON_bool stream_finish_number(cJSON_Stream * const stream, const unsigned char *start, const unsigned char *end)
+{
+    parse_buffer buffer;
+    if (!stream_token(stream, start, end, &buffer) || !parse_number(stream->item, &buffer))
+    {
+        return false;
+    }
+    stream_value_done(stream);
+    /* what strtod() left of the token cannot follow a value inside an array or object */
+    return (buffer.offset == buffer.length) || (stream->state == stream_trailing);
+}
+
+static cJSON_bool stream_is_number_char(unsigned char c)
+{
+    return ((c >= '0') && (c <= '9')) || (c == '+') || (c == '-') || (c == 'e') || (c == 'E') || (c == '.');
+}
+
+/* parses [start, limit), a part of the current line without its '\n'; false if the line is invalid */
+static cJSON_bool stream_parse(cJSON_Stream * const stream, const unsigned char *start, const unsigned char * const limit)
+{
+    const unsigned char *pointer = start;
+    const unsigned char *token_start = start; /* a token that began in an earlier feed goes on here */
+    unsigned char c = 0;
+
+    while (pointer < limit)
+    {
+        switch (stream->state)
+        {
+            case stream_root:
+            case stream_value:
+            case stream_array_first:
+                pointer += scan_whitespace(pointer, limit);
+                if (pointer == limit)
+                {
+                    return true;
+                }
+                c = *pointer;
+                if ((stream->state == stream_array_first) && (c == ']'))
+                {
+                    pointer++;
+                    stream_close(stream);
+                }
+                else if ((stream->state == stream_root) && (c == 0xEF) && (pointer == start) && (stream->line_length == 0))
+                {
+                    stream->literal = "\xEF\xBB\xBF";
+                    stream->literal_matched = 0;
+                    stream->state = stream_bom;
+                }
+                else if ((c == '[') || (c == '{'))
+                {
+                    pointer++;
+                    if (!stream_open(stream, (c == '[') ? cJSON_Array : cJSON_Object))
+                    {
+                        return false;
+                    }
+                }
+                else if ((c == '\"') || (c == '-') || ((c >= '0') && (c <= '9')))
+                {
+                    if (stream_begin_value(stream) == NULL)
+                    {
+                        return false;
+                    }
+                    token_start = pointer++;
+                    stream->token_is_name = false;
+                    stream->state = (c == '\"') ? stream_string : stream_number;
+                }
+                else if ((c == 'n') || (c == 't') || (c == 'f'))
+                {
+                    if (stream_begin_value(stream) == NULL)
+                    {
+                        return false;
+                    }
+                    stream->literal = (c == 'n') ? "null" : ((c == 't') ? "true" : "false");
+                    stream->literal_matched = 0;
+                    stream->state = stream_literal;
+                }
+                else
+                {
+                    return false;
+                }
+                break;
+
+            case stream_object_first:
+            case stream_name:
+                pointer += scan_whitespace(pointer, limit);
+                if (pointer == limit)
+                {
+                    return true;
+                }
+                if ((stream->state == stream_object_first) && (*pointer == '}'))
+                {
+                    pointer++;
+                    stream_close(stream);
+                    break;
+                }
+                if (*pointer != '\"')
+                {
+                    return false; /* failed to parse name */
+                }
+                stream->item = cJSON_New_Item(&global_hooks);
+                if (stream->item == NULL)
+                {
+                    return false;
+                }
+                stream_append(stream->stack[stream->depth - 1], stream->item);
+                token_start = pointer++;
+                stream->token_is_name = true;
+                stream->state = stream_string;
+                break;
+
+            case stream_colon:
+                pointer += scan_whitespace(pointer, limit);
+                if (pointer == limit)
+                {
+                    return true;
+                }
+                if (*pointer++ != ':')
+                {
+                    return false; /* invalid object */
+                }
+                stream->state = stream_value;
+                break;
+
+            case stream_after_value:
+                pointer += scan_whitespace(pointer, limit);
+                if (pointer == limit)
+                {
+                    return true;
+                }
+                c = *pointer++;
+                if (c == ',')
+                {
+                    stream->state = (stream->stack[stream->depth - 1]->type == cJSON_Array) ? stream_value : stream_name;
+                }
+                else if (c == ((stream->stack[stream->depth - 1]->type == cJSON_Array) ? ']' : '}'))
+                {
+                    stream_close(stream);
+                }
+                else
+                {
+                    return false; /* expected end of array or object */
+                }
+                break;
+
+            case stream_string:
+            {
+                const unsigned char *scan = pointer;
+                if (stream->escaped)
+                {
+                    /* the byte after a backslash that ended the last feed */
+                    stream->escaped = false;
+                    scan++;
+                }
+                for (;;)
+                {
+                    scan += scan_string_special(scan, limit);
+                    if ((scan == limit) || (*scan == '\"'))
+                    {
+                        break;
+                    }
+                    /* escape sequence */
+                    if ((scan + 1) == limit)
+                    {
+                        stream->escaped = true;
+                        scan = limit;
+                        break;
+                    }
+                    scan += 2;
+                }
+                if (scan == limit)
+                {
+                    pointer = limit;
+                    break;
+                }
+                pointer = scan + 1;
+                if (!stream_finish_string(stream, token_start, pointer))
+                {
+                    return false;
+                }
+                break;
+            }
+
+            case stream_number:
+                while ((pointer < limit) && stream_is_number_char(*pointer))
+                {
+                    pointer++;
+                }
+                if (pointer == limit)
+                {
+                    break;
+                }
+                /* the byte after the number is read in the next state */
+                if (!stream_finish_number(stream, token_start, pointer))
+                {
+                    return false;
+                }
+                break;
+
+            case stream_literal:
+            case stream_bom:
+                while ((pointer < limit) && (stream->literal[stream->literal_matched] != '\0'))
+                {
+                    if (*pointer++ != (unsigned char)stream->literal[stream->literal_matched++])
+                    {
+                        return false;
+                    }
+                }
+                if (stream->literal[stream->literal_matched] != '\0')
+                {
+                    return true;
+                }
+                if (stream->state == stream_bom)
+                {
+                    stream->has_bom = true;
+                    stream->state = stream_root;
+                }
+                else
+                {
+                    stream->item->type = (stream->literal[0] == 'n') ? cJSON_NULL : ((stream->literal[0] == 't') ? cJSON_True : cJSON_False);
+                    stream->item->valueint = (stream->literal[0] == 't') ? 1 : 0;
+                    stream_value_done(stream);
+                }
+                break;
+
+            default: /* stream_trailing, stream_skip */
+                return true;
+        }
+    }
+    if ((stream->state == stream_string) || (stream->state == stream_number))
+    {
+        /* the token goes on in the next feed */
+        return stream_carry(stream, token_start, limit);
+    }
+    return true;
+}
+
+/* the '\n' of the current line was reached */
+static int stream_end_line(cJSON_Stream * const stream, cJSON **document)
+{
+    int result = stream->too_long ? cJSON_StreamTooLong : cJSON_StreamInvalid;
+
+    if ((stream->state == stream_number) && !stream_finish_number(stream, NULL, NULL))
+    {
+        stream_restart(stream, stream_skip);
+    }
+    /* a byte order mark is only skipped in lines of at least five bytes */
+    if ((stream->state == stream_trailing) && !(stream->has_bom && (stream->line_length < 5)))
+    {
+        *document = stream->root;
+        stream->root = NULL;
+        result = cJSON_StreamDocument;
+    }
+    cJSON_ResetStream(stream);
+    return result;
+}
+
+CJSON_PUBLIC(int) cJSON_StreamFeed(cJSON_Stream * const stream, const char *data, size_t length, size_t *consumed, cJSON **document)
+{
+    const unsigned char *start = (const unsigned char*)data;
+    const unsigned char *newline = (const unsigned char*)memchr(data, '\n', length);
+    const unsigned char *limit = (newline != NULL) ? newline : (start + length);
+    size_t line_part = (size_t)(limit - start);
+
+    *document = NULL;
+    *consumed = (newline != NULL) ? (line_part + 1) : length;
+
+    if (!stream->too_long && (stream->max_length != 0) && (line_part > (stream->max_length - stream->line_length)))
+    {
+        stream->too_long = true;
+        stream_restart(stream, stream_skip);
+    }
+    if ((stream->state != stream_skip) && !stream_parse(stream, start, limit))
+    {
+        stream_restart(stream, stream_skip);
+    }
+    stream->line_length += line_part;
+
+    if (newline == NULL)
+    {
+        return cJSON_StreamIncomplete;
+    }
+    return stream_end_line(stream, document);
+}
+
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
@@ -1975,6 +2727,102 @@ CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const objec
     return get_object_item(object, string, true);
 }
 
+/* FNV-1a over a key; collisions only cost a strcmp */
+static unsigned int object_key_hash(const char *key)
+{
+    const unsigned char *byte = (const unsigned char*)key;
+    unsigned int hash = 2166136261u;
+
+    while (*byte != '\0')
+    {
+        hash = (hash ^ *byte) * 16777619u;
+        byte++;
+    }
+
+    return hash;
+}
+
+/* names looked up per walk; up to GET_OBJECT_ITEMS_SHORT of them are compared directly, more are hashed first */
+#define GET_OBJECT_ITEMS_CHUNK 32
+#define GET_OBJECT_ITEMS_SHORT 8
+
+CJSON_PUBLIC(size_t) cJSON_GetObjectItemsCaseSensitive(const cJSON * const object, const char * const * const names, cJSON ** const items, const size_t count)
+{
+    unsigned int hashes[GET_OBJECT_ITEMS_CHUNK];
+    size_t pending[GET_OBJECT_ITEMS_CHUNK];
+    size_t found = 0;
+    size_t first = 0;
+
+    if ((names == NULL) || (items == NULL))
+    {
+        return 0;
+    }
+
+    for (first = 0; first < count; first++)
+    {
+        items[first] = NULL;
+    }
+    if (object == NULL)
+    {
+        return 0;
+    }
+
+    for (first = 0; first < count; first += GET_OBJECT_ITEMS_CHUNK)
+    {
+        size_t chunk = count - first;
+        size_t missing = 0;
+        size_t i = 0;
+        cJSON_bool hashed = false;
+        cJSON *current_element = NULL;
+
+        if (chunk > GET_OBJECT_ITEMS_CHUNK)
+        {
+            chunk = GET_OBJECT_ITEMS_CHUNK;
+        }
+        hashed = chunk > GET_OBJECT_ITEMS_SHORT;
+        for (i = 0; i < chunk; i++)
+        {
+            if (names[first + i] != NULL)
+            {
+                pending[missing] = first + i;
+                if (hashed)
+                {
+                    hashes[missing] = object_key_hash(names[first + i]);
+                }
+                missing++;
+            }
+        }
+
+        /* like cJSON_GetObjectItemCaseSensitive(), the first member of a name wins and a member without a name ends the walk */
+        for (current_element = object->child; (current_element != NULL) && (current_element->string != NULL) && (missing > 0); current_element = current_element->next)
+        {
+            unsigned int hash = hashed ? object_key_hash(current_element->string) : 0;
+            i = 0;
+            while (i < missing)
+            {
+                if ((hashed ? (hashes[i] == hash) : (names[pending[i]][0] == current_element->string[0])) && (strcmp(names[pending[i]], current_element->string) == 0))
+                {
+                    /* found names leave the pending list, so later members are compared against fewer */
+                    items[pending[i]] = current_element;
+                    found++;
+                    missing--;
+                    pending[i] = pending[missing];
+                    if (hashed)
+                    {
+                        hashes[i] = hashes[missing];
+                    }
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string)
 {
     return cJSON_GetObjectItem(object, string) ? 1 : 0;
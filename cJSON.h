@@ -158,6 +158,47 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Incremental parsing of newline-delimited documents: feed the bytes as they arrive and
+ * get each document when its '\n' is fed. The result for a line is the same as that of
+ * cJSON_ParseWithLength() on it, but the line is read once and never needs to be kept whole.
+ * Nodes are allocated with the hooks in effect while feeding; a partial document stays
+ * allocated between feeds. The stack of open containers and the bytes of a string or number
+ * split between two feeds are kept in buffers of the stream itself (stdlib malloc). */
+typedef struct cJSON_Stream
+{
+    cJSON *root;          /* document being built */
+    cJSON *item;          /* item whose name or value is being read */
+    cJSON **stack;        /* open arrays and objects, innermost last */
+    size_t depth;
+    size_t stack_size;
+    unsigned char *token; /* string or number split between two feeds */
+    size_t token_length;
+    size_t token_size;
+    const char *literal;  /* null, true or false (or a byte order mark) being matched */
+    size_t literal_matched;
+    size_t line_length;   /* bytes of the current line so far, without its '\n' */
+    size_t max_length;    /* longer lines are rejected; 0 for no limit */
+    int state;
+    cJSON_bool token_is_name;
+    cJSON_bool escaped;   /* the last feed ended on a backslash inside a string */
+    cJSON_bool has_bom;
+    cJSON_bool too_long;
+} cJSON_Stream;
+
+/* Results of cJSON_StreamFeed() */
+#define cJSON_StreamIncomplete 0 /* every byte was consumed and the line goes on */
+#define cJSON_StreamDocument 1   /* a line ended with a document, returned in *document */
+#define cJSON_StreamInvalid 2    /* a line ended that does not start with a JSON value */
+#define cJSON_StreamTooLong 3    /* a line ended that was longer than max_length */
+
+CJSON_PUBLIC(void) cJSON_InitStream(cJSON_Stream * const stream, size_t max_length);
+/* Consumes bytes up to and including the first '\n' (all of them if there is none); *consumed tells how many. */
+CJSON_PUBLIC(int) cJSON_StreamFeed(cJSON_Stream * const stream, const char *data, size_t length, size_t *consumed, cJSON **document);
+/* Drops a partial line, e.g. after the connection was lost. */
+CJSON_PUBLIC(void) cJSON_ResetStream(cJSON_Stream * const stream);
+/* Drops a partial line and releases the stream's buffers. */
+CJSON_PUBLIC(void) cJSON_FreeStream(cJSON_Stream * const stream);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -177,6 +218,9 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 /* Get item "string" from object. Case insensitive. */
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
+/* Looks up "count" names in one walk over the object: items[i] receives the member called names[i], or NULL.
+ * Same matching as cJSON_GetObjectItemCaseSensitive(). Returns how many names were found. */
+CJSON_PUBLIC(size_t) cJSON_GetObjectItemsCaseSensitive(const cJSON * const object, const char * const * const names, cJSON ** const items, const size_t count);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
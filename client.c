@@ -6,18 +6,42 @@
 #include <netdb.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "protocol.h"
 #include "cJSON.h"
 #include "board.h" // Added for LED matrix control
-
-#define BUFFER_SIZE 2048
-#define CLIENT_RECV_BUFFER_MAX_LEN (BUFFER_SIZE * 2)
+#include "line_framer.h"
+#include "wire_protocol.h"
+#include "board_delta.h"
+#include "json_arena.h"
+
+#define CLIENT_RECV_BUFFER_MAX_LEN LINE_FRAMER_CAPACITY // Longer messages are dropped, not fatal
+#define RECONNECT_WINDOW_MS 10000      // Keep trying to get back in for this long (the server keeps the seat longer)
+#define RECONNECT_FIRST_DELAY_MS 100   // Doubled after every failed attempt
+#define RECONNECT_MAX_DELAY_MS 1000
+#define SEARCH_MAX_DEPTH 3              // Deepest iteration of the search thread
+#define SEARCH_DEADLINE_MARGIN_MS 500   // A move goes out this long before the server's turn clock runs out
+#define SEARCH_DEFAULT_TIMEOUT_MS 5000  // Turn time assumed when 'your_turn' carries none
 
 char client_username[MAX_USERNAME_LEN];
 char my_player_symbol = ' ';
-char client_recv_buffer[CLIENT_RECV_BUFFER_MAX_LEN];
-int client_recv_buffer_len = 0;
+char client_session_token[SESSION_TOKEN_LEN]; // From 'register_ack', empty until registered
+int game_in_progress = 0;                     // Set from 'game_start' (or 'resume_ack') until 'game_over'
+char game_players[2][MAX_USERNAME_LEN];       // Seat order ('R' first), names the seats of binary frames
+int wire_binary_requested = 0;                // -binary: ask for the frames of wire_protocol.h
+WireFormat client_wire_format = WIRE_FORMAT_JSON; // Switched by the server's 'register_ack' / 'resume_ack'
+int delta_updates_requested = 0;              // -delta: ask for changed cells instead of full boards
+char client_board[8][9];                      // Last board received, the base of the next delta
+int client_board_known = 0;
+LineFramer client_recv_framer;
+cJSON_Stream client_json_stream;              // JSON lines are parsed as their bytes arrive
+int client_stream_arena_open = 0;             // A line is being parsed into the JSON arena
 
 static struct RGBLedMatrix *matrix_ptr = NULL; // Pointer for the LED matrix
 
@@ -104,8 +128,11 @@ int is_valid_move(int sx, int sy, int tx, int ty)
     return 0;
 }
 
-int negamax(char grid[BOARD_ROWS][BOARD_COLS + 1], char color, int depth, MoveCoords *best_move)
+// 'stop' (may be NULL) abandons the search once set; the result is meaningless then
+int negamax(char grid[BOARD_ROWS][BOARD_COLS + 1], char color, int depth, MoveCoords *best_move, _Atomic int *stop)
 { // grid is 0-indexed
+    if (stop && atomic_load_explicit(stop, memory_order_relaxed))
+        return 0;
     if (depth == 0)
         return evaluate_board(grid, color); // Pass 0-indexed grid
     int best_score = -10000;                // A very small number
@@ -141,7 +168,7 @@ int negamax(char grid[BOARD_ROWS][BOARD_COLS + 1], char color, int depth, MoveCo
                     clone_grid(grid, new_grid);                      // Use 0-indexed clone
                     apply_move(new_grid, r_s, c_s, r_t, c_t, color); // Use 0-indexed apply
 
-                    int score = -negamax(new_grid, opp_color, depth - 1, NULL); // Recursive call for opponent
+                    int score = -negamax(new_grid, opp_color, depth - 1, NULL, stop); // Recursive call for opponent
 
                     if (score > best_score)
                     {
@@ -162,12 +189,12 @@ int negamax(char grid[BOARD_ROWS][BOARD_COLS + 1], char color, int depth, MoveCo
 }
 
 // Automated Move Generation Function
-MoveCoords move_generate(char current_board[BOARD_ROWS][BOARD_COLS + 1], char player_symbol)
+MoveCoords move_generate(char current_board[BOARD_ROWS][BOARD_COLS + 1], char player_symbol, int depth)
 {
     MoveCoords move = {0, 0, 0, 0}; // Initialize (consider if a "no move" state is needed)
 
     // negamax works with 0-indexed board and fills 'move' with 0-indexed coordinates
-    negamax(current_board, player_symbol, 3, &move);
+    negamax(current_board, player_symbol, depth, &move, NULL);
 
     // Convert 0-indexed coordinates from negamax to 1-indexed for the game protocol/output
     move.sx += 1;
@@ -178,33 +205,197 @@ MoveCoords move_generate(char current_board[BOARD_ROWS][BOARD_COLS + 1], char pl
     return move;
 }
 
+// --- Search Thread ---
+// The I/O thread posts a job per 'your_turn' and keeps reading the socket. The search thread
+// deepens one ply at a time and keeps the move of the deepest finished iteration; a job is
+// cancelled (its running search stops at the next node) by a newer job or search_cancel().
+
+static pthread_mutex_t search_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t search_wake = PTHREAD_COND_INITIALIZER;
+static unsigned search_job_id = 0;                // Current job; results of older jobs are discarded
+static int search_job_waiting = 0;                // The current job has not been picked up yet
+static char search_board[BOARD_ROWS][BOARD_COLS + 1];
+static char search_symbol;
+static MoveCoords search_best;                    // 1-indexed move of the deepest finished iteration...
+static int search_best_depth = 0;                 // ...of job search_best_job (0: none yet)
+static unsigned search_best_job = 0;
+static unsigned search_done_job = 0;              // Last job searched to SEARCH_MAX_DEPTH
+static _Atomic int search_stop;
+static int search_notify_fds[2] = {-1, -1};       // Written when a job is done, read by the select() loop
+
+static void *search_thread_main(void *arg)
+{
+    (void)arg;
+    char board[BOARD_ROWS][BOARD_COLS + 1];
+    pthread_mutex_lock(&search_lock);
+    while (1)
+    {
+        while (!search_job_waiting)
+        {
+            pthread_cond_wait(&search_wake, &search_lock);
+        }
+        unsigned job = search_job_id;
+        char symbol = search_symbol;
+        clone_grid(search_board, board);
+        search_job_waiting = 0;
+        atomic_store(&search_stop, 0);
+        pthread_mutex_unlock(&search_lock);
+
+        for (int depth = 1; depth <= SEARCH_MAX_DEPTH; depth++)
+        {
+            MoveCoords move = {0, 0, 0, 0};
+            int score = negamax(board, symbol, depth, &move, &search_stop);
+            if (atomic_load(&search_stop))
+            {
+                break;
+            }
+            pthread_mutex_lock(&search_lock);
+            if (job == search_job_id)
+            {
+                search_best = (MoveCoords){move.sx + 1, move.sy + 1, move.tx + 1, move.ty + 1};
+                search_best_depth = depth;
+                search_best_job = job;
+            }
+            pthread_mutex_unlock(&search_lock);
+            if (depth == 1 && score == -10000)
+            {
+                break; // No move at all, deeper searches find none either
+            }
+        }
+
+        pthread_mutex_lock(&search_lock);
+        if (job == search_job_id && !atomic_load(&search_stop))
+        {
+            search_done_job = job;
+            if (write(search_notify_fds[1], "", 1) == -1 && errno != EAGAIN)
+            {
+                perror("write search notification");
+            }
+        }
+    }
+    return NULL;
+}
+
+// Function to start the search thread; returns -1 on failure
+int search_start(void)
+{
+    if (pipe(search_notify_fds) == -1)
+    {
+        perror("pipe");
+        return -1;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(search_notify_fds[i], F_SETFL, fcntl(search_notify_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(search_notify_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, search_thread_main, NULL) != 0)
+    {
+        fprintf(stderr, "Could not start the search thread.\n");
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+// Function to hand a board to the search thread, replacing any job still running; returns the job id
+unsigned search_post(char board[BOARD_ROWS][BOARD_COLS + 1], char player_symbol)
+{
+    pthread_mutex_lock(&search_lock);
+    unsigned job = ++search_job_id;
+    clone_grid(board, search_board);
+    search_symbol = player_symbol;
+    search_job_waiting = 1;
+    atomic_store(&search_stop, 1);
+    pthread_cond_signal(&search_wake);
+    pthread_mutex_unlock(&search_lock);
+    return job;
+}
+
+// Function to stop the current job; nothing it found is reported any more
+void search_cancel(void)
+{
+    pthread_mutex_lock(&search_lock);
+    search_job_id++;
+    search_job_waiting = 0;
+    atomic_store(&search_stop, 1);
+    pthread_mutex_unlock(&search_lock);
+}
+
+// Function to read the best move found for a job so far; returns its depth, 0 if there is none yet.
+// *done is set once the job was searched to SEARCH_MAX_DEPTH.
+int search_result(unsigned job, MoveCoords *move, int *done)
+{
+    pthread_mutex_lock(&search_lock);
+    int depth = search_best_job == job ? search_best_depth : 0;
+    if (depth > 0)
+    {
+        *move = search_best;
+    }
+    *done = search_done_job == job;
+    pthread_mutex_unlock(&search_lock);
+    return depth;
+}
+
+// Function to empty the notification pipe; results are then read with search_result()
+void search_drain_notifications(void)
+{
+    char drained[64];
+    while (read(search_notify_fds[0], drained, sizeof(drained)) > 0)
+    {
+    }
+}
+
 // JSON Utility Function Implementations (Client-side)
 
-// Helper function to get message type from JSON
-char *get_message_type_from_json(const char *json_string)
+// Helper function to release a message from parse_message_with_type() together with its arena
+void release_message(cJSON *message)
+{
+    cJSON_Delete(message);
+    json_arena_end();
+}
+
+// Helper function to identify the type of a parsed message; *out_type_str points into it.
+// Returns 0, or -1 if the message has no string 'type'.
+int identify_message(const cJSON *root, MessageType *out_type, const char **out_type_str)
 {
-    cJSON *root = cJSON_Parse(json_string);
+    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
+    if (!cJSON_IsString(type_json) || (type_json->valuestring == NULL))
+    {
+        fprintf(stderr, "Error: JSON message does not have a valid 'type' field.\n");
+        return -1;
+    }
+
+    *out_type = message_type_from_string(type_json->valuestring);
+    *out_type_str = type_json->valuestring;
+    return 0;
+}
+
+// Helper function to parse a message once and identify its type.
+// The returned tree must be released with release_message(); *out_type_str points into it.
+// Until then everything cJSON allocates, the reply included, comes from the JSON arena.
+cJSON *parse_message_with_type(const char *json_string, size_t json_len, MessageType *out_type, const char **out_type_str)
+{
+    json_arena_begin();
+    cJSON *root = cJSON_ParseWithLength(json_string, json_len);
     if (root == NULL)
     {
         const char *error_ptr = cJSON_GetErrorPtr();
         if (error_ptr != NULL)
         {
-            fprintf(stderr, "Error parsing JSON before: %s\n", error_ptr);
+            fprintf(stderr, "Error parsing JSON before: %.*s\n", (int)(json_len - (error_ptr - json_string)), error_ptr);
         }
+        json_arena_end();
         return NULL;
     }
 
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || (type_json->valuestring == NULL))
+    if (identify_message(root, out_type, out_type_str) != 0)
     {
-        fprintf(stderr, "Error: JSON message does not have a valid 'type' field.\n");
-        cJSON_Delete(root);
+        release_message(root);
         return NULL;
     }
-
-    char *type_str = strdup(type_json->valuestring);
-    cJSON_Delete(root);
-    return type_str;
+    return root;
 }
 
 // Serialization for ClientRegisterPayload
@@ -224,77 +415,214 @@ char *serialize_client_register(const ClientRegisterPayload *payload)
         cJSON_Delete(root);
         return NULL;
     }
+    if ((payload->wire[0] != '\0' && cJSON_AddStringToObject(root, "wire", payload->wire) == NULL) ||
+        (payload->board_updates[0] != '\0' && cJSON_AddStringToObject(root, "board_updates", payload->board_updates) == NULL))
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
 
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     return json_string;
 }
 
-// Deserialization for ServerRegisterAckPayload
-int deserialize_server_register_ack(const char *json_string, ServerRegisterAckPayload *out_payload)
+// Reads an optional string option of 'register_ack' and 'resume_ack' ("wire", "board_updates"); absent reads as ""
+static void deserialize_optional_option(const cJSON *root, const char *name, char *out, size_t out_size)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
+    cJSON *option_json = cJSON_GetObjectItemCaseSensitive(root, name);
+    out[0] = '\0';
+    if (cJSON_IsString(option_json) && (option_json->valuestring != NULL))
+    {
+        strncpy(out, option_json->valuestring, out_size - 1);
+        out[out_size - 1] = '\0';
+    }
+}
 
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "register_ack") != 0)
+// Reads a board sent as an array of 8 row strings
+static int deserialize_board_rows(const cJSON *board_json, char board[8][9])
+{
+    if (!cJSON_IsArray(board_json) || cJSON_GetArraySize(board_json) != 8)
     {
-        cJSON_Delete(root);
         return -1;
     }
+    for (int i = 0; i < 8; ++i)
+    {
+        cJSON *row_json = cJSON_GetArrayItem(board_json, i);
+        if (!cJSON_IsString(row_json) || (row_json->valuestring == NULL))
+        {
+            return -1;
+        }
+        strncpy(board[i], row_json->valuestring, 8);
+        board[i][8] = '\0';
+    }
+    return 0;
+}
+
+// Reads the board of a turn message: all rows, or with "board_updates":"delta" the changed
+// cells applied to the last board received. The result becomes the base of the next delta.
+static int deserialize_turn_board(const cJSON *root, char board[8][9])
+{
+    cJSON *board_json = cJSON_GetObjectItemCaseSensitive(root, "board");
+    if (board_json != NULL)
+    {
+        if (deserialize_board_rows(board_json, board) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        cJSON *changes_json = cJSON_GetObjectItemCaseSensitive(root, "changes");
+        if (!cJSON_IsString(changes_json) || (changes_json->valuestring == NULL) || !client_board_known)
+        {
+            return -1;
+        }
+        memcpy(board, client_board, sizeof(client_board));
+        if (board_delta_apply(board, changes_json->valuestring) < 0)
+        {
+            return -1;
+        }
+
+        cJSON *checksum_json = cJSON_GetObjectItemCaseSensitive(root, "checksum");
+        if (cJSON_IsString(checksum_json) && (checksum_json->valuestring != NULL))
+        {
+            char checksum[BOARD_CHECKSUM_LEN];
+            board_delta_checksum((const char(*)[9])board, checksum);
+            if (strcmp(checksum, checksum_json->valuestring) != 0)
+            {
+                fprintf(stderr, "Board checksum mismatch; waiting for the next full board.\n");
+                client_board_known = 0;
+                return -1;
+            }
+        }
+    }
+    memcpy(client_board, board, sizeof(client_board));
+    client_board_known = 1;
+    return 0;
+}
+
+// Deserialization for ServerRegisterAckPayload from an already parsed message
+int deserialize_server_register_ack(const cJSON *root, ServerRegisterAckPayload *out_payload)
+{
     strcpy(out_payload->type, "register_ack");
-    cJSON_Delete(root);
+
+    // Optional: servers without session resume do not send a token
+    out_payload->session_token[0] = '\0';
+    cJSON *token_json = cJSON_GetObjectItemCaseSensitive(root, "session_token");
+    if (cJSON_IsString(token_json) && (token_json->valuestring != NULL))
+    {
+        strncpy(out_payload->session_token, token_json->valuestring, SESSION_TOKEN_LEN - 1);
+        out_payload->session_token[SESSION_TOKEN_LEN - 1] = '\0';
+    }
+    deserialize_optional_option(root, "wire", out_payload->wire, sizeof(out_payload->wire));
+    deserialize_optional_option(root, "board_updates", out_payload->board_updates, sizeof(out_payload->board_updates));
     return 0;
 }
 
-// Deserialization for ServerRegisterNackPayload
-int deserialize_server_register_nack(const char *json_string, ServerRegisterNackPayload *out_payload)
+// Serialization for ClientResumePayload
+char *serialize_client_resume(const ClientResumePayload *payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
+    cJSON *root = cJSON_CreateObject();
     if (root == NULL)
-        return -1;
+        return NULL;
 
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "register_nack") != 0)
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL ||
+        cJSON_AddStringToObject(root, "username", payload->username) == NULL ||
+        cJSON_AddStringToObject(root, "session_token", payload->session_token) == NULL ||
+        (payload->wire[0] != '\0' && cJSON_AddStringToObject(root, "wire", payload->wire) == NULL) ||
+        (payload->board_updates[0] != '\0' && cJSON_AddStringToObject(root, "board_updates", payload->board_updates) == NULL))
     {
         cJSON_Delete(root);
+        return NULL;
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+}
+
+// Deserialization for ServerResumeAckPayload from an already parsed message
+int deserialize_server_resume_ack(const cJSON *root, ServerResumeAckPayload *out_payload)
+{
+    strcpy(out_payload->type, "resume_ack");
+
+    cJSON *room_json = cJSON_GetObjectItemCaseSensitive(root, "room");
+    out_payload->room = cJSON_IsNumber(room_json) ? room_json->valueint : -1;
+
+    cJSON *players_json = cJSON_GetObjectItemCaseSensitive(root, "players");
+    if (!cJSON_IsArray(players_json) || cJSON_GetArraySize(players_json) != 2)
+    {
         return -1;
     }
-    strcpy(out_payload->type, "register_nack");
+    for (int i = 0; i < 2; ++i)
+    {
+        cJSON *player_name_json = cJSON_GetArrayItem(players_json, i);
+        if (!cJSON_IsString(player_name_json) || (player_name_json->valuestring == NULL))
+        {
+            return -1;
+        }
+        strncpy(out_payload->players[i], player_name_json->valuestring, MAX_USERNAME_LEN - 1);
+        out_payload->players[i][MAX_USERNAME_LEN - 1] = '\0';
+    }
+
+    if (deserialize_board_rows(cJSON_GetObjectItemCaseSensitive(root, "board"), out_payload->board) != 0)
+    {
+        return -1;
+    }
+
+    cJSON *next_player_json = cJSON_GetObjectItemCaseSensitive(root, "next_player");
+    cJSON *timeout_json = cJSON_GetObjectItemCaseSensitive(root, "timeout");
+    if (!cJSON_IsString(next_player_json) || (next_player_json->valuestring == NULL) || !cJSON_IsNumber(timeout_json))
+    {
+        return -1;
+    }
+    strncpy(out_payload->next_player, next_player_json->valuestring, MAX_USERNAME_LEN - 1);
+    out_payload->next_player[MAX_USERNAME_LEN - 1] = '\0';
+    out_payload->timeout = timeout_json->valuedouble;
+    deserialize_optional_option(root, "wire", out_payload->wire, sizeof(out_payload->wire));
+    deserialize_optional_option(root, "board_updates", out_payload->board_updates, sizeof(out_payload->board_updates));
+    return 0;
+}
+
+// Deserialization for ServerResumeNackPayload from an already parsed message
+int deserialize_server_resume_nack(const cJSON *root, ServerResumeNackPayload *out_payload)
+{
+    strcpy(out_payload->type, "resume_nack");
 
     cJSON *reason_json = cJSON_GetObjectItemCaseSensitive(root, "reason");
     if (!cJSON_IsString(reason_json) || (reason_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
     strncpy(out_payload->reason, reason_json->valuestring, MAX_REASON_LEN - 1);
     out_payload->reason[MAX_REASON_LEN - 1] = '\0';
-
-    cJSON_Delete(root);
     return 0;
 }
 
-// Deserialization for ServerGameStartPayload
-int deserialize_server_game_start(const char *json_string, ServerGameStartPayload *out_payload)
+// Deserialization for ServerRegisterNackPayload from an already parsed message
+int deserialize_server_register_nack(const cJSON *root, ServerRegisterNackPayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
+    strcpy(out_payload->type, "register_nack");
 
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "game_start") != 0)
+    cJSON *reason_json = cJSON_GetObjectItemCaseSensitive(root, "reason");
+    if (!cJSON_IsString(reason_json) || (reason_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
+    strncpy(out_payload->reason, reason_json->valuestring, MAX_REASON_LEN - 1);
+    out_payload->reason[MAX_REASON_LEN - 1] = '\0';
+    return 0;
+}
+
+// Deserialization for ServerGameStartPayload from an already parsed message
+int deserialize_server_game_start(const cJSON *root, ServerGameStartPayload *out_payload)
+{
     strcpy(out_payload->type, "game_start");
 
     cJSON *players_json = cJSON_GetObjectItemCaseSensitive(root, "players");
     if (!cJSON_IsArray(players_json) || cJSON_GetArraySize(players_json) != 2)
     {
-        cJSON_Delete(root);
         return -1;
     }
     for (int i = 0; i < 2; ++i)
@@ -302,7 +630,6 @@ int deserialize_server_game_start(const char *json_string, ServerGameStartPayloa
         cJSON *player_name_json = cJSON_GetArrayItem(players_json, i);
         if (!cJSON_IsString(player_name_json) || (player_name_json->valuestring == NULL))
         {
-            cJSON_Delete(root);
             return -1;
         }
         strncpy(out_payload->players[i], player_name_json->valuestring, MAX_USERNAME_LEN - 1);
@@ -312,13 +639,10 @@ int deserialize_server_game_start(const char *json_string, ServerGameStartPayloa
     cJSON *first_player_json = cJSON_GetObjectItemCaseSensitive(root, "first_player");
     if (!cJSON_IsString(first_player_json) || (first_player_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
     strncpy(out_payload->first_player, first_player_json->valuestring, MAX_USERNAME_LEN - 1);
     out_payload->first_player[MAX_USERNAME_LEN - 1] = '\0';
-
-    cJSON_Delete(root);
     return 0;
 }
 
@@ -351,134 +675,58 @@ error:
     return NULL;
 }
 
-// Deserialization for ServerYourTurnPayload
-int deserialize_server_your_turn(const char *json_string, ServerYourTurnPayload *out_payload)
+// Deserialization for ServerYourTurnPayload from an already parsed message
+int deserialize_server_your_turn(const cJSON *root, ServerYourTurnPayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
-
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "your_turn") != 0)
-    {
-        cJSON_Delete(root);
-        return -1;
-    }
     strcpy(out_payload->type, "your_turn");
 
-    cJSON *board_json = cJSON_GetObjectItemCaseSensitive(root, "board");
-    if (!cJSON_IsArray(board_json) || cJSON_GetArraySize(board_json) != 8)
+    if (deserialize_turn_board(root, out_payload->board) != 0)
     {
-        cJSON_Delete(root);
         return -1;
     }
-    for (int i = 0; i < 8; ++i)
-    {
-        cJSON *row_json = cJSON_GetArrayItem(board_json, i);
-        if (!cJSON_IsString(row_json) || (row_json->valuestring == NULL))
-        {
-            cJSON_Delete(root);
-            return -1;
-        }
-        strncpy(out_payload->board[i], row_json->valuestring, 8);
-        out_payload->board[i][8] = '\0';
-    }
 
     cJSON *timeout_json = cJSON_GetObjectItemCaseSensitive(root, "timeout");
     if (!cJSON_IsNumber(timeout_json))
     {
-        cJSON_Delete(root);
         return -1;
     }
     out_payload->timeout = timeout_json->valuedouble;
-
-    cJSON_Delete(root);
     return 0;
 }
 
-// Deserialization for ServerMoveOkPayload
-int deserialize_server_move_ok(const char *json_string, ServerMoveOkPayload *out_payload)
+// Deserialization for ServerMoveOkPayload from an already parsed message
+int deserialize_server_move_ok(const cJSON *root, ServerMoveOkPayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
-
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "move_ok") != 0)
-    {
-        cJSON_Delete(root);
-        return -1;
-    }
     strcpy(out_payload->type, "move_ok");
 
-    cJSON *board_json = cJSON_GetObjectItemCaseSensitive(root, "board");
-    if (!cJSON_IsArray(board_json) || cJSON_GetArraySize(board_json) != 8)
+    if (deserialize_turn_board(root, out_payload->board) != 0)
     {
-        cJSON_Delete(root);
         return -1;
     }
-    for (int i = 0; i < 8; ++i)
-    {
-        cJSON *row_json = cJSON_GetArrayItem(board_json, i);
-        if (!cJSON_IsString(row_json) || (row_json->valuestring == NULL))
-        {
-            cJSON_Delete(root);
-            return -1;
-        }
-        strncpy(out_payload->board[i], row_json->valuestring, 8);
-        out_payload->board[i][8] = '\0';
-    }
 
     cJSON *next_player_json = cJSON_GetObjectItemCaseSensitive(root, "next_player");
     if (!cJSON_IsString(next_player_json) || (next_player_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
     strncpy(out_payload->next_player, next_player_json->valuestring, MAX_USERNAME_LEN - 1);
     out_payload->next_player[MAX_USERNAME_LEN - 1] = '\0';
-
-    cJSON_Delete(root);
     return 0;
 }
 
-// Deserialization for ServerInvalidMovePayload
-int deserialize_server_invalid_move(const char *json_string, ServerInvalidMovePayload *out_payload)
+// Deserialization for ServerInvalidMovePayload from an already parsed message
+int deserialize_server_invalid_move(const cJSON *root, ServerInvalidMovePayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
-
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "invalid_move") != 0)
-    {
-        cJSON_Delete(root);
-        return -1;
-    }
     strcpy(out_payload->type, "invalid_move");
 
-    cJSON *board_json = cJSON_GetObjectItemCaseSensitive(root, "board");
-    if (!cJSON_IsArray(board_json) || cJSON_GetArraySize(board_json) != 8)
+    if (deserialize_turn_board(root, out_payload->board) != 0)
     {
-        cJSON_Delete(root);
         return -1;
     }
-    for (int i = 0; i < 8; ++i)
-    {
-        cJSON *row_json = cJSON_GetArrayItem(board_json, i);
-        if (!cJSON_IsString(row_json) || (row_json->valuestring == NULL))
-        {
-            cJSON_Delete(root);
-            return -1;
-        }
-        strncpy(out_payload->board[i], row_json->valuestring, 8);
-        out_payload->board[i][8] = '\0';
-    }
 
     cJSON *next_player_json = cJSON_GetObjectItemCaseSensitive(root, "next_player");
     if (!cJSON_IsString(next_player_json) || (next_player_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
     strncpy(out_payload->next_player, next_player_json->valuestring, MAX_USERNAME_LEN - 1);
@@ -495,168 +743,453 @@ int deserialize_server_invalid_move(const char *json_string, ServerInvalidMovePa
     {
         out_payload->reason[0] = '\0';
     }
-
-    cJSON_Delete(root);
     return 0;
 }
 
-// Deserialization for ServerPassPayload
-int deserialize_server_pass(const char *json_string, ServerPassPayload *out_payload)
+// Deserialization for ServerPassPayload from an already parsed message
+int deserialize_server_pass(const cJSON *root, ServerPassPayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
-
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "pass") != 0)
-    {
-        cJSON_Delete(root);
-        return -1;
-    }
     strcpy(out_payload->type, "pass");
 
     cJSON *next_player_json = cJSON_GetObjectItemCaseSensitive(root, "next_player");
     if (!cJSON_IsString(next_player_json) || (next_player_json->valuestring == NULL))
     {
-        cJSON_Delete(root);
         return -1;
     }
     strncpy(out_payload->next_player, next_player_json->valuestring, MAX_USERNAME_LEN - 1);
     out_payload->next_player[MAX_USERNAME_LEN - 1] = '\0';
+    return 0;
+}
 
-    cJSON_Delete(root);
+// Deserialization for ServerGameOverPayload from an already parsed message
+int deserialize_server_game_over(const cJSON *root, ServerGameOverPayload *out_payload)
+{
+    strcpy(out_payload->type, "game_over");
+
+    cJSON *scores_obj_json = cJSON_GetObjectItemCaseSensitive(root, "scores");
+    if (!cJSON_IsObject(scores_obj_json))
+    {
+        return -1;
+    }
+
+    int score_idx = 0;
+    cJSON *current_score_item = NULL;
+    cJSON_ArrayForEach(current_score_item, scores_obj_json)
+    {
+        if (score_idx < 2)
+        {
+            if (current_score_item->string != NULL && cJSON_IsNumber(current_score_item))
+            {
+                strncpy(out_payload->scores[score_idx].username, current_score_item->string, MAX_USERNAME_LEN - 1);
+                out_payload->scores[score_idx].username[MAX_USERNAME_LEN - 1] = '\0';
+                out_payload->scores[score_idx].score = current_score_item->valueint;
+                score_idx++;
+            }
+            else
+            {
+                fprintf(stderr, "Warning: Malformed score item in game_over message.\n");
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Warning: More than 2 scores received in game_over message. Ignoring extras.\n");
+            break;
+        }
+    }
+
+    for (int i = score_idx; i < 2; ++i)
+    {
+        strcpy(out_payload->scores[i].username, "N/A");
+        out_payload->scores[i].score = 0;
+    }
     return 0;
 }
 
-// Deserialization for ServerGameOverPayload
-int deserialize_server_game_over(const char *json_string, ServerGameOverPayload *out_payload)
+// Client Logic Functions
+
+// Sends one JSON message and its newline with a single writev(), so both leave together
+// Returns -1 on failure (errno is set).
+int send_json_line_to_server(int sockfd, const char *json_string)
+{
+    struct iovec iov[2] = {{(void *)json_string, strlen(json_string)}, {"\n", 1}};
+    ssize_t expected = (ssize_t)(iov[0].iov_len + 1);
+    return writev(sockfd, iov, 2) == expected ? 0 : -1;
+}
+
+void send_registration_to_server(int sockfd, const char *username)
+{
+    ClientRegisterPayload reg_payload;
+    strcpy(reg_payload.type, "register");
+    strncpy(reg_payload.username, username, MAX_USERNAME_LEN - 1);
+    reg_payload.username[MAX_USERNAME_LEN - 1] = '\0';
+    strcpy(reg_payload.wire, wire_binary_requested ? WIRE_FORMAT_BINARY : "");
+    strcpy(reg_payload.board_updates, delta_updates_requested ? BOARD_UPDATES_DELTA : "");
+
+    char *json_string = serialize_client_register(&reg_payload);
+    if (json_string == NULL)
+    {
+        fprintf(stderr, "Error: Could not serialize registration message.\n");
+        return;
+    }
+
+    client_wire_format = WIRE_FORMAT_JSON; // Until the ack says otherwise
+    if (send_json_line_to_server(sockfd, json_string) < 0)
+    {
+        perror("send registration failed");
+    }
+    else
+    {
+        printf("Registration message sent for username: %s\n", username);
+    }
+    cJSON_free(json_string);
+}
+
+void send_resume_to_server(int sockfd)
+{
+    ClientResumePayload resume_payload;
+    strcpy(resume_payload.type, "resume");
+    strcpy(resume_payload.username, client_username);
+    strcpy(resume_payload.session_token, client_session_token);
+    strcpy(resume_payload.wire, wire_binary_requested ? WIRE_FORMAT_BINARY : "");
+    strcpy(resume_payload.board_updates, delta_updates_requested ? BOARD_UPDATES_DELTA : "");
+
+    char *json_string = serialize_client_resume(&resume_payload);
+    if (json_string == NULL)
+    {
+        fprintf(stderr, "Error: Could not serialize resume message.\n");
+        return;
+    }
+
+    client_wire_format = WIRE_FORMAT_JSON; // Until the ack says otherwise
+    if (send_json_line_to_server(sockfd, json_string) < 0)
+    {
+        perror("send resume failed");
+    }
+    else
+    {
+        printf("Resume message sent for username: %s\n", client_username);
+    }
+    cJSON_free(json_string);
+}
+
+// Sends a move (all 0 to pass) in the negotiated wire format
+void send_move_to_server(int sockfd, const ClientMovePayload *payload)
+{
+    if (client_wire_format == WIRE_FORMAT_FRAMES)
+    {
+        WireMessage frame = {.type = WIRE_FRAME_MOVE, .move = {payload->sx, payload->sy, payload->tx, payload->ty}};
+        unsigned char buffer[WIRE_FRAME_HEADER_SIZE + 8];
+        size_t frame_len = wire_encode(&frame, buffer, sizeof(buffer));
+        if (send(sockfd, buffer, frame_len, 0) < 0)
+        {
+            perror("send move frame failed");
+        }
+        return;
+    }
+
+    char *json_move_string = serialize_client_move(payload);
+    if (json_move_string == NULL)
+    {
+        fprintf(stderr, "Error serializing move message.\n");
+        return;
+    }
+    if (send_json_line_to_server(sockfd, json_move_string) < 0)
+    {
+        perror("send move failed");
+    }
+    cJSON_free(json_move_string);
+}
+
+void display_board(const char board[BOARD_ROWS][BOARD_COLS + 1])
+{
+    printf("Current Board:\n");
+    printf("   1 2 3 4 5 6 7 8\n");
+    printf(" +-----------------+\n");
+    for (int i = 0; i < 8; ++i)
+    {
+        printf("%d| ", i + 1);
+        for (int j = 0; j < 8; ++j)
+        {
+            printf("%c ", board[i][j]);
+        }
+        printf("|\n");
+    }
+    printf(" +-----------------+\n");
+}
+
+// --- Turn Messages (JSON or binary frames) ---
+
+// The turn being searched: its move goes out when the search is done or at turn_deadline
+int turn_pending = 0;
+unsigned turn_job;
+int turn_sockfd = -1;
+char turn_board[BOARD_ROWS][BOARD_COLS + 1];
+struct timespec turn_deadline; // CLOCK_MONOTONIC
+
+// Function to send the best move found for the pending turn and end it
+void send_turn_move(void)
+{
+    MoveCoords decided_move;
+    int done;
+    int depth = search_result(turn_job, &decided_move, &done);
+    search_cancel();
+    turn_pending = 0;
+    if (depth == 0)
+    {
+        // Not even one ply finished in time: a one-ply search here takes well under a millisecond
+        decided_move = move_generate(turn_board, my_player_symbol, 1);
+        depth = 1;
+    }
+    if (!done)
+    {
+        printf("Turn time nearly up, sending the best move of depth %d.\n", depth);
+    }
+
+    ClientMovePayload move_payload_to_send;
+    strcpy(move_payload_to_send.type, "move");
+    strcpy(move_payload_to_send.username, client_username);
+
+    move_payload_to_send.sx = decided_move.sx;
+    move_payload_to_send.sy = decided_move.sy;
+    move_payload_to_send.tx = decided_move.tx;
+    move_payload_to_send.ty = decided_move.ty;
+
+    printf("Client sending move to server: (%d,%d) -> (%d,%d)\n",
+           move_payload_to_send.sx, move_payload_to_send.sy,
+           move_payload_to_send.tx, move_payload_to_send.ty);
+    send_move_to_server(turn_sockfd, &move_payload_to_send);
+}
+
+// Function to drop the pending turn, e.g. after a 'pass' or a lost connection
+void cancel_turn(void)
+{
+    if (turn_pending)
+    {
+        search_cancel();
+        turn_pending = 0;
+    }
+}
+
+// Microseconds until the pending turn's move is due, 0 once the deadline has passed
+static long long turn_time_left_us(void)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-        return -1;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long left_us = (long long)(turn_deadline.tv_sec - now.tv_sec) * 1000000 + (turn_deadline.tv_nsec - now.tv_nsec) / 1000;
+    return left_us > 0 ? left_us : 0;
+}
 
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    if (!cJSON_IsString(type_json) || strcmp(type_json->valuestring, "game_over") != 0)
+// Function to compute how long select() may wait before the pending turn's move is due
+struct timeval *turn_wait_time(struct timeval *tv)
+{
+    if (!turn_pending)
     {
-        cJSON_Delete(root);
-        return -1;
+        return NULL;
     }
-    strcpy(out_payload->type, "game_over");
+    long long left_us = turn_time_left_us();
+    tv->tv_sec = (time_t)(left_us / 1000000);
+    tv->tv_usec = (suseconds_t)(left_us % 1000000);
+    return tv;
+}
 
-    cJSON *scores_obj_json = cJSON_GetObjectItemCaseSensitive(root, "scores");
-    if (!cJSON_IsObject(scores_obj_json))
+// Function to send the pending turn's move if its search is done or its deadline has come
+void check_turn(void)
+{
+    if (!turn_pending)
     {
-        cJSON_Delete(root);
-        return -1;
+        return;
+    }
+    MoveCoords unused;
+    int done;
+    search_result(turn_job, &unused, &done);
+    if (done || turn_time_left_us() == 0)
+    {
+        send_turn_move();
     }
+}
 
-    int score_idx = 0;
-    cJSON *current_score_item = NULL;
-    cJSON_ArrayForEach(current_score_item, scores_obj_json)
+void handle_your_turn(ServerYourTurnPayload *yt_payload, int sockfd)
+{
+    printf("\nIt's your turn! (Automating move)\n");
+    display_board(yt_payload->board);
+    if (matrix_ptr)
     {
-        if (score_idx < 2)
-        {
-            if (current_score_item->string != NULL && cJSON_IsNumber(current_score_item))
-            {
-                strncpy(out_payload->scores[score_idx].username, current_score_item->string, MAX_USERNAME_LEN - 1);
-                out_payload->scores[score_idx].username[MAX_USERNAME_LEN - 1] = '\0';
-                out_payload->scores[score_idx].score = current_score_item->valueint;
-                score_idx++;
-            }
-            else
-            {
-                fprintf(stderr, "Warning: Malformed score item in game_over message.\n");
-            }
-        }
-        else
-        {
-            fprintf(stderr, "Warning: More than 2 scores received in game_over message. Ignoring extras.\n");
-            break;
-        }
+        post_octaflip_board(matrix_ptr, yt_payload->board);
     }
 
-    for (int i = score_idx; i < 2; ++i)
+    if (my_player_symbol == ' ')
     {
-        strcpy(out_payload->scores[i].username, "N/A");
-        out_payload->scores[i].score = 0;
+        fprintf(stderr, "Error: Player symbol not set. Cannot generate move.\n");
     }
 
-    cJSON_Delete(root);
-    return 0;
+    // The search runs on its own thread, so 'pass' or a dropped connection is still noticed meanwhile
+    long timeout_ms = yt_payload->timeout > 0 ? (long)(yt_payload->timeout * 1000) : SEARCH_DEFAULT_TIMEOUT_MS;
+    long budget_ms = timeout_ms - SEARCH_DEADLINE_MARGIN_MS > timeout_ms / 2 ? timeout_ms - SEARCH_DEADLINE_MARGIN_MS : timeout_ms / 2;
+    clock_gettime(CLOCK_MONOTONIC, &turn_deadline);
+    turn_deadline.tv_sec += budget_ms / 1000;
+    turn_deadline.tv_nsec += (budget_ms % 1000) * 1000000L;
+    if (turn_deadline.tv_nsec >= 1000000000L)
+    {
+        turn_deadline.tv_sec++;
+        turn_deadline.tv_nsec -= 1000000000L;
+    }
+    clone_grid(yt_payload->board, turn_board);
+    turn_sockfd = sockfd;
+    turn_job = search_post(yt_payload->board, my_player_symbol);
+    turn_pending = 1;
 }
 
-// Client Logic Functions
-
-void send_registration_to_server(int sockfd, const char *username)
+void handle_move_ok(const ServerMoveOkPayload *mo_payload)
 {
-    ClientRegisterPayload reg_payload;
-    strcpy(reg_payload.type, "register");
-    strncpy(reg_payload.username, username, MAX_USERNAME_LEN - 1);
-    reg_payload.username[MAX_USERNAME_LEN - 1] = '\0';
-
-    char *json_string = serialize_client_register(&reg_payload);
-    if (json_string == NULL)
+    printf("Move accepted.\n");
+    display_board(mo_payload->board);
+    if (matrix_ptr)
     {
-        fprintf(stderr, "Error: Could not serialize registration message.\n");
-        return;
+        post_octaflip_board(matrix_ptr, mo_payload->board);
+    }
+    printf("Next player: %s\n", mo_payload->next_player);
+    if (strcmp(mo_payload->next_player, client_username) != 0)
+    {
+        printf("Waiting for %s to move...\n", mo_payload->next_player);
     }
+}
 
-    if (send(sockfd, json_string, strlen(json_string), 0) < 0 ||
-        send(sockfd, "\n", 1, 0) < 0)
+void handle_invalid_move(const ServerInvalidMovePayload *im_payload)
+{
+    printf("Move invalid by server.");
+    if (im_payload->reason[0] != '\0')
     {
-        perror("send registration or newline failed");
+        printf(" Reason: %s\n", im_payload->reason);
     }
     else
     {
-        printf("Registration message sent for username: %s\n", username);
+        printf("\n");
+    }
+    display_board(im_payload->board);
+    if (matrix_ptr)
+    {
+        post_octaflip_board(matrix_ptr, im_payload->board);
+    }
+    printf("Next player: %s. It might be your turn again if server indicates.\n", im_payload->next_player);
+    if (strcmp(im_payload->next_player, client_username) != 0)
+    {
+        printf("Waiting for %s to move...\n", im_payload->next_player);
     }
-    free(json_string);
 }
 
-void display_board(char board[BOARD_ROWS][BOARD_COLS + 1])
+void handle_pass(const ServerPassPayload *pass_payload)
 {
-    printf("Current Board:\n");
-    printf("   1 2 3 4 5 6 7 8\n");
-    printf(" +-----------------+\n");
-    for (int i = 0; i < 8; ++i)
+    cancel_turn(); // The server's clock ran out first; a late move would only be rejected
+    printf("Turn passed by server (e.g. timeout or no valid moves). Next player: %s\n", pass_payload->next_player);
+    if (strcmp(pass_payload->next_player, client_username) != 0)
     {
-        printf("%d| ", i + 1);
-        for (int j = 0; j < 8; ++j)
-        {
-            printf("%c ", board[i][j]);
-        }
-        printf("|\n");
+        printf("Waiting for %s to move...\n", pass_payload->next_player);
     }
-    printf(" +-----------------+\n");
 }
 
-void handle_server_message(const char *json_message, int sockfd)
+// Names the player of a seat carried by a binary frame
+static void seat_to_username(int seat, char out[MAX_USERNAME_LEN])
+{
+    const char *name = (seat == 0 || seat == 1) && game_players[seat][0] != '\0' ? game_players[seat] : "N/A";
+    strncpy(out, name, MAX_USERNAME_LEN - 1);
+    out[MAX_USERNAME_LEN - 1] = '\0';
+}
+
+void handle_server_message(const char *json_message, size_t message_len, int sockfd);
+
+// Handles one binary frame (see wire_protocol.h); JSON frames go to handle_server_message()
+void handle_server_frame(const char *frame, size_t frame_len, int sockfd)
 {
-    char *msg_type_str = get_message_type_from_json(json_message);
-    if (msg_type_str == NULL)
+    WireMessage msg;
+    if (wire_decode((const unsigned char *)frame, frame_len, &msg) != 0)
     {
-        fprintf(stderr, "Could not determine message type from: %s\n", json_message);
+        fprintf(stderr, "Received a malformed frame from the server (type %d, %zu bytes).\n",
+                frame_len > 0 ? (unsigned char)frame[0] : -1, frame_len);
         return;
     }
 
+    switch (msg.type)
+    {
+    case WIRE_FRAME_JSON:
+        handle_server_message(msg.text, msg.text_len, sockfd);
+        break;
+    case WIRE_FRAME_YOUR_TURN:
+    {
+        ServerYourTurnPayload yt_payload;
+        strcpy(yt_payload.type, "your_turn");
+        memcpy(yt_payload.board, msg.board, sizeof(yt_payload.board));
+        yt_payload.timeout = msg.timeout;
+        printf("Received message of type: your_turn\n");
+        handle_your_turn(&yt_payload, sockfd);
+        break;
+    }
+    case WIRE_FRAME_MOVE_OK:
+    {
+        ServerMoveOkPayload mo_payload;
+        strcpy(mo_payload.type, "move_ok");
+        memcpy(mo_payload.board, msg.board, sizeof(mo_payload.board));
+        seat_to_username(msg.next_seat, mo_payload.next_player);
+        printf("Received message of type: move_ok\n");
+        handle_move_ok(&mo_payload);
+        break;
+    }
+    case WIRE_FRAME_INVALID_MOVE:
+    {
+        ServerInvalidMovePayload im_payload;
+        strcpy(im_payload.type, "invalid_move");
+        memcpy(im_payload.board, msg.board, sizeof(im_payload.board));
+        seat_to_username(msg.next_seat, im_payload.next_player);
+        size_t reason_len = msg.text_len < MAX_REASON_LEN - 1 ? msg.text_len : MAX_REASON_LEN - 1;
+        memcpy(im_payload.reason, msg.text, reason_len);
+        im_payload.reason[reason_len] = '\0';
+        printf("Received message of type: invalid_move\n");
+        handle_invalid_move(&im_payload);
+        break;
+    }
+    case WIRE_FRAME_PASS:
+    {
+        ServerPassPayload pass_payload;
+        strcpy(pass_payload.type, "pass");
+        seat_to_username(msg.next_seat, pass_payload.next_player);
+        printf("Received message of type: pass\n");
+        handle_pass(&pass_payload);
+        break;
+    }
+    default:
+        fprintf(stderr, "Received unhandled frame type %d from server.\n", msg.type);
+        break;
+    }
+}
+
+// Handles one parsed message and releases it
+void dispatch_server_message(cJSON *message, MessageType msg_type, const char *msg_type_str, int sockfd)
+{
     printf("Received message of type: %s\n", msg_type_str);
 
-    if (strcmp(msg_type_str, "register_ack") == 0)
+    switch (msg_type)
+    {
+    case MSG_REGISTER_ACK:
     {
         ServerRegisterAckPayload ack_payload;
-        if (deserialize_server_register_ack(json_message, &ack_payload) == 0)
+        if (deserialize_server_register_ack(message, &ack_payload) == 0)
         {
+            strcpy(client_session_token, ack_payload.session_token);
+            if (strcmp(ack_payload.wire, WIRE_FORMAT_BINARY) == 0)
+            {
+                client_wire_format = WIRE_FORMAT_FRAMES; // Everything after this ack is framed
+            }
             printf("Registration successful. Waiting for game to start...\n");
         }
         else
         {
             fprintf(stderr, "Error deserializing register_ack.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "register_nack") == 0)
+    case MSG_REGISTER_NACK:
     {
         ServerRegisterNackPayload nack_payload;
-        if (deserialize_server_register_nack(json_message, &nack_payload) == 0)
+        if (deserialize_server_register_nack(message, &nack_payload) == 0)
         {
             fprintf(stderr, "Registration failed: %s\n", nack_payload.reason);
             if (matrix_ptr)
@@ -668,11 +1201,12 @@ void handle_server_message(const char *json_message, int sockfd)
         {
             fprintf(stderr, "Error deserializing register_nack.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "game_start") == 0)
+    case MSG_GAME_START:
     {
         ServerGameStartPayload gs_payload;
-        if (deserialize_server_game_start(json_message, &gs_payload) == 0)
+        if (deserialize_server_game_start(message, &gs_payload) == 0)
         {
             printf("Game started!\n");
             printf("Players: %s, %s\n", gs_payload.players[0], gs_payload.players[1]);
@@ -687,6 +1221,14 @@ void handle_server_message(const char *json_message, int sockfd)
                 my_player_symbol = 'B';
             }
             printf("Client is player %c.\n", my_player_symbol);
+            client_board_known = 0; // The first board of a game comes in full
+            memcpy(game_players, gs_payload.players, sizeof(game_players));
+            if (strcmp(gs_payload.players[0], gs_payload.first_player) != 0)
+            {
+                memcpy(game_players[0], gs_payload.players[1], MAX_USERNAME_LEN);
+                memcpy(game_players[1], gs_payload.players[0], MAX_USERNAME_LEN);
+            }
+            game_in_progress = 1;
 
             if (strcmp(gs_payload.first_player, client_username) == 0)
             {
@@ -701,130 +1243,111 @@ void handle_server_message(const char *json_message, int sockfd)
         {
             fprintf(stderr, "Error deserializing game_start.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "your_turn") == 0)
+    case MSG_YOUR_TURN:
     {
         ServerYourTurnPayload yt_payload;
-        if (deserialize_server_your_turn(json_message, &yt_payload) == 0)
+        if (deserialize_server_your_turn(message, &yt_payload) == 0)
         {
-            printf("\nIt's your turn! (Automating move)\n");
-            display_board(yt_payload.board);
-            if (matrix_ptr)
-            {
-                render_octaflip_board(matrix_ptr, yt_payload.board);
-            }
-
-            if (my_player_symbol == ' ')
-            {
-                fprintf(stderr, "Error: Player symbol not set. Cannot generate move.\n");
-            }
-
-            MoveCoords decided_move = move_generate(yt_payload.board, my_player_symbol);
-
-            ClientMovePayload move_payload_to_send;
-            strcpy(move_payload_to_send.type, "move");
-            strcpy(move_payload_to_send.username, client_username);
-
-            move_payload_to_send.sx = decided_move.sx;
-            move_payload_to_send.sy = decided_move.sy;
-            move_payload_to_send.tx = decided_move.tx;
-            move_payload_to_send.ty = decided_move.ty;
-
-            char *json_move_string = serialize_client_move(&move_payload_to_send);
-            if (json_move_string)
-            {
-                printf("Client sending move to server: (%d,%d) -> (%d,%d)\n",
-                       move_payload_to_send.sx, move_payload_to_send.sy,
-                       move_payload_to_send.tx, move_payload_to_send.ty);
-                if (send(sockfd, json_move_string, strlen(json_move_string), 0) < 0 ||
-                    send(sockfd, "\n", 1, 0) < 0)
-                {
-                    perror("send move or newline failed");
-                }
-                free(json_move_string);
-            }
-            else
-            {
-                fprintf(stderr, "Error serializing move message.\n");
-            }
+            handle_your_turn(&yt_payload, sockfd);
         }
         else
         {
             fprintf(stderr, "Error deserializing your_turn.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "move_ok") == 0)
+    case MSG_MOVE_OK:
     {
         ServerMoveOkPayload mo_payload;
-        if (deserialize_server_move_ok(json_message, &mo_payload) == 0)
+        if (deserialize_server_move_ok(message, &mo_payload) == 0)
         {
-            printf("Move accepted.\n");
-            display_board(mo_payload.board);
-            if (matrix_ptr)
-            {
-                render_octaflip_board(matrix_ptr, mo_payload.board);
-            }
-            printf("Next player: %s\n", mo_payload.next_player);
-            if (strcmp(mo_payload.next_player, client_username) != 0)
-            {
-                printf("Waiting for %s to move...\n", mo_payload.next_player);
-            }
+            handle_move_ok(&mo_payload);
         }
         else
         {
             fprintf(stderr, "Error deserializing move_ok.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "invalid_move") == 0)
+    case MSG_INVALID_MOVE:
     {
         ServerInvalidMovePayload im_payload;
-        if (deserialize_server_invalid_move(json_message, &im_payload) == 0)
+        if (deserialize_server_invalid_move(message, &im_payload) == 0)
+        {
+            handle_invalid_move(&im_payload);
+        }
+        else
+        {
+            fprintf(stderr, "Error deserializing invalid_move.\n");
+        }
+        break;
+    }
+    case MSG_PASS:
+    {
+        ServerPassPayload pass_payload;
+        if (deserialize_server_pass(message, &pass_payload) == 0)
+        {
+            handle_pass(&pass_payload);
+        }
+        else
+        {
+            fprintf(stderr, "Error deserializing pass.\n");
+        }
+        break;
+    }
+    case MSG_RESUME_ACK:
+    {
+        ServerResumeAckPayload ra_payload;
+        if (deserialize_server_resume_ack(message, &ra_payload) == 0)
         {
-            printf("Move invalid by server.");
-            if (im_payload.reason[0] != '\0')
+            my_player_symbol = strcmp(ra_payload.players[0], client_username) == 0 ? 'R' : 'B';
+            memcpy(game_players, ra_payload.players, sizeof(game_players));
+            memcpy(client_board, ra_payload.board, sizeof(client_board));
+            client_board_known = 1;
+            if (strcmp(ra_payload.wire, WIRE_FORMAT_BINARY) == 0)
             {
-                printf(" Reason: %s\n", im_payload.reason);
+                client_wire_format = WIRE_FORMAT_FRAMES; // Everything after this ack is framed
             }
-            else
+            printf("Back in the game (room %d) as player %c.\n", ra_payload.room, my_player_symbol);
+            display_board(ra_payload.board);
+            if (matrix_ptr)
             {
-                printf("\n");
+                post_octaflip_board(matrix_ptr, ra_payload.board);
             }
-            display_board(im_payload.board);
-            if (matrix_ptr)
+            if (strcmp(ra_payload.next_player, client_username) == 0)
             {
-                render_octaflip_board(matrix_ptr, im_payload.board);
+                printf("Your turn, %.0f s left. (Waiting for YOUR_TURN message)\n", ra_payload.timeout);
             }
-            printf("Next player: %s. It might be your turn again if server indicates.\n", im_payload.next_player);
-            if (strcmp(im_payload.next_player, client_username) != 0)
+            else
             {
-                printf("Waiting for %s to move...\n", im_payload.next_player);
+                printf("Waiting for %s to move...\n", ra_payload.next_player);
             }
         }
         else
         {
-            fprintf(stderr, "Error deserializing invalid_move.\n");
+            fprintf(stderr, "Error deserializing resume_ack.\n");
         }
+        break;
     }
-    else if (strcmp(msg_type_str, "pass") == 0)
+    case MSG_RESUME_NACK:
     {
-        ServerPassPayload pass_payload;
-        if (deserialize_server_pass(json_message, &pass_payload) == 0)
-        {
-            printf("Turn passed by server (e.g. timeout or no valid moves). Next player: %s\n", pass_payload.next_player);
-            if (strcmp(pass_payload.next_player, client_username) != 0)
-            {
-                printf("Waiting for %s to move...\n", pass_payload.next_player);
-            }
-        }
-        else
+        ServerResumeNackPayload rn_payload;
+        if (deserialize_server_resume_nack(message, &rn_payload) != 0)
         {
-            fprintf(stderr, "Error deserializing pass.\n");
+            strcpy(rn_payload.reason, "unknown");
         }
+        fprintf(stderr, "Could not resume the game: %s\n", rn_payload.reason);
+        if (matrix_ptr)
+            cleanup_matrix(matrix_ptr); // Cleanup matrix
+        close(sockfd);
+        exit(1);
     }
-    else if (strcmp(msg_type_str, "game_over") == 0)
+    case MSG_GAME_OVER:
     {
         ServerGameOverPayload go_payload;
-        if (deserialize_server_game_over(json_message, &go_payload) == 0)
+        if (deserialize_server_game_over(message, &go_payload) == 0)
         {
             printf("\nGame Over!\n");
             printf("Scores:\n");
@@ -858,12 +1381,84 @@ void handle_server_message(const char *json_message, int sockfd)
             close(sockfd);
             exit(1);
         }
+        break;
+    }
+    default:
+        fprintf(stderr, "Received unknown or unhandled message type from server: %s\n", msg_type_str);
+        break;
+    }
+    release_message(message);
+}
+
+void handle_server_message(const char *json_message, size_t message_len, int sockfd)
+{
+    MessageType msg_type;
+    const char *msg_type_str;
+    cJSON *message = parse_message_with_type(json_message, message_len, &msg_type, &msg_type_str);
+    if (message == NULL)
+    {
+        fprintf(stderr, "Could not determine message type from: %.*s\n", (int)message_len, json_message);
+        return;
+    }
+    dispatch_server_message(message, msg_type, msg_type_str, sockfd);
+}
+
+// Feeds received bytes to the JSON stream and handles the message of a line once its '\n' arrives.
+// A message is built in the JSON arena from its first byte on, so the arena stays open between
+// reads until the line is complete. Returns the bytes consumed: up to the end of the first
+// complete line, or all of them.
+size_t feed_server_json(const char *bytes, size_t len, int sockfd)
+{
+    size_t consumed;
+    cJSON *document;
+    if (!client_stream_arena_open)
+    {
+        json_arena_begin();
+        client_stream_arena_open = 1;
+    }
+    int status = cJSON_StreamFeed(&client_json_stream, bytes, len, &consumed, &document);
+    if (status == cJSON_StreamIncomplete)
+    {
+        return consumed;
+    }
+
+    client_stream_arena_open = 0;
+    if (status == cJSON_StreamDocument)
+    {
+        MessageType msg_type;
+        const char *msg_type_str;
+        if (identify_message(document, &msg_type, &msg_type_str) == 0)
+        {
+            dispatch_server_message(document, msg_type, msg_type_str, sockfd); // Releases it
+        }
+        else
+        {
+            release_message(document);
+        }
+        return consumed;
+    }
+
+    if (status == cJSON_StreamTooLong)
+    {
+        fprintf(stderr, "Dropped a server message longer than %d bytes.\n", CLIENT_RECV_BUFFER_MAX_LEN - 1);
     }
     else
     {
-        fprintf(stderr, "Received unknown or unhandled message type from server: %s\n", msg_type_str);
+        fprintf(stderr, "Dropped a server message that is not valid JSON.\n");
+    }
+    json_arena_end();
+    return consumed;
+}
+
+// Drops a partly received line, e.g. when the connection is lost
+void reset_server_json_stream(void)
+{
+    cJSON_ResetStream(&client_json_stream);
+    if (client_stream_arena_open)
+    {
+        json_arena_end();
+        client_stream_arena_open = 0;
     }
-    free(msg_type_str);
 }
 
 // 1. Command-Line Argument Parsing:
@@ -875,7 +1470,7 @@ int parse_client_args(int argc, char *argv[], char **server_ip_out, char **serve
 
     if (argc < 7)
     {
-        fprintf(stderr, "Usage: %s -ip <server_ip> -port <server_port> -username <username>\n", argv[0]);
+        fprintf(stderr, "Usage: %s -ip <server_ip> -port <server_port> -username <username> [-binary] [-delta]\n", argv[0]);
         return -1;
     }
 
@@ -917,6 +1512,14 @@ int parse_client_args(int argc, char *argv[], char **server_ip_out, char **serve
                 goto usage_error;
             }
         }
+        else if (strcmp(argv[i], "-binary") == 0)
+        {
+            wire_binary_requested = 1;
+        }
+        else if (strcmp(argv[i], "-delta") == 0)
+        {
+            delta_updates_requested = 1;
+        }
         else
         {
             fprintf(stderr, "Error: Unknown argument '%s'.\n", argv[i]);
@@ -939,7 +1542,7 @@ int parse_client_args(int argc, char *argv[], char **server_ip_out, char **serve
     return 0;
 
 usage_error:
-    fprintf(stderr, "Usage: %s -ip <server_ip> -port <server_port> -username <username>\n", argv[0]);
+    fprintf(stderr, "Usage: %s -ip <server_ip> -port <server_port> -username <username> [-binary] [-delta]\n", argv[0]);
     return -1;
 }
 
@@ -983,6 +1586,43 @@ int connect_to_server(const char *server_ip, const char *server_port)
     return sockfd;
 }
 
+// 3. Reconnection:
+// After a dropped connection, retries with a doubling delay for up to RECONNECT_WINDOW_MS.
+// A running game is resumed with the session token, so the seat, the board and the time
+// left for the current turn are kept; before the game starts the client simply registers
+// again. Returns the new socket, or -1 if the server could not be reached in time.
+int reconnect_to_server(const char *server_ip, const char *server_port)
+{
+    long waited_ms = 0;
+    long delay_ms = RECONNECT_FIRST_DELAY_MS;
+    while (waited_ms < RECONNECT_WINDOW_MS)
+    {
+        struct timespec delay = {delay_ms / 1000, (delay_ms % 1000) * 1000000L};
+        nanosleep(&delay, NULL);
+        waited_ms += delay_ms;
+        delay_ms = delay_ms * 2 > RECONNECT_MAX_DELAY_MS ? RECONNECT_MAX_DELAY_MS : delay_ms * 2;
+
+        int sockfd = connect_to_server(server_ip, server_port);
+        if (sockfd == -1)
+        {
+            continue;
+        }
+        printf("Reconnected to server after %ld ms. Socket FD: %d\n", waited_ms, sockfd);
+        line_framer_init(&client_recv_framer);
+        reset_server_json_stream();
+        if (game_in_progress)
+        {
+            send_resume_to_server(sockfd);
+        }
+        else
+        {
+            send_registration_to_server(sockfd, client_username);
+        }
+        return sockfd;
+    }
+    return -1;
+}
+
 int main(int argc, char *argv[])
 {
     char *server_ip;
@@ -1001,6 +1641,10 @@ int main(int argc, char *argv[])
     // Initialize LED Matrix (modifies argc, &argv)
     // Do this after parsing our own args but before using them if they might be consumed by matrix lib
     matrix_ptr = initialize_matrix(&argc, &argv);
+    if (matrix_ptr)
+    {
+        start_board_renderer(matrix_ptr); // Boards are drawn off the network thread; inline if this fails
+    }
     // We can check if matrix_ptr is NULL here if initialization is critical before connection,
     // but errors are handled within initialize_matrix.
 
@@ -1020,18 +1664,34 @@ int main(int argc, char *argv[])
 
     printf("Connected to server. Socket FD: %d\n", sockfd);
 
+    // A send() on a dropped connection must fail with EPIPE, not kill the client
+    signal(SIGPIPE, SIG_IGN);
+    json_arena_install(); // Messages and replies are built in the JSON arena, see release_message()
+    if (search_start() == -1)
+    {
+        if (matrix_ptr)
+            cleanup_matrix(matrix_ptr); // Cleanup matrix
+        close(sockfd);
+        exit(1);
+    }
+
     send_registration_to_server(sockfd, client_username);
 
     fd_set read_fds;
+    line_framer_init(&client_recv_framer);
+    cJSON_InitStream(&client_json_stream, CLIENT_RECV_BUFFER_MAX_LEN - 1);
 
     while (1)
     {
         FD_ZERO(&read_fds);
         FD_SET(sockfd, &read_fds);
+        FD_SET(search_notify_fds[0], &read_fds);
 
-        int current_max_fd = sockfd;
+        int current_max_fd = sockfd > search_notify_fds[0] ? sockfd : search_notify_fds[0];
 
-        int activity = select(current_max_fd + 1, &read_fds, NULL, NULL, NULL);
+        // While a move is being searched, wake up in time to send it
+        struct timeval turn_time_left;
+        int activity = select(current_max_fd + 1, &read_fds, NULL, NULL, turn_wait_time(&turn_time_left));
 
         if ((activity < 0) && (errno != EINTR))
         {
@@ -1042,65 +1702,77 @@ int main(int argc, char *argv[])
             close(sockfd);
             exit(1);
         }
+        if (activity < 0)
+        {
+            continue;
+        }
+
+        if (FD_ISSET(search_notify_fds[0], &read_fds))
+        {
+            search_drain_notifications();
+        }
+        check_turn();
 
         if (FD_ISSET(sockfd, &read_fds))
         {
-            char temp_buf[BUFFER_SIZE];
-            int bytes_received = recv(sockfd, temp_buf, sizeof(temp_buf) - 1, 0);
+            ssize_t bytes_received = line_framer_recv(&client_recv_framer, sockfd);
             if (bytes_received > 0)
             {
-                temp_buf[bytes_received] = '\0';
+                // The format is checked per message: an ack can switch it in the middle of a read
+                for (;;)
+                {
+                    if (client_wire_format == WIRE_FORMAT_JSON)
+                    {
+                        const char *bytes;
+                        size_t available = line_framer_peek(&client_recv_framer, &bytes);
+                        if (available == 0)
+                        {
+                            break;
+                        }
+                        line_framer_consume(&client_recv_framer, feed_server_json(bytes, available, sockfd));
+                        continue;
+                    }
 
-                if (client_recv_buffer_len + bytes_received >= CLIENT_RECV_BUFFER_MAX_LEN)
+                    const char *frame;
+                    size_t frame_len;
+                    int framer_status = line_framer_next_frame(&client_recv_framer, &frame, &frame_len);
+                    if (framer_status == LINE_FRAMER_NONE)
+                    {
+                        break;
+                    }
+                    if (framer_status == LINE_FRAMER_OVERSIZED)
+                    {
+                        fprintf(stderr, "Dropped a server message longer than %d bytes.\n", CLIENT_RECV_BUFFER_MAX_LEN - 1);
+                        continue;
+                    }
+                    handle_server_frame(frame, frame_len, sockfd);
+                }
+            }
+            else
+            {
+                if (bytes_received == 0)
                 {
-                    fprintf(stderr, "Client receive buffer overflow. Discarding data.\n");
-                    client_recv_buffer_len = 0;
+                    printf("Disconnected from server.\n");
                 }
                 else
                 {
-                    memcpy(client_recv_buffer + client_recv_buffer_len, temp_buf, bytes_received);
-                    client_recv_buffer_len += bytes_received;
-                    client_recv_buffer[client_recv_buffer_len] = '\0';
+                    perror("recv error");
                 }
-
-                char *current_pos = client_recv_buffer;
-                char *newline_ptr;
-                while ((newline_ptr = strchr(current_pos, '\n')) != NULL)
+                close(sockfd);
+                sockfd = -1;
+                cancel_turn(); // A resumed seat gets a fresh 'your_turn'
+                if (client_session_token[0] != '\0')
                 {
-                    int message_len = newline_ptr - current_pos;
-                    char single_json_message[message_len + 1];
-                    strncpy(single_json_message, current_pos, message_len);
-                    single_json_message[message_len] = '\0';
-
-                    handle_server_message(single_json_message, sockfd);
-
-                    current_pos = newline_ptr + 1;
+                    printf("Reconnecting...\n");
+                    sockfd = reconnect_to_server(server_ip, server_port);
                 }
-
-                int remaining_len = client_recv_buffer_len - (current_pos - client_recv_buffer);
-                if (remaining_len > 0 && current_pos != client_recv_buffer)
+                if (sockfd == -1)
                 {
-                    memmove(client_recv_buffer, current_pos, remaining_len);
+                    fprintf(stderr, "Disconnected from server. Exiting.\n");
+                    if (matrix_ptr)
+                        cleanup_matrix(matrix_ptr); // Cleanup matrix
+                    exit(1);
                 }
-                client_recv_buffer_len = remaining_len;
-                client_recv_buffer[client_recv_buffer_len] = '\0';
-            }
-            else if (bytes_received == 0)
-            {
-                printf("Disconnected from server. Exiting.\n");
-                if (matrix_ptr)
-                    cleanup_matrix(matrix_ptr); // Cleanup matrix
-                close(sockfd);
-                exit(1);
-            }
-            else
-            {
-                perror("recv error");
-                fprintf(stderr, "Disconnected from server. Exiting.\n");
-                if (matrix_ptr)
-                    cleanup_matrix(matrix_ptr); // Cleanup matrix
-                close(sockfd);
-                exit(1);
             }
         }
     }
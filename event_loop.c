@@ -0,0 +1,791 @@
+#include "event_loop.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <stdint.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define EPOLL_BATCH_MAX 256
+
+// --- io_uring backend ---
+// Raw system calls instead of liburing, so the server builds without extra libraries.
+// Readiness uses one-shot IORING_OP_POLL_ADD requests that are re-armed on the next wait,
+// which keeps the level-triggered behaviour of epoll (multishot polls only fire on new
+// wake-ups, so bytes left in a socket after a partial read would never be reported).
+
+#define URING_ENTRIES 1024
+#define URING_KIND_SEND 0 // user_data is a UringSend pointer (malloc alignment leaves the low bits clear)
+#define URING_KIND_POLL 1 // user_data is fd << 32 | generation << 2 | kind
+#define URING_KIND_IGNORE 2
+#define URING_GEN_MASK 0x3fffffffu
+
+typedef struct UringSend UringSend;
+
+typedef struct
+{
+    uint32_t gen;        // Bumped on every add/remove so completions of an old poll are ignored
+    uint8_t registered;
+    uint16_t queued;     // Sends waiting in the pending list
+    uint16_t submitted;  // Sends in the submission ring or in the kernel
+    int error;           // errno of the first send that failed in the kernel, 0 if none
+    UringSend *backlog;  // Sends queued while earlier ones were in the kernel, in order
+    UringSend *backlog_tail;
+} UringFdState;
+
+typedef struct
+{
+    int fd;
+    uint32_t gen;
+} UringReady;
+
+struct UringSend
+{
+    int fd;
+    unsigned long seq; // Queue order, kept when the pending list is grouped by socket
+    UringSend *next;   // Next send in the socket's backlog
+    size_t len;
+    char data[];
+};
+
+struct EventLoopUring
+{
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned sq_local_tail; // Next submission slot; published to the kernel before each enter
+
+    int max_fds;
+    UringFdState *fds;
+    UringSend **pending;
+    int num_pending, pending_capacity;
+    unsigned long next_seq;
+    UringReady *rearm; // Reported to the caller by the last wait, polled again by the next one
+    int num_rearm;
+    UringReady *ready; // Completed polls not reported yet
+    int num_ready;
+    int *released; // Sockets whose in-flight chain completed with a backlog left to submit
+    int num_released;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static uint64_t uring_poll_data(int fd, uint32_t gen)
+{
+    return ((uint64_t)(uint32_t)fd << 32) | ((uint64_t)(gen & URING_GEN_MASK) << 2) | URING_KIND_POLL;
+}
+
+static void uring_drop_backlog(struct EventLoopUring *u, int fd)
+{
+    while (u->fds[fd].backlog)
+    {
+        UringSend *op = u->fds[fd].backlog;
+        u->fds[fd].backlog = op->next;
+        free(op);
+    }
+    u->fds[fd].backlog_tail = NULL;
+}
+
+static void uring_free(struct EventLoopUring *u)
+{
+    if (u->sqes && u->sqes != MAP_FAILED)
+        munmap(u->sqes, u->sqes_size);
+    if (u->cq_ring && u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring)
+        munmap(u->cq_ring, u->cq_ring_size);
+    if (u->sq_ring && u->sq_ring != MAP_FAILED)
+        munmap(u->sq_ring, u->sq_ring_size);
+    if (u->ring_fd != -1)
+        close(u->ring_fd);
+    for (int i = 0; i < u->num_pending; i++)
+        free(u->pending[i]);
+    free(u->pending);
+    if (u->fds)
+    {
+        for (int fd = 0; fd < u->max_fds; fd++)
+            uring_drop_backlog(u, fd);
+    }
+    free(u->fds);
+    free(u->rearm);
+    free(u->ready);
+    free(u->released);
+    free(u);
+}
+
+static struct EventLoopUring *uring_create(int max_fds)
+{
+    struct EventLoopUring *u = calloc(1, sizeof(*u));
+    if (!u)
+        return NULL;
+    u->ring_fd = -1;
+    u->max_fds = max_fds;
+    u->fds = calloc((size_t)max_fds, sizeof(UringFdState));
+    u->rearm = malloc((size_t)max_fds * sizeof(UringReady));
+    u->ready = malloc((size_t)max_fds * sizeof(UringReady));
+    u->released = malloc((size_t)max_fds * sizeof(int));
+    if (!u->fds || !u->rearm || !u->ready || !u->released)
+    {
+        uring_free(u);
+        return NULL;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER; // Each loop is used by one thread
+    u->ring_fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (u->ring_fd == -1 && errno == EINVAL)
+    {
+        memset(&params, 0, sizeof(params)); // Older kernel: no optional flags
+        u->ring_fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    }
+    if (u->ring_fd == -1 || !(params.features & IORING_FEAT_EXT_ARG))
+    {
+        if (u->ring_fd != -1)
+            errno = ENOSYS; // Waiting with a timeout needs IORING_ENTER_EXT_ARG (Linux 5.11)
+        uring_free(u);
+        return NULL;
+    }
+
+    u->sq_entries = params.sq_entries;
+    u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP && u->cq_ring_size > u->sq_ring_size)
+        u->sq_ring_size = u->cq_ring_size;
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED)
+    {
+        uring_free(u);
+        return NULL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        u->cq_ring = u->sq_ring;
+    else
+        u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+    u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if (u->cq_ring == MAP_FAILED || u->sqes == MAP_FAILED)
+    {
+        uring_free(u);
+        return NULL;
+    }
+
+    char *sq = u->sq_ring;
+    char *cq = u->cq_ring;
+    u->sq_head = (unsigned *)(sq + params.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + params.sq_off.array);
+    u->cq_head = (unsigned *)(cq + params.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    u->sq_local_tail = *u->sq_tail;
+    return u;
+}
+
+// Submits every queued entry and, if 'min_complete' > 0, waits for that many completions
+// (at most 'timeout_ms' when it is not negative). Returns 0, or -1 with errno set.
+static int uring_enter(struct EventLoopUring *u, unsigned min_complete, int timeout_ms)
+{
+    __atomic_store_n(u->sq_tail, u->sq_local_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void *argp = NULL;
+    size_t arg_size = 0;
+    if (min_complete && timeout_ms >= 0)
+    {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        arg_size = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    if (to_submit == 0 && min_complete == 0)
+        return 0;
+    if (sys_io_uring_enter(u->ring_fd, to_submit, min_complete, flags, argp, arg_size) < 0)
+        return errno == ETIME || errno == EINTR ? 0 : -1;
+    return 0;
+}
+
+// Returns a cleared submission entry, submitting what is queued if the ring is full
+static struct io_uring_sqe *uring_get_sqe(struct EventLoopUring *u)
+{
+    if (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)
+    {
+        uring_enter(u, 0, -1);
+        if (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)
+            return NULL;
+    }
+    unsigned index = u->sq_local_tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    u->sq_local_tail++;
+    return sqe;
+}
+
+static unsigned uring_sq_space(struct EventLoopUring *u)
+{
+    return u->sq_entries - (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE));
+}
+
+static int uring_arm_poll(struct EventLoopUring *u, int fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe)
+    {
+        errno = EBUSY;
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = uring_poll_data(fd, u->fds[fd].gen);
+    return 0;
+}
+
+// Takes every available completion: finished sends are freed, readable sockets are
+// appended to the ready list. A failed send is kept as the socket's error and returned by
+// its next send; the rest of its chain completes with -ECANCELED and its backlog is dropped.
+// When a socket's last send in the kernel completes, its backlog is released for submission.
+static void uring_reap(struct EventLoopUring *u)
+{
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        uint64_t data = cqe->user_data;
+        unsigned kind = (unsigned)(data & 3);
+        if (kind == URING_KIND_SEND)
+        {
+            UringSend *op = (UringSend *)(uintptr_t)data;
+            UringFdState *state = &u->fds[op->fd];
+            if (state->error == 0 && cqe->res < 0 && cqe->res != -ECANCELED)
+                state->error = -cqe->res;
+            else if (state->error == 0 && cqe->res >= 0 && (size_t)cqe->res < op->len)
+                state->error = EPIPE; // MSG_WAITALL only stops short when the connection is gone
+            if (state->error != 0)
+                uring_drop_backlog(u, op->fd);
+            if (state->submitted > 0)
+                state->submitted--;
+            if (state->submitted == 0 && state->backlog)
+                u->released[u->num_released++] = op->fd;
+            free(op);
+        }
+        else if (kind == URING_KIND_POLL)
+        {
+            int fd = (int)(data >> 32);
+            uint32_t gen = (uint32_t)(data >> 2) & URING_GEN_MASK;
+            if (fd < u->max_fds && u->fds[fd].registered && (u->fds[fd].gen & URING_GEN_MASK) == gen &&
+                u->num_ready < u->max_fds)
+            {
+                u->ready[u->num_ready].fd = fd;
+                u->ready[u->num_ready].gen = gen;
+                u->num_ready++;
+            }
+        }
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int compare_uring_sends(const void *a, const void *b)
+{
+    const UringSend *x = *(UringSend *const *)a;
+    const UringSend *y = *(UringSend *const *)b;
+    if (x->fd != y->fd)
+        return x->fd < y->fd ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq ? 1 : 0);
+}
+
+// Puts one send into the submission ring, linked to the next one if 'link' is set.
+// Returns -1 (and drops the send) if the ring stays full.
+static int uring_submit_send(struct EventLoopUring *u, UringSend *op, int link)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe)
+    {
+        fprintf(stderr, "Server: io_uring submission ring full, dropping a message for socket %d\n", op->fd);
+        free(op);
+        return -1;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = op->fd;
+    sqe->addr = (uint64_t)(uintptr_t)op->data;
+    sqe->len = (uint32_t)op->len;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    if (link)
+        sqe->flags |= IOSQE_IO_LINK;
+    u->fds[op->fd].submitted++;
+    return 0;
+}
+
+// Moves the released backlogs and the pending sends to the submission ring, one linked chain per socket
+static void uring_flush_sends(struct EventLoopUring *u)
+{
+    for (int i = 0; i < u->num_released; i++)
+    {
+        int fd = u->released[i];
+        int count = 0;
+        for (UringSend *op = u->fds[fd].backlog; op; op = op->next)
+            count++;
+        if (count == 0)
+            continue; // Dropped after a failed send
+        if (uring_sq_space(u) < (unsigned)count)
+            uring_enter(u, 0, -1);
+        UringSend *op = u->fds[fd].backlog;
+        u->fds[fd].backlog = NULL;
+        u->fds[fd].backlog_tail = NULL;
+        while (op)
+        {
+            UringSend *next = op->next;
+            uring_submit_send(u, op, next != NULL);
+            op = next;
+        }
+    }
+    u->num_released = 0;
+
+    if (u->num_pending == 0)
+        return;
+    qsort(u->pending, (size_t)u->num_pending, sizeof(UringSend *), compare_uring_sends);
+
+    int i = 0;
+    while (i < u->num_pending)
+    {
+        int end = i;
+        while (end < u->num_pending && u->pending[end]->fd == u->pending[i]->fd)
+            end++;
+        if (uring_sq_space(u) < (unsigned)(end - i))
+            uring_enter(u, 0, -1); // Keep each chain within one submission
+
+        for (int k = i; k < end; k++)
+        {
+            u->fds[u->pending[k]->fd].queued--;
+            uring_submit_send(u, u->pending[k], k + 1 < end);
+        }
+        i = end;
+    }
+    u->num_pending = 0;
+}
+
+static long elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000L + (now.tv_nsec - start->tv_nsec) / 1000000L;
+}
+
+// Submits everything and waits at most 'timeout_ms' until no send for 'fd' is left queued,
+// in its backlog or in the kernel; sends to a peer with socket space complete during the
+// submission itself. Sends still stuck after that are cut off: the connection is shut down,
+// so they fail at once, and its backlog is dropped. Returns 0, or -1 if it was cut off.
+static int uring_drain_sends(struct EventLoopUring *u, int fd, int timeout_ms)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uring_flush_sends(u);
+    uring_enter(u, 0, -1);
+    uring_reap(u);
+    while (u->fds[fd].submitted > 0)
+    {
+        long left = timeout_ms - elapsed_ms_since(&start);
+        if (left <= 0)
+            break;
+        if (uring_enter(u, 1, (int)left) == -1)
+        {
+            perror("io_uring_enter");
+            break;
+        }
+        uring_reap(u);
+        uring_flush_sends(u); // A backlog released by the reap is the next chain
+    }
+    if (u->fds[fd].submitted == 0 && u->fds[fd].backlog == NULL)
+        return 0;
+
+    fprintf(stderr, "Server: socket %d does not take its pending messages; shutting it down.\n", fd);
+    uring_drop_backlog(u, fd);
+    shutdown(fd, SHUT_RDWR); // Wakes the blocked sends with EPIPE
+    while (u->fds[fd].submitted > 0)
+    {
+        if (uring_enter(u, 1, -1) == -1)
+        {
+            perror("io_uring_enter");
+            break;
+        }
+        uring_reap(u);
+    }
+    return -1;
+}
+
+static int uring_add(struct EventLoopUring *u, int fd)
+{
+    if (fd < 0 || fd >= u->max_fds)
+    {
+        errno = EMFILE;
+        return -1;
+    }
+    u->fds[fd].gen++;
+    u->fds[fd].registered = 1;
+    u->fds[fd].error = 0;
+    if (uring_arm_poll(u, fd) == -1)
+    {
+        u->fds[fd].registered = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void uring_remove(struct EventLoopUring *u, int fd, int timeout_ms)
+{
+    if (fd < 0 || fd >= u->max_fds)
+        return;
+    if (u->fds[fd].registered)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(u);
+        if (sqe)
+        {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = uring_poll_data(fd, u->fds[fd].gen);
+            sqe->user_data = URING_KIND_IGNORE;
+        }
+        u->fds[fd].registered = 0;
+        u->fds[fd].gen++; // Late completions of the old poll no longer match
+    }
+    if (u->fds[fd].queued > 0 || u->fds[fd].submitted > 0 || u->fds[fd].backlog)
+        uring_drain_sends(u, fd, timeout_ms);
+    u->fds[fd].error = 0;
+}
+
+// Queues 'len' bytes, followed by a '\n' if 'add_newline' is set
+static int uring_queue_send(struct EventLoopUring *u, int fd, const char *message, size_t len, int add_newline)
+{
+    if (fd < 0 || fd >= u->max_fds)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (u->fds[fd].error != 0)
+    {
+        errno = u->fds[fd].error; // An earlier send failed; the caller drops the connection as with epoll
+        return -1;
+    }
+    // Sends from an earlier submission may still be waiting for socket space: this one joins
+    // the socket's backlog, which is submitted as the next chain once they complete
+    int to_backlog = u->fds[fd].submitted > 0 || u->fds[fd].backlog != NULL;
+
+    if (!to_backlog && u->num_pending == u->pending_capacity)
+    {
+        int capacity = u->pending_capacity ? u->pending_capacity * 2 : 64;
+        UringSend **grown = realloc(u->pending, (size_t)capacity * sizeof(UringSend *));
+        if (!grown)
+            return -1;
+        u->pending = grown;
+        u->pending_capacity = capacity;
+    }
+    UringSend *op = malloc(sizeof(UringSend) + len + 1);
+    if (!op)
+        return -1;
+    op->fd = fd;
+    op->seq = u->next_seq++;
+    op->len = len + (add_newline ? 1 : 0);
+    memcpy(op->data, message, len);
+    op->data[len] = '\n';
+    op->next = NULL;
+    if (to_backlog)
+    {
+        if (u->fds[fd].backlog_tail)
+            u->fds[fd].backlog_tail->next = op;
+        else
+            u->fds[fd].backlog = op;
+        u->fds[fd].backlog_tail = op;
+        return 0;
+    }
+    u->pending[u->num_pending++] = op;
+    u->fds[fd].queued++;
+    return 0;
+}
+
+static int uring_wait(struct EventLoopUring *u, int *ready_fds, int max_ready, int timeout_ms)
+{
+    // Poll again the sockets reported last time; the caller has read from them since
+    for (int i = 0; i < u->num_rearm; i++)
+    {
+        int fd = u->rearm[i].fd;
+        if (u->fds[fd].registered && (u->fds[fd].gen & URING_GEN_MASK) == u->rearm[i].gen)
+            uring_arm_poll(u, fd);
+    }
+    u->num_rearm = 0;
+    uring_reap(u);
+    uring_flush_sends(u);
+
+    if (uring_enter(u, u->num_ready > 0 ? 0 : 1, timeout_ms) == -1)
+        return -1;
+    uring_reap(u);
+
+    int n = 0;
+    int kept = 0;
+    for (int i = 0; i < u->num_ready; i++)
+    {
+        int fd = u->ready[i].fd;
+        if (!u->fds[fd].registered || (u->fds[fd].gen & URING_GEN_MASK) != u->ready[i].gen)
+            continue; // Removed after the poll completed
+        if (n < max_ready)
+        {
+            ready_fds[n++] = fd;
+            u->rearm[u->num_rearm++] = u->ready[i];
+        }
+        else
+        {
+            u->ready[kept++] = u->ready[i];
+        }
+    }
+    u->num_ready = kept;
+    return n;
+}
+
+// --- End io_uring backend ---
+
+
+EventLoopBackend event_loop_default_backend(void)
+{
+    const char *value = getenv("OCTAFLIP_EVENT_LOOP");
+    if (value == NULL || strcasecmp(value, "epoll") == 0)
+        return EVENT_LOOP_EPOLL;
+    if (strcasecmp(value, "select") == 0)
+        return EVENT_LOOP_SELECT;
+    if (strcasecmp(value, "io_uring") == 0)
+        return EVENT_LOOP_IO_URING;
+    fprintf(stderr, "Server: Unknown OCTAFLIP_EVENT_LOOP '%s', using 'epoll'.\n", value);
+    return EVENT_LOOP_EPOLL;
+}
+
+const char *event_loop_backend_name(EventLoopBackend backend)
+{
+    switch (backend)
+    {
+    case EVENT_LOOP_EPOLL:
+        return "epoll";
+    case EVENT_LOOP_IO_URING:
+        return "io_uring";
+    default:
+        return "select";
+    }
+}
+
+int event_loop_init(EventLoop *loop, EventLoopBackend backend, int max_fds)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = -1;
+    loop->fd_max = -1;
+    FD_ZERO(&loop->master_fds);
+
+    if (backend == EVENT_LOOP_IO_URING)
+    {
+        loop->uring = uring_create(max_fds);
+        if (loop->uring)
+        {
+            loop->backend = EVENT_LOOP_IO_URING;
+            return 0;
+        }
+        perror("io_uring_setup, falling back to epoll");
+        backend = EVENT_LOOP_EPOLL;
+    }
+    if (backend == EVENT_LOOP_EPOLL)
+    {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd != -1)
+        {
+            loop->backend = EVENT_LOOP_EPOLL;
+            return 0;
+        }
+        perror("epoll_create1, falling back to select");
+    }
+    loop->backend = EVENT_LOOP_SELECT;
+    return 0;
+}
+
+int event_loop_add(EventLoop *loop, int fd)
+{
+    if (loop->backend == EVENT_LOOP_IO_URING)
+    {
+        return uring_add(loop->uring, fd);
+    }
+    if (loop->backend == EVENT_LOOP_EPOLL)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        errno = EMFILE;
+        return -1;
+    }
+    FD_SET(fd, &loop->master_fds);
+    if (fd > loop->fd_max)
+    {
+        loop->fd_max = fd;
+    }
+    return 0;
+}
+
+// Stops watching a descriptor; with io_uring its sends get at most 'drain_ms' to complete
+static void remove_descriptor(EventLoop *loop, int fd, int drain_ms)
+{
+    if (loop->backend == EVENT_LOOP_IO_URING)
+    {
+        uring_remove(loop->uring, fd, drain_ms);
+        return;
+    }
+    if (loop->backend == EVENT_LOOP_EPOLL)
+    {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        return;
+    }
+
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        return;
+    }
+    FD_CLR(fd, &loop->master_fds);
+    while (loop->fd_max >= 0 && !FD_ISSET(loop->fd_max, &loop->master_fds))
+    {
+        loop->fd_max--;
+    }
+}
+
+void event_loop_remove(EventLoop *loop, int fd)
+{
+    remove_descriptor(loop, fd, EVENT_LOOP_HANDOFF_DRAIN_MS);
+}
+
+void event_loop_remove_for_close(EventLoop *loop, int fd)
+{
+    remove_descriptor(loop, fd, 0);
+}
+
+int event_loop_wait(EventLoop *loop, int *ready_fds, int max_ready, int timeout_ms)
+{
+    if (loop->backend == EVENT_LOOP_IO_URING)
+    {
+        return uring_wait(loop->uring, ready_fds, max_ready, timeout_ms);
+    }
+    if (loop->backend == EVENT_LOOP_EPOLL)
+    {
+        struct epoll_event events[EPOLL_BATCH_MAX];
+        int n = epoll_wait(loop->epoll_fd, events, max_ready < EPOLL_BATCH_MAX ? max_ready : EPOLL_BATCH_MAX, timeout_ms);
+        if (n < 0)
+        {
+            return errno == EINTR ? 0 : -1;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            ready_fds[i] = events[i].data.fd;
+        }
+        return n;
+    }
+
+    fd_set read_fds = loop->master_fds;
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    int activity = select(loop->fd_max + 1, &read_fds, NULL, NULL, &tv);
+    if (activity < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int n = 0;
+    for (int fd = 0; fd <= loop->fd_max && n < activity && n < max_ready; fd++)
+    {
+        if (FD_ISSET(fd, &read_fds))
+        {
+            ready_fds[n++] = fd;
+        }
+    }
+    return n;
+}
+
+int event_loop_send_line(EventLoop *loop, int fd, const char *message, size_t len)
+{
+    if (loop->backend == EVENT_LOOP_IO_URING)
+    {
+        return uring_queue_send(loop->uring, fd, message, len, 1);
+    }
+
+    // One syscall, so the message and its delimiter leave in the same segment
+    struct iovec iov[2] = {{(void *)message, len}, {"\n", 1}};
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent == -1)
+    {
+        return -1;
+    }
+    if ((size_t)sent < len + 1)
+    {
+        // Short write on a full socket buffer: send the rest the way two send() calls would
+        size_t done = (size_t)sent;
+        if (done < len && send(fd, message + done, len - done, MSG_NOSIGNAL) == -1)
+            return -1;
+        if (send(fd, "\n", 1, MSG_NOSIGNAL) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+int event_loop_send(EventLoop *loop, int fd, const void *data, size_t len)
+{
+    if (loop->backend == EVENT_LOOP_IO_URING)
+    {
+        return uring_queue_send(loop->uring, fd, data, len, 0);
+    }
+    return send(fd, data, len, MSG_NOSIGNAL) == -1 ? -1 : 0;
+}
+
+void event_loop_close(EventLoop *loop)
+{
+    if (loop->uring)
+    {
+        uring_free(loop->uring);
+        loop->uring = NULL;
+    }
+    if (loop->epoll_fd != -1)
+    {
+        close(loop->epoll_fd);
+        loop->epoll_fd = -1;
+    }
+}
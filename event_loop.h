@@ -0,0 +1,116 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stddef.h>
+#include <sys/select.h>
+
+// Readiness-based event loop used by every server worker thread.
+// Each thread owns one loop; only sockets registered with that loop are reported to it.
+
+#define EVENT_LOOP_HANDOFF_DRAIN_MS 200 // io_uring: longest wait for a handed-off socket's sends
+
+typedef enum
+{
+    EVENT_LOOP_EPOLL,
+    EVENT_LOOP_SELECT,  // Portable fallback, limited to descriptors below FD_SETSIZE
+    EVENT_LOOP_IO_URING // Opt-in: readiness polls and queued sends share one io_uring_enter() per wake-up
+} EventLoopBackend;
+
+struct EventLoopUring; // Private state of the io_uring backend
+
+typedef struct
+{
+    EventLoopBackend backend;
+    int epoll_fd;
+    fd_set master_fds; // Select backend only
+    int fd_max;        // Select backend only
+    struct EventLoopUring *uring; // io_uring backend only
+} EventLoop;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Picks the backend from OCTAFLIP_EVENT_LOOP ("epoll", "select" or "io_uring"), epoll by default.
+ */
+EventLoopBackend event_loop_default_backend(void);
+
+/**
+ * @brief Returns the name of a backend for log messages.
+ */
+const char *event_loop_backend_name(EventLoopBackend backend);
+
+/**
+ * @brief Creates an empty loop. io_uring falls back to epoll, and epoll to select(), when
+ * the kernel does not provide them.
+ *
+ * @param max_fds Descriptors handled by the loop are below this value.
+ * @return int 0 on success, -1 on failure.
+ */
+int event_loop_init(EventLoop *loop, EventLoopBackend backend, int max_fds);
+
+/**
+ * @brief Starts reporting a descriptor whenever it is readable (level-triggered).
+ *
+ * @return int 0 on success, -1 if the descriptor cannot be watched (errno is set).
+ */
+int event_loop_add(EventLoop *loop, int fd);
+
+/**
+ * @brief Stops reporting a descriptor that stays open, e.g. before handing it to another
+ * thread's loop.
+ *
+ * With io_uring the sends queued for it must complete first, so the next owner's sends
+ * cannot overtake them. They get at most EVENT_LOOP_HANDOFF_DRAIN_MS; a peer that does not
+ * take them by then is shut down, so wherever the descriptor goes next it reads end of
+ * file and is dropped like any closed connection.
+ */
+void event_loop_remove(EventLoop *loop, int fd);
+
+/**
+ * @brief Stops reporting a descriptor that is about to be closed.
+ *
+ * With io_uring, queued sends are submitted and those the peer has room for complete; any
+ * still waiting for socket space are cut off by shutting the connection down rather than
+ * waited for, so a peer that stopped reading never holds up the worker.
+ */
+void event_loop_remove_for_close(EventLoop *loop, int fd);
+
+/**
+ * @brief Waits until at least one descriptor is readable or the timeout expires.
+ *
+ * @param ready_fds Out: readable descriptors.
+ * @param max_ready Capacity of ready_fds; descriptors beyond it are reported by the next call.
+ * @param timeout_ms Upper bound on the wait in milliseconds.
+ * @return int Number of descriptors written (0 on timeout or signal), -1 on error.
+ */
+int event_loop_wait(EventLoop *loop, int *ready_fds, int max_ready, int timeout_ms);
+
+/**
+ * @brief Sends one message followed by the newline delimiter on a socket of this loop.
+ *
+ * epoll and select send right away. io_uring copies the message and queues it; queued
+ * sends are submitted by the next event_loop_wait() or event_loop_remove(), and the sends
+ * queued for one socket in between go out as a linked chain so they stay in order. Sends
+ * queued while an earlier chain of the socket is still in the kernel wait in a per-socket
+ * backlog and go out as the next chain when it completes. A send that fails in the kernel
+ * makes the next send on the socket return -1 with its errno.
+ *
+ * @return int 0 on success (or once queued), -1 on failure (errno is set).
+ */
+int event_loop_send_line(EventLoop *loop, int fd, const char *message, size_t len);
+
+/**
+ * @brief Sends bytes as they are (e.g. a binary frame) on a socket of this loop.
+ *
+ * Same ordering and queueing as event_loop_send_line().
+ *
+ * @return int 0 on success (or once queued), -1 on failure (errno is set).
+ */
+int event_loop_send(EventLoop *loop, int fd, const void *data, size_t len);
+
+/**
+ * @brief Releases the resources of a loop. Registered descriptors stay open.
+ */
+void event_loop_close(EventLoop *loop);
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,267 @@
+#include "game_journal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int journal_fd = -1;
+static _Atomic int journal_dirty; // Written since the last fdatasync()
+
+typedef struct
+{
+    int interval_ms;
+    _Atomic int *dirty;
+    int (*flush)(void);
+    const char *what;
+} PeriodicSync;
+
+static uint64_t clock_ms(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+uint32_t game_journal_checksum(const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put_u16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void *sync_thread_main(void *arg)
+{
+    PeriodicSync *sync = arg;
+    struct timespec interval = {sync->interval_ms / 1000, (sync->interval_ms % 1000) * 1000000L};
+    while (1)
+    {
+        nanosleep(&interval, NULL);
+        if (atomic_exchange(sync->dirty, 0) && sync->flush() == -1)
+        {
+            perror(sync->what);
+        }
+    }
+    return NULL;
+}
+
+int game_journal_start_sync(int interval_ms, _Atomic int *dirty, int (*flush)(void), const char *what)
+{
+    PeriodicSync *sync = malloc(sizeof(*sync)); // Owned by the thread, which runs until exit
+    pthread_t thread;
+    if (sync == NULL)
+        return -1;
+    sync->interval_ms = interval_ms;
+    sync->dirty = dirty;
+    sync->flush = flush;
+    sync->what = what;
+    if (pthread_create(&thread, NULL, sync_thread_main, sync) != 0)
+    {
+        free(sync);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+static int flush_journal(void)
+{
+    return fdatasync(journal_fd);
+}
+
+int game_journal_open(const char *path)
+{
+    journal_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journal_fd == -1)
+    {
+        perror("open journal");
+        return -1;
+    }
+    if (game_journal_start_sync(GAME_JOURNAL_SYNC_INTERVAL_MS, &journal_dirty, flush_journal, "fdatasync journal") != 0)
+    {
+        fprintf(stderr, "Server: Could not start the journal sync thread.\n");
+        close(journal_fd);
+        journal_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int game_journal_enabled(void)
+{
+    return journal_fd != -1;
+}
+
+void game_journal_begin(GameJournalGame *game, uint32_t room_id, const char *name_seat0, const char *name_seat1)
+{
+    game->room_id = room_id;
+    game->start_unix_ms = clock_ms(CLOCK_REALTIME);
+    game->start_mono_ms = clock_ms(CLOCK_MONOTONIC);
+    game->last_event_mono_ms = game->start_mono_ms;
+    game->duration_ms = 0;
+    game->end_reason = JOURNAL_END_FINISHED;
+    game->flags = 0;
+    game->scores[0] = game->scores[1] = 0;
+    strncpy(game->names[0], name_seat0, MAX_USERNAME_LEN - 1);
+    game->names[0][MAX_USERNAME_LEN - 1] = '\0';
+    strncpy(game->names[1], name_seat1, MAX_USERNAME_LEN - 1);
+    game->names[1][MAX_USERNAME_LEN - 1] = '\0';
+    game->num_events = 0;
+}
+
+void game_journal_event(GameJournalGame *game, GameJournalEventKind kind, int seat, int sx, int sy, int tx, int ty)
+{
+    if (game->num_events >= GAME_JOURNAL_MAX_EVENTS)
+    {
+        game->flags |= GAME_JOURNAL_FLAG_TRUNCATED;
+        return;
+    }
+    uint64_t now = clock_ms(CLOCK_MONOTONIC);
+    uint64_t delay = now - game->last_event_mono_ms;
+    game->last_event_mono_ms = now;
+    if (delay > 0xffff)
+        delay = 0xffff;
+
+    game->events[game->num_events++] = (uint32_t)(sx & 7) | (uint32_t)(sy & 7) << 3 | (uint32_t)(tx & 7) << 6 |
+                                       (uint32_t)(ty & 7) << 9 | (uint32_t)(kind & 7) << 12 | (uint32_t)(seat & 1) << 15 |
+                                       (uint32_t)delay << 16;
+}
+
+size_t game_journal_encode(const GameJournalGame *game, GameJournalEndReason end_reason, int score_seat0, int score_seat1,
+                           unsigned char *out, size_t out_size)
+{
+    size_t name_len[2];
+    for (int seat = 0; seat < 2; seat++)
+    {
+        name_len[seat] = strnlen(game->names[seat], MAX_USERNAME_LEN - 1);
+    }
+    size_t length = GAME_JOURNAL_HEADER_SIZE + name_len[0] + name_len[1] + 4 * (size_t)game->num_events + 4;
+    if (length > out_size)
+        return 0;
+
+    uint64_t duration = game->last_event_mono_ms - game->start_mono_ms;
+    put_u32(out, GAME_JOURNAL_MAGIC);
+    put_u32(out + 4, (uint32_t)length);
+    put_u32(out + 8, game->room_id);
+    put_u64(out + 12, game->start_unix_ms);
+    put_u32(out + 20, duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration);
+    put_u16(out + 24, game->num_events);
+    out[26] = (unsigned char)end_reason;
+    out[27] = game->flags;
+    out[28] = (unsigned char)(score_seat0 < 0 ? 0 : score_seat0 > 255 ? 255 : score_seat0);
+    out[29] = (unsigned char)(score_seat1 < 0 ? 0 : score_seat1 > 255 ? 255 : score_seat1);
+    out[30] = (unsigned char)name_len[0];
+    out[31] = (unsigned char)name_len[1];
+
+    unsigned char *p = out + GAME_JOURNAL_HEADER_SIZE;
+    memcpy(p, game->names[0], name_len[0]);
+    p += name_len[0];
+    memcpy(p, game->names[1], name_len[1]);
+    p += name_len[1];
+    for (int i = 0; i < game->num_events; i++, p += 4)
+        put_u32(p, game->events[i]);
+    put_u32(p, game_journal_checksum(out, length - 4));
+    return length;
+}
+
+int game_journal_decode(const unsigned char *data, size_t size, GameJournalGame *out, size_t *out_length)
+{
+    if (size < GAME_JOURNAL_HEADER_SIZE)
+        return 0;
+    if (get_u32(data) != GAME_JOURNAL_MAGIC)
+        return -1;
+
+    size_t length = get_u32(data + 4);
+    uint16_t num_events = get_u16(data + 24);
+    size_t name_len[2] = {data[30], data[31]};
+    if (num_events > GAME_JOURNAL_MAX_EVENTS || name_len[0] >= MAX_USERNAME_LEN || name_len[1] >= MAX_USERNAME_LEN ||
+        length != GAME_JOURNAL_HEADER_SIZE + name_len[0] + name_len[1] + 4 * (size_t)num_events + 4)
+        return -1;
+    *out_length = length;
+    if (size < length)
+        return 0;
+    if (get_u32(data + length - 4) != game_journal_checksum(data, length - 4))
+        return -1;
+
+    out->room_id = get_u32(data + 8);
+    out->start_unix_ms = get_u64(data + 12);
+    out->duration_ms = get_u32(data + 20);
+    out->num_events = num_events;
+    out->end_reason = data[26];
+    out->flags = data[27];
+    out->scores[0] = data[28];
+    out->scores[1] = data[29];
+    const unsigned char *p = data + GAME_JOURNAL_HEADER_SIZE;
+    for (int seat = 0; seat < 2; seat++)
+    {
+        memcpy(out->names[seat], p, name_len[seat]);
+        out->names[seat][name_len[seat]] = '\0';
+        p += name_len[seat];
+    }
+    for (int i = 0; i < num_events; i++, p += 4)
+        out->events[i] = get_u32(p);
+    return 1;
+}
+
+void game_journal_append(const GameJournalGame *game, GameJournalEndReason end_reason, int score_seat0, int score_seat1)
+{
+    if (journal_fd == -1)
+        return;
+    unsigned char record[GAME_JOURNAL_MAX_RECORD];
+    size_t length = game_journal_encode(game, end_reason, score_seat0, score_seat1, record, sizeof(record));
+
+    // One write() per record: O_APPEND keeps it in one piece even with several workers writing
+    ssize_t written;
+    do
+    {
+        written = write(journal_fd, record, length);
+    } while (written == -1 && errno == EINTR);
+    if (written != (ssize_t)length)
+    {
+        perror("write journal");
+        return;
+    }
+    atomic_store(&journal_dirty, 1);
+}
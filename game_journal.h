@@ -0,0 +1,144 @@
+#ifndef GAME_JOURNAL_H
+#define GAME_JOURNAL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "protocol.h"
+
+// Append-only binary journal of finished games.
+// A game is collected in memory while it runs and appended with a single write() as one
+// self-contained record when its room is released, so a crash of the server process loses
+// no finished game. A background thread fdatasync()s the file at most once per
+// GAME_JOURNAL_SYNC_INTERVAL_MS, which bounds what a power loss can take.
+//
+// Record layout (little-endian):
+//   0  u32  magic "OFG1"
+//   4  u32  record length in bytes, checksum included
+//   8  u32  room id
+//  12  u64  start time, Unix milliseconds
+//  20  u32  duration in milliseconds
+//  24  u16  event count
+//  26  u8   end reason (GameJournalEndReason)
+//  27  u8   flags (GAME_JOURNAL_FLAG_*)
+//  28  u8   final score of seat 0 ('R'), u8 final score of seat 1 ('B')
+//  30  u8   name length of seat 0, u8 name length of seat 1
+//  32       names, seat 0 then seat 1, not NUL-terminated
+//   .  u32  events (see below), one per turn
+//   .  u32  FNV-1a checksum of every byte before it
+//
+// Event word: bits 0-11 source row/col and target row/col (3 bits each, 0-indexed),
+// bits 12-14 kind, bit 15 seat, bits 16-31 milliseconds since the previous event
+// (since the game start for the first one), saturated at 65535.
+
+#define GAME_JOURNAL_MAGIC 0x3147464fu // "OFG1"
+#define GAME_JOURNAL_HEADER_SIZE 32
+#define GAME_JOURNAL_MAX_EVENTS 1024 // Turns kept per game; later ones set GAME_JOURNAL_FLAG_TRUNCATED
+#define GAME_JOURNAL_MAX_RECORD (GAME_JOURNAL_HEADER_SIZE + 2 * 255 + 4 * GAME_JOURNAL_MAX_EVENTS + 4)
+#define GAME_JOURNAL_SYNC_INTERVAL_MS 1000
+#define GAME_JOURNAL_FLAG_TRUNCATED 0x01
+
+typedef enum
+{
+    JOURNAL_EVENT_MOVE = 0,    // Legal move, applied to the board
+    JOURNAL_EVENT_PASS,        // Pass sent by the player
+    JOURNAL_EVENT_INVALID,     // Rejected move; the board is unchanged and the turn passes
+    JOURNAL_EVENT_TIMEOUT,     // No move within the turn timeout
+    JOURNAL_EVENT_DISCONNECT,  // The player to move disconnected
+    JOURNAL_EVENT_AUTO_PASS    // The player to move had already left
+} GameJournalEventKind;
+
+typedef enum
+{
+    JOURNAL_END_FINISHED = 0, // Regular game over (full board, no pieces or two passes)
+    JOURNAL_END_ABANDONED     // The room closed before the game was over
+} GameJournalEndReason;
+
+// A game being recorded (kept in its room) or decoded from the journal
+typedef struct
+{
+    uint32_t room_id;
+    uint64_t start_unix_ms;
+    uint64_t start_mono_ms;
+    uint64_t last_event_mono_ms;
+    uint32_t duration_ms;   // Decoded records only
+    uint8_t end_reason;     // Decoded records only
+    uint8_t flags;
+    uint8_t scores[2];      // Decoded records only
+    char names[2][MAX_USERNAME_LEN];
+    uint16_t num_events;
+    uint32_t events[GAME_JOURNAL_MAX_EVENTS];
+} GameJournalGame;
+
+static inline int game_journal_event_kind(uint32_t event) { return (int)((event >> 12) & 7); }
+static inline int game_journal_event_seat(uint32_t event) { return (int)((event >> 15) & 1); }
+static inline unsigned game_journal_event_delay_ms(uint32_t event) { return event >> 16; }
+static inline void game_journal_event_coords(uint32_t event, int *sx, int *sy, int *tx, int *ty)
+{
+    *sx = (int)(event & 7);
+    *sy = (int)((event >> 3) & 7);
+    *tx = (int)((event >> 6) & 7);
+    *ty = (int)((event >> 9) & 7);
+}
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Opens (or creates) the journal file for appending and starts the sync thread.
+ *
+ * @return int 0 on success, -1 on failure.
+ */
+int game_journal_open(const char *path);
+
+/**
+ * @brief Returns 1 once game_journal_open() has succeeded.
+ */
+int game_journal_enabled(void);
+
+/**
+ * @brief FNV-1a hash of 'len' bytes; the checksum of journal records and snapshot slots.
+ */
+uint32_t game_journal_checksum(const void *data, size_t len);
+
+/**
+ * @brief Starts a detached thread that calls 'flush' every 'interval_ms' milliseconds if
+ * '*dirty' was set since its last call, so workers never wait for the disk.
+ *
+ * @param what Named in the message printed when 'flush' fails (it returns -1 with errno set).
+ * @return int 0 on success, -1 if the thread could not be started.
+ */
+int game_journal_start_sync(int interval_ms, _Atomic int *dirty, int (*flush)(void), const char *what);
+
+/**
+ * @brief Starts recording a game. Seat 0 plays 'R'.
+ */
+void game_journal_begin(GameJournalGame *game, uint32_t room_id, const char *name_seat0, const char *name_seat1);
+
+/**
+ * @brief Records one turn. Coordinates are 0-indexed; out-of-range values are stored modulo 8
+ * (only rejected moves can have them).
+ */
+void game_journal_event(GameJournalGame *game, GameJournalEventKind kind, int seat, int sx, int sy, int tx, int ty);
+
+/**
+ * @brief Encodes a game and appends it to the journal file. Does nothing if the journal is not open.
+ */
+void game_journal_append(const GameJournalGame *game, GameJournalEndReason end_reason, int score_seat0, int score_seat1);
+
+/**
+ * @brief Encodes a game as one journal record.
+ *
+ * @return size_t Record length, or 0 if 'out_size' is too small.
+ */
+size_t game_journal_encode(const GameJournalGame *game, GameJournalEndReason end_reason, int score_seat0, int score_seat1,
+                           unsigned char *out, size_t out_size);
+
+/**
+ * @brief Decodes the record at the start of 'data'.
+ *
+ * @param out_length Out: length of the record, also set when the checksum fails.
+ * @return int 1 on success, 0 if more bytes are needed, -1 if the bytes are not a valid record.
+ */
+int game_journal_decode(const unsigned char *data, size_t size, GameJournalGame *out, size_t *out_length);
+
+#endif // GAME_JOURNAL_H
@@ -0,0 +1,89 @@
+#include "game_rules.h"
+#include <stdlib.h>
+
+int game_rules_is_legal_move(char board[8][9], int sx, int sy, int tx, int ty, char player_role)
+{
+    if (sx < 0 || sx >= 8 || sy < 0 || sy >= 8 || tx < 0 || tx >= 8 || ty < 0 || ty >= 8)
+        return 0;
+    if (board[sx][sy] != player_role || board[tx][ty] != '.')
+        return 0;
+
+    int dr = abs(sx - tx);
+    int dc = abs(sy - ty);
+    return (dr <= 2 && dc <= 2) && (dr > 0 || dc > 0);
+}
+
+int game_rules_apply_move(char board[8][9], int sx, int sy, int tx, int ty, char player_role, uint64_t *flipped_mask)
+{
+    if (!game_rules_is_legal_move(board, sx, sy, tx, ty, player_role))
+        return -1;
+
+    // Distance 2 is a jump (the source empties), distance 1 a clone
+    if (abs(sx - tx) == 2 || abs(sy - ty) == 2)
+    {
+        board[sx][sy] = '.';
+    }
+    board[tx][ty] = player_role;
+
+    char opponent_role = (player_role == 'R') ? 'B' : 'R';
+    uint64_t mask = 0;
+    int flips = 0;
+    for (int r = tx - 1; r <= tx + 1; ++r)
+    {
+        for (int c = ty - 1; c <= ty + 1; ++c)
+        {
+            if (r < 0 || r >= 8 || c < 0 || c >= 8 || board[r][c] != opponent_role)
+                continue;
+            board[r][c] = player_role;
+            mask |= (uint64_t)1 << (r * 8 + c);
+            flips++;
+        }
+    }
+
+    if (flipped_mask)
+        *flipped_mask = mask;
+    return flips;
+}
+
+int game_rules_list_moves(char board[8][9], char player_role, RulesMove *out_moves, int max_moves)
+{
+    int count = 0;
+    for (int sx = 0; sx < 8; ++sx)
+    {
+        for (int sy = 0; sy < 8; ++sy)
+        {
+            if (board[sx][sy] != player_role)
+                continue;
+            for (int tx = sx - 2; tx <= sx + 2; ++tx)
+            {
+                for (int ty = sy - 2; ty <= sy + 2; ++ty)
+                {
+                    if (tx < 0 || tx >= 8 || ty < 0 || ty >= 8 || board[tx][ty] != '.')
+                        continue;
+                    if (count == max_moves)
+                        return count;
+                    out_moves[count].sx = sx;
+                    out_moves[count].sy = sy;
+                    out_moves[count].tx = tx;
+                    out_moves[count].ty = ty;
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+int game_rules_count_pieces(char board[8][9], char player_role)
+{
+    int count = 0;
+    for (int r = 0; r < 8; ++r)
+    {
+        for (int c = 0; c < 8; ++c)
+        {
+            if (board[r][c] == player_role)
+                count++;
+        }
+    }
+    return count;
+}
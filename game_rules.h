@@ -0,0 +1,51 @@
+#ifndef GAME_RULES_H
+#define GAME_RULES_H
+
+#include <stdint.h>
+
+// OctaFlip move rules shared by the server and the headless tools.
+// Boards use the protocol layout: 8 rows of 8 cells ('R', 'B', '.' or '#') plus a NUL.
+// All coordinates here are 0-indexed (row, column).
+
+#define GAME_RULES_MAX_MOVES 1536 // Upper bound on the moves of one side (64 cells x 24 targets)
+
+typedef struct
+{
+    int sx, sy, tx, ty;
+} RulesMove;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Checks a move without changing the board.
+ *
+ * A move is legal if the source holds the player's piece, the target is empty ('.')
+ * and the target is at most 2 cells away in both directions.
+ *
+ * @return int 1 if the move is legal, 0 otherwise.
+ */
+int game_rules_is_legal_move(char board[8][9], int sx, int sy, int tx, int ty, char player_role);
+
+/**
+ * @brief Applies a legal move: clones (distance 1) or jumps (distance 2), then flips
+ * every opponent piece adjacent to the target.
+ *
+ * @param flipped_mask Optional out: bit (row * 8 + col) is set for each flipped cell.
+ * @return int Number of flipped pieces, or -1 if the move is illegal (board unchanged).
+ */
+int game_rules_apply_move(char board[8][9], int sx, int sy, int tx, int ty, char player_role, uint64_t *flipped_mask);
+
+/**
+ * @brief Lists every legal move of a player.
+ *
+ * @param out_moves Array of at least max_moves entries.
+ * @return int Number of moves written (0 means the player has to pass).
+ */
+int game_rules_list_moves(char board[8][9], char player_role, RulesMove *out_moves, int max_moves);
+
+/**
+ * @brief Counts the pieces of one player.
+ */
+int game_rules_count_pieces(char board[8][9], char player_role);
+
+#endif // GAME_RULES_H
@@ -0,0 +1,394 @@
+#include "game_snapshot.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FILE_HEADER_SIZE 4096 // Keeps the slots page-aligned
+#define STATE_SIZE offsetof(GameSnapshotRoom, events)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t slot_size;
+    uint32_t num_slots;
+} SnapshotFileHeader;
+
+// One copy of a slot's game header
+typedef struct
+{
+    uint32_t magic;                  // GAME_SNAPSHOT_SLOT_MAGIC once written, 0 when free
+    uint32_t checksum;               // FNV-1a of 'sequence' and 'state'
+    uint64_t sequence;               // Saves of the slot so far; the higher valid copy is current
+    unsigned char state[STATE_SIZE]; // GameSnapshotRoom up to 'events'
+} SlotHeader;
+
+#define SLOT_CHECKED_OFFSET offsetof(SlotHeader, sequence)
+#define SLOT_CHECKED_SIZE (offsetof(SlotHeader, state) + STATE_SIZE - SLOT_CHECKED_OFFSET)
+
+typedef struct
+{
+    SlotHeader headers[2];                    // Written in turn, by sequence number parity
+    uint32_t events[GAME_JOURNAL_MAX_EVENTS]; // Shared by both copies, see game_snapshot.h
+} SnapshotSlot;
+
+static unsigned char *mapping;
+static size_t mapping_size;
+static int mapped_slots;
+static uint64_t *slot_sequences; // Per mapped slot: sequence number of its current header copy
+static _Atomic int snapshot_dirty; // Written since the last msync()
+
+static GameSnapshotRoom *restored_rooms;
+static int num_restored_rooms;
+
+// The restored games also stay in "<path>.prev" until each has been saved to the new file
+// (or has ended) and that file is synced; a crash before then finds them there again.
+static char *previous_path;
+static _Atomic int *restored_done;  // Per restored game: saved again or ended
+static _Atomic int restored_pending; // Restored games not done yet
+static unsigned char *synced_done;   // restored_done as of the last msync() (sync thread only)
+static int previous_pending = -1;    // Games in the previous file, -1 once it is removed (sync thread only)
+
+static uint32_t header_checksum(const SlotHeader *header)
+{
+    return game_journal_checksum((const unsigned char *)header + SLOT_CHECKED_OFFSET, SLOT_CHECKED_SIZE);
+}
+
+static SnapshotSlot *slot_at(unsigned char *base, int slot)
+{
+    return (SnapshotSlot *)(base + FILE_HEADER_SIZE + (size_t)slot * sizeof(SnapshotSlot));
+}
+
+// Function to read the current game of a slot read back from the file
+// Copies the header of the newest valid copy into 'room' (not the events).
+// Returns 1 if the slot holds a usable game, 0 otherwise.
+static int read_slot(const SnapshotSlot *slot, GameSnapshotRoom *room)
+{
+    const SlotHeader *current = NULL;
+    for (int i = 0; i < 2; i++)
+    {
+        const SlotHeader *header = &slot->headers[i];
+        if (header->magic == GAME_SNAPSHOT_SLOT_MAGIC && header->checksum == header_checksum(header) &&
+            (current == NULL || header->sequence > current->sequence))
+            current = header;
+    }
+    if (current == NULL)
+        return 0;
+    memcpy(room, current->state, STATE_SIZE);
+    if (room->current_seat < 0 || room->current_seat > 1 || room->num_events > GAME_JOURNAL_MAX_EVENTS)
+        return 0;
+    return memchr(room->names[0], '\0', MAX_USERNAME_LEN) != NULL && memchr(room->names[1], '\0', MAX_USERNAME_LEN) != NULL;
+}
+
+// Helper function to check whether a game has been loaded already
+static int is_restored(uint32_t room_id)
+{
+    for (int i = 0; i < num_restored_rooms; i++)
+    {
+        if (restored_rooms[i].room_id == room_id)
+            return 1;
+    }
+    return 0;
+}
+
+// Function to add the valid games of a snapshot file to 'restored_rooms'
+// Games already loaded from a newer file are skipped. A missing file adds nothing.
+static void load_snapshot_file(const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        if (errno != ENOENT)
+            perror("open snapshot");
+        return;
+    }
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < FILE_HEADER_SIZE)
+    {
+        close(fd);
+        return;
+    }
+
+    unsigned char *old = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (old == MAP_FAILED)
+    {
+        perror("mmap snapshot");
+        return;
+    }
+    const SnapshotFileHeader *header = (const SnapshotFileHeader *)old;
+    if (header->magic != GAME_SNAPSHOT_FILE_MAGIC || header->slot_size != sizeof(SnapshotSlot) ||
+        FILE_HEADER_SIZE + (size_t)header->num_slots * sizeof(SnapshotSlot) > (size_t)st.st_size)
+    {
+        fprintf(stderr, "Server: Snapshot file %s has an unknown format; its games are not resumed.\n", path);
+        munmap(old, (size_t)st.st_size);
+        return;
+    }
+
+    GameSnapshotRoom room;
+    int num_valid = 0;
+    for (uint32_t s = 0; s < header->num_slots; s++)
+    {
+        num_valid += read_slot(slot_at(old, (int)s), &room);
+    }
+    if (num_valid > 0)
+    {
+        GameSnapshotRoom *grown = realloc(restored_rooms, (size_t)(num_restored_rooms + num_valid) * sizeof(GameSnapshotRoom));
+        if (grown == NULL)
+        {
+            perror("malloc restored rooms");
+            num_valid = 0;
+        }
+        else
+        {
+            restored_rooms = grown;
+        }
+    }
+    int num_loaded = num_restored_rooms;
+    for (uint32_t s = 0; s < header->num_slots && num_valid > 0; s++)
+    {
+        const SnapshotSlot *slot = slot_at(old, (int)s);
+        if (read_slot(slot, &room))
+        {
+            num_valid--;
+            if (!is_restored(room.room_id))
+            {
+                memcpy(room.events, slot->events, (size_t)room.num_events * sizeof(uint32_t));
+                restored_rooms[num_loaded++] = room;
+            }
+        }
+    }
+    num_restored_rooms = num_loaded;
+    munmap(old, (size_t)st.st_size);
+}
+
+// Function to write the restored games not done as of the last msync() to the previous file
+// Goes through a temporary file and rename(), so the previous file is always complete.
+static int write_previous_file(void)
+{
+    char temp_path[PATH_MAX];
+    int num_slots = 0;
+    SnapshotSlot *slot = calloc(1, sizeof(SnapshotSlot)); // One header copy is used, the other stays free
+    if (slot == NULL)
+        return -1;
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", previous_path);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        free(slot);
+        return -1;
+    }
+
+    unsigned char header_page[FILE_HEADER_SIZE] = {0};
+    SnapshotFileHeader *header = (SnapshotFileHeader *)header_page;
+    for (int i = 0; i < num_restored_rooms; i++)
+        num_slots += !synced_done[i];
+    header->magic = GAME_SNAPSHOT_FILE_MAGIC;
+    header->slot_size = sizeof(SnapshotSlot);
+    header->num_slots = (uint32_t)num_slots;
+    int failed = write(fd, header_page, sizeof(header_page)) != (ssize_t)sizeof(header_page);
+    for (int i = 0; i < num_restored_rooms && !failed; i++)
+    {
+        if (synced_done[i])
+            continue;
+        memcpy(slot->headers[0].state, &restored_rooms[i], STATE_SIZE);
+        memcpy(slot->events, restored_rooms[i].events, sizeof(slot->events));
+        slot->headers[0].sequence = 1;
+        slot->headers[0].checksum = header_checksum(&slot->headers[0]);
+        slot->headers[0].magic = GAME_SNAPSHOT_SLOT_MAGIC;
+        failed = write(fd, slot, sizeof(SnapshotSlot)) != (ssize_t)sizeof(SnapshotSlot);
+    }
+    free(slot);
+    if (failed || fsync(fd) == -1)
+    {
+        close(fd);
+        unlink(temp_path);
+        return -1;
+    }
+    close(fd);
+    if (rename(temp_path, previous_path) == -1)
+        return -1;
+    previous_pending = num_slots;
+    return 0;
+}
+
+// Marks a restored game as no longer needed from the previous file
+static void restored_room_done(uint32_t room_id)
+{
+    for (int i = 0; i < num_restored_rooms; i++)
+    {
+        if (restored_rooms[i].room_id == room_id && !atomic_exchange(&restored_done[i], 1))
+        {
+            atomic_fetch_sub(&restored_pending, 1); // After the slot write, which it publishes
+            atomic_store(&snapshot_dirty, 1);
+        }
+    }
+}
+
+// Syncs the mapping, then drops the restored games it now holds from the previous file
+static int flush_snapshot(void)
+{
+    int pending = 0;
+    for (int i = 0; i < num_restored_rooms; i++)
+    {
+        synced_done[i] = (unsigned char)atomic_load(&restored_done[i]); // Before msync(): their saves are in the synced pages
+        pending += !synced_done[i];
+    }
+    if (msync(mapping, mapping_size, MS_SYNC) == -1)
+        return -1;
+    if (previous_pending >= 0 && pending == 0)
+    {
+        if (unlink(previous_path) == -1 && errno != ENOENT)
+            return -1;
+        previous_pending = -1;
+    }
+    else if (previous_pending > pending && write_previous_file() == -1)
+    {
+        atomic_store(&snapshot_dirty, 1); // Try again next time
+        return -1;
+    }
+    return 0;
+}
+
+int game_snapshot_open(const char *path, int num_slots)
+{
+    size_t path_len = strlen(path);
+    previous_path = malloc(path_len + sizeof(".prev"));
+    if (previous_path == NULL)
+    {
+        perror("malloc snapshot path");
+        return -1;
+    }
+    memcpy(previous_path, path, path_len);
+    memcpy(previous_path + path_len, ".prev", sizeof(".prev"));
+
+    // The file holds the newest state of each game; the previous file those a crash kept from being saved again
+    load_snapshot_file(path);
+    load_snapshot_file(previous_path);
+    if (num_restored_rooms > 0)
+    {
+        restored_done = calloc((size_t)num_restored_rooms, sizeof(*restored_done));
+        synced_done = calloc((size_t)num_restored_rooms, 1);
+        if (restored_done == NULL || synced_done == NULL || write_previous_file() == -1)
+        {
+            perror("write previous snapshot");
+            return -1;
+        }
+        atomic_store(&restored_pending, num_restored_rooms);
+    }
+    else if (unlink(previous_path) == -1 && errno != ENOENT)
+    {
+        perror("unlink previous snapshot");
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        perror("open snapshot");
+        return -1;
+    }
+
+    // Truncating first drops the old slots without touching every page of the new file;
+    // the restored games are safe in the previous file until they are saved here again
+    size_t size = FILE_HEADER_SIZE + (size_t)num_slots * sizeof(SnapshotSlot);
+    slot_sequences = calloc((size_t)num_slots, sizeof(*slot_sequences));
+    if (slot_sequences == NULL)
+    {
+        perror("calloc snapshot slots");
+        close(fd);
+        return -1;
+    }
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, (off_t)size) == -1)
+    {
+        perror("ftruncate snapshot");
+        close(fd);
+        return -1;
+    }
+    unsigned char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap snapshot");
+        return -1;
+    }
+    SnapshotFileHeader *header = (SnapshotFileHeader *)base;
+    header->magic = GAME_SNAPSHOT_FILE_MAGIC;
+    header->slot_size = sizeof(SnapshotSlot);
+    header->num_slots = (uint32_t)num_slots;
+
+    mapping = base;
+    mapping_size = size;
+    mapped_slots = num_slots;
+    atomic_store(&snapshot_dirty, 1);
+    if (game_journal_start_sync(GAME_SNAPSHOT_SYNC_INTERVAL_MS, &snapshot_dirty, flush_snapshot, "msync snapshot") != 0)
+    {
+        fprintf(stderr, "Server: Could not start the snapshot sync thread.\n");
+        munmap(base, size);
+        mapping = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int game_snapshot_enabled(void)
+{
+    return mapping != NULL;
+}
+
+int game_snapshot_restored_count(void)
+{
+    return num_restored_rooms;
+}
+
+const GameSnapshotRoom *game_snapshot_restored(int index)
+{
+    return &restored_rooms[index];
+}
+
+void game_snapshot_save(int slot, const GameSnapshotRoom *state, const uint32_t *events, int first_new_event)
+{
+    if (mapping == NULL || slot < 0 || slot >= mapped_slots)
+        return;
+    SnapshotSlot *room = slot_at(mapping, slot);
+
+    // Events first: the header written afterwards is what makes them count
+    if (first_new_event < state->num_events)
+    {
+        memcpy(&room->events[first_new_event], &events[first_new_event],
+               (size_t)(state->num_events - first_new_event) * sizeof(uint32_t));
+    }
+    // Into the copy not holding the current state, so a torn write leaves that one intact
+    uint64_t sequence = ++slot_sequences[slot];
+    SlotHeader *header = &room->headers[sequence & 1];
+    header->magic = 0;
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->state, state, STATE_SIZE);
+    header->sequence = sequence;
+    header->checksum = header_checksum(header);
+    atomic_thread_fence(memory_order_release);
+    header->magic = GAME_SNAPSHOT_SLOT_MAGIC;
+    if (!atomic_load_explicit(&snapshot_dirty, memory_order_relaxed))
+        atomic_store_explicit(&snapshot_dirty, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&restored_pending, memory_order_relaxed) > 0)
+        restored_room_done(state->room_id);
+}
+
+void game_snapshot_clear(int slot, uint32_t room_id)
+{
+    if (mapping == NULL || slot < 0 || slot >= mapped_slots)
+        return;
+    SnapshotSlot *room = slot_at(mapping, slot);
+    uint64_t sequence = slot_sequences[slot];
+    room->headers[(sequence + 1) & 1].magic = 0; // The older copy first: the current one alone is never stale
+    atomic_thread_fence(memory_order_release);
+    room->headers[sequence & 1].magic = 0;
+    atomic_store_explicit(&snapshot_dirty, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&restored_pending, memory_order_relaxed) > 0)
+        restored_room_done(room_id); // Ended: must not come back from the previous file either
+}
@@ -0,0 +1,93 @@
+#ifndef GAME_SNAPSHOT_H
+#define GAME_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "protocol.h"
+#include "game_journal.h"
+
+// Crash-safe snapshots of the running games, so a restarted server can resume them.
+// The file is an array of fixed-size slots mapped with MAP_SHARED; every room owns one
+// slot and rewrites it after each turn. A store into the mapping reaches the page cache
+// right away, so a crash of the server process loses nothing; a background thread
+// msync()s dirty mappings at most once per GAME_SNAPSHOT_SYNC_INTERVAL_MS for power loss.
+//
+// Restoring never leaves a window in which a crash loses games: the games found at startup
+// are first written to "<path>.prev", and the new file is started empty. Each of them is
+// dropped from the previous file once it has been saved to the new one (or has ended) and
+// the new file is synced; the previous file is removed when none are left. Both files are
+// read at startup, the newer state of a game winning.
+//
+// A slot holds two copies of the game header and one shared array of turn events. A save
+// appends its new events, then writes the header into the copy not holding the current
+// state, with the next sequence number, its checksum and the magic last. On load the valid
+// copy with the highest sequence number wins, so a save torn by a crash leaves the previous
+// state of the game rather than no game. The events are append-only while a game runs, so
+// the older copy still finds all the events it counts.
+
+#define GAME_SNAPSHOT_FILE_MAGIC 0x3253464fu // "OFS2"
+#define GAME_SNAPSHOT_SLOT_MAGIC 0x74736e53u // "Snst"
+#define GAME_SNAPSHOT_SYNC_INTERVAL_MS 1000
+
+// One running game. The fields up to 'events' are stored as the slot header (native byte order).
+typedef struct
+{
+    uint32_t room_id;
+    uint32_t event_seq;          // Spectator stream sequence number
+    int8_t current_seat;         // Seat to move
+    uint8_t consecutive_passes;
+    uint16_t total_moves;
+    uint8_t seat_present[2];     // 0 once the player of that seat has left the game
+    uint8_t journal_active;      // Turns below are being recorded for the game journal
+    uint8_t journal_flags;
+    uint16_t num_events;
+    uint16_t reserved;
+    uint32_t elapsed_ms;         // Game time when the snapshot was taken
+    uint64_t start_unix_ms;
+    uint64_t session_tokens[2];
+    char board[8][8];
+    char names[2][MAX_USERNAME_LEN];
+    uint32_t events[GAME_JOURNAL_MAX_EVENTS]; // Journal event words, see game_journal.h
+} GameSnapshotRoom;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Opens (or creates) the snapshot file with room for 'num_slots' games.
+ *
+ * Valid games found in the file and in "<path>.prev" are kept for game_snapshot_restored()
+ * and written to "<path>.prev"; the file is then cleared and mapped. Starts the sync thread.
+ *
+ * @return int 0 on success, -1 on failure.
+ */
+int game_snapshot_open(const char *path, int num_slots);
+
+/**
+ * @brief Returns 1 once game_snapshot_open() has succeeded.
+ */
+int game_snapshot_enabled(void);
+
+/**
+ * @brief Returns the number of games loaded from the file by game_snapshot_open().
+ */
+int game_snapshot_restored_count(void);
+
+/**
+ * @brief Returns one game loaded from the file (0 <= index < game_snapshot_restored_count()).
+ */
+const GameSnapshotRoom *game_snapshot_restored(int index);
+
+/**
+ * @brief Writes the state of one game to its slot.
+ *
+ * Only events from 'first_new_event' on are copied; earlier ones are already in the slot.
+ * The header fields of 'state' are used, its 'events' are ignored.
+ */
+void game_snapshot_save(int slot, const GameSnapshotRoom *state, const uint32_t *events, int first_new_event);
+
+/**
+ * @brief Marks a slot as free once the game of room 'room_id' is over.
+ */
+void game_snapshot_clear(int slot, uint32_t room_id);
+
+#endif // GAME_SNAPSHOT_H
@@ -0,0 +1,57 @@
+#include "json_arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include "cJSON.h"
+
+#define ARENA_ALIGN 16
+
+static __thread _Alignas(ARENA_ALIGN) unsigned char arena_data[JSON_ARENA_SIZE];
+static __thread size_t arena_used;
+static __thread int arena_active;
+static __thread unsigned long arena_fallbacks;
+
+static void *arena_malloc(size_t size)
+{
+    if (arena_active)
+    {
+        size_t rounded = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        if (rounded >= size && rounded <= JSON_ARENA_SIZE - arena_used)
+        {
+            void *block = arena_data + arena_used;
+            arena_used += rounded;
+            return block;
+        }
+        arena_fallbacks++;
+    }
+    return malloc(size);
+}
+
+// Blocks of this thread's arena are taken back by json_arena_end(); everything else came from malloc()
+static void arena_free(void *pointer)
+{
+    if ((uintptr_t)pointer - (uintptr_t)arena_data < JSON_ARENA_SIZE)
+        return;
+    free(pointer);
+}
+
+void json_arena_install(void)
+{
+    cJSON_Hooks hooks = {arena_malloc, arena_free};
+    cJSON_InitHooks(&hooks);
+}
+
+void json_arena_begin(void)
+{
+    arena_active = 1;
+}
+
+void json_arena_end(void)
+{
+    arena_active = 0;
+    arena_used = 0;
+}
+
+unsigned long json_arena_fallbacks(void)
+{
+    return arena_fallbacks;
+}
@@ -0,0 +1,40 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+
+// Per-thread bump arena for cJSON, plugged in through cJSON_InitHooks().
+// Between json_arena_begin() and json_arena_end() every node, string and printed buffer
+// cJSON allocates on the calling thread comes from that thread's arena, and freeing it
+// costs nothing; json_arena_end() takes it all back at once. Requests that do not fit any
+// more, and all allocations outside a begin/end pair, fall back to malloc().
+//
+// Anything allocated inside the pair must be released (or no longer used) before
+// json_arena_end(), and must not be handed to another thread. Results of cJSON_Print*()
+// are released with cJSON_free(), never with free().
+
+#define JSON_ARENA_SIZE 16384 // Bytes per thread; a parsed 4 KiB line needs well under half
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Installs the arena hooks into cJSON. Call once at startup, before any thread parses.
+ */
+void json_arena_install(void);
+
+/**
+ * @brief Starts serving the calling thread's cJSON allocations from its arena.
+ */
+void json_arena_begin(void);
+
+/**
+ * @brief Releases everything allocated since json_arena_begin() and falls back to malloc() again.
+ */
+void json_arena_end(void);
+
+/**
+ * @brief Returns how many allocations of the calling thread did not fit into its arena.
+ */
+unsigned long json_arena_fallbacks(void);
+
+#endif // JSON_ARENA_H
@@ -0,0 +1,454 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "server_messages.h"
+#include "json_arena.h"
+
+// Microbenchmark of the server's message encoders: the allocation-free writers
+// (write_server_*) against the cJSON serializers they replaced (serialize_server_*).
+// First checks on random payloads, including names that need escaping and fractional
+// numbers, that both produce the same bytes; then times the messages of a turn.
+// Last, times what still goes through cJSON, parsing a message and printing the reply,
+// with malloc() and with the per-message arena of json_arena.c, and reading fields with
+// one lookup per key against cJSON_GetObjectItemsCaseSensitive() (one walk for all keys).
+
+static unsigned long heap_allocations; // Counted through cJSON's hooks
+
+static void *counting_malloc(size_t size)
+{
+    heap_allocations++;
+    return malloc(size);
+}
+
+static unsigned rng_state = 12345;
+
+static unsigned next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Mostly plain names, sometimes with quotes, backslashes, control characters or UTF-8
+static void random_name(char *out, size_t size)
+{
+    static const char plain[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+    static const char *specials[] = {"\"", "\\", "\n", "\t", "\x01", "\x1f", "\xc3\xa9", "/", "\x7f"};
+    size_t len = 1 + next_random() % (size - 1);
+    size_t i = 0;
+    while (i < len)
+    {
+        if (next_random() % 8 == 0)
+        {
+            const char *special = specials[next_random() % (sizeof(specials) / sizeof(specials[0]))];
+            size_t special_len = strlen(special);
+            if (i + special_len > len)
+                break;
+            memcpy(out + i, special, special_len);
+            i += special_len;
+        }
+        else
+        {
+            out[i++] = plain[next_random() % (sizeof(plain) - 1)];
+        }
+    }
+    out[i] = '\0';
+}
+
+static void random_board(char board[8][9])
+{
+    static const char cells[] = ".RB#";
+    for (int r = 0; r < 8; r++)
+    {
+        for (int c = 0; c < 8; c++)
+            board[r][c] = cells[next_random() % 4];
+        board[r][8] = '\0';
+    }
+}
+
+// Whole seconds as the server sends them, and now and then fractions, extremes or NaN
+static double random_number(void)
+{
+    switch (next_random() % 8)
+    {
+    case 0:
+        return (double)(next_random() % 1000) / 7.0;
+    case 1:
+        return -(double)(next_random() % 100000);
+    case 2:
+        return 1e300 * (next_random() % 3);
+    case 3:
+        return next_random() % 2 ? NAN : 0.1;
+    default:
+        return (double)(next_random() % 10);
+    }
+}
+
+static void random_board_update(const char board[8][9], BoardUpdate *update)
+{
+    update->is_delta = (int)(next_random() % 2);
+    board_delta_format(board, ((uint64_t)next_random() << 32) | next_random(), update->changes);
+    if (next_random() % 4 == 0)
+        board_delta_checksum(board, update->checksum);
+    else
+        update->checksum[0] = '\0';
+}
+
+static unsigned long checked, mismatches;
+
+// Compares one writer's output with its reference serializer
+static void compare(const char *name, char *reference, int written, const char *text)
+{
+    checked++;
+    if (reference == NULL || written < 0 || strcmp(reference, text) != 0 || (size_t)written != strlen(reference))
+    {
+        if (mismatches++ < 5)
+        {
+            fprintf(stderr, "Mismatch in %s:\n  cJSON:  %s\n  writer: %s\n", name, reference ? reference : "(null)",
+                    written < 0 ? "(did not fit)" : text);
+        }
+    }
+    free(reference);
+}
+
+// Function to check every writer against its serializer on random payloads
+static void check_equivalence(int rounds)
+{
+    char text[SERVER_MESSAGE_MAX_LEN];
+    for (int i = 0; i < rounds; i++)
+    {
+        ServerYourTurnPayload your_turn = {.type = "your_turn", .timeout = random_number()};
+        random_board(your_turn.board);
+        random_board_update(your_turn.board, &your_turn.board_update);
+        compare("your_turn", serialize_server_your_turn(&your_turn), write_server_your_turn(&your_turn, text, sizeof(text)), text);
+
+        ServerMoveOkPayload move_ok = {.type = "move_ok"};
+        random_board(move_ok.board);
+        random_board_update(move_ok.board, &move_ok.board_update);
+        random_name(move_ok.next_player, MAX_USERNAME_LEN);
+        compare("move_ok", serialize_server_move_ok(&move_ok), write_server_move_ok(&move_ok, text, sizeof(text)), text);
+
+        ServerInvalidMovePayload invalid_move = {.type = "invalid_move"};
+        random_board(invalid_move.board);
+        random_board_update(invalid_move.board, &invalid_move.board_update);
+        random_name(invalid_move.next_player, MAX_USERNAME_LEN);
+        compare("invalid_move", serialize_server_invalid_move(&invalid_move), write_server_invalid_move(&invalid_move, text, sizeof(text)), text);
+
+        ServerPassPayload pass = {.type = "pass"};
+        random_name(pass.next_player, MAX_USERNAME_LEN);
+        compare("pass", serialize_server_pass(&pass), write_server_pass(&pass, text, sizeof(text)), text);
+
+        ServerGameOverPayload game_over = {.type = "game_over"};
+        for (int s = 0; s < 2; s++)
+        {
+            if (next_random() % 5 != 0)
+                random_name(game_over.scores[s].username, MAX_USERNAME_LEN);
+            game_over.scores[s].score = (int)(next_random() % 65) - (int)(next_random() % 2);
+        }
+        compare("game_over", serialize_server_game_over(&game_over), write_server_game_over(&game_over, text, sizeof(text)), text);
+
+        ServerRegisterAckPayload register_ack = {.type = "register_ack", .session_token = "00ff00ff00ff00ff"};
+        strcpy(register_ack.wire, next_random() % 2 ? "binary" : "");
+        strcpy(register_ack.board_updates, next_random() % 2 ? "delta" : "");
+        compare("register_ack", serialize_server_register_ack(&register_ack), write_server_register_ack(&register_ack, text, sizeof(text)), text);
+
+        ServerRegisterNackPayload register_nack = {.type = "register_nack"};
+        random_name(register_nack.reason, MAX_REASON_LEN);
+        compare("register_nack", serialize_server_register_nack(&register_nack), write_server_register_nack(&register_nack, text, sizeof(text)), text);
+
+        ServerGameStartPayload game_start = {.type = "game_start"};
+        random_name(game_start.players[0], MAX_USERNAME_LEN);
+        random_name(game_start.players[1], MAX_USERNAME_LEN);
+        strcpy(game_start.first_player, game_start.players[next_random() % 2]);
+        compare("game_start", serialize_server_game_start(&game_start), write_server_game_start(&game_start, text, sizeof(text)), text);
+
+        ServerResumeAckPayload resume_ack = {.type = "resume_ack", .room = (int)(next_random() % 5000) - 1, .timeout = random_number()};
+        random_name(resume_ack.players[0], MAX_USERNAME_LEN);
+        random_name(resume_ack.players[1], MAX_USERNAME_LEN);
+        random_board(resume_ack.board);
+        random_name(resume_ack.next_player, MAX_USERNAME_LEN);
+        strcpy(resume_ack.wire, next_random() % 2 ? "binary" : "");
+        strcpy(resume_ack.board_updates, next_random() % 2 ? "delta" : "");
+        compare("resume_ack", serialize_server_resume_ack(&resume_ack), write_server_resume_ack(&resume_ack, text, sizeof(text)), text);
+
+        ServerResumeNackPayload resume_nack = {.type = "resume_nack"};
+        random_name(resume_nack.reason, MAX_REASON_LEN);
+        compare("resume_nack", serialize_server_resume_nack(&resume_nack), write_server_resume_nack(&resume_nack, text, sizeof(text)), text);
+
+        ServerSpectateSnapshotPayload snapshot = {.type = "spectate_snapshot", .room = (int)(next_random() % 100) - 1,
+                                                  .seq = next_random(), .game_active = (int)(next_random() % 2)};
+        for (int s = 0; s < 2; s++)
+        {
+            if (next_random() % 3 != 0)
+                random_name(snapshot.players[s], MAX_USERNAME_LEN);
+        }
+        random_board(snapshot.board);
+        random_name(snapshot.next_player, MAX_USERNAME_LEN);
+        compare("spectate_snapshot", serialize_server_spectate_snapshot(&snapshot), write_server_spectate_snapshot(&snapshot, text, sizeof(text)), text);
+
+        ServerSpectateUpdatePayload update = {.type = "spectate_update", .room = (int)(next_random() % 100), .seq = next_random(),
+                                              .event = "move", .sx = (int)(next_random() % 9), .sy = (int)(next_random() % 9),
+                                              .tx = (int)(next_random() % 9), .ty = (int)(next_random() % 9)};
+        random_name(update.player, MAX_USERNAME_LEN);
+        random_name(update.next_player, MAX_USERNAME_LEN);
+        char board[8][9];
+        random_board(board);
+        board_delta_format(board, next_random() % 2 ? next_random() : 0, update.changes);
+        if (next_random() % 4 == 0)
+            board_delta_checksum(board, update.checksum);
+        compare("spectate_update", serialize_server_spectate_update(&update), write_server_spectate_update(&update, text, sizeof(text)), text);
+    }
+}
+
+// Function to compare the one-walk lookup with per-key lookups on random objects,
+// including duplicate members, missing names and names repeated in the request
+static void check_lookups(int rounds)
+{
+    char keys[48][16];
+    const char *names[48];
+    cJSON *items[48];
+    for (int round = 0; round < rounds; round++)
+    {
+        int members = (int)(next_random() % 40);
+        int count = 1 + (int)(next_random() % 48);
+        cJSON *object = cJSON_CreateObject();
+        for (int i = 0; i < 48; i++)
+            snprintf(keys[i], sizeof(keys[i]), "k%u", next_random() % 24);
+        for (int i = 0; i < members; i++)
+            cJSON_AddNumberToObject(object, keys[next_random() % 48], i);
+        for (int i = 0; i < count; i++)
+            names[i] = next_random() % 8 == 0 ? NULL : keys[next_random() % 48];
+
+        size_t found = cJSON_GetObjectItemsCaseSensitive(object, names, items, (size_t)count);
+        size_t expected_found = 0;
+        for (int i = 0; i < count; i++)
+        {
+            cJSON *expected = names[i] ? cJSON_GetObjectItemCaseSensitive(object, names[i]) : NULL;
+            expected_found += expected != NULL;
+            if (items[i] != expected)
+            {
+                fprintf(stderr, "MISMATCH lookup of \"%s\" (%d members, %d names)\n", names[i] ? names[i] : "(null)", members, count);
+                mismatches++;
+            }
+        }
+        if (found != expected_found)
+        {
+            fprintf(stderr, "MISMATCH lookup count %zu, expected %zu\n", found, expected_found);
+            mismatches++;
+        }
+        checked++;
+        cJSON_Delete(object);
+    }
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+// Keeps the compiler from dropping the timed writes
+static volatile size_t sink;
+
+// Function to time both encoders of one message and print a result line
+#define BENCH_MESSAGE(label, payload, serialize, write, iterations)                                      \
+    do                                                                                                   \
+    {                                                                                                    \
+        char text[SERVER_MESSAGE_MAX_LEN];                                                               \
+        struct timespec t0, t1, t2;                                                                      \
+        unsigned long allocations_before = heap_allocations;                                             \
+        clock_gettime(CLOCK_MONOTONIC, &t0);                                                             \
+        for (long n = 0; n < (iterations); n++)                                                          \
+        {                                                                                                \
+            char *json = serialize(&(payload));                                                          \
+            sink += json[0];                                                                             \
+            free(json);                                                                                  \
+        }                                                                                                \
+        clock_gettime(CLOCK_MONOTONIC, &t1);                                                             \
+        for (long n = 0; n < (iterations); n++)                                                          \
+        {                                                                                                \
+            sink += (size_t)write(&(payload), text, sizeof(text));                                       \
+        }                                                                                                \
+        clock_gettime(CLOCK_MONOTONIC, &t2);                                                             \
+        double cjson_ns = elapsed_ns(&t0, &t1) / (iterations);                                           \
+        double writer_ns = elapsed_ns(&t1, &t2) / (iterations);                                          \
+        printf("%-18s %4zu B %10.1f ns %7.1f allocs %10.1f ns %6.1fx\n", (label), strlen(text),          \
+               cjson_ns, (double)(heap_allocations - allocations_before) / (iterations), writer_ns,      \
+               writer_ns > 0 ? cjson_ns / writer_ns : 0.0);                                              \
+    } while (0)
+
+// The client's turn: parse 'your_turn', print the 'move' reply
+static size_t parse_your_turn_and_reply(const char *line, size_t len)
+{
+    cJSON *message = cJSON_ParseWithLength(line, len);
+    cJSON *board = cJSON_GetObjectItemCaseSensitive(message, "board");
+    size_t result = (size_t)cJSON_GetArraySize(board);
+    cJSON *reply = cJSON_CreateObject();
+    cJSON_AddStringToObject(reply, "type", "move");
+    cJSON_AddStringToObject(reply, "username", "player_one");
+    cJSON_AddNumberToObject(reply, "sx", 4);
+    cJSON_AddNumberToObject(reply, "sy", 4);
+    cJSON_AddNumberToObject(reply, "tx", 5);
+    cJSON_AddNumberToObject(reply, "ty", 5);
+    char *text = cJSON_PrintUnformatted(reply);
+    result += text[0];
+    cJSON_free(text);
+    cJSON_Delete(reply);
+    cJSON_Delete(message);
+    return result;
+}
+
+// The server's side: parse 'move' and read its fields
+static size_t parse_move(const char *line, size_t len)
+{
+    cJSON *message = cJSON_ParseWithLength(line, len);
+    size_t result = (size_t)cJSON_GetObjectItemCaseSensitive(message, "sx")->valueint +
+                    strlen(cJSON_GetObjectItemCaseSensitive(message, "username")->valuestring);
+    cJSON_Delete(message);
+    return result;
+}
+
+// Function to time reading 'count' fields of a parsed object key by key and in one walk
+static void bench_lookup(const char *label, const cJSON *object, const char *const *names, size_t count, long iterations)
+{
+    cJSON *items[64];
+    struct timespec t0, t1, t2;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long n = 0; n < iterations; n++)
+    {
+        for (size_t i = 0; i < count; i++)
+            sink += (size_t)cJSON_GetObjectItemCaseSensitive(object, names[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (long n = 0; n < iterations; n++)
+    {
+        sink += cJSON_GetObjectItemsCaseSensitive(object, names, items, count);
+        sink += (size_t)items[count - 1];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    double per_key_ns = elapsed_ns(&t0, &t1) / iterations;
+    double one_walk_ns = elapsed_ns(&t1, &t2) / iterations;
+    printf("%-18s %3d/%-3zu %10.1f ns %14s %10.1f ns %6.1fx\n", label, cJSON_GetArraySize(object), count,
+           per_key_ns, "", one_walk_ns, one_walk_ns > 0 ? per_key_ns / one_walk_ns : 0.0);
+}
+
+// Function to time one parse (and print) step with malloc() and with the JSON arena
+static void bench_arena(const char *label, size_t (*step)(const char *, size_t), const char *line, long iterations)
+{
+    size_t len = strlen(line);
+    struct timespec t0, t1, t2;
+
+    cJSON_Hooks counting = {counting_malloc, free};
+    cJSON_InitHooks(&counting);
+    unsigned long allocations_before = heap_allocations;
+    sink += step(line, len);
+    unsigned long malloc_allocations = heap_allocations - allocations_before;
+
+    cJSON_InitHooks(NULL); // Plain malloc(), as before the arena
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long n = 0; n < iterations; n++)
+        sink += step(line, len);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    json_arena_install();
+    unsigned long fallbacks_before = json_arena_fallbacks();
+    for (long n = 0; n < iterations; n++)
+    {
+        json_arena_begin();
+        sink += step(line, len);
+        json_arena_end();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    double malloc_ns = elapsed_ns(&t0, &t1) / iterations;
+    double arena_ns = elapsed_ns(&t1, &t2) / iterations;
+    printf("%-18s %4zu B %10.1f ns %7lu allocs %10.1f ns %6.1fx  (%lu arena overflows)\n", label, len, malloc_ns,
+           malloc_allocations, arena_ns, arena_ns > 0 ? malloc_ns / arena_ns : 0.0, json_arena_fallbacks() - fallbacks_before);
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = 200000;
+    int rounds = 20000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            iterations = atol(argv[++i]);
+        else if (strcmp(argv[i], "-check") == 0 && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: %s [-n <iterations>] [-check <rounds>]\n"
+                            "  -n      timed encodings per message and encoder (default 200000)\n"
+                            "  -check  random payloads compared per message type (default 20000)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0)
+        iterations = 1;
+
+    cJSON_Hooks hooks = {counting_malloc, free};
+    cJSON_InitHooks(&hooks);
+
+    check_equivalence(rounds);
+    check_lookups(rounds);
+    printf("Compared %lu messages: %lu mismatches\n\n", checked, mismatches);
+
+    ServerYourTurnPayload your_turn = {.type = "your_turn", .timeout = 5};
+    random_board(your_turn.board);
+    ServerYourTurnPayload your_turn_delta = your_turn;
+    your_turn_delta.board_update.is_delta = 1;
+    strcpy(your_turn_delta.board_update.changes, "34R45R44R");
+    ServerMoveOkPayload move_ok = {.type = "move_ok", .next_player = "player_two"};
+    random_board(move_ok.board);
+    ServerSpectateUpdatePayload update = {.type = "spectate_update", .room = 12, .seq = 4711, .event = "move",
+                                          .player = "player_one", .sx = 1, .sy = 1, .tx = 2, .ty = 2,
+                                          .next_player = "player_two", .changes = "22R"};
+    ServerGameOverPayload game_over = {.type = "game_over", .scores = {{"player_one", 40}, {"player_two", 24}}};
+
+    printf("%-18s %6s %13s %14s %13s %7s\n", "message", "size", "cJSON", "", "writer", "speedup");
+    BENCH_MESSAGE("your_turn", your_turn, serialize_server_your_turn, write_server_your_turn, iterations);
+    BENCH_MESSAGE("your_turn (delta)", your_turn_delta, serialize_server_your_turn, write_server_your_turn, iterations);
+    BENCH_MESSAGE("move_ok", move_ok, serialize_server_move_ok, write_server_move_ok, iterations);
+    BENCH_MESSAGE("spectate_update", update, serialize_server_spectate_update, write_server_spectate_update, iterations);
+    BENCH_MESSAGE("game_over", game_over, serialize_server_game_over, write_server_game_over, iterations);
+
+
+    char your_turn_line[SERVER_MESSAGE_MAX_LEN];
+    write_server_your_turn(&your_turn, your_turn_line, sizeof(your_turn_line));
+    printf("\n%-18s %6s %13s %14s %13s %7s\n", "parse and print", "size", "malloc", "", "arena", "speedup");
+    bench_arena("your_turn + move", parse_your_turn_and_reply, your_turn_line, iterations);
+    bench_arena("move", parse_move, "{\"type\":\"move\",\"username\":\"player_one\",\"sx\":4,\"sy\":4,\"tx\":5,\"ty\":5}", iterations);
+
+    printf("\n%-18s %7s %13s %14s %13s %7s\n", "field lookup", "members", "per key", "", "one walk", "speedup");
+    cJSON *move = cJSON_Parse("{\"type\":\"move\",\"username\":\"player_one\",\"sx\":4,\"sy\":4,\"tx\":5,\"ty\":5}");
+    const char *move_fields[] = {"username", "sx", "sy", "tx", "ty"};
+    bench_lookup("move", move, move_fields, 5, iterations);
+    cJSON *turn = cJSON_Parse(your_turn_line);
+    const char *turn_fields[] = {"board", "timeout"};
+    bench_lookup("your_turn", turn, turn_fields, 2, iterations);
+
+    // A game_over scores map of a large tournament: every player's score, and a handful of them
+    cJSON *scores = cJSON_CreateObject();
+    char players[64][MAX_USERNAME_LEN];
+    const char *player_names[64];
+    for (int i = 0; i < 64; i++)
+    {
+        snprintf(players[i], sizeof(players[i]), "player_%02d", 63 - i);
+        cJSON_AddNumberToObject(scores, players[i], i);
+        player_names[i] = players[i];
+    }
+    bench_lookup("scores (all)", scores, player_names, 64, iterations / 16);
+    bench_lookup("scores (4)", scores, player_names + 20, 4, iterations);
+    cJSON_Delete(scores);
+    cJSON_Delete(turn);
+    cJSON_Delete(move);
+
+    return mismatches ? 2 : 0;
+}
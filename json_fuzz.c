@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+
+// Differential fuzzer for cJSON's vector scanning of strings and whitespace. Every input
+// is parsed twice, with the vector scanners and with the original byte-by-byte loops
+// (cJSON.c built with CJSON_SCAN_REFERENCE); the trees, or the error positions, must agree.
+// Inputs are the protocol's messages, optionally seed files, and random mutations of them:
+// escapes, quotes, control characters, whitespace runs and truncations at every offset.
+// Each input is also fed to a cJSON_Stream in random pieces; every line it returns must
+// match cJSON_ParseWithLength() of that line.
+
+extern int cJSON_scan_reference; // Defined by cJSON.c under CJSON_SCAN_REFERENCE
+
+#define MAX_INPUT_LEN 4096
+#define MAX_SEEDS 64
+
+static const char *builtin_seeds[] = {
+    "{\"type\":\"register\",\"username\":\"player_one\",\"session_token\":\"\",\"wire\":\"binary\"}",
+    "{\"type\":\"move\",\"username\":\"player_one\",\"sx\":1,\"sy\":1,\"tx\":2,\"ty\":2}",
+    "{\"type\":\"your_turn\",\"board\":[\"R......B\",\"........\",\"........\",\"...##...\",\"...##...\",\"........\",\"........\",\"B......R\"],\"timeout\":5}",
+    "{\"type\":\"your_turn\",\"changes\":\"34R45R44R\",\"checksum\":\"0f3a9b21\",\"timeout\":4.5}",
+    "{\"type\":\"move_ok\",\"board\":[\"RR.....B\",\"R.......\",\"........\",\"........\",\"........\",\"........\",\"........\",\"B......R\"],\"next_player\":\"player_two\"}",
+    "{\"type\":\"game_over\",\"scores\":{\"player_one\":40,\"player_two\":24}}",
+    "{\"type\":\"register_nack\",\"reason\":\"Name \\\"taken\\\" \\\\ try \\u00e9\\ud83d\\ude00 again\\n\"}",
+    "{\n  \"type\": \"spectate_update\",\n  \"room\": 3,\n\t\"seq\": 17,\r\n  \"players\": [ \"a\" , \"b\" ] ,\n  \"active\": true, \"x\": null\n}\n",
+    "  [ 1, -2.5e3, \"\", \"\\/\\b\\f\\r\\t\", [], {}, false ]   ",
+    "\xEF\xBB\xBF{\"type\":\"pass\",\"next_player\":\"x\"}",
+    "\xEF\xBB\xBF" "1",
+};
+
+static unsigned rng_state = 2463534242u;
+
+static unsigned next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Function to change an input in one of the ways that stress the scanners
+static size_t mutate(char *data, size_t len)
+{
+    static const char *fragments[] = {"\\", "\"", "\\\"", "\\\\", "\\u00", "\\ud83d", "\\n", "\x01", "\x1f", " ",
+                                      "\t\r\n", "\x7f", "\xc3\xa9", "\xff", "R......B", "{", "}", "[", "]", ",", ":"};
+    size_t pos = len ? next_random() % (len + 1) : 0;
+    switch (next_random() % 6)
+    {
+    case 0: // Insert a fragment
+    {
+        const char *fragment = fragments[next_random() % (sizeof(fragments) / sizeof(fragments[0]))];
+        size_t fragment_len = strlen(fragment);
+        if (len + fragment_len > MAX_INPUT_LEN)
+            return len;
+        memmove(data + pos + fragment_len, data + pos, len - pos);
+        memcpy(data + pos, fragment, fragment_len);
+        return len + fragment_len;
+    }
+    case 1: // Insert a run of whitespace or of plain characters, long enough to span vectors
+    {
+        size_t run = next_random() % 48;
+        if (len + run > MAX_INPUT_LEN)
+            return len;
+        memmove(data + pos + run, data + pos, len - pos);
+        int plain = next_random() % 2;
+        for (size_t i = 0; i < run; i++)
+            data[pos + i] = plain ? (char)('a' + next_random() % 26) : " \t\r\n\x01"[next_random() % 5];
+        return len + run;
+    }
+    case 2: // Overwrite one byte with anything
+        if (pos < len)
+            data[pos] = (char)next_random();
+        return len;
+    case 3: // Delete a few bytes
+    {
+        size_t count = next_random() % 4;
+        if (pos + count > len)
+            count = len - pos;
+        memmove(data + pos, data + pos + count, len - pos - count);
+        return len - count;
+    }
+    case 4: // Truncate, e.g. inside a string or right after a backslash
+        return pos;
+    default: // Leave it
+        return len;
+    }
+}
+
+// Parses with one kind of scanning; returns the compact text of the tree, or the error offset as text
+static char *parse_with(int reference, const char *data, size_t len)
+{
+    cJSON_scan_reference = reference;
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    char *text;
+    if (root == NULL)
+    {
+        text = malloc(32);
+        const char *error_ptr = cJSON_GetErrorPtr();
+        snprintf(text, 32, "error at %ld", error_ptr ? (long)(error_ptr - data) : -1L);
+        return text;
+    }
+    text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return text;
+}
+
+static unsigned long checked, parsed_ok, mismatches, stream_lines;
+
+// Prints one line's outcome like parse_with(); takes ownership of 'document'
+static char *stream_result(int status, cJSON *document)
+{
+    char *text;
+    if (status == cJSON_StreamDocument)
+    {
+        text = cJSON_PrintUnformatted(document);
+        cJSON_Delete(document);
+        return text;
+    }
+    text = malloc(32);
+    snprintf(text, 32, status == cJSON_StreamTooLong ? "too long" : "invalid");
+    return text;
+}
+
+// Function to feed an input and a final '\n' to a stream in random pieces and compare every
+// line it returns with the byte-by-byte parse of that line. Every few inputs the stream gets a
+// length limit, and the lines over it must come back as too long.
+static void check_stream(const char *data, size_t len)
+{
+    char *fed = malloc(len + 1);
+    memcpy(fed, data, len);
+    fed[len] = '\n';
+
+    cJSON_Stream stream;
+    size_t max_length = next_random() % 4 == 0 ? next_random() % 128 + 1 : 0;
+    cJSON_InitStream(&stream, max_length);
+    size_t max_piece = next_random() % 2 ? 1 + next_random() % 4 : 1 + next_random() % 64;
+    size_t line_start = 0;
+    size_t offset = 0;
+    while (offset <= len)
+    {
+        size_t piece = 1 + next_random() % max_piece;
+        if (piece > len + 1 - offset)
+            piece = len + 1 - offset;
+        while (piece > 0)
+        {
+            size_t consumed;
+            cJSON *document;
+            cJSON_scan_reference = 0;
+            int status = cJSON_StreamFeed(&stream, fed + offset, piece, &consumed, &document);
+            offset += consumed;
+            piece -= consumed;
+            if (status == cJSON_StreamIncomplete)
+                continue;
+
+            size_t line_len = offset - 1 - line_start;
+            char *streamed = stream_result(status, document);
+            char *expected;
+            if (max_length != 0 && line_len > max_length)
+            {
+                expected = malloc(32);
+                strcpy(expected, "too long");
+            }
+            else
+            {
+                expected = parse_with(1, fed + line_start, line_len);
+                if (strncmp(expected, "error", 5) == 0)
+                    strcpy(expected, "invalid");
+            }
+            stream_lines++;
+            if (streamed == NULL || expected == NULL || strcmp(streamed, expected) != 0)
+            {
+                if (mismatches++ < 5)
+                {
+                    fprintf(stderr, "Stream mismatch on a line of %zu bytes (pieces up to %zu): %.*s\n  stream:    %s\n  bytewise:  %s\n",
+                            line_len, max_piece, (int)line_len, fed + line_start, streamed ? streamed : "(null)",
+                            expected ? expected : "(null)");
+                }
+            }
+            free(streamed);
+            free(expected);
+            line_start = offset;
+        }
+    }
+    cJSON_FreeStream(&stream);
+    free(fed);
+}
+
+// Function to compare both parses of one input. The input is copied to the end of a
+// buffer of exactly its size, so a scanner reading past it is caught by ASan or valgrind.
+static void check_input(const char *data, size_t len)
+{
+    char *exact = malloc(len ? len : 1);
+    memcpy(exact, data, len);
+    char *vector = parse_with(0, exact, len);
+    char *bytewise = parse_with(1, exact, len);
+    checked++;
+    if (strncmp(bytewise, "error", 5) != 0)
+        parsed_ok++;
+    if (vector == NULL || bytewise == NULL || strcmp(vector, bytewise) != 0)
+    {
+        if (mismatches++ < 5)
+        {
+            fprintf(stderr, "Mismatch on %zu bytes: %.*s\n  vector:    %s\n  bytewise:  %s\n", len, (int)len, data,
+                    vector ? vector : "(null)", bytewise ? bytewise : "(null)");
+        }
+    }
+    free(vector);
+    free(bytewise);
+    free(exact);
+    check_stream(data, len);
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+// Function to time parsing the unmutated seeds with both kinds of scanning
+static void time_seeds(char **seeds, const size_t *seed_lens, int num_seeds, long iterations)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < num_seeds; i++)
+        bytes += seed_lens[i];
+    printf("\nParsing %d seeds (%zu bytes), %ld times:\n", num_seeds, bytes, iterations);
+
+    double ns[2];
+    for (int reference = 1; reference >= 0; reference--)
+    {
+        struct timespec t0, t1;
+        cJSON_scan_reference = reference;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (long n = 0; n < iterations; n++)
+        {
+            for (int i = 0; i < num_seeds; i++)
+                cJSON_Delete(cJSON_ParseWithLength(seeds[i], seed_lens[i]));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns[reference] = elapsed_ns(&t0, &t1) / ((double)iterations * num_seeds);
+        printf("  %-9s %8.1f ns/message %8.1f MB/s\n", reference ? "bytewise" : "vector", ns[reference],
+               (double)bytes * iterations * 1e3 / elapsed_ns(&t0, &t1));
+    }
+    printf("  speedup   %8.2fx\n", ns[0] > 0 ? ns[1] / ns[0] : 0.0);
+
+    // The same messages through a stream, each arriving in 64-byte pieces
+    struct timespec t0, t1;
+    cJSON_Stream stream;
+    cJSON_InitStream(&stream, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long n = 0; n < iterations; n++)
+    {
+        for (int i = 0; i < num_seeds; i++)
+        {
+            for (size_t offset = 0; offset < seed_lens[i];)
+            {
+                size_t piece = seed_lens[i] - offset < 64 ? seed_lens[i] - offset : 64;
+                size_t consumed;
+                cJSON *document;
+                if (cJSON_StreamFeed(&stream, seeds[i] + offset, piece, &consumed, &document) == cJSON_StreamDocument)
+                    cJSON_Delete(document);
+                offset += consumed;
+            }
+            size_t consumed;
+            cJSON *document;
+            if (cJSON_StreamFeed(&stream, "\n", 1, &consumed, &document) == cJSON_StreamDocument)
+                cJSON_Delete(document);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    cJSON_FreeStream(&stream);
+    printf("  %-9s %8.1f ns/message %8.1f MB/s (64-byte pieces)\n", "stream",
+           elapsed_ns(&t0, &t1) / ((double)iterations * num_seeds), (double)bytes * iterations * 1e3 / elapsed_ns(&t0, &t1));
+}
+
+// Reads one seed file; returns its length or -1
+static long read_seed(const char *path, char *out)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    size_t len = fread(out, 1, MAX_INPUT_LEN, file);
+    fclose(file);
+    return (long)len;
+}
+
+int main(int argc, char *argv[])
+{
+    long cases = 200000;
+    long iterations = 20000;
+    char *seeds[MAX_SEEDS];
+    size_t seed_lens[MAX_SEEDS];
+    int num_seeds = 0;
+
+    for (size_t i = 0; i < sizeof(builtin_seeds) / sizeof(builtin_seeds[0]); i++)
+    {
+        seeds[num_seeds] = strdup(builtin_seeds[i]);
+        seed_lens[num_seeds++] = strlen(builtin_seeds[i]);
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            cases = atol(argv[++i]);
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+            rng_state = (unsigned)strtoul(argv[++i], NULL, 10) | 1u;
+        else if (strcmp(argv[i], "-time") == 0 && i + 1 < argc)
+            iterations = atol(argv[++i]);
+        else if (argv[i][0] != '-' && num_seeds < MAX_SEEDS)
+        {
+            char *seed = malloc(MAX_INPUT_LEN);
+            long len = read_seed(argv[i], seed);
+            if (len < 0)
+                return 1;
+            seeds[num_seeds] = seed;
+            seed_lens[num_seeds++] = (size_t)len;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-n <cases>] [-seed <number>] [-time <iterations>] [seed files...]\n"
+                            "  -n     mutated inputs to compare (default 200000)\n"
+                            "  -seed  random seed, to repeat a run\n"
+                            "  -time  parses of the seeds to time per scanner (default 20000, 0 to skip)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    // One level deeper than cJSON's nesting limit; fuzzed, but not timed
+    int timed_seeds = num_seeds;
+    seeds[num_seeds] = malloc(2 * (CJSON_NESTING_LIMIT + 1));
+    memset(seeds[num_seeds], '[', CJSON_NESTING_LIMIT + 1);
+    memset(seeds[num_seeds] + CJSON_NESTING_LIMIT + 1, ']', CJSON_NESTING_LIMIT + 1);
+    seed_lens[num_seeds++] = 2 * (CJSON_NESTING_LIMIT + 1);
+
+    // Every seed, and every prefix of it: truncations at each offset and vector boundary
+    char input[MAX_INPUT_LEN + 64];
+    for (int i = 0; i < num_seeds; i++)
+    {
+        for (size_t len = 0; len <= seed_lens[i]; len++)
+            check_input(seeds[i], len);
+    }
+    for (long n = 0; n < cases; n++)
+    {
+        int seed = (int)(next_random() % (unsigned)num_seeds);
+        size_t len = seed_lens[seed];
+        memcpy(input, seeds[seed], len);
+        int rounds = 1 + (int)(next_random() % 8);
+        for (int r = 0; r < rounds; r++)
+            len = mutate(input, len);
+        check_input(input, len);
+    }
+    printf("Compared %lu inputs (%lu valid JSON) and %lu streamed lines: %lu mismatches\n", checked, parsed_ok,
+           stream_lines, mismatches);
+
+    if (iterations > 0)
+        time_seeds(seeds, seed_lens, timed_seeds, iterations);
+
+    for (int i = 0; i < num_seeds; i++)
+        free(seeds[i]);
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,195 @@
+#include "line_framer.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#define RING_MASK (LINE_FRAMER_CAPACITY - 1)
+
+#if (LINE_FRAMER_CAPACITY & RING_MASK) != 0
+#error "LINE_FRAMER_CAPACITY must be a power of two"
+#endif
+
+// Only lines that wrap around the end of a ring are copied, and only here
+static __thread char wrapped_line_scratch[LINE_FRAMER_CAPACITY];
+
+void line_framer_init(LineFramer *framer)
+{
+    framer->head = 0;
+    framer->tail = 0;
+    framer->scanned = 0;
+    framer->discarding = 0;
+    framer->frame_skip = 0;
+    framer->oversized_lines = 0;
+}
+
+// Returns a view of 'length' bytes starting at the monotonic offset 'start'
+static const char *ring_view(LineFramer *framer, size_t start, size_t length)
+{
+    size_t start_pos = start & RING_MASK;
+    if (start_pos + length <= LINE_FRAMER_CAPACITY)
+    {
+        return framer->data + start_pos;
+    }
+    size_t first_part = LINE_FRAMER_CAPACITY - start_pos;
+    memcpy(wrapped_line_scratch, framer->data + start_pos, first_part);
+    memcpy(wrapped_line_scratch + first_part, framer->data, length - first_part);
+    return wrapped_line_scratch;
+}
+
+ssize_t line_framer_recv(LineFramer *framer, int socket_fd)
+{
+    size_t free_space = LINE_FRAMER_CAPACITY - (framer->tail - framer->head);
+    if (free_space == 0)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // The free space is at most two runs: up to the end of the ring, then from its start
+    size_t write_pos = framer->tail & RING_MASK;
+    size_t first_run = LINE_FRAMER_CAPACITY - write_pos;
+    struct iovec iov[2];
+    int iov_count = 1;
+
+    iov[0].iov_base = framer->data + write_pos;
+    if (first_run >= free_space)
+    {
+        iov[0].iov_len = free_space;
+    }
+    else
+    {
+        iov[0].iov_len = first_run;
+        iov[1].iov_base = framer->data;
+        iov[1].iov_len = free_space - first_run;
+        iov_count = 2;
+    }
+
+    ssize_t nbytes = readv(socket_fd, iov, iov_count);
+    if (nbytes > 0)
+    {
+        framer->tail += (size_t)nbytes;
+    }
+    return nbytes;
+}
+
+int line_framer_next(LineFramer *framer, const char **line, size_t *line_len)
+{
+    while (framer->scanned < framer->tail)
+    {
+        size_t scan_pos = framer->scanned & RING_MASK;
+        size_t run = framer->tail - framer->scanned;
+        if (run > LINE_FRAMER_CAPACITY - scan_pos)
+        {
+            run = LINE_FRAMER_CAPACITY - scan_pos;
+        }
+
+        const char *newline_ptr = memchr(framer->data + scan_pos, '\n', run);
+        if (newline_ptr == NULL)
+        {
+            framer->scanned += run;
+            continue;
+        }
+
+        size_t newline_offset = framer->scanned + (size_t)(newline_ptr - (framer->data + scan_pos));
+        size_t line_start = framer->head;
+        framer->scanned = newline_offset + 1;
+        framer->head = framer->scanned;
+
+        if (framer->discarding)
+        {
+            // End of an oversized line: resume normal framing after it
+            framer->discarding = 0;
+            continue;
+        }
+
+        size_t length = newline_offset - line_start;
+        *line = ring_view(framer, line_start, length);
+        *line_len = length;
+        return LINE_FRAMER_LINE;
+    }
+
+    if (framer->discarding)
+    {
+        framer->head = framer->tail; // Still inside an oversized line
+        return LINE_FRAMER_NONE;
+    }
+
+    if (framer->tail - framer->head == LINE_FRAMER_CAPACITY)
+    {
+        // The ring is full without a delimiter: drop what we have and skip to the next '\n'
+        framer->head = framer->tail;
+        framer->discarding = 1;
+        framer->oversized_lines++;
+        return LINE_FRAMER_OVERSIZED;
+    }
+    return LINE_FRAMER_NONE;
+}
+
+int line_framer_next_frame(LineFramer *framer, const char **frame, size_t *frame_len)
+{
+    if (framer->frame_skip > 0)
+    {
+        size_t available = framer->tail - framer->head;
+        size_t skipped = available < framer->frame_skip ? available : framer->frame_skip;
+        framer->head += skipped;
+        framer->frame_skip -= skipped;
+        framer->scanned = framer->head;
+        if (framer->frame_skip > 0)
+        {
+            return LINE_FRAMER_NONE;
+        }
+    }
+    if (framer->tail - framer->head < 2)
+    {
+        return LINE_FRAMER_NONE;
+    }
+
+    size_t length = (unsigned char)framer->data[framer->head & RING_MASK] |
+                    (size_t)(unsigned char)framer->data[(framer->head + 1) & RING_MASK] << 8;
+    if (length == 0)
+    {
+        framer->head += 2; // Empty frame, nothing to hand out
+        framer->scanned = framer->head;
+        return line_framer_next_frame(framer, frame, frame_len);
+    }
+    if (length > LINE_FRAMER_CAPACITY - 2)
+    {
+        // Skip it as its bytes arrive; the frames after it are read normally
+        framer->head += 2;
+        framer->scanned = framer->head;
+        framer->frame_skip = length;
+        framer->oversized_lines++;
+        return LINE_FRAMER_OVERSIZED;
+    }
+    if (framer->tail - framer->head < 2 + length)
+    {
+        return LINE_FRAMER_NONE;
+    }
+
+    *frame = ring_view(framer, framer->head + 2, length);
+    *frame_len = length;
+    framer->head += 2 + length;
+    framer->scanned = framer->head;
+    return LINE_FRAMER_LINE;
+}
+
+size_t line_framer_peek(LineFramer *framer, const char **bytes)
+{
+    size_t head_pos = framer->head & RING_MASK;
+    size_t run = framer->tail - framer->head;
+    if (run > LINE_FRAMER_CAPACITY - head_pos)
+    {
+        run = LINE_FRAMER_CAPACITY - head_pos;
+    }
+    *bytes = framer->data + head_pos;
+    return run;
+}
+
+void line_framer_consume(LineFramer *framer, size_t count)
+{
+    framer->head += count;
+    if (framer->scanned < framer->head)
+    {
+        framer->scanned = framer->head;
+    }
+}
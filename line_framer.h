@@ -0,0 +1,101 @@
+#ifndef LINE_FRAMER_H
+#define LINE_FRAMER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Capacity of the receive ring in bytes. Must be a power of two.
+// A single message (without its '\n') may be at most LINE_FRAMER_CAPACITY - 1 bytes long.
+#define LINE_FRAMER_CAPACITY 4096
+
+// Return values of line_framer_next()
+#define LINE_FRAMER_NONE 0       // No complete line buffered yet
+#define LINE_FRAMER_LINE 1       // A complete line was returned
+#define LINE_FRAMER_OVERSIZED -1 // A line (or frame) longer than the ring was dropped
+
+// Ring-buffer framer for newline-delimited messages.
+// Bytes are received straight into the ring, each byte is searched for '\n' only once,
+// and complete lines are handed out as (pointer, length) views without copying.
+// Connections that switched to binary frames (see wire_protocol.h) read the same ring
+// with line_framer_next_frame() instead, and a streaming parser takes raw bytes with
+// line_framer_peek() / line_framer_consume().
+typedef struct
+{
+    char data[LINE_FRAMER_CAPACITY];
+    size_t head;      // Monotonic offset of the first unconsumed byte
+    size_t tail;      // Monotonic offset one past the last received byte
+    size_t scanned;   // Bytes before this offset are known not to hold a pending '\n'
+    int discarding;   // Set while skipping the rest of an oversized line
+    size_t frame_skip; // Bytes of an oversized frame still to skip
+    unsigned long oversized_lines;
+} LineFramer;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Resets the framer to an empty state.
+ *
+ * @param framer The framer to initialize.
+ */
+void line_framer_init(LineFramer *framer);
+
+/**
+ * @brief Receives from a socket directly into the free space of the ring.
+ *
+ * Call line_framer_next() until it returns LINE_FRAMER_NONE before receiving again,
+ * otherwise the ring may stay full.
+ *
+ * @param framer The framer to fill.
+ * @param socket_fd The socket to read from.
+ * @return ssize_t Bytes received, 0 if the peer closed the connection, -1 on error (errno is set).
+ */
+ssize_t line_framer_recv(LineFramer *framer, int socket_fd);
+
+/**
+ * @brief Returns the next complete line, without its '\n'.
+ *
+ * The view usually points into the ring itself. A line that wraps around the end of the
+ * ring is linearized into a per-thread scratch buffer, so the view is only valid until the
+ * next line_framer_recv() or line_framer_next() call made by the same thread.
+ * A line that cannot fit in the ring is skipped up to its '\n' and reported once as
+ * LINE_FRAMER_OVERSIZED; lines after it are framed normally.
+ *
+ * @param framer The framer to read from.
+ * @param line Out: start of the line (not NUL-terminated).
+ * @param line_len Out: length of the line in bytes.
+ * @return int LINE_FRAMER_LINE, LINE_FRAMER_NONE or LINE_FRAMER_OVERSIZED.
+ */
+int line_framer_next(LineFramer *framer, const char **line, size_t *line_len);
+
+/**
+ * @brief Returns the next complete length-prefixed frame, without its 2-byte length.
+ *
+ * The view follows the same rules as for line_framer_next(). A frame whose length does not
+ * fit in the ring is skipped and reported once as LINE_FRAMER_OVERSIZED.
+ *
+ * @param framer The framer to read from.
+ * @param frame Out: frame type and payload.
+ * @param frame_len Out: length of the frame type and payload in bytes (at least 1).
+ * @return int LINE_FRAMER_LINE, LINE_FRAMER_NONE or LINE_FRAMER_OVERSIZED.
+ */
+int line_framer_next_frame(LineFramer *framer, const char **frame, size_t *frame_len);
+
+/**
+ * @brief Returns received bytes that were not handed out yet, for a parser that reads
+ *        them as they arrive (see cJSON_StreamFeed()) instead of waiting for whole lines.
+ *
+ * Bytes that wrap around the end of the ring come in two views. Release the bytes the
+ * parser consumed with line_framer_consume().
+ *
+ * @param framer The framer to read from.
+ * @param bytes Out: start of the view.
+ * @return size_t Bytes in the view, 0 if everything was handed out.
+ */
+size_t line_framer_peek(LineFramer *framer, const char **bytes);
+
+/**
+ * @brief Drops the first 'count' bytes of the last line_framer_peek() view.
+ */
+void line_framer_consume(LineFramer *framer, size_t count);
+
+#endif // LINE_FRAMER_H
@@ -0,0 +1,909 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "cJSON.h"
+#include "protocol.h"
+#include "line_framer.h"
+#include "game_rules.h"
+
+// Headless load generator: opens many connections to the OctaFlip server, registers them,
+// plays legal moves and reports throughput and latency. Needs no LED matrix.
+
+#define LOADGEN_DEFAULT_PORT "5050"
+#define LOADGEN_MAX_EVENTS 256
+#define LOADGEN_OUT_BUFFER_LEN 512
+#define LOADGEN_MESSAGE_LEN 256
+
+// Log-linear latency histogram: 16 sub-buckets per power of two, values in microseconds
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKETS (61 * LATENCY_SUB_BUCKETS)
+
+typedef enum
+{
+    VC_IDLE,             // Not connected; timer = next connect attempt
+    VC_CONNECTING,       // Non-blocking connect in flight; timer = request timeout
+    VC_REGISTERING,      // 'register' sent; timer = request timeout
+    VC_REGISTER_BACKOFF, // Got register_nack; timer = next register attempt
+    VC_WAITING,          // Registered, waiting for game_start or our turn; no timer
+    VC_THINKING,         // Our turn; timer = when the move is sent
+    VC_AWAITING_REPLY,   // Move sent; timer = request timeout
+    VC_GAME_OVER         // Got game_over; the server closes the connection next
+} VirtualClientState;
+
+typedef enum
+{
+    THINK_FIXED,
+    THINK_UNIFORM,
+    THINK_EXPONENTIAL
+} ThinkDistribution;
+
+typedef struct
+{
+    int fd;
+    VirtualClientState state;
+    unsigned int generation; // Bumped on every new connection, keeps usernames unique
+    char username[MAX_USERNAME_LEN];
+    char role; // 'R' or 'B' while in a game, ' ' otherwise
+    char board[8][9];
+    double request_sent_at; // When the outstanding register/move was sent
+    double deadline;        // Pending timer, INFINITY if none
+    int heap_index;         // Position in timer_heap, -1 if not queued
+    char out[LOADGEN_OUT_BUFFER_LEN];
+    size_t out_len;
+    LineFramer framer;
+} VirtualClient;
+
+typedef struct
+{
+    unsigned long counts[LATENCY_BUCKETS];
+    unsigned long total;
+    uint64_t max_value;
+} LatencyHistogram;
+
+// --- Configuration ---
+static const char *server_ip = "127.0.0.1";
+static const char *server_port = LOADGEN_DEFAULT_PORT;
+static int num_virtual_clients = 2;
+static double run_duration_seconds = 30.0;
+static ThinkDistribution think_distribution = THINK_FIXED;
+static double think_param_a = 0.0; // ms: fixed value, uniform min, or exponential mean
+static double think_param_b = 0.0; // ms: uniform max
+static int use_greedy_policy = 0;
+static double request_timeout_seconds = 10.0;
+static double retry_delay_seconds = 0.2;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+// --- Runtime state ---
+static VirtualClient *virtual_clients = NULL;
+static int *timer_heap = NULL;
+static int timer_heap_size = 0;
+static int epoll_fd = -1;
+static struct addrinfo *server_address = NULL;
+static volatile sig_atomic_t stop_requested = 0;
+
+static struct
+{
+    unsigned long connect_attempts;
+    unsigned long connect_failures;
+    unsigned long registrations_acked;
+    unsigned long registrations_nacked;
+    unsigned long games_started;
+    unsigned long games_finished;
+    unsigned long moves_sent;
+    unsigned long passes_sent;
+    unsigned long moves_accepted;
+    unsigned long moves_rejected;
+    unsigned long server_passes;
+    unsigned long timeouts;
+    unsigned long protocol_errors;
+    unsigned long unexpected_disconnects;
+} stats;
+
+static LatencyHistogram move_latency;
+static LatencyHistogram register_latency;
+
+// Function to read the monotonic clock in seconds
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Function to draw a uniform number in [0, 1) (xorshift64*)
+static double random_unit(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+// Function to draw one think time, in seconds
+static double draw_think_time(void)
+{
+    switch (think_distribution)
+    {
+    case THINK_UNIFORM:
+        return (think_param_a + (think_param_b - think_param_a) * random_unit()) / 1000.0;
+    case THINK_EXPONENTIAL:
+        return -think_param_a * log(1.0 - random_unit()) / 1000.0;
+    case THINK_FIXED:
+    default:
+        return think_param_a / 1000.0;
+    }
+}
+
+// --- Latency histogram ---
+
+static int latency_bucket(uint64_t value)
+{
+    if (value < LATENCY_SUB_BUCKETS)
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int exponent = msb - LATENCY_SUB_BUCKET_BITS + 1;
+    return exponent * LATENCY_SUB_BUCKETS + (int)((value >> (exponent - 1)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+static uint64_t latency_bucket_upper_bound(int bucket)
+{
+    int exponent = bucket / LATENCY_SUB_BUCKETS;
+    uint64_t mantissa = (uint64_t)(bucket % LATENCY_SUB_BUCKETS);
+    if (exponent == 0)
+        return mantissa;
+    uint64_t width = (uint64_t)1 << (exponent - 1);
+    return ((LATENCY_SUB_BUCKETS + mantissa) << (exponent - 1)) + width - 1;
+}
+
+static void latency_record(LatencyHistogram *histogram, double seconds)
+{
+    uint64_t micros = seconds <= 0 ? 0 : (uint64_t)(seconds * 1e6);
+    histogram->counts[latency_bucket(micros)]++;
+    histogram->total++;
+    if (micros > histogram->max_value)
+        histogram->max_value = micros;
+}
+
+static uint64_t latency_percentile(const LatencyHistogram *histogram, double percentile)
+{
+    if (histogram->total == 0)
+        return 0;
+    unsigned long target = (unsigned long)ceil(percentile / 100.0 * (double)histogram->total);
+    if (target == 0)
+        target = 1;
+    unsigned long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; ++b)
+    {
+        seen += histogram->counts[b];
+        if (seen >= target)
+        {
+            uint64_t bound = latency_bucket_upper_bound(b);
+            return bound < histogram->max_value ? bound : histogram->max_value;
+        }
+    }
+    return histogram->max_value;
+}
+
+// --- Timer heap (min-heap of client indices ordered by deadline) ---
+
+static void heap_swap(int a, int b)
+{
+    int tmp = timer_heap[a];
+    timer_heap[a] = timer_heap[b];
+    timer_heap[b] = tmp;
+    virtual_clients[timer_heap[a]].heap_index = a;
+    virtual_clients[timer_heap[b]].heap_index = b;
+}
+
+static void heap_sift_up(int pos)
+{
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (virtual_clients[timer_heap[parent]].deadline <= virtual_clients[timer_heap[pos]].deadline)
+            break;
+        heap_swap(parent, pos);
+        pos = parent;
+    }
+}
+
+static void heap_sift_down(int pos)
+{
+    for (;;)
+    {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < timer_heap_size && virtual_clients[timer_heap[left]].deadline < virtual_clients[timer_heap[smallest]].deadline)
+            smallest = left;
+        if (right < timer_heap_size && virtual_clients[timer_heap[right]].deadline < virtual_clients[timer_heap[smallest]].deadline)
+            smallest = right;
+        if (smallest == pos)
+            return;
+        heap_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+// Function to cancel a client's pending timer
+static void cancel_timer(VirtualClient *vc)
+{
+    int pos = vc->heap_index;
+    vc->deadline = INFINITY;
+    if (pos < 0)
+        return;
+    vc->heap_index = -1;
+    timer_heap_size--;
+    if (pos == timer_heap_size)
+        return;
+    int moved = timer_heap[timer_heap_size];
+    timer_heap[pos] = moved;
+    virtual_clients[moved].heap_index = pos;
+    heap_sift_up(pos);
+    heap_sift_down(virtual_clients[moved].heap_index);
+}
+
+// Function to (re)arm a client's single timer
+static void set_timer(VirtualClient *vc, double deadline)
+{
+    cancel_timer(vc);
+    vc->deadline = deadline;
+    vc->heap_index = timer_heap_size;
+    timer_heap[timer_heap_size++] = (int)(vc - virtual_clients);
+    heap_sift_up(vc->heap_index);
+}
+
+// --- Connections ---
+
+static void update_epoll_interest(VirtualClient *vc)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (vc->state == VC_CONNECTING || vc->out_len > 0 ? EPOLLOUT : 0);
+    ev.data.u32 = (uint32_t)(vc - virtual_clients);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, vc->fd, &ev) == -1)
+        perror("epoll_ctl MOD");
+}
+
+// Function to close a connection and schedule a reconnect
+static void close_virtual_client(VirtualClient *vc, double now, double reconnect_delay)
+{
+    if (vc->fd != -1)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, vc->fd, NULL);
+        close(vc->fd);
+        vc->fd = -1;
+    }
+    vc->state = VC_IDLE;
+    vc->role = ' ';
+    vc->out_len = 0;
+    set_timer(vc, now + reconnect_delay);
+}
+
+// Function to start a non-blocking connect
+static void start_connect(VirtualClient *vc, double now)
+{
+    stats.connect_attempts++;
+    int fd = socket(server_address->ai_family, server_address->ai_socktype | SOCK_NONBLOCK, server_address->ai_protocol);
+    if (fd == -1)
+    {
+        perror("socket");
+        stats.connect_failures++;
+        set_timer(vc, now + retry_delay_seconds);
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, server_address->ai_addr, server_address->ai_addrlen) == -1 && errno != EINPROGRESS)
+    {
+        close(fd);
+        stats.connect_failures++;
+        set_timer(vc, now + retry_delay_seconds);
+        return;
+    }
+
+    vc->fd = fd;
+    vc->generation++;
+    snprintf(vc->username, sizeof(vc->username), "lg%d_%u", (int)(vc - virtual_clients), vc->generation);
+    vc->state = VC_CONNECTING;
+    vc->out_len = 0;
+    vc->role = ' ';
+    line_framer_init(&vc->framer);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = (uint32_t)(vc - virtual_clients);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        perror("epoll_ctl ADD");
+        close(fd);
+        vc->fd = -1;
+        vc->state = VC_IDLE;
+        stats.connect_failures++;
+        set_timer(vc, now + retry_delay_seconds);
+        return;
+    }
+    set_timer(vc, now + request_timeout_seconds);
+}
+
+// Function to write as much of the pending output as the socket takes
+static int flush_output(VirtualClient *vc)
+{
+    while (vc->out_len > 0)
+    {
+        ssize_t n = send(vc->fd, vc->out, vc->out_len, MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        memmove(vc->out, vc->out + n, vc->out_len - (size_t)n);
+        vc->out_len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Function to queue one newline-terminated message
+static int send_line(VirtualClient *vc, const char *line, int len)
+{
+    if (vc->out_len + (size_t)len + 1 > sizeof(vc->out))
+        return -1;
+    int was_empty = (vc->out_len == 0);
+    memcpy(vc->out + vc->out_len, line, (size_t)len);
+    vc->out[vc->out_len + (size_t)len] = '\n';
+    vc->out_len += (size_t)len + 1;
+    if (flush_output(vc) == -1)
+        return -1;
+    if (was_empty != (vc->out_len == 0))
+        update_epoll_interest(vc);
+    return 0;
+}
+
+static void send_register(VirtualClient *vc, double now)
+{
+    char message[LOADGEN_MESSAGE_LEN];
+    int len = snprintf(message, sizeof(message), "{\"type\":\"register\",\"username\":\"%s\"}", vc->username);
+    if (send_line(vc, message, len) == -1)
+    {
+        stats.unexpected_disconnects++;
+        close_virtual_client(vc, now, retry_delay_seconds);
+        return;
+    }
+    vc->state = VC_REGISTERING;
+    vc->request_sent_at = now;
+    set_timer(vc, now + request_timeout_seconds);
+}
+
+// Function to pick a move: uniformly random, or the one with the best immediate piece balance
+static RulesMove choose_move(VirtualClient *vc, int *out_is_pass)
+{
+    static RulesMove moves[GAME_RULES_MAX_MOVES];
+    RulesMove chosen = {0, 0, 0, 0};
+    int count = game_rules_list_moves(vc->board, vc->role, moves, GAME_RULES_MAX_MOVES);
+    *out_is_pass = (count == 0);
+    if (count == 0)
+        return chosen;
+
+    if (!use_greedy_policy)
+        return moves[(int)(random_unit() * count)];
+
+    char opponent = (vc->role == 'R') ? 'B' : 'R';
+    int best_score = -1000;
+    int ties = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        char trial[8][9];
+        memcpy(trial, vc->board, sizeof(trial));
+        game_rules_apply_move(trial, moves[i].sx, moves[i].sy, moves[i].tx, moves[i].ty, vc->role, NULL);
+        int score = game_rules_count_pieces(trial, vc->role) - game_rules_count_pieces(trial, opponent);
+        if (score > best_score)
+        {
+            best_score = score;
+            chosen = moves[i];
+            ties = 1;
+        }
+        else if (score == best_score && random_unit() * ++ties < 1.0)
+        {
+            chosen = moves[i]; // Reservoir-sample among equally good moves
+        }
+    }
+    return chosen;
+}
+
+static void send_move(VirtualClient *vc, double now)
+{
+    int is_pass;
+    RulesMove move = choose_move(vc, &is_pass);
+    char message[LOADGEN_MESSAGE_LEN];
+    int len;
+    if (is_pass)
+    {
+        len = snprintf(message, sizeof(message), "{\"type\":\"move\",\"username\":\"%s\",\"sx\":0,\"sy\":0,\"tx\":0,\"ty\":0}", vc->username);
+        stats.passes_sent++;
+    }
+    else
+    {
+        // The protocol is 1-indexed
+        len = snprintf(message, sizeof(message), "{\"type\":\"move\",\"username\":\"%s\",\"sx\":%d,\"sy\":%d,\"tx\":%d,\"ty\":%d}",
+                       vc->username, move.sx + 1, move.sy + 1, move.tx + 1, move.ty + 1);
+    }
+    if (send_line(vc, message, len) == -1)
+    {
+        stats.unexpected_disconnects++;
+        close_virtual_client(vc, now, retry_delay_seconds);
+        return;
+    }
+    stats.moves_sent++;
+    vc->state = VC_AWAITING_REPLY;
+    vc->request_sent_at = now;
+    set_timer(vc, now + request_timeout_seconds);
+}
+
+// Function to copy a protocol board ("board": [8 strings]) into the client
+static int copy_board(const cJSON *root, char board[8][9])
+{
+    const cJSON *board_json = cJSON_GetObjectItemCaseSensitive(root, "board");
+    if (!cJSON_IsArray(board_json) || cJSON_GetArraySize(board_json) != 8)
+        return -1;
+    for (int i = 0; i < 8; ++i)
+    {
+        const cJSON *row = cJSON_GetArrayItem(board_json, i);
+        if (!cJSON_IsString(row) || strlen(row->valuestring) < 8)
+            return -1;
+        memcpy(board[i], row->valuestring, 8);
+        board[i][8] = '\0';
+    }
+    return 0;
+}
+
+// Function to react to one message from the server
+static void handle_server_line(VirtualClient *vc, const char *line, size_t len, double now)
+{
+    cJSON *root = cJSON_ParseWithLength(line, len);
+    const cJSON *type_json = root ? cJSON_GetObjectItemCaseSensitive(root, "type") : NULL;
+    if (!cJSON_IsString(type_json))
+    {
+        stats.protocol_errors++;
+        cJSON_Delete(root);
+        return;
+    }
+
+    switch (message_type_from_string(type_json->valuestring))
+    {
+    case MSG_REGISTER_ACK:
+        if (vc->state != VC_REGISTERING)
+        {
+            stats.protocol_errors++;
+            break;
+        }
+        latency_record(&register_latency, now - vc->request_sent_at);
+        stats.registrations_acked++;
+        vc->state = VC_WAITING;
+        cancel_timer(vc);
+        break;
+    case MSG_REGISTER_NACK:
+        if (vc->state != VC_REGISTERING)
+        {
+            stats.protocol_errors++;
+            break;
+        }
+        latency_record(&register_latency, now - vc->request_sent_at);
+        stats.registrations_nacked++;
+        vc->state = VC_REGISTER_BACKOFF;
+        set_timer(vc, now + retry_delay_seconds);
+        break;
+    case MSG_GAME_START:
+    {
+        const cJSON *first_player = cJSON_GetObjectItemCaseSensitive(root, "first_player");
+        if (!cJSON_IsString(first_player))
+        {
+            stats.protocol_errors++;
+            break;
+        }
+        vc->role = (strcmp(first_player->valuestring, vc->username) == 0) ? 'R' : 'B';
+        if (vc->role == 'R')
+            stats.games_started++; // Counted once per game
+        break;
+    }
+    case MSG_YOUR_TURN:
+        if (vc->role == ' ' || copy_board(root, vc->board) == -1)
+        {
+            stats.protocol_errors++;
+            break;
+        }
+        vc->state = VC_THINKING;
+        set_timer(vc, now + draw_think_time());
+        break;
+    case MSG_MOVE_OK:
+    case MSG_INVALID_MOVE:
+        if (vc->state != VC_AWAITING_REPLY)
+        {
+            stats.protocol_errors++;
+            break;
+        }
+        latency_record(&move_latency, now - vc->request_sent_at);
+        if (message_type_from_string(type_json->valuestring) == MSG_MOVE_OK)
+            stats.moves_accepted++;
+        else
+            stats.moves_rejected++;
+        copy_board(root, vc->board);
+        vc->state = VC_WAITING;
+        cancel_timer(vc);
+        break;
+    case MSG_PASS:
+        // We ran out of turn time; a move still being "thought about" is now stale
+        stats.server_passes++;
+        if (vc->state == VC_THINKING)
+        {
+            vc->state = VC_WAITING;
+            cancel_timer(vc);
+        }
+        break;
+    case MSG_GAME_OVER:
+        if (vc->role == 'R')
+            stats.games_finished++;
+        vc->state = VC_GAME_OVER;
+        cancel_timer(vc);
+        break;
+    default:
+        stats.protocol_errors++;
+        break;
+    }
+    cJSON_Delete(root);
+}
+
+// Function to handle readiness of one connection
+static void handle_client_event(VirtualClient *vc, uint32_t events, double now)
+{
+    if (vc->state == VC_CONNECTING)
+    {
+        int so_error = 0;
+        socklen_t so_len = sizeof(so_error);
+        getsockopt(vc->fd, SOL_SOCKET, SO_ERROR, &so_error, &so_len);
+        if (so_error != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            stats.connect_failures++;
+            close_virtual_client(vc, now, retry_delay_seconds);
+            return;
+        }
+        if (!(events & EPOLLOUT))
+            return;
+        vc->state = VC_REGISTERING; // Connected
+        update_epoll_interest(vc);
+        send_register(vc, now);
+        return;
+    }
+
+    if ((events & EPOLLOUT) && vc->out_len > 0)
+    {
+        if (flush_output(vc) == -1)
+        {
+            stats.unexpected_disconnects++;
+            close_virtual_client(vc, now, retry_delay_seconds);
+            return;
+        }
+        if (vc->out_len == 0)
+            update_epoll_interest(vc);
+    }
+
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+        return;
+
+    for (;;)
+    {
+        ssize_t nbytes = line_framer_recv(&vc->framer, vc->fd);
+        if (nbytes == 0 || (nbytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            // The server closes both players after game_over; anything else is unexpected
+            if (vc->state != VC_GAME_OVER)
+                stats.unexpected_disconnects++;
+            close_virtual_client(vc, now, vc->state == VC_GAME_OVER ? 0.0 : retry_delay_seconds);
+            return;
+        }
+        if (nbytes == -1)
+            break;
+
+        const char *line;
+        size_t line_len;
+        int status;
+        while ((status = line_framer_next(&vc->framer, &line, &line_len)) != LINE_FRAMER_NONE)
+        {
+            if (status == LINE_FRAMER_OVERSIZED)
+            {
+                stats.protocol_errors++;
+                continue;
+            }
+            handle_server_line(vc, line, line_len, now);
+            if (vc->fd == -1)
+                return;
+        }
+    }
+}
+
+// Function to fire one expired timer
+static void handle_timer(VirtualClient *vc, double now)
+{
+    switch (vc->state)
+    {
+    case VC_IDLE:
+        start_connect(vc, now);
+        break;
+    case VC_REGISTER_BACKOFF:
+        send_register(vc, now);
+        break;
+    case VC_THINKING:
+        send_move(vc, now);
+        break;
+    case VC_CONNECTING:
+    case VC_REGISTERING:
+    case VC_AWAITING_REPLY:
+        stats.timeouts++;
+        close_virtual_client(vc, now, retry_delay_seconds);
+        break;
+    default:
+        break;
+    }
+}
+
+static void print_progress(double elapsed, unsigned long moves_in_interval, double interval)
+{
+    int in_game = 0;
+    for (int i = 0; i < num_virtual_clients; ++i)
+    {
+        if (virtual_clients[i].role != ' ')
+            in_game++;
+    }
+    printf("[%6.1fs] moves/s %8.1f | in game %5d | games %lu | timeouts %lu | errors %lu\n",
+           elapsed, moves_in_interval / interval, in_game, stats.games_finished, stats.timeouts,
+           stats.protocol_errors + stats.unexpected_disconnects);
+    fflush(stdout);
+}
+
+static void print_latency_line(const char *label, const LatencyHistogram *histogram)
+{
+    printf("  %-22s n=%-9lu p50 %8llu  p90 %8llu  p99 %8llu  p99.9 %8llu  max %8llu (us)\n", label, histogram->total,
+           (unsigned long long)latency_percentile(histogram, 50.0), (unsigned long long)latency_percentile(histogram, 90.0),
+           (unsigned long long)latency_percentile(histogram, 99.0), (unsigned long long)latency_percentile(histogram, 99.9),
+           (unsigned long long)histogram->max_value);
+}
+
+static void print_summary(double elapsed)
+{
+    printf("\nLoad generator summary: %d clients against %s:%s for %.1f s (%s policy)\n",
+           num_virtual_clients, server_ip, server_port, elapsed, use_greedy_policy ? "greedy" : "random");
+    printf("  connections            attempted %lu, failed %lu, unexpected disconnects %lu\n",
+           stats.connect_attempts, stats.connect_failures, stats.unexpected_disconnects);
+    printf("  registrations          accepted %lu, rejected %lu\n", stats.registrations_acked, stats.registrations_nacked);
+    printf("  games                  started %lu, finished %lu\n", stats.games_started, stats.games_finished);
+    printf("  moves                  sent %lu (passes %lu), accepted %lu, rejected %lu, server passes %lu\n",
+           stats.moves_sent, stats.passes_sent, stats.moves_accepted, stats.moves_rejected, stats.server_passes);
+    printf("  throughput             %.1f moves/s\n", elapsed > 0 ? stats.moves_accepted / elapsed : 0.0);
+    print_latency_line("move -> reply", &move_latency);
+    print_latency_line("register -> reply", &register_latency);
+    printf("  timeouts %lu, protocol errors %lu\n", stats.timeouts, stats.protocol_errors);
+}
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Function to parse "fixed:MS", "uniform:MIN:MAX" or "exp:MEAN"
+static int parse_think_spec(const char *spec)
+{
+    if (sscanf(spec, "fixed:%lf", &think_param_a) == 1 && think_param_a >= 0)
+    {
+        think_distribution = THINK_FIXED;
+        return 0;
+    }
+    if (sscanf(spec, "uniform:%lf:%lf", &think_param_a, &think_param_b) == 2 && think_param_a >= 0 && think_param_b >= think_param_a)
+    {
+        think_distribution = THINK_UNIFORM;
+        return 0;
+    }
+    if (sscanf(spec, "exp:%lf", &think_param_a) == 1 && think_param_a >= 0)
+    {
+        think_distribution = THINK_EXPONENTIAL;
+        return 0;
+    }
+    return -1;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-ip <server_ip>] [-port <server_port>] [-clients <n>] [-duration <seconds>]\n"
+            "          [-think fixed:<ms>|uniform:<min_ms>:<max_ms>|exp:<mean_ms>] [-policy random|greedy]\n"
+            "          [-timeout <seconds>] [-retry-ms <ms>] [-seed <n>]\n",
+            program);
+}
+
+static int parse_loadgen_args(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, "Error: Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        const char *value = argv[++i];
+        const char *option = argv[i - 1];
+        if (strcmp(option, "-ip") == 0)
+            server_ip = value;
+        else if (strcmp(option, "-port") == 0)
+            server_port = value;
+        else if (strcmp(option, "-clients") == 0)
+            num_virtual_clients = atoi(value);
+        else if (strcmp(option, "-duration") == 0)
+            run_duration_seconds = atof(value);
+        else if (strcmp(option, "-think") == 0)
+        {
+            if (parse_think_spec(value) == -1)
+            {
+                fprintf(stderr, "Error: Invalid think time '%s'\n", value);
+                return -1;
+            }
+        }
+        else if (strcmp(option, "-policy") == 0)
+        {
+            if (strcmp(value, "greedy") == 0)
+                use_greedy_policy = 1;
+            else if (strcmp(value, "random") == 0)
+                use_greedy_policy = 0;
+            else
+            {
+                fprintf(stderr, "Error: Unknown policy '%s'\n", value);
+                return -1;
+            }
+        }
+        else if (strcmp(option, "-timeout") == 0)
+            request_timeout_seconds = atof(value);
+        else if (strcmp(option, "-retry-ms") == 0)
+            retry_delay_seconds = atof(value) / 1000.0;
+        else if (strcmp(option, "-seed") == 0)
+            rng_state = strtoull(value, NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+        else
+        {
+            fprintf(stderr, "Error: Unknown option %s\n", option);
+            return -1;
+        }
+    }
+    if (num_virtual_clients <= 0 || run_duration_seconds <= 0 || request_timeout_seconds <= 0)
+    {
+        fprintf(stderr, "Error: -clients, -duration and -timeout must be positive.\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to make sure one process can hold every connection
+static void raise_fd_limit(int needed)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1 || limit.rlim_cur >= (rlim_t)needed)
+        return;
+    limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max >= (rlim_t)needed) ? (rlim_t)needed : limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1 || limit.rlim_cur < (rlim_t)needed)
+        fprintf(stderr, "Warning: Open file limit is %llu; some of the %d connections may fail.\n",
+                (unsigned long long)limit.rlim_cur, num_virtual_clients);
+}
+
+int main(int argc, char *argv[])
+{
+    if (parse_loadgen_args(argc, argv) == -1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int gai_status = getaddrinfo(server_ip, server_port, &hints, &server_address);
+    if (gai_status != 0)
+    {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(gai_status));
+        return 1;
+    }
+
+    raise_fd_limit(num_virtual_clients + 64);
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+
+    virtual_clients = calloc((size_t)num_virtual_clients, sizeof(VirtualClient));
+    timer_heap = calloc((size_t)num_virtual_clients, sizeof(int));
+    epoll_fd = epoll_create1(0);
+    if (virtual_clients == NULL || timer_heap == NULL || epoll_fd == -1)
+    {
+        perror("loadgen setup");
+        return 1;
+    }
+
+    double start_time = now_seconds();
+    for (int i = 0; i < num_virtual_clients; ++i)
+    {
+        VirtualClient *vc = &virtual_clients[i];
+        vc->fd = -1;
+        vc->state = VC_IDLE;
+        vc->role = ' ';
+        vc->heap_index = -1;
+        vc->deadline = INFINITY;
+        set_timer(vc, start_time + (retry_delay_seconds * i) / num_virtual_clients); // Spread the connect burst
+    }
+
+    printf("Load generator: %d clients -> %s:%s for %.0f s\n", num_virtual_clients, server_ip, server_port, run_duration_seconds);
+
+    struct epoll_event events[LOADGEN_MAX_EVENTS];
+    double end_time = start_time + run_duration_seconds;
+    double next_report = start_time + 1.0;
+    unsigned long moves_at_last_report = 0;
+    double now = start_time;
+
+    while (!stop_requested && now < end_time)
+    {
+        double wake_at = next_report;
+        if (timer_heap_size > 0 && virtual_clients[timer_heap[0]].deadline < wake_at)
+            wake_at = virtual_clients[timer_heap[0]].deadline;
+        int timeout_ms = (int)ceil((wake_at - now) * 1000.0);
+        if (timeout_ms < 0)
+            timeout_ms = 0;
+
+        int ready = epoll_wait(epoll_fd, events, LOADGEN_MAX_EVENTS, timeout_ms);
+        if (ready == -1 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            break;
+        }
+        now = now_seconds();
+        for (int e = 0; e < ready; ++e)
+        {
+            handle_client_event(&virtual_clients[events[e].data.u32], events[e].events, now);
+        }
+
+        while (timer_heap_size > 0 && virtual_clients[timer_heap[0]].deadline <= now)
+        {
+            VirtualClient *vc = &virtual_clients[timer_heap[0]];
+            cancel_timer(vc);
+            handle_timer(vc, now);
+        }
+
+        if (now >= next_report)
+        {
+            print_progress(now - start_time, stats.moves_accepted - moves_at_last_report, now - next_report + 1.0);
+            moves_at_last_report = stats.moves_accepted;
+            next_report += 1.0;
+        }
+    }
+
+    print_summary(now_seconds() - start_time);
+
+    for (int i = 0; i < num_virtual_clients; ++i)
+    {
+        if (virtual_clients[i].fd != -1)
+            close(virtual_clients[i].fd);
+    }
+    close(epoll_fd);
+    freeaddrinfo(server_address);
+    free(timer_heap);
+    free(virtual_clients);
+    return 0;
+}
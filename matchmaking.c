@@ -0,0 +1,497 @@
+#include "matchmaking.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RATING_TABLE_INITIAL_CAPACITY 256
+
+// --- Match Queue ---
+
+// Orders entries by (rating, handle); handles make every key unique
+static int entry_less(const MatchQueue *queue, int a, int b)
+{
+    const MatchEntry *ea = &queue->entries[a];
+    const MatchEntry *eb = &queue->entries[b];
+    if (ea->rating != eb->rating)
+        return ea->rating < eb->rating;
+    return a < b;
+}
+
+// xorshift32, only used for treap priorities
+static unsigned int next_priority(MatchQueue *queue)
+{
+    unsigned int x = queue->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    queue->rng_state = x;
+    return x;
+}
+
+// Splits the subtree 't' into keys smaller than 'handle' (*left) and the rest (*right)
+static void treap_split(MatchQueue *queue, int t, int handle, int *left, int *right)
+{
+    if (t == -1)
+    {
+        *left = -1;
+        *right = -1;
+        return;
+    }
+    if (entry_less(queue, t, handle))
+    {
+        treap_split(queue, queue->entries[t].right, handle, &queue->entries[t].right, right);
+        *left = t;
+    }
+    else
+    {
+        treap_split(queue, queue->entries[t].left, handle, left, &queue->entries[t].left);
+        *right = t;
+    }
+}
+
+// Joins two subtrees where every key of 'a' is smaller than every key of 'b'
+static int treap_merge(MatchQueue *queue, int a, int b)
+{
+    if (a == -1)
+        return b;
+    if (b == -1)
+        return a;
+    if (queue->entries[a].priority > queue->entries[b].priority)
+    {
+        queue->entries[a].right = treap_merge(queue, queue->entries[a].right, b);
+        return a;
+    }
+    queue->entries[b].left = treap_merge(queue, a, queue->entries[b].left);
+    return b;
+}
+
+static int treap_insert(MatchQueue *queue, int t, int handle)
+{
+    if (t == -1)
+        return handle;
+    if (queue->entries[handle].priority > queue->entries[t].priority)
+    {
+        treap_split(queue, t, handle, &queue->entries[handle].left, &queue->entries[handle].right);
+        return handle;
+    }
+    if (entry_less(queue, handle, t))
+        queue->entries[t].left = treap_insert(queue, queue->entries[t].left, handle);
+    else
+        queue->entries[t].right = treap_insert(queue, queue->entries[t].right, handle);
+    return t;
+}
+
+static int treap_erase(MatchQueue *queue, int t, int handle)
+{
+    if (t == -1)
+        return -1;
+    if (t == handle)
+        return treap_merge(queue, queue->entries[t].left, queue->entries[t].right);
+    if (entry_less(queue, handle, t))
+        queue->entries[t].left = treap_erase(queue, queue->entries[t].left, handle);
+    else
+        queue->entries[t].right = treap_erase(queue, queue->entries[t].right, handle);
+    return t;
+}
+
+// Closest queued entry below 'handle' in (rating, handle) order, or -1
+static int treap_predecessor(const MatchQueue *queue, int handle)
+{
+    int best = -1;
+    int t = queue->root;
+    while (t != -1)
+    {
+        if (entry_less(queue, t, handle))
+        {
+            best = t;
+            t = queue->entries[t].right;
+        }
+        else
+        {
+            t = queue->entries[t].left;
+        }
+    }
+    return best;
+}
+
+// Closest queued entry above 'handle' in (rating, handle) order, or -1
+static int treap_successor(const MatchQueue *queue, int handle)
+{
+    int best = -1;
+    int t = queue->root;
+    while (t != -1)
+    {
+        if (entry_less(queue, handle, t))
+        {
+            best = t;
+            t = queue->entries[t].left;
+        }
+        else
+        {
+            t = queue->entries[t].right;
+        }
+    }
+    return best;
+}
+
+static void heap_swap(MatchQueue *queue, int i, int j)
+{
+    int a = queue->check_heap[i];
+    int b = queue->check_heap[j];
+    queue->check_heap[i] = b;
+    queue->check_heap[j] = a;
+    queue->entries[b].heap_index = i;
+    queue->entries[a].heap_index = j;
+}
+
+static int heap_earlier(const MatchQueue *queue, int i, int j)
+{
+    return queue->entries[queue->check_heap[i]].next_check_at < queue->entries[queue->check_heap[j]].next_check_at;
+}
+
+static void heap_sift_up(MatchQueue *queue, int i)
+{
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!heap_earlier(queue, i, parent))
+            break;
+        heap_swap(queue, i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(MatchQueue *queue, int i)
+{
+    for (;;)
+    {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < queue->heap_size && heap_earlier(queue, l, smallest))
+            smallest = l;
+        if (r < queue->heap_size && heap_earlier(queue, r, smallest))
+            smallest = r;
+        if (smallest == i)
+            break;
+        heap_swap(queue, i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_remove(MatchQueue *queue, int handle)
+{
+    int i = queue->entries[handle].heap_index;
+    int last = queue->heap_size - 1;
+    if (i != last)
+    {
+        heap_swap(queue, i, last);
+    }
+    queue->heap_size--;
+    queue->entries[handle].heap_index = -1;
+    if (i < queue->heap_size)
+    {
+        heap_sift_down(queue, i);
+        heap_sift_up(queue, i);
+    }
+}
+
+// Rating difference this entry accepts after waiting until 'now'
+static int entry_window(const MatchEntry *entry, double now)
+{
+    double waited = now - entry->enqueued_at;
+    if (waited < 0)
+        waited = 0;
+    double window = MATCH_WINDOW_BASE + MATCH_WINDOW_GROWTH_PER_SEC * waited;
+    if (window >= MATCH_WINDOW_MAX)
+        return INT32_MAX;
+    return (int)window;
+}
+
+int match_queue_init(MatchQueue *queue, int capacity)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->entries = calloc((size_t)capacity, sizeof(MatchEntry));
+    queue->check_heap = calloc((size_t)capacity, sizeof(int));
+    if (!queue->entries || !queue->check_heap)
+    {
+        match_queue_free(queue);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++)
+    {
+        queue->entries[i].left = -1;
+        queue->entries[i].right = -1;
+        queue->entries[i].heap_index = -1;
+    }
+    queue->capacity = capacity;
+    queue->root = -1;
+    queue->rng_state = 0x9e3779b9u;
+    return 0;
+}
+
+void match_queue_free(MatchQueue *queue)
+{
+    free(queue->entries);
+    free(queue->check_heap);
+    queue->entries = NULL;
+    queue->check_heap = NULL;
+    queue->capacity = 0;
+    queue->heap_size = 0;
+    queue->root = -1;
+    queue->queued = 0;
+}
+
+void match_queue_push(MatchQueue *queue, int handle, int rating, double now)
+{
+    if (handle < 0 || handle >= queue->capacity || queue->entries[handle].in_queue)
+        return;
+
+    MatchEntry *entry = &queue->entries[handle];
+    entry->rating = rating;
+    entry->in_queue = 1;
+    entry->enqueued_at = now;
+    entry->next_check_at = now + MATCH_RECHECK_INTERVAL_SEC;
+    entry->priority = next_priority(queue);
+    entry->left = -1;
+    entry->right = -1;
+    queue->root = treap_insert(queue, queue->root, handle);
+
+    entry->heap_index = queue->heap_size;
+    queue->check_heap[queue->heap_size++] = handle;
+    heap_sift_up(queue, entry->heap_index);
+    queue->queued++;
+}
+
+void match_queue_remove(MatchQueue *queue, int handle)
+{
+    if (handle < 0 || handle >= queue->capacity || !queue->entries[handle].in_queue)
+        return;
+
+    queue->root = treap_erase(queue, queue->root, handle);
+    heap_remove(queue, handle);
+    queue->entries[handle].in_queue = 0;
+    queue->entries[handle].left = -1;
+    queue->entries[handle].right = -1;
+    queue->queued--;
+}
+
+int match_queue_take_pair(MatchQueue *queue, int handle, double now, int *out_first, int *out_second)
+{
+    if (handle < 0 || handle >= queue->capacity || !queue->entries[handle].in_queue)
+        return 0;
+
+    const MatchEntry *entry = &queue->entries[handle];
+    int candidates[2] = {treap_predecessor(queue, handle), treap_successor(queue, handle)};
+    int best = -1;
+    int best_diff = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        int c = candidates[i];
+        if (c == -1)
+            continue;
+        int diff = abs(queue->entries[c].rating - entry->rating);
+        // Prefer the closer rating, then the player that has waited longer
+        if (best == -1 || diff < best_diff ||
+            (diff == best_diff && queue->entries[c].enqueued_at < queue->entries[best].enqueued_at))
+        {
+            best = c;
+            best_diff = diff;
+        }
+    }
+    if (best == -1)
+        return 0;
+
+    int window = entry_window(entry, now);
+    int opponent_window = entry_window(&queue->entries[best], now);
+    if (best_diff > (window > opponent_window ? window : opponent_window))
+        return 0;
+
+    if (queue->entries[best].enqueued_at < entry->enqueued_at)
+    {
+        *out_first = best;
+        *out_second = handle;
+    }
+    else
+    {
+        *out_first = handle;
+        *out_second = best;
+    }
+    match_queue_remove(queue, handle);
+    match_queue_remove(queue, best);
+    return 1;
+}
+
+int match_queue_poll(MatchQueue *queue, double now, int *out_first, int *out_second)
+{
+    while (queue->heap_size > 0)
+    {
+        int handle = queue->check_heap[0];
+        MatchEntry *entry = &queue->entries[handle];
+        if (entry->next_check_at > now)
+            return 0;
+        if (match_queue_take_pair(queue, handle, now, out_first, out_second))
+            return 1;
+        entry->next_check_at = now + MATCH_RECHECK_INTERVAL_SEC;
+        heap_sift_down(queue, 0);
+    }
+    return 0;
+}
+
+// --- Rating Table ---
+
+// FNV-1a hash of a NUL-terminated username
+static size_t hash_username(const char *username)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)username; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+// Returns the slot holding 'username', or the free slot where it would be inserted
+static RatingRecord *find_slot(RatingRecord *records, size_t capacity, const char *username)
+{
+    size_t mask = capacity - 1;
+    size_t i = hash_username(username) & mask;
+    while (records[i].username[0] != '\0' && strcmp(records[i].username, username) != 0)
+    {
+        i = (i + 1) & mask;
+    }
+    return &records[i];
+}
+
+// Removes a record, shifting later records of its probe sequence back so no tombstone is needed
+static void remove_slot(RatingTable *table, RatingRecord *record)
+{
+    size_t mask = table->capacity - 1;
+    size_t hole = (size_t)(record - table->records);
+    size_t i = hole;
+    while (1)
+    {
+        i = (i + 1) & mask;
+        if (table->records[i].username[0] == '\0')
+            break;
+        // The record at 'i' may fill the hole unless its home slot lies cyclically in (hole, i]
+        size_t home = hash_username(table->records[i].username) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            table->records[hole] = table->records[i];
+            hole = i;
+        }
+    }
+    table->records[hole].username[0] = '\0';
+    table->count--;
+}
+
+// Evicts the next record found that is offline and keeps no seat; returns -1 if there is none
+static int evict_one(RatingTable *table)
+{
+    for (size_t n = 0; n < table->capacity; n++)
+    {
+        size_t i = (table->evict_cursor + n) & (table->capacity - 1);
+        RatingRecord *record = &table->records[i];
+        if (record->username[0] != '\0' && !record->online && record->resume_room_id < 0)
+        {
+            remove_slot(table, record);
+            table->evict_cursor = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int rating_table_grow(RatingTable *table)
+{
+    size_t new_capacity = table->capacity * 2;
+    RatingRecord *new_records = calloc(new_capacity, sizeof(RatingRecord));
+    if (!new_records)
+        return -1;
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->records[i].username[0] != '\0')
+        {
+            *find_slot(new_records, new_capacity, table->records[i].username) = table->records[i];
+        }
+    }
+    free(table->records);
+    table->records = new_records;
+    table->capacity = new_capacity;
+    return 0;
+}
+
+int rating_table_init(RatingTable *table)
+{
+    table->records = calloc(RATING_TABLE_INITIAL_CAPACITY, sizeof(RatingRecord));
+    table->capacity = table->records ? RATING_TABLE_INITIAL_CAPACITY : 0;
+    table->count = 0;
+    table->evict_cursor = 0;
+    return table->records ? 0 : -1;
+}
+
+void rating_table_free(RatingTable *table)
+{
+    free(table->records);
+    table->records = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+RatingRecord *rating_table_find(RatingTable *table, const char *username)
+{
+    if (table->capacity == 0 || username[0] == '\0')
+        return NULL;
+    RatingRecord *record = find_slot(table->records, table->capacity, username);
+    return record->username[0] != '\0' ? record : NULL;
+}
+
+RatingRecord *rating_table_get(RatingTable *table, const char *username)
+{
+    if (table->capacity == 0 || username[0] == '\0')
+        return NULL;
+    RatingRecord *record = find_slot(table->records, table->capacity, username);
+    if (record->username[0] != '\0')
+        return record;
+
+    if (table->count >= RATING_TABLE_MAX_RECORDS)
+    {
+        if (evict_one(table) != 0)
+            return NULL;
+        record = find_slot(table->records, table->capacity, username);
+    }
+    // Keep the load factor under 3/4 so probe sequences stay short
+    if ((table->count + 1) * 4 > table->capacity * 3)
+    {
+        if (rating_table_grow(table) != 0)
+            return NULL;
+        record = find_slot(table->records, table->capacity, username);
+    }
+    strncpy(record->username, username, MAX_USERNAME_LEN - 1);
+    record->username[MAX_USERNAME_LEN - 1] = '\0';
+    record->rating = RATING_DEFAULT;
+    record->games_played = 0;
+    record->online = 0;
+    record->resume_room_id = -1;
+    table->count++;
+    return record;
+}
+
+void rating_table_release(RatingTable *table, RatingRecord *record)
+{
+    if (record && !record->online && record->resume_room_id < 0 && record->games_played == 0)
+        remove_slot(table, record);
+}
+
+void elo_update(RatingRecord *a, RatingRecord *b, double score_a)
+{
+    double expected_a = 1.0 / (1.0 + pow(10.0, (b->rating - a->rating) / 400.0));
+    double delta = RATING_K_FACTOR * (score_a - expected_a);
+    a->rating += delta;
+    b->rating -= delta;
+    a->games_played++;
+    b->games_played++;
+}
@@ -0,0 +1,161 @@
+#ifndef MATCHMAKING_H
+#define MATCHMAKING_H
+
+#include "protocol.h"
+
+// Matchmaking for the server: a queue of registered players waiting for an opponent,
+// paired by Elo rating with a search window that widens the longer a player waits.
+// Every operation on the queue is O(log n) in the number of queued players.
+
+#define MATCH_WINDOW_BASE 50            // Rating difference accepted right after queueing
+#define MATCH_WINDOW_GROWTH_PER_SEC 50  // Added to the window for every second of waiting
+#define MATCH_WINDOW_MAX 800            // Once reached, any opponent is accepted
+#define MATCH_RECHECK_INTERVAL_SEC 1.0  // How often a waiting player looks again
+
+#define RATING_DEFAULT 1500.0
+#define RATING_K_FACTOR 32.0
+#define RATING_TABLE_MAX_RECORDS 65536 // Names remembered at most; see rating_table_get()
+
+// One queued player. Handles are small integers chosen by the caller (the server uses
+// lobby slot indices), so entries live in a flat array and link to each other by handle.
+typedef struct
+{
+    int rating;
+    int in_queue;
+    double enqueued_at;   // Caller's clock, in seconds
+    double next_check_at; // When the entry is due for another look at its neighbours
+    unsigned int priority; // Treap heap priority
+    int left, right;       // Treap children (handles), -1 if none
+    int heap_index;        // Position in the re-check heap, -1 if not queued
+} MatchEntry;
+
+// Waiting players ordered by (rating, handle) in a treap, so the closest opponents are
+// the in-order neighbours, plus a min-heap of re-check deadlines so widening windows are
+// re-evaluated without scanning the whole queue.
+typedef struct
+{
+    MatchEntry *entries;
+    int *check_heap;
+    int capacity;
+    int heap_size;
+    int root;
+    int queued;
+    unsigned int rng_state;
+} MatchQueue;
+
+// Rating of one username. A record that is offline, keeps no seat for 'resume' and has
+// played no game carries nothing but the default rating, and is dropped by
+// rating_table_release(); other records stay until the table is full.
+typedef struct
+{
+    char username[MAX_USERNAME_LEN]; // Empty for a free slot
+    double rating;
+    int games_played;
+    int online; // Set while a connection is registered under this name
+    int resume_room_id; // Game a restarted server kept for this name until it resumes or ends, -1 if none
+} RatingRecord;
+
+// Open-addressing hash table of ratings keyed by username
+typedef struct
+{
+    RatingRecord *records;
+    size_t capacity; // Power of two
+    size_t count;
+    size_t evict_cursor; // Where the search for a record to evict resumes
+} RatingTable;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Allocates a queue for handles 0 .. capacity - 1.
+ *
+ * @return int 0 on success, -1 if the allocation failed.
+ */
+int match_queue_init(MatchQueue *queue, int capacity);
+
+/**
+ * @brief Frees the memory of a queue.
+ */
+void match_queue_free(MatchQueue *queue);
+
+/**
+ * @brief Adds a player to the queue. Does nothing if the handle is already queued.
+ *
+ * @param now Current time in seconds, from the same clock as every other call.
+ */
+void match_queue_push(MatchQueue *queue, int handle, int rating, double now);
+
+/**
+ * @brief Removes a player from the queue (e.g. on disconnect). Safe on unqueued handles.
+ */
+void match_queue_remove(MatchQueue *queue, int handle);
+
+/**
+ * @brief Looks for an acceptable opponent for one queued player.
+ *
+ * Only the nearest rating neighbours are considered. A pair is acceptable when the
+ * rating difference fits the wider of the two windows. On success both players are
+ * removed from the queue.
+ *
+ * @param out_first Out: the player that has waited longer.
+ * @param out_second Out: the other player.
+ * @return int 1 if a pair was taken, 0 otherwise.
+ */
+int match_queue_take_pair(MatchQueue *queue, int handle, double now, int *out_first, int *out_second);
+
+/**
+ * @brief Re-checks queued players whose windows have widened since their last look.
+ *
+ * Call it repeatedly until it returns 0; each call returns at most one pair.
+ *
+ * @return int 1 if a pair was taken (see match_queue_take_pair()), 0 if none is due.
+ */
+int match_queue_poll(MatchQueue *queue, double now, int *out_first, int *out_second);
+
+/**
+ * @brief Allocates an empty rating table.
+ *
+ * @return int 0 on success, -1 if the allocation failed.
+ */
+int rating_table_init(RatingTable *table);
+
+/**
+ * @brief Frees the memory of a rating table.
+ */
+void rating_table_free(RatingTable *table);
+
+/**
+ * @brief Returns the record of a username, creating it with the default rating if needed.
+ *
+ * When the table already holds RATING_TABLE_MAX_RECORDS names, a new one replaces a record
+ * that is offline and keeps no seat for 'resume' (the next one found by a sweep over the
+ * table), so that player's rating is forgotten. The table never grows past that bound.
+ * The pointer is only valid until the next rating_table_get() or rating_table_release() call.
+ *
+ * @return RatingRecord* The record, or NULL if the table could not grow or is full of online players.
+ */
+RatingRecord *rating_table_get(RatingTable *table, const char *username);
+
+/**
+ * @brief Returns the record of a username without creating it.
+ *
+ * @return RatingRecord* The record, or NULL if the username has never registered.
+ */
+RatingRecord *rating_table_find(RatingTable *table, const char *username);
+
+/**
+ * @brief Drops a record if it is offline, keeps no seat for 'resume' and has played no game.
+ *
+ * Call it whenever one of those changes, so names that only connected once do not pile up.
+ * Other records may move; pointers to them are no longer valid.
+ */
+void rating_table_release(RatingTable *table, RatingRecord *record);
+
+/**
+ * @brief Applies the Elo update for one finished game.
+ *
+ * @param score_a 1.0 if 'a' won, 0.5 for a draw, 0.0 if 'a' lost.
+ */
+void elo_update(RatingRecord *a, RatingRecord *b, double score_a);
+
+#endif // MATCHMAKING_H
@@ -1,10 +1,14 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <string.h>
+#include "board_delta.h"
+
 // Maximum string lengths (adjust as needed)
 #define MAX_USERNAME_LEN 32
 #define MAX_REASON_LEN 128
 #define MAX_BOARD_STR_LEN (8 * 9) // 8 rows * (8 chars + 1 newline/null)
+#define SESSION_TOKEN_LEN 17 // 16 hex digits and the terminating NUL
 
 // 1. Define C structs for each JSON message type.
 //    These structs will be used by both client and server for parsing and constructing messages.
@@ -16,11 +20,103 @@ typedef struct
     char type[32]; // "register", "move", "game_start", etc.
 } BaseMessage;
 
+// Interned message types. Each received line is parsed once, its "type" string is
+// mapped to one of these values, and the parsed tree is handed to the matching handler.
+typedef enum
+{
+    MSG_UNKNOWN = 0,
+    // Client to Server
+    MSG_REGISTER,
+    MSG_MOVE,
+    MSG_SPECTATE,
+    MSG_STATS,
+    MSG_RESUME,
+    // Server to Client
+    MSG_REGISTER_ACK,
+    MSG_REGISTER_NACK,
+    MSG_GAME_START,
+    MSG_YOUR_TURN,
+    MSG_MOVE_OK,
+    MSG_INVALID_MOVE,
+    MSG_PASS,
+    MSG_GAME_OVER,
+    MSG_RESUME_ACK,
+    MSG_RESUME_NACK,
+    // Server to Spectator
+    MSG_SPECTATE_SNAPSHOT,
+    MSG_SPECTATE_UPDATE,
+    MSG_STATS_REPORT
+} MessageType;
+
+static inline MessageType message_type_from_string(const char *type)
+{
+    if (type == NULL)
+        return MSG_UNKNOWN;
+
+    // Branch on the first character so most lookups need a single strcmp
+    switch (type[0])
+    {
+    case 'r':
+        if (strcmp(type, "register") == 0)
+            return MSG_REGISTER;
+        if (strcmp(type, "register_ack") == 0)
+            return MSG_REGISTER_ACK;
+        if (strcmp(type, "register_nack") == 0)
+            return MSG_REGISTER_NACK;
+        if (strcmp(type, "resume") == 0)
+            return MSG_RESUME;
+        if (strcmp(type, "resume_ack") == 0)
+            return MSG_RESUME_ACK;
+        if (strcmp(type, "resume_nack") == 0)
+            return MSG_RESUME_NACK;
+        break;
+    case 'm':
+        if (strcmp(type, "move") == 0)
+            return MSG_MOVE;
+        if (strcmp(type, "move_ok") == 0)
+            return MSG_MOVE_OK;
+        break;
+    case 's':
+        if (strcmp(type, "spectate") == 0)
+            return MSG_SPECTATE;
+        if (strcmp(type, "spectate_snapshot") == 0)
+            return MSG_SPECTATE_SNAPSHOT;
+        if (strcmp(type, "spectate_update") == 0)
+            return MSG_SPECTATE_UPDATE;
+        if (strcmp(type, "stats") == 0)
+            return MSG_STATS;
+        if (strcmp(type, "stats_report") == 0)
+            return MSG_STATS_REPORT;
+        break;
+    case 'g':
+        if (strcmp(type, "game_start") == 0)
+            return MSG_GAME_START;
+        if (strcmp(type, "game_over") == 0)
+            return MSG_GAME_OVER;
+        break;
+    case 'y':
+        if (strcmp(type, "your_turn") == 0)
+            return MSG_YOUR_TURN;
+        break;
+    case 'i':
+        if (strcmp(type, "invalid_move") == 0)
+            return MSG_INVALID_MOVE;
+        break;
+    case 'p':
+        if (strcmp(type, "pass") == 0)
+            return MSG_PASS;
+        break;
+    }
+    return MSG_UNKNOWN;
+}
+
 // Client to Server Payloads
 typedef struct
 {
     char type[32]; // "register"
     char username[MAX_USERNAME_LEN];
+    char wire[16]; // Optional: "binary" asks for the frames of wire_protocol.h, "" keeps JSON lines
+    char board_updates[16]; // Optional: "delta" asks for changed cells instead of full boards (board_delta.h)
 } ClientRegisterPayload;
 
 typedef struct
@@ -33,10 +129,28 @@ typedef struct
     int ty;
 } ClientMovePayload;
 
+typedef struct
+{
+    char type[32]; // "spectate"
+    int room;      // Optional room id; -1 (or absent) watches the most recently started game
+} ClientSpectatePayload;
+
+typedef struct
+{
+    char type[32]; // "resume"
+    char username[MAX_USERNAME_LEN];
+    char session_token[SESSION_TOKEN_LEN]; // From 'register_ack'
+    char wire[16]; // Optional, as in 'register'
+    char board_updates[16]; // Optional, as in 'register'
+} ClientResumePayload;
+
 // Server to Client Payloads
 typedef struct
 {
     char type[32]; // "register_ack"
+    char session_token[SESSION_TOKEN_LEN]; // Lets the player 'resume' its game on a new connection
+    char wire[16]; // "binary" once the connection switches to frames after this message, else ""
+    char board_updates[16]; // "delta" if turn messages carry changed cells from now on, else ""
 } ServerRegisterAckPayload;
 
 typedef struct
@@ -52,11 +166,21 @@ typedef struct
     char first_player[MAX_USERNAME_LEN];
 } ServerGameStartPayload;
 
+// How the board of a turn message travels. With "board_updates":"delta" the receiver gets
+// only the cells changed since the last board it was sent, unless it has none yet.
+typedef struct
+{
+    int is_delta;                      // 1: 'changes' (and maybe 'checksum') stand for 'board'
+    char changes[BOARD_CHANGES_LEN];   // See board_delta.h
+    char checksum[BOARD_CHECKSUM_LEN]; // "" if this update carries none
+} BoardUpdate;
+
 typedef struct
 {
     char type[32];    // "your_turn"
     char board[8][9]; // Array of 8 strings
     double timeout;
+    BoardUpdate board_update;
 } ServerYourTurnPayload;
 
 typedef struct
@@ -64,6 +188,7 @@ typedef struct
     char type[32];    // "move_ok"
     char board[8][9]; // Array of 8 strings
     char next_player[MAX_USERNAME_LEN];
+    BoardUpdate board_update;
 } ServerMoveOkPayload;
 
 typedef struct
@@ -72,6 +197,7 @@ typedef struct
     char board[8][9]; // Array of 8 strings
     char next_player[MAX_USERNAME_LEN];
     char reason[MAX_REASON_LEN]; // Reason for invalid move
+    BoardUpdate board_update;
 } ServerInvalidMovePayload;
 
 typedef struct
@@ -92,6 +218,55 @@ typedef struct
     PlayerScore scores[2];
 } ServerGameOverPayload;
 
+// Reply to a successful 'resume': the game as it stands. A 'your_turn' with the time
+// left follows if the resumed player is to move.
+typedef struct
+{
+    char type[32]; // "resume_ack"
+    int room;
+    char players[2][MAX_USERNAME_LEN]; // Seat order; players[0] plays 'R'
+    char board[8][9];
+    char next_player[MAX_USERNAME_LEN];
+    double timeout; // Seconds left for the player to move
+    char wire[16];  // As in 'register_ack'
+    char board_updates[16]; // As in 'register_ack'; this ack's board is the base for the next changes
+} ServerResumeAckPayload;
+
+typedef struct
+{
+    char type[32]; // "resume_nack"
+    char reason[MAX_REASON_LEN];
+} ServerResumeNackPayload;
+
+// Spectator stream payloads. A snapshot is sent on join and at every game start,
+// followed by one incremental update per processed turn.
+typedef struct
+{
+    char type[32];    // "spectate_snapshot"
+    int room;          // Room id, -1 while waiting for the next game
+    unsigned long seq; // Sequence number of the last event included in this snapshot
+    int game_active;
+    char players[2][MAX_USERNAME_LEN]; // Empty strings while no game is running
+    char board[8][9];
+    char next_player[MAX_USERNAME_LEN];
+} ServerSpectateSnapshotPayload;
+
+typedef struct
+{
+    char type[32];  // "spectate_update"
+    int room;
+    unsigned long seq; // Per room, without gaps
+    char event[16]; // "move", "pass", "invalid_move", "timeout", "disconnect"
+    char player[MAX_USERNAME_LEN];
+    int sx; // 1-indexed like ClientMovePayload, (0,0,0,0) when no coordinates apply
+    int sy;
+    int tx;
+    int ty;
+    char next_player[MAX_USERNAME_LEN];
+    char changes[BOARD_CHANGES_LEN];   // Cells the event changed (board_delta.h), "" if none
+    char checksum[BOARD_CHECKSUM_LEN]; // Board after the event, every BOARD_DELTA_CHECKSUM_INTERVAL seq; else ""
+} ServerSpectateUpdatePayload;
+
 /*
 Note on JSON utilities (cJSON.c, cJSON.h, or your own json_utils.c/.h):
 The submission allows for these files[cite: 25].
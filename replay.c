@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "game_journal.h"
+#include "game_rules.h"
+
+// Offline replay of game journals written by 'server -journal'. Every game is re-run
+// through the move rules from the initial position; each move must be legal and the final
+// piece counts must match the recorded scores. Needs no LED matrix and no server.
+
+typedef struct
+{
+    unsigned long games;
+    unsigned long events;
+    unsigned long moves;
+    unsigned long illegal_moves;   // Recorded as legal but rejected by the rules
+    unsigned long score_mismatches;
+    unsigned long truncated_games;
+    unsigned long abandoned_games;
+    unsigned long corrupt_records; // Bad magic, length or checksum (skipped)
+    unsigned long long bytes;
+} ReplayTotals;
+
+static int verbose = 0;   // Print every board
+static int list_games = 0; // One line per game
+
+static const char *event_names[] = {"move", "pass", "invalid", "timeout", "disconnect", "auto_pass", "?", "?"};
+
+static void print_board(char board[8][9])
+{
+    for (int r = 0; r < 8; r++)
+    {
+        printf("    %s\n", board[r]);
+    }
+}
+
+// Function to re-run one decoded game and check it against its record
+static void replay_game(const GameJournalGame *game, ReplayTotals *totals)
+{
+    char board[8][9];
+    for (int r = 0; r < 8; r++)
+    {
+        memset(board[r], '.', 8);
+        board[r][8] = '\0';
+    }
+    board[0][0] = 'R';
+    board[7][7] = 'R';
+    board[0][7] = 'B';
+    board[7][0] = 'B';
+
+    if (verbose)
+    {
+        time_t start = (time_t)(game->start_unix_ms / 1000);
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime(&start));
+        printf("Room %u at %s UTC: %s (R) vs %s (B), %u turns, %.1f s\n", game->room_id, when,
+               game->names[0], game->names[1], game->num_events, game->duration_ms / 1000.0);
+    }
+
+    unsigned long illegal = 0;
+    for (int i = 0; i < game->num_events; i++)
+    {
+        uint32_t event = game->events[i];
+        int kind = game_journal_event_kind(event);
+        int seat = game_journal_event_seat(event);
+        char role = seat == 0 ? 'R' : 'B';
+        int sx, sy, tx, ty;
+        game_journal_event_coords(event, &sx, &sy, &tx, &ty);
+
+        if (kind == JOURNAL_EVENT_MOVE)
+        {
+            totals->moves++;
+            if (game_rules_apply_move(board, sx, sy, tx, ty, role, NULL) < 0)
+            {
+                illegal++;
+                fprintf(stderr, "Room %u, turn %d: illegal move %c (%d,%d)->(%d,%d)\n",
+                        game->room_id, i + 1, role, sx, sy, tx, ty);
+            }
+        }
+        if (verbose)
+        {
+            printf("  %3d %c %-10s", i + 1, role, event_names[kind]);
+            if (kind == JOURNAL_EVENT_MOVE || kind == JOURNAL_EVENT_INVALID)
+                printf(" (%d,%d)->(%d,%d)", sx, sy, tx, ty);
+            printf(" +%ums\n", game_journal_event_delay_ms(event));
+            if (kind == JOURNAL_EVENT_MOVE)
+                print_board(board);
+        }
+    }
+
+    int score_r = game_rules_count_pieces(board, 'R');
+    int score_b = game_rules_count_pieces(board, 'B');
+    int truncated = (game->flags & GAME_JOURNAL_FLAG_TRUNCATED) != 0;
+    int mismatch = !truncated && (score_r != game->scores[0] || score_b != game->scores[1]);
+
+    totals->games++;
+    totals->events += game->num_events;
+    totals->illegal_moves += illegal;
+    totals->score_mismatches += mismatch;
+    totals->truncated_games += truncated;
+    totals->abandoned_games += game->end_reason == JOURNAL_END_ABANDONED;
+
+    if (mismatch)
+    {
+        fprintf(stderr, "Room %u: replayed score R %d B %d, recorded R %u B %u\n",
+                game->room_id, score_r, score_b, game->scores[0], game->scores[1]);
+    }
+    if (verbose || list_games)
+    {
+        printf("Room %u: %s %d - %d %s, %u turns%s%s%s\n", game->room_id, game->names[0], score_r, score_b, game->names[1],
+               game->num_events, game->end_reason == JOURNAL_END_ABANDONED ? ", abandoned" : "",
+               truncated ? ", truncated" : "", illegal || mismatch ? ", MISMATCH" : "");
+    }
+}
+
+// Function to replay every record of one journal file
+// Returns 0 on success, -1 if the file could not be read.
+static int replay_file(const char *path, ReplayTotals *totals)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+    const unsigned char *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        perror(path);
+        return -1;
+    }
+    madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    static GameJournalGame game;
+    size_t size = (size_t)st.st_size;
+    size_t offset = 0;
+    while (offset < size)
+    {
+        size_t length = 0;
+        int status = game_journal_decode(data + offset, size - offset, &game, &length);
+        if (status == 1)
+        {
+            replay_game(&game, totals);
+            offset += length;
+            continue;
+        }
+        if (status == 0)
+        {
+            fprintf(stderr, "%s: incomplete record at offset %zu (%zu bytes left)\n", path, offset, size - offset);
+            totals->corrupt_records++;
+            break;
+        }
+        // Resynchronize on the next magic number
+        fprintf(stderr, "%s: corrupt record at offset %zu\n", path, offset);
+        totals->corrupt_records++;
+        offset++;
+        while (offset + 4 <= size && memcmp(data + offset, "OFG1", 4) != 0)
+            offset++;
+        if (offset + 4 > size)
+            break;
+    }
+    totals->bytes += size;
+    munmap((void *)data, size);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int first_file = 1;
+    for (; first_file < argc && argv[first_file][0] == '-'; first_file++)
+    {
+        if (strcmp(argv[first_file], "-v") == 0)
+            verbose = 1;
+        else if (strcmp(argv[first_file], "-list") == 0)
+            list_games = 1;
+        else
+            break;
+    }
+    if (first_file >= argc || argv[first_file][0] == '-')
+    {
+        fprintf(stderr, "Usage: %s [-v] [-list] <journal> [<journal> ...]\n"
+                        "  -v     print every turn and board\n"
+                        "  -list  print one line per game\n",
+                argv[0]);
+        return 1;
+    }
+
+    ReplayTotals totals = {0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int failed = 0;
+    for (int i = first_file; i < argc; i++)
+    {
+        if (replay_file(argv[i], &totals) != 0)
+            failed = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Replayed %lu games (%lu abandoned, %lu truncated), %lu turns, %lu moves from %.1f KiB in %.3f s (%.0f moves/s)\n",
+           totals.games, totals.abandoned_games, totals.truncated_games, totals.events, totals.moves,
+           totals.bytes / 1024.0, seconds, seconds > 0 ? totals.moves / seconds : 0.0);
+    printf("Illegal moves: %lu, score mismatches: %lu, corrupt records: %lu\n",
+           totals.illegal_moves, totals.score_mismatches, totals.corrupt_records);
+
+    if (failed || totals.illegal_moves || totals.score_mismatches || totals.corrupt_records)
+        return 2;
+    return 0;
+}
@@ -6,19 +6,47 @@
 #include <netdb.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <sys/select.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
 #include <time.h>
+#include <signal.h>
+#include <stdint.h>
 #include "protocol.h"
 #include <errno.h>
 #include "cJSON.h"
+#include "line_framer.h"
+#include "server_log.h"
+#include "game_rules.h"
+#include "matchmaking.h"
+#include "event_loop.h"
+#include "server_metrics.h"
+#include "game_journal.h"
+#include "game_snapshot.h"
+#include "wire_protocol.h"
+#include "board_delta.h"
+#include "server_messages.h"
+#include "json_arena.h"
 
 // Server configuration
 #define SERVER_PORT "5050"
-#define MAX_CLIENTS 2
-#define BUFFER_SIZE 2048
-#define LISTEN_BACKLOG 10
+#define MAX_CLIENTS 2 // Players per game room
+#define LISTEN_BACKLOG 128
 #define TURN_TIMEOUT_SECONDS 5
-#define PLAYER_RECV_BUFFER_MAX_LEN (BUFFER_SIZE * 2)
+#define RESUME_GRACE_SECONDS 15 // How long a suspended seat waits for its player to 'resume'
+#define PLAYER_RECV_BUFFER_MAX_LEN LINE_FRAMER_CAPACITY // Longer messages are dropped, not fatal
+#define SPECTATOR_SLOTS_INITIAL 256  // Per worker; the table doubles on demand up to max_connection_fds
+#define SPECTATOR_FRAME_BUFFER_LEN (SERVER_MESSAGE_MAX_LEN + 1) // A written message and its newline
+#define MAX_LOBBY_CONNECTIONS 4096   // Players connected but not seated in a room yet (worker 0)
+#define MAX_ROOMS 1024               // Game rooms per worker
+#define MAX_CONNECTION_FDS 65536     // Highest socket number the server will serve
+#define MAX_WORKERS 64
+#define EVENT_BATCH_SIZE 256         // Ready sockets handled per event loop wake-up
 
 // Player state enumeration
 typedef enum
@@ -27,7 +55,8 @@ typedef enum
     P_CONNECTED,
     P_REGISTERED,
     P_PLAYING,
-    P_DISCONNECTED
+    P_DISCONNECTED,
+    P_SUSPENDED // Seat whose connection dropped mid-game (or was lost in a restart), kept until its player resumes
 } ClientConnectionState;
 
 // Player Information Structure
@@ -39,42 +68,189 @@ typedef struct
     struct sockaddr_storage address;
     socklen_t addr_len;
     char player_role; // 'R' or 'B'
+    double rating;    // Elo rating at registration time
+    uint64_t session_token; // Issued in 'register_ack', proves the player on 'resume'
+    time_t suspended_since; // P_SUSPENDED: when the seat lost its connection
+    WireFormat wire_format; // Framing of everything after 'register_ack' / 'resume_ack'
+    int board_updates_delta; // Negotiated "board_updates":"delta" (JSON lines only)
+    int sent_board_valid;    // 'sent_board' is the last board this player was sent in its game
+    unsigned board_updates_sent;
+    char sent_board[8][9];
     time_t last_message_time;
-    char recv_buffer[PLAYER_RECV_BUFFER_MAX_LEN]; // Buffer for incoming messages
-    int recv_buffer_len;                          // Current length of data in recv_buffer
+    LineFramer recv_framer; // Ring buffer for incoming messages
 } PlayerState;
 
+// Spectator connection state enumeration
+typedef enum
+{
+    S_EMPTY,
+    S_PENDING, // Accepted while the player slots were full, waiting for 'spectate' or 'register'
+    S_WATCHING
+} SpectatorConnectionState;
+
+// Spectator Information Structure
+typedef struct
+{
+    int socket_fd;
+    SpectatorConnectionState state;
+    LineFramer recv_framer;
+    int room_index;         // Room being watched, -1 while waiting for the next game to start
+    int prev_watcher;       // Neighbours in the watcher list of the room (spectator slots), -1 at the ends
+    int next_watcher;
+} SpectatorState;
+
+// One game between two matched players. Seat 0 plays 'R' and moves first.
+typedef struct
+{
+    int id; // Unique for the lifetime of the server, reported to spectators
+    int in_use;
+    PlayerState players[MAX_CLIENTS];
+    int num_clients;
+    int num_registered_players;
+    char board[8][9];
+    int current_turn_player_index; // Index in 'players', -1 while no game is running
+    time_t turn_start_time;        // To track the 5s timeout
+    uint64_t turn_sent_ns;         // When 'your_turn' went out, for the turn round-trip histogram
+    int total_moves_made_in_game;  // For game over condition
+    int consecutive_passes;        // Tracks consecutive passes for game over condition
+    unsigned long event_seq;       // Sequence number of the last event streamed to spectators
+    int watcher_head;              // First spectator slot watching this room, -1 if none
+    int num_watching;
+    int journal_active;            // The running game is being recorded
+    GameJournalEndReason journal_end_reason;
+    GameJournalGame journal;       // Turns so far, appended to the journal when the room is released
+    int snapshot_events_saved;     // Journal events already in the room's snapshot slot
+} GameRoom;
+
+// Where a socket currently lives; connections move between these tables
+typedef enum
+{
+    CONN_NONE,
+    CONN_LOBBY,
+    CONN_ROOM,
+    CONN_SPECTATOR
+} ConnectionKind;
+
+typedef struct
+{
+    ConnectionKind kind;
+    int index; // Slot in 'lobby', 'rooms' or 'spectators'
+    int seat;  // Seat in the room for CONN_ROOM
+} ConnectionRef;
+
+// A connection (or a matched pair) passed from one worker to another.
+// Buffered bytes travel with the copied framer, so nothing already received is lost.
+typedef enum
+{
+    HANDOFF_PAIR,     // Two matched players; the receiver opens room 'room_id' for them
+    HANDOFF_SPECTATOR, // A watching spectator for room 'room_id' (-1: the latest game there)
+    HANDOFF_RESUME     // A player resuming its seat in room 'room_id', in players[0]
+} HandoffKind;
+
+typedef struct Handoff
+{
+    HandoffKind kind;
+    int room_id;
+    PlayerState players[MAX_CLIENTS]; // HANDOFF_PAIR in seat order, HANDOFF_RESUME in players[0]
+    int spectator_socket;             // HANDOFF_SPECTATOR
+    LineFramer spectator_framer;
+    struct Handoff *next;
+} Handoff;
+
+// One event loop thread. Worker 0 runs on the main thread and also owns the listener,
+// the lobby and matchmaking; every worker runs its own shard of game rooms. A room and
+// its sockets belong to exactly one worker, so the move path never takes a lock.
+typedef struct
+{
+    int index;
+    pthread_t thread;
+    EventLoop loop;
+    int wake_fd;              // eventfd that signals a non-empty inbox
+    pthread_mutex_t inbox_lock;
+    Handoff *inbox_head;
+    Handoff *inbox_tail;
+} ServerWorker;
+
 // Global variables
-PlayerState players[MAX_CLIENTS];
-int num_clients = 0;
-int num_registered_players = 0;
-char octaflip_board[8][9];          // Game board
-int current_turn_player_index = -1; // Index in the 'players' array
-time_t turn_start_time;             // To track the 5s timeout
-int total_moves_made_in_game = 0;   // For game over condition
-int consecutive_passes_server = 0;  // Tracks consecutive passes for game over condition
-
-fd_set master_fds; // Master file descriptor list
-fd_set read_fds;   // Temp file descriptor list for select()
-int listener_fd;   // Listening socket descriptor
-int fd_max;        // Maximum file descriptor number
+ServerWorker workers[MAX_WORKERS];
+int num_workers = 1;
+int listener_fd;       // Listening socket descriptor (worker 0)
+int stats_listener_fd = -1; // UNIX socket serving the metrics as text (worker 0), -1 if disabled
+int max_connection_fds; // Size of the per-worker socket tables
+
+// Worker 0 only: lobby and matchmaking
+PlayerState *lobby;              // Connected players that are not in a room yet
+int num_clients = 0;             // Lobby connections
+int num_registered_players = 0;  // Lobby players waiting in the matchmaking queue
+int next_room_id = 1;            // Room ids are dealt round-robin: room N runs on worker N % num_workers
+MatchQueue match_queue;          // Handles are lobby slot indices
+
+// Shared by all workers, only touched on registration, disconnection and game over
+RatingTable ratings;
+pthread_mutex_t ratings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Per-worker state: each thread sees its own copy
+__thread ServerWorker *current_worker;
+__thread GameRoom *rooms; // MAX_ROOMS entries
+__thread int num_active_rooms = 0;
+__thread int last_room_id = -1; // Game shown to spectators that do not ask for one
+__thread ConnectionRef *connection_by_fd; // max_connection_fds entries
+
+__thread SpectatorState *spectators; // spectator_capacity entries
+__thread int spectator_capacity = 0;
+__thread int *free_spectator_slots;  // Stack of empty slots, spectator_capacity entries
+__thread int num_free_spectator_slots = 0;
+__thread int num_spectator_connections = 0; // Pending and watching spectator sockets
+__thread int num_watching_spectators = 0;   // Spectators subscribed to a move stream
+__thread int idle_watcher_head = -1;        // Watching spectators not bound to a room yet
 
 // Forward declarations
-void initialize_player_states(PlayerState all_players[]);
+void initialize_player_states(PlayerState all_players[], int count);
 int initialize_server_socket(const char *port);
-void add_player(int client_socket, struct sockaddr_storage *client_addr, socklen_t addr_len, PlayerState all_players[], int *current_num_clients);
-void remove_player(PlayerState *player_to_remove, PlayerState all_players[], int *current_num_clients, int *current_num_registered_players);
-void accept_new_connection(int current_listener_fd, PlayerState all_players[], int *current_num_clients);
-void handle_client_message(PlayerState *player, PlayerState all_players[], int *current_num_clients, int *current_num_registered_players, char game_board[8][9]);
-void process_move_request(PlayerState *player, const char *received_json_string, PlayerState all_players[], char game_board[8][9]);
-void handle_turn_timeout(PlayerState all_players[], char game_board[8][9]);
-void start_player_turn(PlayerState all_players[], int player_idx, char game_board[8][9]);
-void switch_to_next_turn(PlayerState all_players[], char game_board[8][9]);
-int check_and_process_game_over(PlayerState all_players[], char game_board[8][9]);
-void handle_client_disconnection(PlayerState *disconnected_player, PlayerState all_players[], char game_board[8][9]);
+void add_player(int client_socket, struct sockaddr_storage *client_addr, socklen_t addr_len);
+void remove_player(PlayerState *player_to_remove, int *current_num_clients, int *current_num_registered_players);
+void accept_new_connection(int current_listener_fd);
+void handle_client_message(GameRoom *room, PlayerState *player);
+int process_buffered_client_messages(GameRoom *room, PlayerState *player);
+void process_buffered_messages_for_fd(int client_socket);
+void process_move_request(GameRoom *room, PlayerState *player, const ClientMovePayload *move_payload);
+void handle_turn_timeout(GameRoom *room);
+void start_player_turn(GameRoom *room, int player_idx);
+void switch_to_next_turn(GameRoom *room);
+int check_and_process_game_over(GameRoom *room);
+void handle_client_disconnection(GameRoom *room, PlayerState *disconnected_player);
 int count_player_pieces_on_board(char board[8][9], char player_symbol);
-void attempt_game_start(PlayerState players[], int current_registered_count, char game_board[8][9]);
+void attempt_game_start(GameRoom *room);
 void log_board_and_move(char current_board[8][9], const char *player_username, int sx, int sy, int tx, int ty, const char *move_type_or_status);
+void initialize_rooms(void);
+void release_room(GameRoom *room);
+void update_ratings_after_game(const ServerGameOverPayload *game_over);
+void queue_player_for_match(PlayerState *player);
+void seat_matched_players(int first_handle, int second_handle);
+void seat_players_in_room(int room_id, PlayerState pair[MAX_CLIENTS]);
+int worker_for_room(int room_id);
+void post_handoff(ServerWorker *target, Handoff *handoff);
+void hand_off_spectator(SpectatorState *spectator, int room_id);
+void initialize_spectator_states(int first, int last);
+void bind_idle_watchers_to_room(GameRoom *room);
+void attach_watcher(SpectatorState *spectator, GameRoom *room);
+void detach_watcher(SpectatorState *spectator);
+int add_spectator_connection(int client_socket);
+void remove_spectator(SpectatorState *spectator);
+void handle_spectator_message(SpectatorState *spectator);
+void broadcast_to_spectators(GameRoom *room, const char *json_message);
+void broadcast_spectator_snapshot(GameRoom *room);
+void notify_spectators_of_move(GameRoom *room, const char *event, const char *player_username, int sx, int sy, int tx, int ty, uint64_t changed_cells);
+void send_stats_report(const PlayerState *player);
+void send_stats_report_to_spectator(SpectatorState *spectator);
+void process_resume_request(PlayerState *player, const cJSON *received_message);
+void resume_player_in_room(int room_id, PlayerState *player);
+
+// Returns 1 for a seat that still takes part in the running game
+static int seat_in_game(const PlayerState *player)
+{
+    return player->state == P_PLAYING || player->state == P_SUSPENDED;
+}
 
 // Helper to get the username of the next playing player
 // Returns 1 if found and populates out_username, 0 otherwise.
@@ -84,7 +260,7 @@ static int get_next_playing_player_username(PlayerState all_players[], int curre
     for (int i = 0; i < MAX_CLIENTS; ++i)
     {
         next_player_candidate = (next_player_candidate + 1) % MAX_CLIENTS;
-        if (all_players[next_player_candidate].state == P_PLAYING)
+        if (seat_in_game(&all_players[next_player_candidate]))
         {
             strncpy(out_username, all_players[next_player_candidate].username, username_size - 1);
             out_username[username_size - 1] = '\0';
@@ -96,17 +272,89 @@ static int get_next_playing_player_username(PlayerState all_players[], int curre
     return 0; // Not found
 }
 
+// Function to record the turn of the player to move in the game journal
+static void journal_turn(GameRoom *room, GameJournalEventKind kind, int sx, int sy, int tx, int ty)
+{
+    if (room->journal_active)
+    {
+        game_journal_event(&room->journal, kind, room->current_turn_player_index, sx, sy, tx, ty);
+    }
+}
+
+// Function to write a running game to its slot in the snapshot file
+// Called whenever the turn changes hands, so a restarted server resumes the game at this turn.
+static void save_room_snapshot(GameRoom *room)
+{
+    if (!game_snapshot_enabled() || room->current_turn_player_index == -1)
+    {
+        return;
+    }
+    GameSnapshotRoom state; // Only the header is filled in; the events come from the journal
+    state.room_id = (uint32_t)room->id;
+    state.event_seq = (uint32_t)room->event_seq;
+    state.current_seat = (int8_t)room->current_turn_player_index;
+    state.consecutive_passes = (uint8_t)room->consecutive_passes;
+    state.total_moves = (uint16_t)room->total_moves_made_in_game;
+    state.journal_active = (uint8_t)room->journal_active;
+    state.journal_flags = room->journal_active ? room->journal.flags : 0;
+    state.num_events = room->journal_active ? room->journal.num_events : 0;
+    state.reserved = 0;
+    state.elapsed_ms = room->journal_active ? (uint32_t)(room->journal.last_event_mono_ms - room->journal.start_mono_ms) : 0;
+    state.start_unix_ms = room->journal_active ? room->journal.start_unix_ms : 0;
+    for (int seat = 0; seat < MAX_CLIENTS; seat++)
+    {
+        PlayerState *player = &room->players[seat];
+        state.seat_present[seat] = (uint8_t)seat_in_game(player);
+        state.session_tokens[seat] = player->session_token;
+        memset(state.names[seat], 0, MAX_USERNAME_LEN); // No stale bytes in the file
+        strncpy(state.names[seat], player->username, MAX_USERNAME_LEN - 1);
+    }
+    for (int r = 0; r < 8; r++)
+    {
+        memcpy(state.board[r], room->board[r], 8);
+    }
+
+    int slot = current_worker->index * MAX_ROOMS + (int)(room - rooms);
+    game_snapshot_save(slot, &state, room->journal.events, room->snapshot_events_saved);
+    room->snapshot_events_saved = state.num_events;
+}
+
+// Function to send one JSON message and its newline delimiter to a connection of this worker
+// With the io_uring backend the message is queued and goes out with the next event loop wait.
+static int send_json_line(int client_socket, const char *json_message)
+{
+    size_t json_len = strlen(json_message);
+    server_metrics_add(METRIC_BYTES_OUT, json_len + 1);
+    return event_loop_send_line(&current_worker->loop, client_socket, json_message, json_len);
+}
+
 // --- JSON Utility Stubs ---
-const char *get_message_type_from_json(const char *json_string)
+
+// Function to release a message from parse_message_with_type() together with its arena
+void release_message(cJSON *message)
+{
+    cJSON_Delete(message);
+    json_arena_end();
+}
+
+// Parses a received message once and interns its "type" field.
+// Returns the parsed tree, which is handed to the handlers and then released by the caller
+// with release_message(), or NULL if the message is not JSON or has no string 'type'.
+// The tree and everything cJSON allocates until then live in this thread's JSON arena.
+cJSON *parse_message_with_type(const char *json_string, size_t json_len, MessageType *out_type, const char **out_type_str)
 {
-    cJSON *root = cJSON_Parse(json_string);
+    uint64_t parse_start_ns = server_metrics_now_ns();
+    server_metrics_add(METRIC_MESSAGES_IN, 1);
+    json_arena_begin();
+    cJSON *root = cJSON_ParseWithLength(json_string, json_len);
     if (root == NULL)
     {
         const char *error_ptr = cJSON_GetErrorPtr();
         if (error_ptr != NULL)
         {
-            fprintf(stderr, "Error parsing JSON before: %s\n", error_ptr);
+            fprintf(stderr, "Error parsing JSON before: %.*s\n", (int)(json_len - (error_ptr - json_string)), error_ptr);
         }
+        json_arena_end();
         return NULL;
     }
 
@@ -114,155 +362,147 @@ const char *get_message_type_from_json(const char *json_string)
     if (!cJSON_IsString(type_json) || (type_json->valuestring == NULL))
     {
         fprintf(stderr, "Error: JSON message does not have a valid 'type' field.\n");
-        cJSON_Delete(root);
+        release_message(root);
         return NULL;
     }
 
-    char *type_str = strdup(type_json->valuestring);
-    cJSON_Delete(root);
-    return type_str;
+    *out_type = message_type_from_string(type_json->valuestring);
+    *out_type_str = type_json->valuestring;
+    server_metrics_observe(METRIC_PARSE_NS, server_metrics_now_ns() - parse_start_ns);
+    return root;
 }
 
-// Deserialize ClientMovePayload
-int deserialize_client_move(const char *json_string, ClientMovePayload *out_payload)
+// Deserialize ClientMovePayload from an already parsed "move" message
+int deserialize_client_move(const cJSON *root, ClientMovePayload *out_payload)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (root == NULL)
-    {
-        fprintf(stderr, "Error: Failed to parse ClientMovePayload JSON.\n");
-        return -1;
-    }
-
-    cJSON *type_json = cJSON_GetObjectItemCaseSensitive(root, "type");
-    cJSON *username_json = cJSON_GetObjectItemCaseSensitive(root, "username");
-    cJSON *sx_json = cJSON_GetObjectItemCaseSensitive(root, "sx");
-    cJSON *sy_json = cJSON_GetObjectItemCaseSensitive(root, "sy");
-    cJSON *tx_json = cJSON_GetObjectItemCaseSensitive(root, "tx");
-    cJSON *ty_json = cJSON_GetObjectItemCaseSensitive(root, "ty");
-
-    if (!cJSON_IsString(type_json) || (type_json->valuestring == NULL) || strcmp(type_json->valuestring, "move") != 0 ||
-        !cJSON_IsString(username_json) || (username_json->valuestring == NULL) ||
+    // Every move reads five fields, so they are looked up in a single walk over the message
+    static const char *const fields[] = {"username", "sx", "sy", "tx", "ty"};
+    cJSON *items[5];
+    cJSON_GetObjectItemsCaseSensitive(root, fields, items, 5);
+    cJSON *username_json = items[0];
+    cJSON *sx_json = items[1];
+    cJSON *sy_json = items[2];
+    cJSON *tx_json = items[3];
+    cJSON *ty_json = items[4];
+
+    if (!cJSON_IsString(username_json) || (username_json->valuestring == NULL) ||
         !cJSON_IsNumber(sx_json) || !cJSON_IsNumber(sy_json) ||
         !cJSON_IsNumber(tx_json) || !cJSON_IsNumber(ty_json))
     {
-        fprintf(stderr, "Error: Malformed ClientMovePayload JSON or incorrect type.\n");
-        cJSON_Delete(root);
+        fprintf(stderr, "Error: Malformed ClientMovePayload JSON.\n");
         return -1;
     }
 
-    strcpy(out_payload->type, type_json->valuestring);
+    strcpy(out_payload->type, "move");
     strncpy(out_payload->username, username_json->valuestring, MAX_USERNAME_LEN - 1);
     out_payload->username[MAX_USERNAME_LEN - 1] = '\0';
     out_payload->sx = sx_json->valueint;
     out_payload->sy = sy_json->valueint;
     out_payload->tx = tx_json->valueint;
     out_payload->ty = ty_json->valueint;
-
-    cJSON_Delete(root);
     return 0;
 }
 
-// Serialize ServerYourTurnPayload
-char *serialize_server_your_turn(const ServerYourTurnPayload *payload)
+// Reads an optional string option of 'register' and 'resume' ("wire", "board_updates"); absent reads as ""
+static void deserialize_optional_option(const cJSON *root, const char *name, char *out, size_t out_size)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
-        return NULL;
+    cJSON *option = cJSON_GetObjectItemCaseSensitive(root, name);
+    out[0] = '\0';
+    if (cJSON_IsString(option) && option->valuestring)
+    {
+        strncpy(out, option->valuestring, out_size - 1);
+        out[out_size - 1] = '\0';
+    }
+}
 
-    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
-        goto error;
+// Deserialize ClientRegisterPayload from an already parsed "register" message
+int deserialize_client_register(const cJSON *root, ClientRegisterPayload *out_payload)
+{
+    cJSON *username = cJSON_GetObjectItemCaseSensitive(root, "username");
 
-    cJSON *board_array = cJSON_CreateArray();
-    if (board_array == NULL)
-        goto error;
-    for (int i = 0; i < 8; ++i)
+    if (!cJSON_IsString(username) || !username->valuestring)
     {
-        cJSON *row_string = cJSON_CreateString(payload->board[i]);
-        if (row_string == NULL)
-        {
-            cJSON_Delete(board_array);
-            goto error;
-        }
-        cJSON_AddItemToArray(board_array, row_string);
+        fprintf(stderr, "Error: Malformed ClientRegisterPayload JSON.\n");
+        return -1;
     }
-    cJSON_AddItemToObject(root, "board", board_array);
-
-    if (cJSON_AddNumberToObject(root, "timeout", payload->timeout) == NULL)
-        goto error;
+    strcpy(out_payload->type, "register");
+    strncpy(out_payload->username, username->valuestring, MAX_USERNAME_LEN - 1);
+    out_payload->username[MAX_USERNAME_LEN - 1] = '\0';
+    deserialize_optional_option(root, "wire", out_payload->wire, sizeof(out_payload->wire));
+    deserialize_optional_option(root, "board_updates", out_payload->board_updates, sizeof(out_payload->board_updates));
+    return 0;
+}
 
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
+// Deserialize ClientSpectatePayload from an already parsed "spectate" message
+// The room is optional, so this never fails; a missing or invalid room reads as -1.
+int deserialize_client_spectate(const cJSON *root, ClientSpectatePayload *out_payload)
+{
+    cJSON *room_json = cJSON_GetObjectItemCaseSensitive(root, "room");
 
-error:
-    cJSON_Delete(root);
-    return NULL;
+    strcpy(out_payload->type, "spectate");
+    out_payload->room = cJSON_IsNumber(room_json) ? room_json->valueint : -1;
+    return 0;
 }
 
-// Serialize ServerMoveOkPayload
-char *serialize_server_move_ok(const ServerMoveOkPayload *payload)
+// Deserialize ClientResumePayload from an already parsed "resume" message
+int deserialize_client_resume(const cJSON *root, ClientResumePayload *out_payload)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
-        return NULL;
-
-    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
-        goto error;
+    cJSON *username = cJSON_GetObjectItemCaseSensitive(root, "username");
+    cJSON *token = cJSON_GetObjectItemCaseSensitive(root, "session_token");
 
-    cJSON *board_array = cJSON_CreateArray();
-    if (board_array == NULL)
-        goto error;
-    for (int i = 0; i < 8; ++i)
+    if (!cJSON_IsString(username) || !username->valuestring || !cJSON_IsString(token) || !token->valuestring)
     {
-        cJSON *row_string = cJSON_CreateString(payload->board[i]);
-        if (row_string == NULL)
-        {
-            cJSON_Delete(board_array);
-            goto error;
-        }
-        cJSON_AddItemToArray(board_array, row_string);
+        fprintf(stderr, "Error: Malformed ClientResumePayload JSON.\n");
+        return -1;
     }
-    cJSON_AddItemToObject(root, "board", board_array);
-
-    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
-        goto error;
-
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
-
-error:
-    cJSON_Delete(root);
-    return NULL;
+    strcpy(out_payload->type, "resume");
+    strncpy(out_payload->username, username->valuestring, MAX_USERNAME_LEN - 1);
+    out_payload->username[MAX_USERNAME_LEN - 1] = '\0';
+    strncpy(out_payload->session_token, token->valuestring, SESSION_TOKEN_LEN - 1);
+    out_payload->session_token[SESSION_TOKEN_LEN - 1] = '\0';
+    deserialize_optional_option(root, "wire", out_payload->wire, sizeof(out_payload->wire));
+    deserialize_optional_option(root, "board_updates", out_payload->board_updates, sizeof(out_payload->board_updates));
+    return 0;
 }
 
-// Serialize ServerInvalidMovePayload
-char *serialize_server_invalid_move(const ServerInvalidMovePayload *payload)
+// Serialize a metrics snapshot as a "stats_report" message
+char *serialize_server_stats_report(const ServerMetricsSnapshot *snapshot)
 {
     cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
+    if (!root)
         return NULL;
 
-    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+    cJSON *counters = cJSON_AddObjectToObject(root, "counters");
+    cJSON *gauges = cJSON_AddObjectToObject(root, "gauges");
+    cJSON *histograms = cJSON_AddObjectToObject(root, "histograms");
+    if (!cJSON_AddStringToObject(root, "type", "stats_report") ||
+        !cJSON_AddNumberToObject(root, "threads", snapshot->num_shards) ||
+        !counters || !gauges || !histograms)
         goto error;
 
-    cJSON *board_array = cJSON_CreateArray();
-    if (board_array == NULL)
-        goto error;
-    for (int i = 0; i < 8; ++i)
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
     {
-        cJSON *row_string = cJSON_CreateString(payload->board[i]);
-        if (row_string == NULL)
-        {
-            cJSON_Delete(board_array);
+        if (!cJSON_AddNumberToObject(counters, server_counter_names[c], (double)snapshot->counters[c]))
+            goto error;
+    }
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++)
+    {
+        if (!cJSON_AddNumberToObject(gauges, server_gauge_names[g], (double)snapshot->gauges[g]))
+            goto error;
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+    {
+        const ServerMetricsHistogram *histogram = &snapshot->histograms[h];
+        cJSON *entry = cJSON_AddObjectToObject(histograms, server_histogram_names[h]);
+        if (!entry ||
+            !cJSON_AddNumberToObject(entry, "count", (double)histogram->count) ||
+            !cJSON_AddNumberToObject(entry, "sum", (double)histogram->sum) ||
+            !cJSON_AddNumberToObject(entry, "p50", (double)server_metrics_quantile(histogram, 0.50)) ||
+            !cJSON_AddNumberToObject(entry, "p90", (double)server_metrics_quantile(histogram, 0.90)) ||
+            !cJSON_AddNumberToObject(entry, "p99", (double)server_metrics_quantile(histogram, 0.99)) ||
+            !cJSON_AddNumberToObject(entry, "max", (double)histogram->max))
             goto error;
-        }
-        cJSON_AddItemToArray(board_array, row_string);
     }
-    cJSON_AddItemToObject(root, "board", board_array);
-
-    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
-        goto error;
 
     char *json_string = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -273,185 +513,161 @@ error:
     return NULL;
 }
 
-// Serialize ServerPassPayload
-char *serialize_server_pass(const ServerPassPayload *payload)
-{
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
-        return NULL;
-
-    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
-        goto error;
-    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
-        goto error;
+// --- End JSON Utility Stubs ---
 
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
+// --- Wire Format ---
 
-error:
-    cJSON_Delete(root);
-    return NULL;
+// Function to send one binary frame to a connection of this worker
+static int send_wire_frame(int client_socket, const WireMessage *frame)
+{
+    unsigned char buffer[WIRE_FRAME_HEADER_SIZE + WIRE_MAX_FRAME];
+    size_t frame_len = wire_encode(frame, buffer, sizeof(buffer));
+    if (frame_len == 0)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    server_metrics_add(METRIC_BYTES_OUT, frame_len);
+    return event_loop_send(&current_worker->loop, client_socket, buffer, frame_len);
 }
 
-// Serialize ServerGameOverPayload
-char *serialize_server_game_over(const ServerGameOverPayload *payload)
+// Function to send a JSON message to a player in the wire format it negotiated
+static int send_player_json(const PlayerState *player, const char *json_message)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
-        return NULL;
-
-    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
-        goto error;
-
-    cJSON *scores_obj = cJSON_CreateObject();
-    if (scores_obj == NULL)
-        goto error;
+    if (player->wire_format == WIRE_FORMAT_FRAMES)
+    {
+        WireMessage frame = {.type = WIRE_FRAME_JSON, .text = json_message, .text_len = strlen(json_message)};
+        return send_wire_frame(player->socket_fd, &frame);
+    }
+    return send_json_line(player->socket_fd, json_message);
+}
 
-    for (int i = 0; i < 2; ++i)
+// Returns the seat of the room's player with this name, WIRE_NO_SEAT if there is none
+static int seat_of_username(const GameRoom *room, const char *username)
+{
+    for (int seat = 0; seat < MAX_CLIENTS; seat++)
     {
-        if (payload->scores[i].username[0] != '\0')
+        if (room->players[seat].username[0] && strcmp(room->players[seat].username, username) == 0)
         {
-            if (cJSON_AddNumberToObject(scores_obj, payload->scores[i].username, payload->scores[i].score) == NULL)
-            {
-                cJSON_Delete(scores_obj);
-                goto error;
-            }
+            return seat;
         }
     }
-    cJSON_AddItemToObject(root, "scores", scores_obj);
-
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
-
-error:
-    cJSON_Delete(root);
-    return NULL;
+    return WIRE_NO_SEAT;
 }
 
-int deserialize_client_register(const char *json_string, ClientRegisterPayload *out_payload)
+// Function to choose how the board of a turn message goes to a player, and to keep that
+// board as the base of the player's next delta. Binary players always get the packed board.
+static void prepare_board_update(PlayerState *player, const char board[8][9], BoardUpdate *update)
 {
-    cJSON *root = cJSON_Parse(json_string);
-    if (!root)
+    update->is_delta = 0;
+    update->checksum[0] = '\0';
+    if (!player->board_updates_delta)
     {
-        fprintf(stderr, "Error: Failed to parse ClientRegisterPayload JSON.\n");
-        return -1;
+        return;
     }
-    cJSON *type = cJSON_GetObjectItemCaseSensitive(root, "type");
-    cJSON *username = cJSON_GetObjectItemCaseSensitive(root, "username");
-
-    if (!cJSON_IsString(type) || !type->valuestring || strcmp(type->valuestring, "register") != 0 ||
-        !cJSON_IsString(username) || !username->valuestring)
+    // A periodic full board heals a client that lost track, e.g. after a missed checksum
+    if (player->sent_board_valid && player->board_updates_sent % BOARD_DELTA_KEYFRAME_INTERVAL != 0)
     {
-        fprintf(stderr, "Error: Malformed ClientRegisterPayload JSON or incorrect type.\n");
-        cJSON_Delete(root);
-        return -1;
+        update->is_delta = 1;
+        board_delta_format(board, board_delta_diff((const char(*)[9])player->sent_board, board), update->changes);
+        if (player->board_updates_sent % BOARD_DELTA_CHECKSUM_INTERVAL == 0)
+        {
+            board_delta_checksum(board, update->checksum);
+        }
     }
-    strcpy(out_payload->type, type->valuestring);
-    strncpy(out_payload->username, username->valuestring, MAX_USERNAME_LEN - 1);
-    out_payload->username[MAX_USERNAME_LEN - 1] = '\0';
-    cJSON_Delete(root);
-    return 0;
+    memcpy(player->sent_board, board, sizeof(player->sent_board));
+    player->sent_board_valid = 1;
+    player->board_updates_sent++;
 }
 
-// Serialize ServerRegisterAckPayload
-char *serialize_server_register_ack(const ServerRegisterAckPayload *payload)
+// The turn messages below go out as fixed-size frames to binary players, so the move path
+// builds no cJSON tree for them. Each returns -1 only if the connection failed.
+
+// Function to send 'your_turn' in the player's wire format
+static int send_your_turn(PlayerState *player, const ServerYourTurnPayload *payload)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (!root)
-        return NULL;
-    if (!cJSON_AddStringToObject(root, "type", payload->type))
+    if (player->wire_format == WIRE_FORMAT_FRAMES)
     {
-        cJSON_Delete(root);
-        return NULL;
+        WireMessage frame = {.type = WIRE_FRAME_YOUR_TURN, .timeout = payload->timeout};
+        memcpy(frame.board, payload->board, sizeof(frame.board));
+        return send_wire_frame(player->socket_fd, &frame);
     }
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
-}
-
-// Serialize ServerRegisterNackPayload
-char *serialize_server_register_nack(const ServerRegisterNackPayload *payload)
-{
-    cJSON *root = cJSON_CreateObject();
-    if (!root)
-        return NULL;
-    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
-        !cJSON_AddStringToObject(root, "reason", payload->reason))
+    ServerYourTurnPayload message = *payload;
+    prepare_board_update(player, payload->board, &message.board_update);
+    char json_message[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_your_turn(&message, json_message, sizeof(json_message)) < 0)
     {
-        cJSON_Delete(root);
-        return NULL;
+        fprintf(stderr, "Error serializing ServerYourTurnPayload\n");
+        return 0;
     }
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
+    return send_json_line(player->socket_fd, json_message);
 }
 
-// Serialize ServerGameStartPayload
-char *serialize_server_game_start(const ServerGameStartPayload *payload)
+// Function to send 'move_ok' in the player's wire format
+static int send_move_ok(const GameRoom *room, PlayerState *player, const ServerMoveOkPayload *payload)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (!root)
-        return NULL;
-
-    if (!cJSON_AddStringToObject(root, "type", payload->type))
-        goto error;
-
-    cJSON *players_array = cJSON_CreateArray();
-    if (!players_array)
-        goto error;
-    for (int i = 0; i < 2; ++i)
+    if (player->wire_format == WIRE_FORMAT_FRAMES)
     {
-        cJSON *player_name = cJSON_CreateString(payload->players[i]);
-        if (!player_name)
-        {
-            cJSON_Delete(players_array);
-            goto error;
-        }
-        cJSON_AddItemToArray(players_array, player_name);
+        WireMessage frame = {.type = WIRE_FRAME_MOVE_OK, .next_seat = seat_of_username(room, payload->next_player)};
+        memcpy(frame.board, payload->board, sizeof(frame.board));
+        return send_wire_frame(player->socket_fd, &frame);
     }
-    cJSON_AddItemToObject(root, "players", players_array);
-
-    if (!cJSON_AddStringToObject(root, "first_player", payload->first_player))
-        goto error;
-
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    return json_string;
-
-error:
-    cJSON_Delete(root);
-    return NULL;
+    ServerMoveOkPayload message = *payload;
+    prepare_board_update(player, payload->board, &message.board_update);
+    char json_message[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_move_ok(&message, json_message, sizeof(json_message)) < 0)
+    {
+        fprintf(stderr, "Error serializing ServerMoveOkPayload for %s\n", player->username);
+        return 0;
+    }
+    return send_json_line(player->socket_fd, json_message);
 }
 
-// --- End JSON Utility Stubs ---
-
-// --- Logging Function ---
-void log_board_and_move(char current_board[8][9], const char *player_username, int sx, int sy, int tx, int ty, const char *move_type_or_status)
+// Function to send 'invalid_move' in the player's wire format
+static int send_invalid_move(const GameRoom *room, PlayerState *player, const ServerInvalidMovePayload *payload)
 {
-    printf("Server Log:\n");
-    printf("  Player: %s\n", player_username ? player_username : "N/A");
-    if (sx == -1 && sy == -1 && tx == -1 && ty == -1)
+    if (player->wire_format == WIRE_FORMAT_FRAMES)
     {
-        printf("  Action: %s\n", move_type_or_status);
+        // No reason text, like the JSON form
+        WireMessage frame = {.type = WIRE_FRAME_INVALID_MOVE, .next_seat = seat_of_username(room, payload->next_player)};
+        memcpy(frame.board, payload->board, sizeof(frame.board));
+        return send_wire_frame(player->socket_fd, &frame);
     }
-    else if (sx == 0 && sy == 0 && tx == 0 && ty == 0 && (strcmp(move_type_or_status, "Attempted Pass") == 0 || strcmp(move_type_or_status, "Valid Pass") == 0))
+    ServerInvalidMovePayload message = *payload;
+    prepare_board_update(player, payload->board, &message.board_update);
+    char json_message[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_invalid_move(&message, json_message, sizeof(json_message)) < 0)
     {
-        printf("  Move: Pass\n");
-        printf("  Status: %s\n", move_type_or_status);
+        fprintf(stderr, "Error serializing ServerInvalidMovePayload for %s\n", player->username);
+        return 0;
     }
-    else
+    return send_json_line(player->socket_fd, json_message);
+}
+
+// Function to send 'pass' in the player's wire format
+static int send_pass(const GameRoom *room, const PlayerState *player, const ServerPassPayload *payload)
+{
+    if (player->wire_format == WIRE_FORMAT_FRAMES)
     {
-        printf("  Move: (%d,%d) -> (%d,%d)\n", sx + 1, sy + 1, tx + 1, ty + 1); // Convert to 1-indexed for display
-        printf("  Status: %s\n", move_type_or_status);
+        WireMessage frame = {.type = WIRE_FRAME_PASS, .next_seat = seat_of_username(room, payload->next_player)};
+        return send_wire_frame(player->socket_fd, &frame);
     }
-    printf("  Board State:\n");
-    for (int i = 0; i < 8; ++i)
+    char json_message[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_pass(payload, json_message, sizeof(json_message)) < 0)
     {
-        printf("    %s\n", current_board[i]);
+        fprintf(stderr, "Error serializing ServerPassPayload for %s\n", player->username);
+        return 0;
     }
-    printf("----------------------------------------\n");
+    return send_json_line(player->socket_fd, json_message);
+}
+
+// --- End Wire Format ---
+
+// --- Logging Function ---
+void log_board_and_move(char current_board[8][9], const char *player_username, int sx, int sy, int tx, int ty, const char *move_type_or_status)
+{
+    // Only copies the raw fields; the log writer thread formats the record
+    server_log_move(SERVER_LOG_INFO, player_username, sx, sy, tx, ty, move_type_or_status, current_board);
 }
 
 // --- OctaFlip Game Logic Interface (Placeholder) ---
@@ -465,11 +681,14 @@ void convert_coordinates_to_zero_indexed(int r1_received, int c1_received, int r
     *c2 = c2_received - 1;
 }
 
-void attempt_game_start(PlayerState all_players[], int current_num_registered_players_val, char game_board[8][9])
+void attempt_game_start(GameRoom *room)
 {
-    if (current_num_registered_players_val == MAX_CLIENTS && current_turn_player_index == -1)
+    PlayerState *all_players = room->players;
+    char(*game_board)[9] = room->board;
+
+    if (room->num_registered_players == MAX_CLIENTS && room->current_turn_player_index == -1)
     {
-        printf("Server: Two players registered. Attempting to start game.\n");
+        SERVER_LOG(SERVER_LOG_INFO, "Room %d: two players seated. Attempting to start game.", room->id);
 
         for (int r = 0; r < 8; r++)
         {
@@ -482,6 +701,10 @@ void attempt_game_start(PlayerState all_players[], int current_num_registered_pl
         game_board[7][0] = 'B';
         game_board[0][7] = 'B';
         game_board[7][7] = 'R';
+        for (int k = 0; k < MAX_CLIENTS; k++)
+        {
+            all_players[k].sent_board_valid = 0; // The first board of a game always goes out in full
+        }
 
         int players_assigned_role = 0;
         int first_player_idx = -1;
@@ -496,14 +719,14 @@ void attempt_game_start(PlayerState all_players[], int current_num_registered_pl
                 {
                     first_player_idx = k;
                 }
-                printf("Server: Player %s is ready to play as %c.\n", all_players[k].username, all_players[k].player_role);
+                SERVER_LOG(SERVER_LOG_INFO, "Player %s is ready to play as %c.", all_players[k].username, all_players[k].player_role);
                 players_assigned_role++;
             }
         }
 
         if (players_assigned_role == MAX_CLIENTS && first_player_idx != -1)
         {
-            total_moves_made_in_game = 0;
+            room->total_moves_made_in_game = 0;
 
             ServerGameStartPayload gs_payload;
             strcpy(gs_payload.type, "game_start");
@@ -532,33 +755,55 @@ void attempt_game_start(PlayerState all_players[], int current_num_registered_pl
                 gs_payload.first_player[MAX_USERNAME_LEN - 1] = '\0';
             }
 
-            char *json_gs_message = serialize_server_game_start(&gs_payload);
-            if (json_gs_message)
+            char json_gs_message[SERVER_MESSAGE_MAX_LEN];
+            if (write_server_game_start(&gs_payload, json_gs_message, sizeof(json_gs_message)) >= 0)
             {
                 for (int k = 0; k < MAX_CLIENTS; ++k)
                 {
                     if (all_players[k].state == P_PLAYING)
                     {
-                        if (send(all_players[k].socket_fd, json_gs_message, strlen(json_gs_message), 0) == -1 ||
-                            send(all_players[k].socket_fd, "\n", 1, 0) == -1)
+                        if (send_player_json(&all_players[k], json_gs_message) == -1)
                         {
-                            perror("send game_start or newline");
-                            handle_client_disconnection(&all_players[k], all_players, game_board);
+                            perror("send game_start");
+                            handle_client_disconnection(room, &all_players[k]);
                         }
                         else
                         {
-                            printf("Server: Sent 'game_start' to %s.\n", all_players[k].username);
+                            SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'game_start' to %s.", all_players[k].username);
                         }
                     }
                 }
-                free(json_gs_message);
             }
             else
             {
                 fprintf(stderr, "Error serializing ServerGameStartPayload.\n");
             }
+            if (!room->in_use)
+            {
+                return; // Both players were lost while sending
+            }
 
-            start_player_turn(all_players, first_player_idx, game_board);
+            last_room_id = room->id;
+            bind_idle_watchers_to_room(room);
+            server_metrics_add(METRIC_GAMES_STARTED, 1);
+            pthread_mutex_lock(&ratings_lock);
+            for (int k = 0; k < MAX_CLIENTS; ++k)
+            {
+                RatingRecord *record = rating_table_find(&ratings, all_players[k].username);
+                if (record)
+                {
+                    record->resume_room_id = room->id; // Lets the player 'resume' if its connection drops
+                }
+            }
+            pthread_mutex_unlock(&ratings_lock);
+            if (game_journal_enabled())
+            {
+                game_journal_begin(&room->journal, (uint32_t)room->id, all_players[0].username, all_players[1].username);
+                room->journal_active = 1;
+                room->journal_end_reason = JOURNAL_END_ABANDONED;
+            }
+            start_player_turn(room, first_player_idx);
+            broadcast_spectator_snapshot(room);
         }
         else
         {
@@ -575,10 +820,24 @@ void attempt_game_start(PlayerState all_players[], int current_num_registered_pl
     }
 }
 
-void process_registration_request(PlayerState *player, const char *received_json_string, PlayerState all_players[], int *current_num_registered_players, char game_board[8][9])
+// Function to draw an unguessable session token for a registering player
+static uint64_t new_session_token(void)
+{
+    uint64_t token;
+    if (getrandom(&token, sizeof(token), 0) != (ssize_t)sizeof(token))
+    {
+        // No entropy source: still unique, just not secret
+        static _Atomic uint64_t fallback_counter;
+        token = ((uint64_t)time(NULL) << 32) ^ (uint64_t)server_metrics_now_ns() ^ ++fallback_counter;
+    }
+    return token;
+}
+
+// Function to register a lobby connection and queue it for matchmaking
+void process_registration_request(PlayerState *player, const cJSON *received_message)
 {
     ClientRegisterPayload reg_payload;
-    if (deserialize_client_register(received_json_string, &reg_payload) != 0)
+    if (deserialize_client_register(received_message, &reg_payload) != 0)
     {
         fprintf(stderr, "Server: Failed to deserialize register request from socket %d.\n", player->socket_fd);
         return;
@@ -590,15 +849,13 @@ void process_registration_request(PlayerState *player, const char *received_json
         ServerRegisterNackPayload nack;
         strcpy(nack.type, "register_nack");
         strcpy(nack.reason, "Invalid state for registration.");
-        char *nack_json = serialize_server_register_nack(&nack);
-        if (nack_json)
+        char nack_json[SERVER_MESSAGE_MAX_LEN];
+        if (write_server_register_nack(&nack, nack_json, sizeof(nack_json)) >= 0)
         {
-            if (send(player->socket_fd, nack_json, strlen(nack_json), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
+            if (send_player_json(player, nack_json) == -1)
             {
-                perror("send register_nack (invalid state) or newline");
+                perror("send register_nack (invalid state)");
             }
-            free(nack_json);
         }
         return;
     }
@@ -609,58 +866,40 @@ void process_registration_request(PlayerState *player, const char *received_json
         ServerRegisterNackPayload nack;
         strcpy(nack.type, "register_nack");
         strcpy(nack.reason, "Username cannot be empty.");
-        char *nack_json = serialize_server_register_nack(&nack);
-        if (nack_json)
+        char nack_json[SERVER_MESSAGE_MAX_LEN];
+        if (write_server_register_nack(&nack, nack_json, sizeof(nack_json)) >= 0)
         {
-            if (send(player->socket_fd, nack_json, strlen(nack_json), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
+            if (send_player_json(player, nack_json) == -1)
             {
-                perror("send register_nack (empty username) or newline");
+                perror("send register_nack (empty username)");
             }
-            free(nack_json);
         }
         return;
     }
 
-    for (int i = 0; i < MAX_CLIENTS; ++i)
+    pthread_mutex_lock(&ratings_lock);
+    RatingRecord *record = rating_table_get(&ratings, reg_payload.username);
+    // A name whose game was kept across a restart stays reserved for 'resume' until that game ends
+    int name_taken = (record == NULL || record->online || record->resume_room_id >= 0);
+    if (!name_taken)
     {
-        if (all_players[i].socket_fd != -1 && (&all_players[i] != player) &&
-            (all_players[i].state == P_REGISTERED || all_players[i].state == P_PLAYING) &&
-            strcmp(all_players[i].username, reg_payload.username) == 0)
-        {
-            fprintf(stderr, "Server: Username '%s' already taken. Registration failed for socket %d.\n", reg_payload.username, player->socket_fd);
-            ServerRegisterNackPayload nack;
-            strcpy(nack.type, "register_nack");
-            strcpy(nack.reason, "invalid");
-            char *nack_json = serialize_server_register_nack(&nack);
-            if (nack_json)
-            {
-                if (send(player->socket_fd, nack_json, strlen(nack_json), 0) == -1 ||
-                    send(player->socket_fd, "\n", 1, 0) == -1)
-                {
-                    perror("send register_nack (username taken) or newline");
-                }
-                free(nack_json);
-            }
-            return;
-        }
+        record->online = 1;
+        player->rating = record->rating;
     }
-
-    if (*current_num_registered_players >= MAX_CLIENTS && player->state != P_REGISTERED)
+    pthread_mutex_unlock(&ratings_lock);
+    if (name_taken)
     {
-        fprintf(stderr, "Server: Maximum registered players reached. Cannot register '%s'.\n", reg_payload.username);
+        fprintf(stderr, "Server: Username '%s' already taken. Registration failed for socket %d.\n", reg_payload.username, player->socket_fd);
         ServerRegisterNackPayload nack;
         strcpy(nack.type, "register_nack");
         strcpy(nack.reason, "invalid");
-        char *nack_json = serialize_server_register_nack(&nack);
-        if (nack_json)
+        char nack_json[SERVER_MESSAGE_MAX_LEN];
+        if (write_server_register_nack(&nack, nack_json, sizeof(nack_json)) >= 0)
         {
-            if (send(player->socket_fd, nack_json, strlen(nack_json), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
+            if (send_player_json(player, nack_json) == -1)
             {
-                perror("send register_nack (server full) or newline");
+                perror("send register_nack (username taken)");
             }
-            free(nack_json);
         }
         return;
     }
@@ -668,22 +907,32 @@ void process_registration_request(PlayerState *player, const char *received_json
     strncpy(player->username, reg_payload.username, MAX_USERNAME_LEN - 1);
     player->username[MAX_USERNAME_LEN - 1] = '\0';
     player->state = P_REGISTERED;
-    (*current_num_registered_players)++;
+    player->session_token = new_session_token();
+    num_registered_players++;
 
-    printf("Server: Player %s (socket %d) registered successfully. Total registered: %d\n", player->username, player->socket_fd, *current_num_registered_players);
+    SERVER_LOG(SERVER_LOG_INFO, "Player %s (socket %d, rating %.0f) registered successfully. Waiting for a match: %d",
+               player->username, player->socket_fd, player->rating, num_registered_players);
 
+    int binary = strcmp(reg_payload.wire, WIRE_FORMAT_BINARY) == 0;
+    // Binary frames carry 16-byte boards, which no delta would beat
+    player->board_updates_delta = !binary && strcmp(reg_payload.board_updates, BOARD_UPDATES_DELTA) == 0;
     ServerRegisterAckPayload ack;
     strcpy(ack.type, "register_ack");
-    char *ack_json = serialize_server_register_ack(&ack);
-    if (ack_json)
+    snprintf(ack.session_token, sizeof(ack.session_token), "%016llx", (unsigned long long)player->session_token);
+    strcpy(ack.wire, binary ? WIRE_FORMAT_BINARY : "");
+    strcpy(ack.board_updates, player->board_updates_delta ? BOARD_UPDATES_DELTA : "");
+    char ack_json[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_register_ack(&ack, ack_json, sizeof(ack_json)) >= 0)
     {
-        if (send(player->socket_fd, ack_json, strlen(ack_json), 0) == -1 ||
-            send(player->socket_fd, "\n", 1, 0) == -1)
+        if (send_json_line(player->socket_fd, ack_json) == -1)
+        {
+            perror("send register_ack");
+            handle_client_disconnection(NULL, player);
+        }
+        else if (binary)
         {
-            perror("send register_ack or newline");
-            handle_client_disconnection(player, all_players, game_board);
+            player->wire_format = WIRE_FORMAT_FRAMES; // Everything after the ack is framed
         }
-        free(ack_json);
     }
     else
     {
@@ -692,68 +941,33 @@ void process_registration_request(PlayerState *player, const char *received_json
 
     if (player->state == P_REGISTERED)
     {
-        attempt_game_start(all_players, *current_num_registered_players, game_board);
+        queue_player_for_match(player);
     }
 }
 
 int validate_and_process_move(char game_board[8][9], int r1, int c1, int r2, int c2, char player_role)
 {
 
-    printf("Server: Validating move for %c from (%d,%d) to (%d,%d)\n", player_role, r1, c1, r2, c2);
-    if (r1 < 0 || r1 >= 8 || c1 < 0 || c1 >= 8 || r2 < 0 || r2 >= 8 || c2 < 0 || c2 >= 8)
+    SERVER_LOG(SERVER_LOG_DEBUG, "Validating move for %c from (%d,%d) to (%d,%d)", player_role, r1, c1, r2, c2);
+    uint64_t flipped_mask;
+    if (game_rules_apply_move(game_board, r1, c1, r2, c2, player_role, &flipped_mask) < 0)
     {
-        printf("Server: Move out of bounds.\n");
+        SERVER_LOG(SERVER_LOG_DEBUG, "Move failed validation.");
         return 0;
     }
-    if (game_board[r1][c1] != player_role)
-    {
-        printf("Server: Source cell does not contain player's piece.\n");
-        return 0;
-    }
-    if (game_board[r2][c2] != '.')
+
+    if (server_log_level <= SERVER_LOG_DEBUG)
     {
-        printf("Server: Destination cell not empty.\n");
-        return 0;
-    }
-    int dr = abs(r1 - r2);
-    int dc = abs(c1 - c2);
-
-    if ((dr <= 2 && dc <= 2) && (dr > 0 || dc > 0))
-    {
-        if (dr == 2 || dc == 2)
+        for (int cell = 0; cell < 64; ++cell)
         {
-            game_board[r1][c1] = '.';
-        }
-        game_board[r2][c2] = player_role;
-
-        char opponent_role = (player_role == 'R') ? 'B' : 'R';
-        for (int row_offset = -1; row_offset <= 1; ++row_offset)
-        {
-            for (int col_offset = -1; col_offset <= 1; ++col_offset)
+            if (flipped_mask & ((uint64_t)1 << cell))
             {
-                if (row_offset == 0 && col_offset == 0)
-                {
-                    continue;
-                }
-
-                int adjacent_r = r2 + row_offset;
-                int adjacent_c = c2 + col_offset;
-
-                if (adjacent_r >= 0 && adjacent_r < 8 && adjacent_c >= 0 && adjacent_c < 8)
-                {
-                    if (game_board[adjacent_r][adjacent_c] == opponent_role)
-                    {
-                        game_board[adjacent_r][adjacent_c] = player_role;
-                        printf("Server: Flipped opponent piece at (%d,%d) to %c\n", adjacent_r, adjacent_c, player_role);
-                    }
-                }
+                SERVER_LOG(SERVER_LOG_DEBUG, "Flipped opponent piece at (%d,%d) to %c", cell / 8, cell % 8, player_role);
             }
         }
-        printf("Server: Move validated and processed (placeholder).\n");
-        return 1;
     }
-    printf("Server: Move failed validation (placeholder).\n");
-    return 0;
+    SERVER_LOG(SERVER_LOG_DEBUG, "Move validated and processed.");
+    return 1;
 }
 // --- End OctaFlip Game Logic Interface ---
 
@@ -791,55 +1005,63 @@ int count_player_pieces_on_board(char board[8][9], char player_symbol)
 }
 
 // Function to notify the current player of their turn
-void start_player_turn(PlayerState all_players[], int player_idx, char game_board[8][9])
+void start_player_turn(GameRoom *room, int player_idx)
 {
+    PlayerState *all_players = room->players;
+    char(*game_board)[9] = room->board;
+
     if (player_idx < 0 || player_idx >= MAX_CLIENTS)
     {
         fprintf(stderr, "Error: Cannot start turn for invalid player index %d.\n", player_idx);
         return;
     }
 
+    if (all_players[player_idx].state == P_SUSPENDED)
+    {
+        // Nobody to notify: the turn runs out unless the player resumes in time
+        room->current_turn_player_index = player_idx;
+        room->turn_start_time = time(NULL);
+        save_room_snapshot(room);
+        return;
+    }
+
     if (all_players[player_idx].state != P_PLAYING)
     {
-        fprintf(stdout, "Server: Player %s (state %d) is not P_PLAYING, auto-passing turn.\n",
-                all_players[player_idx].username[0] ? all_players[player_idx].username : "N/A_IDX_" + player_idx,
-                all_players[player_idx].state);
+        SERVER_LOG(SERVER_LOG_INFO, "Player %s (state %d) is not P_PLAYING, auto-passing turn.",
+                   all_players[player_idx].username[0] ? all_players[player_idx].username : "N/A_IDX_" + player_idx,
+                   all_players[player_idx].state);
         log_board_and_move(game_board, all_players[player_idx].username[0] ? all_players[player_idx].username : "N/A_AUTO_PASS", -1, -1, -1, -1, "Auto-Pass (Not Playing)");
-        consecutive_passes_server++;
-        current_turn_player_index = player_idx;
-        switch_to_next_turn(all_players, game_board);
+        room->consecutive_passes++;
+        room->current_turn_player_index = player_idx;
+        journal_turn(room, JOURNAL_EVENT_AUTO_PASS, 0, 0, 0, 0);
+        switch_to_next_turn(room);
         return;
     }
 
-    current_turn_player_index = player_idx;
-    turn_start_time = time(NULL);
+    room->current_turn_player_index = player_idx;
+    room->turn_start_time = time(NULL);
+    room->turn_sent_ns = server_metrics_now_ns();
+    save_room_snapshot(room);
 
     ServerYourTurnPayload payload;
     strcpy(payload.type, "your_turn");
     memcpy(payload.board, game_board, sizeof(payload.board));
     payload.timeout = (double)TURN_TIMEOUT_SECONDS;
 
-    char *json_message = serialize_server_your_turn(&payload);
-    if (json_message)
-    {
-        if (send(all_players[player_idx].socket_fd, json_message, strlen(json_message), 0) == -1 ||
-            send(all_players[player_idx].socket_fd, "\n", 1, 0) == -1)
-        {
-            perror("send your_turn or newline");
-            handle_client_disconnection(&all_players[player_idx], all_players, game_board);
-        }
-        printf("Server: Sent 'your_turn' to %s (socket %d).\n", all_players[player_idx].username, all_players[player_idx].socket_fd);
-        free(json_message);
-    }
-    else
+    SERVER_LOG(SERVER_LOG_DEBUG, "Sending 'your_turn' to %s (socket %d).", all_players[player_idx].username, all_players[player_idx].socket_fd);
+    if (send_your_turn(&all_players[player_idx], &payload) == -1)
     {
-        fprintf(stderr, "Error serializing ServerYourTurnPayload\n");
+        perror("send your_turn");
+        handle_client_disconnection(room, &all_players[player_idx]);
     }
 }
 
 // Function to check and process game over condition
-int check_and_process_game_over(PlayerState all_players[], char game_board[8][9])
+int check_and_process_game_over(GameRoom *room)
 {
+    PlayerState *all_players = room->players;
+    char(*game_board)[9] = room->board;
+
     int game_over_flag = 0;
     char reason[128] = "";
 
@@ -882,15 +1104,16 @@ int check_and_process_game_over(PlayerState all_players[], char game_board[8][9]
         }
     }
 
-    if (!game_over_flag && consecutive_passes_server >= 2)
+    if (!game_over_flag && room->consecutive_passes >= 2)
     {
         game_over_flag = 1;
-        sprintf(reason, "Two consecutive passes (%d)", consecutive_passes_server);
+        sprintf(reason, "Two consecutive passes (%d)", room->consecutive_passes);
     }
 
     if (game_over_flag)
     {
-        printf("Server: Game over! Reason: %s.\n", reason);
+        SERVER_LOG(SERVER_LOG_INFO, "Room %d: game over! Reason: %s.", room->id, reason);
+        room->journal_end_reason = JOURNAL_END_FINISHED;
 
         ServerGameOverPayload gop;
         strcpy(gop.type, "game_over");
@@ -921,38 +1144,55 @@ int check_and_process_game_over(PlayerState all_players[], char game_board[8][9]
             gop.scores[1].score = 0;
         }
 
-        char *json_game_over = serialize_server_game_over(&gop);
-        if (json_game_over)
+        if (score_idx == 2)
+        {
+            update_ratings_after_game(&gop);
+        }
+
+        char json_game_over[SERVER_MESSAGE_MAX_LEN];
+        if (write_server_game_over(&gop, json_game_over, sizeof(json_game_over)) >= 0)
         {
             for (int i = 0; i < MAX_CLIENTS; ++i)
             {
                 if (all_players[i].socket_fd != -1 && (all_players[i].state == P_PLAYING || all_players[i].state == P_DISCONNECTED))
                 {
-                    if (send(all_players[i].socket_fd, json_game_over, strlen(json_game_over), 0) == -1 ||
-                        send(all_players[i].socket_fd, "\n", 1, 0) == -1)
+                    if (send_player_json(&all_players[i], json_game_over) == -1)
                     {
-                        perror("send game_over or newline");
+                        perror("send game_over");
                     }
                     else
                     {
-                        printf("Server: Sent 'game_over' to %s (socket %d).\n", all_players[i].username, all_players[i].socket_fd);
+                        SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'game_over' to %s (socket %d).", all_players[i].username, all_players[i].socket_fd);
                     }
                 }
             }
-            free(json_game_over);
+            broadcast_to_spectators(room, json_game_over);
         }
         else
         {
             fprintf(stderr, "Error serializing ServerGameOverPayload.\n");
         }
 
+        // A game kept across a restart cannot be resumed any more
+        pthread_mutex_lock(&ratings_lock);
+        for (int i = 0; i < MAX_CLIENTS; ++i)
+        {
+            RatingRecord *record = rating_table_find(&ratings, all_players[i].username);
+            if (record && record->resume_room_id == room->id)
+            {
+                record->resume_room_id = -1;
+                rating_table_release(&ratings, record);
+            }
+        }
+        pthread_mutex_unlock(&ratings_lock);
+
         // Clean up players involved in the game
         for (int i = 0; i < MAX_CLIENTS; ++i)
         {
             // Remove any player that was part of the game or is still connected
             if (all_players[i].socket_fd != -1)
             {
-                remove_player(&all_players[i], all_players, &num_clients, &num_registered_players);
+                remove_player(&all_players[i], &room->num_clients, &room->num_registered_players);
             }
             else if (all_players[i].player_role == 'R' || all_players[i].player_role == 'B')
             {
@@ -962,61 +1202,69 @@ int check_and_process_game_over(PlayerState all_players[], char game_board[8][9]
             }
         }
 
-        current_turn_player_index = -1;
-        total_moves_made_in_game = 0;
-        consecutive_passes_server = 0;
+        room->current_turn_player_index = -1;
+        room->total_moves_made_in_game = 0;
+        room->consecutive_passes = 0;
+        release_room(room);
 
-        printf("Server: Game session concluded and reset.\n");
+        server_metrics_add(METRIC_GAMES_FINISHED, 1);
+        SERVER_LOG(SERVER_LOG_INFO, "Game session concluded and reset.");
         return 1;
     }
     return 0;
 }
 
 // Function to switch to the next player's turn
-void switch_to_next_turn(PlayerState all_players[], char game_board[8][9])
+void switch_to_next_turn(GameRoom *room)
 {
-    total_moves_made_in_game++;
-    printf("Server: Total moves/turns processed in game: %d. Consecutive passes: %d\n", total_moves_made_in_game, consecutive_passes_server);
+    PlayerState *all_players = room->players;
+
+    room->total_moves_made_in_game++;
+    SERVER_LOG(SERVER_LOG_INFO, "Total moves/turns processed in game: %d. Consecutive passes: %d", room->total_moves_made_in_game, room->consecutive_passes);
 
-    if (check_and_process_game_over(all_players, game_board))
+    if (check_and_process_game_over(room))
     {
         return;
     }
 
-    int next_player_candidate = (current_turn_player_index + 1) % MAX_CLIENTS;
+    int next_player_candidate = (room->current_turn_player_index + 1) % MAX_CLIENTS;
     int initial_candidate = next_player_candidate;
 
     do
     {
-        if (all_players[next_player_candidate].state == P_PLAYING)
+        if (seat_in_game(&all_players[next_player_candidate]))
         {
-            start_player_turn(all_players, next_player_candidate, game_board);
+            start_player_turn(room, next_player_candidate);
             return;
         }
         next_player_candidate = (next_player_candidate + 1) % MAX_CLIENTS;
     } while (next_player_candidate != initial_candidate);
 
     fprintf(stderr, "Error: Could not find a valid next player in P_PLAYING state. Game might be stalled or over.\n");
-    current_turn_player_index = -1;
+    room->current_turn_player_index = -1;
 }
 
 // Function to process a move request from a client
-void process_move_request(PlayerState *player, const char *received_json_string, PlayerState all_players[], char game_board[8][9])
+// 'move_payload' is NULL when the request could not be decoded; the turn is then lost.
+void process_move_request(GameRoom *room, PlayerState *player, const ClientMovePayload *move_payload)
 {
-    if (current_turn_player_index == -1 || player->socket_fd != all_players[current_turn_player_index].socket_fd)
+    PlayerState *all_players = room->players;
+    char(*game_board)[9] = room->board;
+
+    if (room->current_turn_player_index == -1 || player->socket_fd != all_players[room->current_turn_player_index].socket_fd)
     {
         fprintf(stderr, "Server: Received move from %s (socket %d) but it's not their turn. Current turn: %s (socket %d).\n",
                 player->username, player->socket_fd,
-                (current_turn_player_index != -1 ? all_players[current_turn_player_index].username : "N/A"),
-                (current_turn_player_index != -1 ? all_players[current_turn_player_index].socket_fd : -1));
+                (room->current_turn_player_index != -1 ? all_players[room->current_turn_player_index].username : "N/A"),
+                (room->current_turn_player_index != -1 ? all_players[room->current_turn_player_index].socket_fd : -1));
 
         ServerInvalidMovePayload nack_payload;
         strcpy(nack_payload.type, "invalid_move");
         memcpy(nack_payload.board, game_board, sizeof(nack_payload.board));
 
-        if (current_turn_player_index != -1 && all_players[current_turn_player_index].state == P_PLAYING)
+        if (room->current_turn_player_index != -1 && seat_in_game(&all_players[room->current_turn_player_index]))
         {
-            strncpy(nack_payload.next_player, all_players[current_turn_player_index].username, MAX_USERNAME_LEN - 1);
+            strncpy(nack_payload.next_player, all_players[room->current_turn_player_index].username, MAX_USERNAME_LEN - 1);
             nack_payload.next_player[MAX_USERNAME_LEN - 1] = '\0';
         }
         else
@@ -1024,103 +1272,89 @@ void process_move_request(PlayerState *player, const char *received_json_string,
             strcpy(nack_payload.next_player, "N/A");
         }
         log_board_and_move(game_board, player->username, 0, 0, 0, 0, "Attempted Move - Not Your Turn");
+        server_metrics_add(METRIC_INVALID_MOVES, 1);
 
-        char *json_response_nack = serialize_server_invalid_move(&nack_payload);
-        if (json_response_nack)
-        {
-            if (send(player->socket_fd, json_response_nack, strlen(json_response_nack), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
-            {
-                perror("send invalid_move (not your turn) or newline");
-            }
-            free(json_response_nack);
-        }
-        else
+        if (send_invalid_move(room, player, &nack_payload) == -1)
         {
-            fprintf(stderr, "Error serializing ServerInvalidMovePayload for 'not your turn' for %s\n", player->username);
+            perror("send invalid_move (not your turn)");
         }
         return;
     }
 
-    turn_start_time = time(NULL);
+    room->turn_start_time = time(NULL);
+    server_metrics_observe(METRIC_TURN_ROUND_TRIP_NS, server_metrics_now_ns() - room->turn_sent_ns);
 
-    ClientMovePayload move_payload;
-    if (deserialize_client_move(received_json_string, &move_payload) != 0)
+    // Kept for the spectator stream: a failed send below clears player->username
+    char mover_username[MAX_USERNAME_LEN];
+    strncpy(mover_username, player->username, MAX_USERNAME_LEN - 1);
+    mover_username[MAX_USERNAME_LEN - 1] = '\0';
+
+    if (move_payload == NULL)
     {
         fprintf(stderr, "Server: Failed to deserialize move request from %s (socket %d).\n", player->username, player->socket_fd);
         log_board_and_move(game_board, player->username, -1, -1, -1, -1, "Deserialization Failed Move");
+        server_metrics_add(METRIC_INVALID_MOVES, 1);
 
         ServerInvalidMovePayload nack_payload;
         strcpy(nack_payload.type, "invalid_move");
         memcpy(nack_payload.board, game_board, sizeof(nack_payload.board));
-        get_next_playing_player_username(all_players, current_turn_player_index, nack_payload.next_player, MAX_USERNAME_LEN);
+        get_next_playing_player_username(all_players, room->current_turn_player_index, nack_payload.next_player, MAX_USERNAME_LEN);
 
-        char *json_response_nack = serialize_server_invalid_move(&nack_payload);
-        if (json_response_nack)
+        if (send_invalid_move(room, player, &nack_payload) == -1)
         {
-            if (send(player->socket_fd, json_response_nack, strlen(json_response_nack), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
-            {
-                perror("send invalid_move (deserialize failed) or newline");
-                handle_client_disconnection(player, all_players, game_board);
-            }
-            free(json_response_nack);
+            perror("send invalid_move (deserialize failed)");
+            handle_client_disconnection(room, player);
         }
-        switch_to_next_turn(all_players, game_board);
+        notify_spectators_of_move(room, "invalid_move", mover_username, 0, 0, 0, 0, 0);
+        journal_turn(room, JOURNAL_EVENT_INVALID, 0, 0, 0, 0);
+        switch_to_next_turn(room);
         return;
     }
 
-    int r1_received = move_payload.sx;
-    int c1_received = move_payload.sy;
-    int r2_received = move_payload.tx;
-    int c2_received = move_payload.ty;
+    int r1_received = move_payload->sx;
+    int c1_received = move_payload->sy;
+    int r2_received = move_payload->tx;
+    int c2_received = move_payload->ty;
 
     int r1, c1, r2, c2;
 
     // Check for pass attempt [cite: 5] - client sends (0,0,0,0) for pass
     if (r1_received == 0 && c1_received == 0 && r2_received == 0 && c2_received == 0)
     {
-        printf("Server: Player %s attempts to pass (received 0,0,0,0).\n", player->username);
+        SERVER_LOG(SERVER_LOG_DEBUG, "Player %s attempts to pass (received 0,0,0,0).", player->username);
         r1 = 0;
         c1 = 0;
         r2 = 0;
         c2 = 0;
         log_board_and_move(game_board, player->username, r1, c1, r2, c2, "Attempted Pass");
-        consecutive_passes_server++;
+        room->consecutive_passes++;
+        server_metrics_add(METRIC_PASSES, 1);
 
         ServerMoveOkPayload ok_payload;
         strcpy(ok_payload.type, "move_ok");
         memcpy(ok_payload.board, game_board, sizeof(ok_payload.board));
 
-        get_next_playing_player_username(all_players, current_turn_player_index, ok_payload.next_player, MAX_USERNAME_LEN);
+        get_next_playing_player_username(all_players, room->current_turn_player_index, ok_payload.next_player, MAX_USERNAME_LEN);
 
-        char *json_response = serialize_server_move_ok(&ok_payload);
-        if (json_response)
+        if (send_move_ok(room, player, &ok_payload) == -1)
         {
-            if (send(player->socket_fd, json_response, strlen(json_response), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
-            {
-                perror("send move_ok (for pass) or newline");
-                handle_client_disconnection(player, all_players, game_board);
-            }
-            else
-            {
-                printf("Server: Sent 'move_ok' (for pass) to %s.\n", player->username);
-                log_board_and_move(game_board, player->username, r1, c1, r2, c2, "Valid Pass");
-            }
-            free(json_response);
+            perror("send move_ok (for pass)");
+            handle_client_disconnection(room, player);
         }
         else
         {
-            fprintf(stderr, "Error serializing ServerMoveOkPayload for pass for %s\n", player->username);
+            SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'move_ok' (for pass) to %s.", player->username);
+            log_board_and_move(game_board, player->username, r1, c1, r2, c2, "Valid Pass");
         }
-        switch_to_next_turn(all_players, game_board);
+        notify_spectators_of_move(room, "pass", mover_username, 0, 0, 0, 0, 0);
+        journal_turn(room, JOURNAL_EVENT_PASS, 0, 0, 0, 0);
+        switch_to_next_turn(room);
         return;
     }
     else
     {
-        printf("Server: Player %s attempts move (received 1-indexed: %d,%d -> %d,%d).\n",
-               player->username, r1_received, c1_received, r2_received, c2_received);
+        SERVER_LOG(SERVER_LOG_DEBUG, "Player %s attempts move (received 1-indexed: %d,%d -> %d,%d).",
+                   player->username, r1_received, c1_received, r2_received, c2_received);
         r1 = r1_received - 1;
         c1 = c1_received - 1;
         r2 = r2_received - 1;
@@ -1132,36 +1366,34 @@ void process_move_request(PlayerState *player, const char *received_json_string,
     char original_board_on_invalid_move[8][9];
     memcpy(original_board_on_invalid_move, game_board, sizeof(original_board_on_invalid_move));
 
-    if (validate_and_process_move(game_board, r1, c1, r2, c2, player->player_role))
+    uint64_t validation_start_ns = server_metrics_now_ns();
+    int move_valid = validate_and_process_move(game_board, r1, c1, r2, c2, player->player_role);
+    server_metrics_observe(METRIC_MOVE_VALIDATION_NS, server_metrics_now_ns() - validation_start_ns);
+    server_metrics_add(move_valid ? METRIC_MOVES : METRIC_INVALID_MOVES, 1);
+
+    if (move_valid)
     {
-        consecutive_passes_server = 0;
+        room->consecutive_passes = 0;
         log_board_and_move(game_board, player->username, r1, c1, r2, c2, "Valid Move");
         ServerMoveOkPayload ok_payload;
         strcpy(ok_payload.type, "move_ok");
         memcpy(ok_payload.board, game_board, sizeof(ok_payload.board));
 
-        get_next_playing_player_username(all_players, current_turn_player_index, ok_payload.next_player, MAX_USERNAME_LEN);
+        get_next_playing_player_username(all_players, room->current_turn_player_index, ok_payload.next_player, MAX_USERNAME_LEN);
 
-        char *json_response = serialize_server_move_ok(&ok_payload);
-        if (json_response)
+        if (send_move_ok(room, player, &ok_payload) == -1)
         {
-            if (send(player->socket_fd, json_response, strlen(json_response), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
-            {
-                perror("send move_ok or newline");
-                handle_client_disconnection(player, all_players, game_board);
-            }
-            else
-            {
-                printf("Server: Sent 'move_ok' to %s.\n", player->username);
-            }
-            free(json_response);
+            perror("send move_ok");
+            handle_client_disconnection(room, player);
         }
         else
         {
-            fprintf(stderr, "Error serializing ServerMoveOkPayload for %s\n", player->username);
+            SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'move_ok' to %s.", player->username);
         }
-        switch_to_next_turn(all_players, game_board);
+        notify_spectators_of_move(room, "move", mover_username, r1_received, c1_received, r2_received, c2_received,
+                                  board_delta_diff((const char(*)[9])original_board_on_invalid_move, (const char(*)[9])game_board));
+        journal_turn(room, JOURNAL_EVENT_MOVE, r1, c1, r2, c2);
+        switch_to_next_turn(room);
     }
     else
     {
@@ -1170,83 +1402,80 @@ void process_move_request(PlayerState *player, const char *received_json_string,
         strcpy(nack_payload.type, "invalid_move");
         memcpy(nack_payload.board, original_board_on_invalid_move, sizeof(nack_payload.board));
 
-        get_next_playing_player_username(all_players, current_turn_player_index, nack_payload.next_player, MAX_USERNAME_LEN);
+        get_next_playing_player_username(all_players, room->current_turn_player_index, nack_payload.next_player, MAX_USERNAME_LEN);
 
-        char *json_response_nack = serialize_server_invalid_move(&nack_payload);
-        if (json_response_nack)
+        if (send_invalid_move(room, player, &nack_payload) == -1)
         {
-            if (send(player->socket_fd, json_response_nack, strlen(json_response_nack), 0) == -1 ||
-                send(player->socket_fd, "\n", 1, 0) == -1)
-            {
-                perror("send invalid_move or newline");
-                handle_client_disconnection(player, all_players, game_board);
-            }
-            else
-            {
-                printf("Server: Sent 'invalid_move' to %s.\n", player->username);
-            }
-            free(json_response_nack);
+            perror("send invalid_move");
+            handle_client_disconnection(room, player);
         }
         else
         {
-            fprintf(stderr, "Error serializing ServerInvalidMovePayload for %s\n", player->username);
+            SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'invalid_move' to %s.", player->username);
         }
-        switch_to_next_turn(all_players, game_board);
+        notify_spectators_of_move(room, "invalid_move", mover_username, r1_received, c1_received, r2_received, c2_received, 0);
+        journal_turn(room, JOURNAL_EVENT_INVALID, r1, c1, r2, c2);
+        switch_to_next_turn(room);
     }
 }
 
 // Function to handle turn timeout
-void handle_turn_timeout(PlayerState all_players[], char game_board[8][9])
+void handle_turn_timeout(GameRoom *room)
 {
-    if (current_turn_player_index == -1 || all_players[current_turn_player_index].state != P_PLAYING)
+    PlayerState *all_players = room->players;
+    char(*game_board)[9] = room->board;
+
+    if (room->current_turn_player_index == -1 || !seat_in_game(&all_players[room->current_turn_player_index]))
     {
         return;
     }
 
-    PlayerState *timed_out_player = &all_players[current_turn_player_index];
-    printf("Server: Player %s (socket %d) timed out.\n", timed_out_player->username, timed_out_player->socket_fd);
+    PlayerState *timed_out_player = &all_players[room->current_turn_player_index];
+    char timed_out_username[MAX_USERNAME_LEN];
+    strncpy(timed_out_username, timed_out_player->username, MAX_USERNAME_LEN - 1);
+    timed_out_username[MAX_USERNAME_LEN - 1] = '\0';
+    SERVER_LOG(SERVER_LOG_INFO, "Player %s (socket %d) timed out.", timed_out_player->username, timed_out_player->socket_fd);
     log_board_and_move(game_board, timed_out_player->username, -1, -1, -1, -1, "Timeout Pass");
-    consecutive_passes_server++;
+    server_metrics_add(METRIC_TIMEOUTS, 1);
+    room->consecutive_passes++;
 
     ServerPassPayload pass_payload;
     strcpy(pass_payload.type, "pass");
 
-    get_next_playing_player_username(all_players, current_turn_player_index, pass_payload.next_player, MAX_USERNAME_LEN);
+    get_next_playing_player_username(all_players, room->current_turn_player_index, pass_payload.next_player, MAX_USERNAME_LEN);
 
-    char *json_response = serialize_server_pass(&pass_payload);
-    if (json_response)
+    // A suspended player has no connection to tell
+    if (timed_out_player->state == P_PLAYING)
     {
-        if (send(timed_out_player->socket_fd, json_response, strlen(json_response), 0) == -1 ||
-            send(timed_out_player->socket_fd, "\n", 1, 0) == -1)
+        if (send_pass(room, timed_out_player, &pass_payload) == -1)
         {
-            perror("send pass on timeout or newline");
-            handle_client_disconnection(timed_out_player, all_players, game_board);
+            perror("send pass on timeout");
+            handle_client_disconnection(room, timed_out_player);
         }
         else
         {
-            printf("Server: Sent 'pass' to %s due to timeout.\n", timed_out_player->username);
+            SERVER_LOG(SERVER_LOG_DEBUG, "Sent 'pass' to %s due to timeout.", timed_out_player->username);
         }
-        free(json_response);
-    }
-    else
-    {
-        fprintf(stderr, "Error serializing ServerPassPayload for %s\n", timed_out_player->username);
     }
 
-    switch_to_next_turn(all_players, game_board);
+    notify_spectators_of_move(room, "timeout", timed_out_username, 0, 0, 0, 0, 0);
+    journal_turn(room, JOURNAL_EVENT_TIMEOUT, 0, 0, 0, 0);
+    switch_to_next_turn(room);
 }
 
 // Function to initialize player states
-void initialize_player_states(PlayerState all_players[])
+void initialize_player_states(PlayerState all_players[], int count)
 {
-    for (int i = 0; i < MAX_CLIENTS; i++)
+    for (int i = 0; i < count; i++)
     {
         all_players[i].socket_fd = -1;
         all_players[i].state = P_EMPTY;
         memset(all_players[i].username, 0, MAX_USERNAME_LEN);
         all_players[i].player_role = ' ';
-        all_players[i].recv_buffer_len = 0;
-        all_players[i].recv_buffer[0] = '\0';
+        all_players[i].wire_format = WIRE_FORMAT_JSON;
+        all_players[i].board_updates_delta = 0;
+        all_players[i].sent_board_valid = 0;
+        line_framer_init(&all_players[i].recv_framer);
     }
 }
 
@@ -1309,31 +1538,38 @@ int initialize_server_socket(const char *port)
     return sockfd;
 }
 
-// Function to add a player to the list
-void add_player(int client_socket, struct sockaddr_storage *client_addr, socklen_t addr_len, PlayerState all_players[], int *current_num_clients)
+// Function to add a new connection to the lobby
+void add_player(int client_socket, struct sockaddr_storage *client_addr, socklen_t addr_len)
 {
-    for (int i = 0; i < MAX_CLIENTS; i++)
+    for (int i = 0; i < MAX_LOBBY_CONNECTIONS; i++)
     {
-        if (all_players[i].socket_fd == -1)
+        if (lobby[i].socket_fd == -1)
         {
-            all_players[i].socket_fd = client_socket;
-            all_players[i].address = *client_addr;
-            all_players[i].addr_len = addr_len;
-            all_players[i].state = P_CONNECTED;
-            all_players[i].last_message_time = time(NULL);
-            (*current_num_clients)++;
-
-            FD_SET(client_socket, &master_fds);
-            if (client_socket > fd_max)
+            if (event_loop_add(&current_worker->loop, client_socket) == -1)
             {
-                fd_max = client_socket;
+                perror("event_loop_add lobby connection");
+                close(client_socket);
+                return;
             }
+            lobby[i].socket_fd = client_socket;
+            lobby[i].address = *client_addr;
+            lobby[i].addr_len = addr_len;
+            lobby[i].state = P_CONNECTED;
+            lobby[i].last_message_time = time(NULL);
+            lobby[i].wire_format = WIRE_FORMAT_JSON;
+            lobby[i].board_updates_delta = 0;
+            lobby[i].sent_board_valid = 0;
+            line_framer_init(&lobby[i].recv_framer);
+            num_clients++;
+            connection_by_fd[client_socket].kind = CONN_LOBBY;
+            connection_by_fd[client_socket].index = i;
+
             char ip_str[INET6_ADDRSTRLEN];
             inet_ntop(client_addr->ss_family,
                       (client_addr->ss_family == AF_INET) ? (void *)&(((struct sockaddr_in *)client_addr)->sin_addr)
                                                           : (void *)&(((struct sockaddr_in6 *)client_addr)->sin6_addr),
                       ip_str, sizeof(ip_str));
-            printf("Server: New connection from %s on socket %d. Client slot %d.\n", ip_str, client_socket, i);
+            SERVER_LOG(SERVER_LOG_INFO, "New connection from %s on socket %d. Lobby slot %d.", ip_str, client_socket, i);
             return;
         }
     }
@@ -1342,14 +1578,22 @@ void add_player(int client_socket, struct sockaddr_storage *client_addr, socklen
 }
 
 // Function to remove a player
-void remove_player(PlayerState *player_to_remove, PlayerState all_players[], int *current_num_clients, int *current_num_registered_players)
+// The counters are those of the table holding the player (the lobby or its room).
+void remove_player(PlayerState *player_to_remove, int *current_num_clients, int *current_num_registered_players)
 {
     if (player_to_remove->socket_fd != -1)
     {
-        printf("Server: Closing connection for socket %d (username: %s)\n", player_to_remove->socket_fd, player_to_remove->username[0] ? player_to_remove->username : "N/A");
+        SERVER_LOG(SERVER_LOG_INFO, "Closing connection for socket %d (username: %s)", player_to_remove->socket_fd, player_to_remove->username[0] ? player_to_remove->username : "N/A");
 
+        event_loop_remove_for_close(&current_worker->loop, player_to_remove->socket_fd);
         close(player_to_remove->socket_fd);
-        FD_CLR(player_to_remove->socket_fd, &master_fds);
+
+        ConnectionRef *conn = &connection_by_fd[player_to_remove->socket_fd];
+        if (conn->kind == CONN_LOBBY)
+        {
+            match_queue_remove(&match_queue, conn->index);
+        }
+        conn->kind = CONN_NONE;
 
         if (player_to_remove->state == P_REGISTERED || player_to_remove->state == P_PLAYING)
         {
@@ -1357,6 +1601,15 @@ void remove_player(PlayerState *player_to_remove, PlayerState all_players[], int
             {
                 (*current_num_registered_players)--;
             }
+            pthread_mutex_lock(&ratings_lock);
+            RatingRecord *record = rating_table_find(&ratings, player_to_remove->username);
+            if (record)
+            {
+                record->online = 0;
+                record->resume_room_id = -1; // Leaving gives up the seat kept for 'resume'
+                rating_table_release(&ratings, record);
+            }
+            pthread_mutex_unlock(&ratings_lock);
         }
 
         player_to_remove->socket_fd = -1;
@@ -1372,7 +1625,7 @@ void remove_player(PlayerState *player_to_remove, PlayerState all_players[], int
 }
 
 // Function to accept a new connection
-void accept_new_connection(int current_listener_fd, PlayerState all_players[], int *current_num_clients)
+void accept_new_connection(int current_listener_fd)
 {
     struct sockaddr_storage client_addr;
     socklen_t addr_len = sizeof(client_addr);
@@ -1383,9 +1636,30 @@ void accept_new_connection(int current_listener_fd, PlayerState all_players[], i
         perror("accept");
         return;
     }
+    server_metrics_add(METRIC_CONNECTIONS_ACCEPTED, 1);
 
-    if (*current_num_clients >= MAX_CLIENTS)
+    // Each reply leaves in one sendmsg(), but the next one often follows before the client
+    // has acknowledged the last; without this, Nagle holds those small per-turn replies back
+    // until the client's delayed ACK (about 40 ms per message).
+    int one = 1;
+    if (setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == -1)
+    {
+        perror("setsockopt TCP_NODELAY");
+    }
+
+    if (new_fd >= max_connection_fds)
+    {
+        fprintf(stderr, "Server: Socket %d exceeds the connection table (%d). Rejecting new connection.\n", new_fd, max_connection_fds);
+        close(new_fd);
+    }
+    else if (num_clients >= MAX_LOBBY_CONNECTIONS)
     {
+        // Lobby is full: park the connection so it can still spectate
+        if (add_spectator_connection(new_fd) == 0)
+        {
+            SERVER_LOG(SERVER_LOG_INFO, "Lobby full. Socket %d parked as a spectator connection.", new_fd);
+            return;
+        }
         fprintf(stderr, "Server: Maximum clients reached. Rejecting new connection from socket %d.\n", new_fd);
         const char *msg = "Server is full. Try again later.\n";
         send(new_fd, msg, strlen(msg), 0);
@@ -1393,280 +1667,2014 @@ void accept_new_connection(int current_listener_fd, PlayerState all_players[], i
     }
     else
     {
-        add_player(new_fd, &client_addr, addr_len, all_players, current_num_clients);
+        add_player(new_fd, &client_addr, addr_len);
     }
 }
 
-// Function to handle client disconnection and associated game logic
-void handle_client_disconnection(PlayerState *disconnected_player, PlayerState all_players[], char game_board[8][9])
+// Function to count the seats of a room that are still part of its game
+static int count_seats_in_game(const GameRoom *room)
 {
-    if (disconnected_player == NULL || disconnected_player->socket_fd == -1)
-    {
-        return;
-    }
-
-    printf("Server: Handling disconnection for player %s (socket %d, state %d).\n",
-           disconnected_player->username[0] ? disconnected_player->username : "N/A",
-           disconnected_player->socket_fd, disconnected_player->state);
-
-    char disconnected_username_copy[MAX_USERNAME_LEN];
-    strncpy(disconnected_username_copy, disconnected_player->username, MAX_USERNAME_LEN - 1);
-    disconnected_username_copy[MAX_USERNAME_LEN - 1] = '\0';
-    char disconnected_player_role = disconnected_player->player_role;
-
-    int game_was_active_with_two_players = 0;
-    if (current_turn_player_index != -1)
-    {
-        int playing_count = 0;
-        for (int i = 0; i < MAX_CLIENTS; ++i)
-        {
-            if (players[i].state == P_PLAYING)
-                playing_count++;
-        }
-        if (playing_count == MAX_CLIENTS)
-            game_was_active_with_two_players = 1;
-    }
-
-    int disconnected_player_slot = -1;
+    int playing_count = 0;
     for (int i = 0; i < MAX_CLIENTS; ++i)
     {
-        if (&all_players[i] == disconnected_player)
-        {
-            disconnected_player_slot = i;
-            break;
-        }
+        if (seat_in_game(&room->players[i]))
+            playing_count++;
     }
+    return playing_count;
+}
 
-    ClientConnectionState old_state = disconnected_player->state;
-    remove_player(disconnected_player, all_players, &num_clients, &num_registered_players);
-
-    if (old_state == P_PLAYING && game_was_active_with_two_players)
+// Function to carry on the game of a room after one of its seats was given up for good
+// 'left_running_game' is set when that seat was playing in a game that still had both players.
+static void continue_after_seat_left(GameRoom *room, int slot, const char *username, char role, int left_running_game)
+{
+    if (left_running_game)
     {
-        if (num_registered_players == 1)
+        if (room->num_registered_players == 1)
         {
-            printf("Server: Player %s (role %c) disconnected. Game continues with remaining player.\n",
-                   disconnected_username_copy, disconnected_player_role);
+            SERVER_LOG(SERVER_LOG_INFO, "Player %s (role %c) disconnected. Game continues with remaining player.",
+                       username, role);
 
-            if (disconnected_player_slot == current_turn_player_index)
+            if (slot == room->current_turn_player_index)
             {
-                log_board_and_move(game_board, disconnected_username_copy, -1, -1, -1, -1, "Disconnect Pass");
-                consecutive_passes_server++;
-                switch_to_next_turn(all_players, game_board);
+                log_board_and_move(room->board, username, -1, -1, -1, -1, "Disconnect Pass");
+                room->consecutive_passes++;
+                notify_spectators_of_move(room, "disconnect", username, 0, 0, 0, 0, 0);
+                journal_turn(room, JOURNAL_EVENT_DISCONNECT, 0, 0, 0, 0);
+                switch_to_next_turn(room);
             }
             else
             {
-                if (check_and_process_game_over(all_players, game_board))
+                if (check_and_process_game_over(room))
                 {
                     return;
                 }
             }
         }
-        else if (num_registered_players == 0)
+        else if (room->num_registered_players == 0)
         {
-            printf("Server: Last playing player %s disconnected or both players disconnected from an active game. Resetting.\n", disconnected_username_copy);
-            current_turn_player_index = -1;
-            total_moves_made_in_game = 0;
-            consecutive_passes_server = 0;
-            check_and_process_game_over(all_players, game_board);
+            SERVER_LOG(SERVER_LOG_INFO, "Last playing player %s disconnected or both players disconnected from an active game. Resetting.", username);
+            room->current_turn_player_index = -1;
+            room->total_moves_made_in_game = 0;
+            room->consecutive_passes = 0;
+            check_and_process_game_over(room);
         }
     }
-    else if (num_registered_players == 0)
+    else if (room->num_registered_players == 0)
+    {
+        SERVER_LOG(SERVER_LOG_INFO, "All clients disconnected or game was not fully active. Server idle or reset.");
+        room->current_turn_player_index = -1;
+        room->total_moves_made_in_game = 0;
+        room->consecutive_passes = 0;
+    }
+
+    if (room->num_clients == 0 && room->current_turn_player_index == -1)
+    {
+        release_room(room);
+    }
+    else if (room->in_use)
     {
-        printf("Server: All clients disconnected or game was not fully active. Server idle or reset.\n");
-        current_turn_player_index = -1;
-        total_moves_made_in_game = 0;
-        consecutive_passes_server = 0;
+        save_room_snapshot(room); // The seat is gone for good, even after a restart
     }
 }
 
-// Function to handle messages from a client
-void handle_client_message(PlayerState *player, PlayerState all_players[], int *current_num_clients, int *current_num_registered_players, char game_board[8][9])
+// Function to keep the seat of a player whose connection dropped mid-game
+// The socket is closed, but the seat keeps its name and session token so the player can
+// 'resume' on a new connection within RESUME_GRACE_SECONDS. The turn clock keeps running.
+static void suspend_player_seat(GameRoom *room, PlayerState *player)
 {
-    char buf[BUFFER_SIZE];
-    int nbytes = recv(player->socket_fd, buf, sizeof(buf) - 1, 0);
+    SERVER_LOG(SERVER_LOG_INFO, "Room %d: %s (socket %d) dropped; seat kept for %d seconds.",
+               room->id, player->username, player->socket_fd, RESUME_GRACE_SECONDS);
 
-    if (nbytes <= 0)
+    event_loop_remove_for_close(&current_worker->loop, player->socket_fd);
+    close(player->socket_fd);
+    connection_by_fd[player->socket_fd].kind = CONN_NONE;
+    player->socket_fd = -1;
+    player->state = P_SUSPENDED;
+    player->suspended_since = time(NULL);
+    line_framer_init(&player->recv_framer);
+    if (room->num_clients > 0)
+    {
+        room->num_clients--;
+    }
+
+    pthread_mutex_lock(&ratings_lock);
+    RatingRecord *record = rating_table_find(&ratings, player->username);
+    if (record)
+    {
+        record->online = 0;
+        record->resume_room_id = room->id;
+    }
+    pthread_mutex_unlock(&ratings_lock);
+    save_room_snapshot(room);
+}
+
+// Function to give up a suspended seat whose player did not resume in time
+static void expire_suspended_seat(GameRoom *room, int slot)
+{
+    PlayerState *player = &room->players[slot];
+    char username_copy[MAX_USERNAME_LEN];
+    strncpy(username_copy, player->username, MAX_USERNAME_LEN - 1);
+    username_copy[MAX_USERNAME_LEN - 1] = '\0';
+    char role = player->player_role;
+    int left_running_game = count_seats_in_game(room) == MAX_CLIENTS;
+
+    SERVER_LOG(SERVER_LOG_INFO, "Room %d: %s did not resume within %d seconds; the seat is given up.",
+               room->id, username_copy, RESUME_GRACE_SECONDS);
+    pthread_mutex_lock(&ratings_lock);
+    RatingRecord *record = rating_table_find(&ratings, username_copy);
+    if (record && record->resume_room_id == room->id)
+    {
+        record->resume_room_id = -1;
+        rating_table_release(&ratings, record);
+    }
+    pthread_mutex_unlock(&ratings_lock);
+
+    player->state = P_DISCONNECTED;
+    memset(player->username, 0, MAX_USERNAME_LEN);
+    player->player_role = ' ';
+    if (room->num_registered_players > 0)
+    {
+        room->num_registered_players--;
+    }
+    continue_after_seat_left(room, slot, username_copy, role, left_running_game);
+}
+
+// Function to handle client disconnection and associated game logic
+// 'room' is NULL for a player still in the lobby. A player dropping out of a running game
+// keeps its seat for a while (see suspend_player_seat()).
+void handle_client_disconnection(GameRoom *room, PlayerState *disconnected_player)
+{
+    if (disconnected_player == NULL || disconnected_player->socket_fd == -1)
     {
-        if (nbytes == 0)
-        {
-            printf("Server: Socket %d (username: %s) hung up.\n", player->socket_fd, player->username[0] ? player->username : "N/A");
-        }
-        else
-        {
-            perror("recv");
-        }
-        handle_client_disconnection(player, all_players, game_board);
         return;
     }
+    server_metrics_add(METRIC_DISCONNECTIONS, 1);
 
-    // Check for buffer overflow before appending
-    if (player->recv_buffer_len + nbytes >= PLAYER_RECV_BUFFER_MAX_LEN)
+    if (room == NULL)
     {
-        fprintf(stderr, "Server: Receive buffer overflow for player %s (socket %d). Disconnecting.\n",
-                player->username[0] ? player->username : "N/A", player->socket_fd);
-        handle_client_disconnection(player, all_players, game_board);
+        SERVER_LOG(SERVER_LOG_INFO, "Lobby player %s (socket %d) disconnected.",
+                   disconnected_player->username[0] ? disconnected_player->username : "N/A", disconnected_player->socket_fd);
+        remove_player(disconnected_player, &num_clients, &num_registered_players);
         return;
     }
 
-    // Append new data to player's persistent buffer
-    memcpy(player->recv_buffer + player->recv_buffer_len, buf, nbytes);
-    player->recv_buffer_len += nbytes;
-    player->recv_buffer[player->recv_buffer_len] = '\0';
+    SERVER_LOG(SERVER_LOG_INFO, "Handling disconnection for player %s (socket %d, state %d).",
+               disconnected_player->username[0] ? disconnected_player->username : "N/A",
+               disconnected_player->socket_fd, disconnected_player->state);
 
-    char *current_pos = player->recv_buffer;
-    char *newline_ptr;
-    while ((newline_ptr = strchr(current_pos, '\n')) != NULL)
+    int game_was_active_with_two_players =
+        room->current_turn_player_index != -1 && count_seats_in_game(room) == MAX_CLIENTS;
+    if (disconnected_player->state == P_PLAYING && game_was_active_with_two_players)
     {
-        int message_len = newline_ptr - current_pos;
-        char json_message[message_len + 1];
-        strncpy(json_message, current_pos, message_len);
-        json_message[message_len] = '\0';
+        suspend_player_seat(room, disconnected_player);
+        return;
+    }
 
-        printf("Server: Processing message from socket %d: %s\n",
-               player->socket_fd, json_message);
+    char disconnected_username_copy[MAX_USERNAME_LEN];
+    strncpy(disconnected_username_copy, disconnected_player->username, MAX_USERNAME_LEN - 1);
+    disconnected_username_copy[MAX_USERNAME_LEN - 1] = '\0';
+    char disconnected_player_role = disconnected_player->player_role;
+    int disconnected_player_slot = (int)(disconnected_player - room->players);
 
-        player->last_message_time = time(NULL);
+    remove_player(disconnected_player, &room->num_clients, &room->num_registered_players);
+    continue_after_seat_left(room, disconnected_player_slot, disconnected_username_copy, disconnected_player_role, 0);
+}
+
+// --- Game Rooms and Matchmaking ---
+
+// Seconds on a clock that never jumps, used for matchmaking windows
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
 
-        const char *msg_type_const = get_message_type_from_json(json_message);
-        if (msg_type_const == NULL)
+// Returns the running room with the given id, or NULL
+static GameRoom *find_room_by_id(int room_id)
+{
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        if (rooms[r].in_use && rooms[r].id == room_id)
         {
-            fprintf(stderr, "Server: Could not determine message type from: %s. Player: %s\n", json_message, player->username);
+            return &rooms[r];
         }
-        else
+    }
+    return NULL;
+}
+
+// Function to initialize every room as free
+void initialize_rooms(void)
+{
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        rooms[r].id = 0;
+        rooms[r].in_use = 0;
+        rooms[r].current_turn_player_index = -1;
+        rooms[r].watcher_head = -1;
+        rooms[r].num_watching = 0;
+        initialize_player_states(rooms[r].players, MAX_CLIENTS);
+    }
+}
+
+// Function to claim a free room of this worker for a new game
+// Returns the room, or NULL if every room is in use.
+static GameRoom *allocate_room(int room_id)
+{
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        GameRoom *room = &rooms[r];
+        if (room->in_use)
         {
-            if (strcmp(msg_type_const, "register") == 0)
-            {
-                process_registration_request(player, json_message, all_players, current_num_registered_players, game_board);
-            }
-            else if (strcmp(msg_type_const, "move") == 0)
-            {
-                if (player->state == P_PLAYING && current_turn_player_index != -1 &&
-                    all_players[current_turn_player_index].socket_fd == player->socket_fd)
-                {
-                    process_move_request(player, json_message, all_players, game_board);
-                }
-                else
-                {
-                    fprintf(stderr, "Server: Move received from %s but not their turn or not playing.\n", player->username);
-                }
-            }
-            else
-            {
-                fprintf(stderr, "Server: Unknown message type '%s' from %s.\n", msg_type_const, player->username);
-            }
-            free((void *)msg_type_const);
+            continue;
         }
-
-        current_pos = newline_ptr + 1;
+        room->id = room_id;
+        room->in_use = 1;
+        room->num_clients = 0;
+        room->num_registered_players = 0;
+        room->current_turn_player_index = -1;
+        room->total_moves_made_in_game = 0;
+        room->consecutive_passes = 0;
+        room->event_seq = 0;
+        room->watcher_head = -1;
+        room->num_watching = 0;
+        room->journal_active = 0;
+        room->snapshot_events_saved = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            memset(room->board[i], '.', 8);
+            room->board[i][8] = '\0';
+        }
+        num_active_rooms++;
+        return room;
     }
+    return NULL;
+}
 
-    int remaining_len = player->recv_buffer_len - (current_pos - player->recv_buffer);
-    if (remaining_len > 0 && current_pos != player->recv_buffer)
+// Function to free a room once its game is over and both players are gone
+// Its spectators go back to waiting for the next game to start.
+void release_room(GameRoom *room)
+{
+    if (!room->in_use)
+    {
+        return;
+    }
+    while (room->watcher_head != -1)
+    {
+        SpectatorState *spectator = &spectators[room->watcher_head];
+        detach_watcher(spectator);
+        attach_watcher(spectator, NULL);
+    }
+    if (room->journal_active)
+    {
+        game_journal_append(&room->journal, room->journal_end_reason,
+                            count_player_pieces_on_board(room->board, 'R'), count_player_pieces_on_board(room->board, 'B'));
+        room->journal_active = 0;
+    }
+    if (game_snapshot_enabled())
+    {
+        game_snapshot_clear(current_worker->index * MAX_ROOMS + (int)(room - rooms), (uint32_t)room->id);
+    }
+    room->in_use = 0;
+    if (last_room_id == room->id)
+    {
+        last_room_id = -1;
+    }
+    if (num_active_rooms > 0)
     {
-        memmove(player->recv_buffer, current_pos, remaining_len);
+        num_active_rooms--;
     }
-    player->recv_buffer_len = remaining_len;
-    player->recv_buffer[player->recv_buffer_len] = '\0';
+    SERVER_LOG(SERVER_LOG_INFO, "Room %d closed. Active rooms: %d", room->id, num_active_rooms);
 }
 
-int main(int argc, char *argv[])
+// Function to update the Elo ratings of the two players of a finished game
+void update_ratings_after_game(const ServerGameOverPayload *game_over)
 {
-    const char *port = SERVER_PORT;
+    double score_a = 0.5;
+    if (game_over->scores[0].score > game_over->scores[1].score)
+        score_a = 1.0;
+    else if (game_over->scores[0].score < game_over->scores[1].score)
+        score_a = 0.0;
+
+    pthread_mutex_lock(&ratings_lock);
+    RatingRecord *a = rating_table_find(&ratings, game_over->scores[0].username);
+    RatingRecord *b = rating_table_find(&ratings, game_over->scores[1].username);
+    if (a == NULL || b == NULL || a == b)
+    {
+        pthread_mutex_unlock(&ratings_lock);
+        return;
+    }
+    elo_update(a, b, score_a);
+    double rating_a = a->rating;
+    double rating_b = b->rating;
+    pthread_mutex_unlock(&ratings_lock);
 
-    initialize_player_states(players);
+    SERVER_LOG(SERVER_LOG_INFO, "Ratings updated: %s %.0f, %s %.0f",
+               game_over->scores[0].username, rating_a, game_over->scores[1].username, rating_b);
+}
 
-    listener_fd = initialize_server_socket(port);
-    if (listener_fd == -1)
+// Function to put a registered lobby player in the matchmaking queue
+// A room is started right away if an opponent within the rating window is waiting.
+void queue_player_for_match(PlayerState *player)
+{
+    int handle = (int)(player - lobby);
+    double now = monotonic_seconds();
+    match_queue_push(&match_queue, handle, (int)player->rating, now);
+
+    int first_handle, second_handle;
+    if (match_queue_take_pair(&match_queue, handle, now, &first_handle, &second_handle))
     {
-        fprintf(stderr, "Failed to initialize server socket. Exiting.\n");
-        exit(1);
+        seat_matched_players(first_handle, second_handle);
+    }
+}
+
+// Function to move a connection out of its lobby slot into 'out'
+// The copy keeps the buffered bytes with the connection. Unless 'target' is this worker,
+// the socket also leaves this worker's event loop.
+static void take_player_from_lobby(PlayerState *player, ServerWorker *target, PlayerState *out)
+{
+    *out = *player;
+    connection_by_fd[player->socket_fd].kind = CONN_NONE;
+    if (target != current_worker)
+    {
+        event_loop_remove(&current_worker->loop, player->socket_fd);
+    }
+    if (player->state == P_REGISTERED && num_registered_players > 0)
+    {
+        num_registered_players--;
     }
 
-    FD_ZERO(&master_fds);
-    FD_ZERO(&read_fds);
-    FD_SET(listener_fd, &master_fds);
-    fd_max = listener_fd;
+    player->socket_fd = -1;
+    player->state = P_EMPTY;
+    memset(player->username, 0, MAX_USERNAME_LEN);
+    line_framer_init(&player->recv_framer);
+    if (num_clients > 0)
+    {
+        num_clients--;
+    }
+}
 
-    printf("Server: Listening on port %s...\n", port);
+// Function to move a matched pair out of the lobby and start their game
+// The player that waited longer takes seat 0 and plays 'R'. Rooms are dealt round-robin
+// over the workers; a pair for another worker is handed to it with its buffered bytes.
+void seat_matched_players(int first_handle, int second_handle)
+{
+    int room_id = next_room_id++;
+    ServerWorker *target = &workers[worker_for_room(room_id)];
 
-    for (int i = 0; i < 8; i++)
+    Handoff *handoff = malloc(sizeof(Handoff));
+    if (handoff == NULL)
     {
-        for (int j = 0; j < 8; j++)
-        {
-            octaflip_board[i][j] = '.';
-        }
-        octaflip_board[i][8] = '\0';
+        perror("malloc handoff");
+        double now = monotonic_seconds();
+        match_queue_push(&match_queue, first_handle, (int)lobby[first_handle].rating, now);
+        match_queue_push(&match_queue, second_handle, (int)lobby[second_handle].rating, now);
+        return;
     }
+    handoff->kind = HANDOFF_PAIR;
+    handoff->room_id = room_id;
 
-    while (1)
+    int handles[MAX_CLIENTS] = {first_handle, second_handle};
+    for (int seat = 0; seat < MAX_CLIENTS; seat++)
     {
-        read_fds = master_fds;
-        struct timeval tv;
-        tv.tv_sec = 1; // Check for timeouts roughly every second
-        tv.tv_usec = 0;
+        take_player_from_lobby(&lobby[handles[seat]], target, &handoff->players[seat]);
+    }
 
-        int activity = select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+    SERVER_LOG(SERVER_LOG_INFO, "Room %d: matched %s (%.0f) with %s (%.0f) on worker %d. Still waiting: %d",
+               room_id, handoff->players[0].username, handoff->players[0].rating,
+               handoff->players[1].username, handoff->players[1].rating, target->index, match_queue.queued);
+    last_room_id = room_id;
 
-        if (activity < 0) // select error
-        {
-            if (errno == EINTR)
-            { // Interrupted by signal, continue
-                continue;
-            }
-            perror("select");
-            // Consider more robust error handling or graceful shutdown
-            exit(4);
-        }
+    if (target == current_worker)
+    {
+        seat_players_in_room(room_id, handoff->players);
+        free(handoff);
+        return;
+    }
+    post_handoff(target, handoff);
 
-        // Check for turn timeout if a game is in progress
-        if (current_turn_player_index != -1 && players[current_turn_player_index].state == P_PLAYING)
-        {
-            if (time(NULL) - turn_start_time >= TURN_TIMEOUT_SECONDS)
-            {
-                handle_turn_timeout(players, octaflip_board);
-            }
-        }
+    // Spectators waiting for a game follow the pair to its worker
+    while (idle_watcher_head != -1)
+    {
+        hand_off_spectator(&spectators[idle_watcher_head], room_id);
+    }
+}
 
-        // Iterate through existing connections looking for data to read or new connections
-        for (int i = 0; i <= fd_max; i++)
+// Function to open a room on this worker for a matched pair and start the game
+// 'pair' holds both connections in seat order; their sockets become owned by this worker.
+void seat_players_in_room(int room_id, PlayerState pair[MAX_CLIENTS])
+{
+    GameRoom *room = allocate_room(room_id);
+    if (room == NULL)
+    {
+        fprintf(stderr, "Server: No free game room on worker %d. Closing %s and %s.\n",
+                current_worker->index, pair[0].username, pair[1].username);
+        for (int seat = 0; seat < MAX_CLIENTS; seat++)
         {
-            if (FD_ISSET(i, &read_fds))
-            {
-                if (i == listener_fd)
-                {
-                    // Handle new connection
-                    accept_new_connection(listener_fd, players, &num_clients);
-                }
-                else
-                {
-                    // Handle data from an existing client
-                    PlayerState *current_player = NULL;
-                    for (int j = 0; j < MAX_CLIENTS; j++)
-                    {
-                        if (players[j].socket_fd == i)
-                        {
-                            current_player = &players[j];
-                            break;
-                        }
-                    }
-                    if (current_player)
-                    {
-                        handle_client_message(current_player, players, &num_clients, &num_registered_players, octaflip_board);
-                    }
-                }
-            }
+            int ignored_clients = 1, ignored_registered = 1;
+            remove_player(&pair[seat], &ignored_clients, &ignored_registered);
         }
+        return;
     }
 
-    // Cleanup (currently unreachable in this infinite loop)
-    close(listener_fd);
-    for (int i = 0; i < MAX_CLIENTS; i++)
+    for (int seat = 0; seat < MAX_CLIENTS; seat++)
+    {
+        int client_socket = pair[seat].socket_fd;
+        room->players[seat] = pair[seat];
+        connection_by_fd[client_socket].kind = CONN_ROOM;
+        connection_by_fd[client_socket].index = (int)(room - rooms);
+        connection_by_fd[client_socket].seat = seat;
+        room->num_clients++;
+        room->num_registered_players++;
+    }
+    attempt_game_start(room);
+}
+
+// Function to send a 'resume_nack' with the given reason
+static void send_resume_nack(const PlayerState *player, const char *reason)
+{
+    ServerResumeNackPayload nack;
+    strcpy(nack.type, "resume_nack");
+    strncpy(nack.reason, reason, MAX_REASON_LEN - 1);
+    nack.reason[MAX_REASON_LEN - 1] = '\0';
+    char nack_json[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_resume_nack(&nack, nack_json, sizeof(nack_json)) >= 0)
+    {
+        if (send_player_json(player, nack_json) == -1)
+        {
+            perror("send resume_nack");
+        }
+    }
+}
+
+// Function to route a lobby connection back to the game a restarted server kept for it
+// The session token is checked by the worker that runs the room.
+void process_resume_request(PlayerState *player, const cJSON *received_message)
+{
+    ClientResumePayload resume_payload;
+    if (deserialize_client_resume(received_message, &resume_payload) != 0)
+    {
+        fprintf(stderr, "Server: Failed to deserialize resume request from socket %d.\n", player->socket_fd);
+        return;
+    }
+    if (player->state != P_CONNECTED)
+    {
+        fprintf(stderr, "Server: Player %s (socket %d) attempted to resume after registering.\n", player->username, player->socket_fd);
+        send_resume_nack(player, "Invalid state for resume.");
+        return;
+    }
+
+    // The seat may still look connected when the old connection is half-open; the room
+    // then checks the token and replaces that connection.
+    int room_id = -1;
+    int was_online = 0;
+    pthread_mutex_lock(&ratings_lock);
+    RatingRecord *record = rating_table_find(&ratings, resume_payload.username);
+    if (record && record->resume_room_id >= 0)
+    {
+        room_id = record->resume_room_id;
+        was_online = record->online;
+        record->online = 1; // Claimed until the room accepts or refuses the token
+        player->rating = record->rating;
+    }
+    pthread_mutex_unlock(&ratings_lock);
+    if (room_id < 0)
+    {
+        SERVER_LOG(SERVER_LOG_INFO, "Socket %d: no game to resume for '%s'.", player->socket_fd, resume_payload.username);
+        send_resume_nack(player, "No game to resume.");
+        return;
+    }
+
+    strncpy(player->username, resume_payload.username, MAX_USERNAME_LEN - 1);
+    player->username[MAX_USERNAME_LEN - 1] = '\0';
+    player->session_token = strtoull(resume_payload.session_token, NULL, 16);
+    player->wire_format = strcmp(resume_payload.wire, WIRE_FORMAT_BINARY) == 0 ? WIRE_FORMAT_FRAMES : WIRE_FORMAT_JSON;
+    player->board_updates_delta = player->wire_format == WIRE_FORMAT_JSON && strcmp(resume_payload.board_updates, BOARD_UPDATES_DELTA) == 0;
+
+    ServerWorker *target = &workers[worker_for_room(room_id)];
+    Handoff *handoff = malloc(sizeof(Handoff));
+    if (handoff == NULL)
+    {
+        perror("malloc handoff");
+        pthread_mutex_lock(&ratings_lock);
+        record = rating_table_find(&ratings, resume_payload.username);
+        if (record)
+        {
+            record->online = was_online;
+        }
+        pthread_mutex_unlock(&ratings_lock);
+        player->wire_format = WIRE_FORMAT_JSON; // Refused: no switch to frames
+        send_resume_nack(player, "Server busy.");
+        return;
+    }
+    handoff->kind = HANDOFF_RESUME;
+    handoff->room_id = room_id;
+    take_player_from_lobby(player, target, &handoff->players[0]);
+
+    if (target == current_worker)
+    {
+        resume_player_in_room(room_id, &handoff->players[0]);
+        free(handoff);
+        return;
+    }
+    post_handoff(target, handoff);
+}
+
+// Function to put a resuming player back into its seat
+// 'player' holds the connection; its socket is owned by this worker. The seat is either
+// suspended or still playing on an old connection that has not noticed the drop yet, which
+// is then closed. The player gets a 'resume_ack' with the board, then 'your_turn' with the
+// time left if it is to move. A wrong token or a game that ended in the meantime closes the
+// connection after a 'resume_nack'.
+void resume_player_in_room(int room_id, PlayerState *player)
+{
+    GameRoom *room = find_room_by_id(room_id);
+    int seat = -1;
+    int name_still_playing = 0;
+    for (int s = 0; room != NULL && s < MAX_CLIENTS; s++)
+    {
+        PlayerState *seated = &room->players[s];
+        if (!seat_in_game(seated) || strcmp(seated->username, player->username) != 0)
+        {
+            continue;
+        }
+        if (seated->session_token == player->session_token)
+        {
+            seat = s;
+        }
+        name_still_playing |= seated->state == P_PLAYING;
+    }
+
+    if (seat == -1)
+    {
+        SERVER_LOG(SERVER_LOG_INFO, "Room %d: refused resume of '%s' (socket %d).", room_id, player->username, player->socket_fd);
+        player->wire_format = WIRE_FORMAT_JSON; // Refused: no switch to frames
+        send_resume_nack(player, "No game to resume.");
+        pthread_mutex_lock(&ratings_lock);
+        RatingRecord *record = rating_table_find(&ratings, player->username);
+        if (record)
+        {
+            record->online = name_still_playing;
+        }
+        pthread_mutex_unlock(&ratings_lock);
+        int ignored_clients = 1, ignored_registered = 0;
+        remove_player(player, &ignored_clients, &ignored_registered);
+        return;
+    }
+
+    PlayerState *seated = &room->players[seat];
+    int client_socket = player->socket_fd;
+    if (seated->state == P_PLAYING)
+    {
+        SERVER_LOG(SERVER_LOG_INFO, "Room %d: %s replaces its old connection (socket %d).", room->id, seated->username, seated->socket_fd);
+        event_loop_remove_for_close(&current_worker->loop, seated->socket_fd); // Likely stuck: never waited for
+        close(seated->socket_fd);
+        connection_by_fd[seated->socket_fd].kind = CONN_NONE;
+        room->num_clients--;
+    }
+    *seated = *player;
+    seated->state = P_PLAYING;
+    seated->player_role = seat == 0 ? 'R' : 'B';
+    seated->last_message_time = time(NULL);
+    connection_by_fd[client_socket].kind = CONN_ROOM;
+    connection_by_fd[client_socket].index = (int)(room - rooms);
+    connection_by_fd[client_socket].seat = seat;
+    room->num_clients++;
+
+    int remaining = TURN_TIMEOUT_SECONDS - (int)(time(NULL) - room->turn_start_time);
+    if (remaining < 0)
+    {
+        remaining = 0;
+    }
+    SERVER_LOG(SERVER_LOG_INFO, "Room %d: %s resumed seat %d (socket %d).", room->id, seated->username, seat, client_socket);
+    server_metrics_add(METRIC_RESUMES, 1);
+
+    ServerResumeAckPayload ack;
+    strcpy(ack.type, "resume_ack");
+    ack.room = room->id;
+    for (int s = 0; s < MAX_CLIENTS; s++)
+    {
+        memcpy(ack.players[s], room->players[s].username, MAX_USERNAME_LEN);
+        ack.players[s][MAX_USERNAME_LEN - 1] = '\0';
+    }
+    memcpy(ack.board, room->board, sizeof(ack.board));
+    memcpy(ack.next_player, room->players[room->current_turn_player_index].username, MAX_USERNAME_LEN);
+    ack.next_player[MAX_USERNAME_LEN - 1] = '\0';
+    ack.timeout = (double)remaining;
+    strcpy(ack.wire, seated->wire_format == WIRE_FORMAT_FRAMES ? WIRE_FORMAT_BINARY : "");
+    strcpy(ack.board_updates, seated->board_updates_delta ? BOARD_UPDATES_DELTA : "");
+    char ack_json[SERVER_MESSAGE_MAX_LEN]; // Always a JSON line; frames start after it
+    if (write_server_resume_ack(&ack, ack_json, sizeof(ack_json)) < 0 || send_json_line(client_socket, ack_json) == -1)
+    {
+        perror("send resume_ack");
+        handle_client_disconnection(room, seated);
+        return;
+    }
+    // The ack's full board is the base of the next delta
+    memcpy(seated->sent_board, room->board, sizeof(seated->sent_board));
+    seated->sent_board_valid = 1;
+    seated->board_updates_sent = 1;
+
+    if (room->current_turn_player_index == seat)
+    {
+        ServerYourTurnPayload payload;
+        strcpy(payload.type, "your_turn");
+        memcpy(payload.board, room->board, sizeof(payload.board));
+        payload.timeout = (double)remaining;
+        room->turn_sent_ns = server_metrics_now_ns();
+        if (send_your_turn(seated, &payload) == -1)
+        {
+            perror("send your_turn");
+            handle_client_disconnection(room, seated);
+            return;
+        }
+    }
+    save_room_snapshot(room);
+}
+
+// Function to reopen the games of the previous server run that belong to this worker
+// Their players are suspended until they 'resume'; the turn clock and the grace period of
+// the seats restart now.
+static void restore_snapshot_rooms(void)
+{
+    for (int i = 0; i < game_snapshot_restored_count(); i++)
+    {
+        const GameSnapshotRoom *saved = game_snapshot_restored(i);
+        if (worker_for_room((int)saved->room_id) != current_worker->index)
+        {
+            continue;
+        }
+        GameRoom *room = allocate_room((int)saved->room_id);
+        if (room == NULL)
+        {
+            // The game stays in the previous snapshot file and is offered again at the next start
+            fprintf(stderr, "Server: No free game room on worker %d to restore room %u; kept for the next start.\n",
+                    current_worker->index, saved->room_id);
+            return;
+        }
+
+        for (int r = 0; r < 8; r++)
+        {
+            memcpy(room->board[r], saved->board[r], 8);
+            room->board[r][8] = '\0';
+        }
+        room->event_seq = saved->event_seq;
+        room->consecutive_passes = saved->consecutive_passes;
+        room->total_moves_made_in_game = saved->total_moves;
+        for (int seat = 0; seat < MAX_CLIENTS; seat++)
+        {
+            PlayerState *player = &room->players[seat];
+            initialize_player_states(player, 1);
+            strncpy(player->username, saved->names[seat], MAX_USERNAME_LEN - 1);
+            player->username[MAX_USERNAME_LEN - 1] = '\0';
+            player->session_token = saved->session_tokens[seat];
+            player->rating = RATING_DEFAULT;
+            if (saved->seat_present[seat])
+            {
+                player->state = P_SUSPENDED;
+                player->suspended_since = time(NULL);
+                player->player_role = seat == 0 ? 'R' : 'B';
+                room->num_registered_players++;
+            }
+            else
+            {
+                player->state = P_DISCONNECTED;
+            }
+        }
+
+        if (saved->journal_active && game_journal_enabled())
+        {
+            GameJournalGame *journal = &room->journal;
+            game_journal_begin(journal, saved->room_id, saved->names[0], saved->names[1]);
+            journal->start_unix_ms = saved->start_unix_ms;
+            if (journal->start_mono_ms > saved->elapsed_ms)
+            {
+                journal->start_mono_ms -= saved->elapsed_ms;
+            }
+            journal->flags = saved->journal_flags;
+            journal->num_events = saved->num_events;
+            memcpy(journal->events, saved->events, (size_t)saved->num_events * sizeof(uint32_t));
+            room->journal_active = 1;
+            room->journal_end_reason = JOURNAL_END_ABANDONED;
+        }
+
+        SERVER_LOG(SERVER_LOG_INFO, "Room %u restored: %s vs %s, %u turns played, waiting for both players to resume.",
+                   saved->room_id, saved->names[0], saved->names[1], saved->total_moves);
+        start_player_turn(room, saved->current_seat);
+    }
+}
+
+// Function to pair queued players whose rating windows have widened enough
+static void run_matchmaking(void)
+{
+    double now = monotonic_seconds();
+    int first_handle, second_handle;
+    while (match_queue_poll(&match_queue, now, &first_handle, &second_handle))
+    {
+        seat_matched_players(first_handle, second_handle);
+    }
+}
+
+// Function to pass the turn of every room whose current player ran out of time
+// Also gives up the suspended seats whose grace period is over.
+static void check_turn_timeouts(void)
+{
+    time_t now = time(NULL);
+    for (int r = 0; r < MAX_ROOMS; r++)
+    {
+        GameRoom *room = &rooms[r];
+        for (int seat = 0; seat < MAX_CLIENTS && room->in_use; seat++)
+        {
+            if (room->players[seat].state == P_SUSPENDED && now - room->players[seat].suspended_since >= RESUME_GRACE_SECONDS)
+            {
+                expire_suspended_seat(room, seat);
+            }
+        }
+        if (room->in_use && room->current_turn_player_index != -1 &&
+            seat_in_game(&room->players[room->current_turn_player_index]) &&
+            now - room->turn_start_time >= TURN_TIMEOUT_SECONDS)
+        {
+            handle_turn_timeout(room);
+        }
+    }
+}
+
+// --- End Game Rooms and Matchmaking ---
+
+// --- Spectator Stream ---
+
+// Function to initialize the spectator slots [first, last) and mark them free
+void initialize_spectator_states(int first, int last)
+{
+    for (int i = last - 1; i >= first; i--) // Lowest slots are handed out first
+    {
+        spectators[i].socket_fd = -1;
+        spectators[i].state = S_EMPTY;
+        spectators[i].room_index = -1;
+        spectators[i].prev_watcher = -1;
+        spectators[i].next_watcher = -1;
+        line_framer_init(&spectators[i].recv_framer);
+        free_spectator_slots[num_free_spectator_slots++] = i;
+    }
+}
+
+// Function to double the spectator table, up to one slot per socket the worker can serve
+// Slots are referred to by index, so moving the table is safe. Returns 0, or -1 if it cannot grow.
+static int grow_spectator_table(void)
+{
+    int capacity = spectator_capacity ? spectator_capacity * 2 : SPECTATOR_SLOTS_INITIAL;
+    if (capacity > max_connection_fds)
+    {
+        capacity = max_connection_fds;
+    }
+    if (capacity <= spectator_capacity)
+    {
+        return -1;
+    }
+    SpectatorState *grown = realloc(spectators, (size_t)capacity * sizeof(SpectatorState));
+    if (!grown)
+    {
+        perror("realloc spectator table");
+        return -1;
+    }
+    spectators = grown;
+    int *grown_free = realloc(free_spectator_slots, (size_t)capacity * sizeof(int));
+    if (!grown_free)
+    {
+        perror("realloc spectator free list");
+        return -1; // 'spectators' keeps its larger size; the new slots are simply not used
+    }
+    free_spectator_slots = grown_free;
+    initialize_spectator_states(spectator_capacity, capacity);
+    spectator_capacity = capacity;
+    return 0;
+}
+
+// Function to park a connection in the spectator table
+// Returns 0 on success, -1 if no spectator slot is left.
+int add_spectator_connection(int client_socket)
+{
+    if (num_free_spectator_slots == 0 && grow_spectator_table() != 0)
+    {
+        return -1;
+    }
+    if (event_loop_add(&current_worker->loop, client_socket) == -1)
+    {
+        perror("event_loop_add spectator connection");
+        return -1;
+    }
+    int i = free_spectator_slots[--num_free_spectator_slots];
+    spectators[i].socket_fd = client_socket;
+    spectators[i].state = S_PENDING;
+    line_framer_init(&spectators[i].recv_framer);
+    connection_by_fd[client_socket].kind = CONN_SPECTATOR;
+    connection_by_fd[client_socket].index = i;
+    num_spectator_connections++;
+    return 0;
+}
+
+// Links a watching spectator into the watcher list of a room, or of the idle list if 'room' is NULL
+void attach_watcher(SpectatorState *spectator, GameRoom *room)
+{
+    int slot = (int)(spectator - spectators);
+    int *head = room ? &room->watcher_head : &idle_watcher_head;
+
+    spectator->room_index = room ? (int)(room - rooms) : -1;
+    spectator->prev_watcher = -1;
+    spectator->next_watcher = *head;
+    if (*head != -1)
+    {
+        spectators[*head].prev_watcher = slot;
+    }
+    *head = slot;
+    if (room)
+    {
+        room->num_watching++;
+    }
+}
+
+// Unlinks a watching spectator from whichever watcher list holds it
+void detach_watcher(SpectatorState *spectator)
+{
+    GameRoom *room = spectator->room_index != -1 ? &rooms[spectator->room_index] : NULL;
+    int *head = room ? &room->watcher_head : &idle_watcher_head;
+
+    if (spectator->prev_watcher != -1)
+    {
+        spectators[spectator->prev_watcher].next_watcher = spectator->next_watcher;
+    }
+    else
+    {
+        *head = spectator->next_watcher;
+    }
+    if (spectator->next_watcher != -1)
+    {
+        spectators[spectator->next_watcher].prev_watcher = spectator->prev_watcher;
+    }
+    spectator->prev_watcher = -1;
+    spectator->next_watcher = -1;
+    spectator->room_index = -1;
+    if (room && room->num_watching > 0)
+    {
+        room->num_watching--;
+    }
+}
+
+// Frees a spectator slot and stops watching its socket without closing it
+// (the caller closes it if 'closing' is set, else the connection moves elsewhere)
+static void release_spectator_slot(SpectatorState *spectator, int closing)
+{
+    if (closing)
+    {
+        event_loop_remove_for_close(&current_worker->loop, spectator->socket_fd);
+    }
+    else
+    {
+        event_loop_remove(&current_worker->loop, spectator->socket_fd);
+    }
+    if (spectator->state == S_WATCHING)
+    {
+        detach_watcher(spectator);
+        if (num_watching_spectators > 0)
+        {
+            num_watching_spectators--;
+        }
+    }
+    if (num_spectator_connections > 0)
+    {
+        num_spectator_connections--;
+    }
+    connection_by_fd[spectator->socket_fd].kind = CONN_NONE;
+    spectator->socket_fd = -1;
+    spectator->state = S_EMPTY;
+    line_framer_init(&spectator->recv_framer);
+    free_spectator_slots[num_free_spectator_slots++] = (int)(spectator - spectators);
+}
+
+// Function to remove a spectator
+void remove_spectator(SpectatorState *spectator)
+{
+    if (spectator->state == S_EMPTY)
+    {
+        return;
+    }
+    SERVER_LOG(SERVER_LOG_INFO, "Closing spectator connection on socket %d.", spectator->socket_fd);
+    int client_socket = spectator->socket_fd;
+    release_spectator_slot(spectator, 1);
+    close(client_socket);
+}
+
+// Appends the newline delimiter once so a message can go out in a single send() per socket.
+// The frame is built in 'buffer' (SPECTATOR_FRAME_BUFFER_LEN bytes) when it fits, else malloc'd.
+// Returns the frame, to be freed if it is not 'buffer', and its length; NULL on allocation failure.
+static char *frame_json_message(const char *json_message, char *buffer, size_t *out_len)
+{
+    size_t json_len = strlen(json_message);
+    char *frame = json_len < SPECTATOR_FRAME_BUFFER_LEN ? buffer : malloc(json_len + 1);
+    if (!frame)
+    {
+        perror("malloc spectator frame");
+        return NULL;
+    }
+    memcpy(frame, json_message, json_len);
+    frame[json_len] = '\n';
+    *out_len = json_len + 1;
+    return frame;
+}
+
+// Non-blocking send of a whole frame. A spectator whose socket cannot take the frame at once
+// is dropped: a partial write would corrupt its stream and waiting would stall the game loop.
+static int send_frame_to_spectator(SpectatorState *spectator, const char *frame, size_t frame_len)
+{
+    ssize_t sent = send(spectator->socket_fd, frame, frame_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent != (ssize_t)frame_len)
+    {
+        fprintf(stderr, "Server: Spectator on socket %d is %s. Dropping.\n",
+                spectator->socket_fd, sent == -1 ? "unreachable" : "lagging behind");
+        remove_spectator(spectator);
+        return -1;
+    }
+    server_metrics_add(METRIC_BYTES_OUT, frame_len);
+    return 0;
+}
+
+// Streams one already-serialized message to every spectator watching a room.
+// The message is serialized and framed once, however many spectators are watching.
+void broadcast_to_spectators(GameRoom *room, const char *json_message)
+{
+    if (room->num_watching == 0 || json_message == NULL)
+    {
+        return;
+    }
+
+    char buffer[SPECTATOR_FRAME_BUFFER_LEN];
+    size_t frame_len;
+    char *frame = frame_json_message(json_message, buffer, &frame_len);
+    if (!frame)
+    {
+        return;
+    }
+
+    int next_slot;
+    for (int slot = room->watcher_head; slot != -1; slot = next_slot)
+    {
+        next_slot = spectators[slot].next_watcher; // The spectator may be dropped below
+        send_frame_to_spectator(&spectators[slot], frame, frame_len);
+    }
+    if (frame != buffer)
+    {
+        free(frame);
+    }
+}
+
+// Builds the full room state a spectator needs before it can apply incremental updates
+// 'room' is NULL for a spectator waiting for the next game, which gets an empty board.
+static void build_spectator_snapshot(GameRoom *room, ServerSpectateSnapshotPayload *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    strcpy(snapshot->type, "spectate_snapshot");
+    strcpy(snapshot->next_player, "N/A");
+    snapshot->room = -1;
+
+    if (room == NULL)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            memset(snapshot->board[i], '.', 8);
+        }
+        return;
+    }
+
+    PlayerState *all_players = room->players;
+    snapshot->room = room->id;
+    snapshot->seq = room->event_seq;
+    snapshot->game_active = (room->current_turn_player_index != -1);
+    memcpy(snapshot->board, room->board, sizeof(snapshot->board));
+
+    if (!snapshot->game_active)
+    {
+        return;
+    }
+
+    // players[0] plays 'R', players[1] plays 'B'
+    const char roles[2] = {'R', 'B'};
+    for (int r = 0; r < 2; ++r)
+    {
+        for (int i = 0; i < MAX_CLIENTS; ++i)
+        {
+            if (seat_in_game(&all_players[i]) && all_players[i].player_role == roles[r])
+            {
+                memcpy(snapshot->players[r], all_players[i].username, MAX_USERNAME_LEN);
+                snapshot->players[r][MAX_USERNAME_LEN - 1] = '\0';
+            }
+        }
+    }
+    if (seat_in_game(&all_players[room->current_turn_player_index]))
+    {
+        memcpy(snapshot->next_player, all_players[room->current_turn_player_index].username, MAX_USERNAME_LEN);
+        snapshot->next_player[MAX_USERNAME_LEN - 1] = '\0';
+    }
+}
+
+// Function to send the current room state to every spectator of a room (e.g. when its game starts)
+void broadcast_spectator_snapshot(GameRoom *room)
+{
+    if (room->num_watching == 0)
+    {
+        return;
+    }
+
+    ServerSpectateSnapshotPayload snapshot;
+    build_spectator_snapshot(room, &snapshot);
+    char json_snapshot[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_spectate_snapshot(&snapshot, json_snapshot, sizeof(json_snapshot)) >= 0)
+    {
+        broadcast_to_spectators(room, json_snapshot);
+    }
+    else
+    {
+        fprintf(stderr, "Error serializing ServerSpectateSnapshotPayload.\n");
+    }
+}
+
+// Function to stream one processed turn to the spectators of a room
+// Coordinates are 1-indexed as received from the client; (0,0,0,0) when none apply.
+// 'changed_cells' marks the cells the event changed on room->board (board_delta_diff()).
+void notify_spectators_of_move(GameRoom *room, const char *event, const char *player_username, int sx, int sy, int tx, int ty, uint64_t changed_cells)
+{
+    room->event_seq++;
+    if (room->num_watching == 0)
+    {
+        return;
+    }
+
+    ServerSpectateUpdatePayload update;
+    strcpy(update.type, "spectate_update");
+    update.room = room->id;
+    update.seq = room->event_seq;
+    strncpy(update.event, event, sizeof(update.event) - 1);
+    update.event[sizeof(update.event) - 1] = '\0';
+    strncpy(update.player, player_username ? player_username : "N/A", MAX_USERNAME_LEN - 1);
+    update.player[MAX_USERNAME_LEN - 1] = '\0';
+    update.sx = sx;
+    update.sy = sy;
+    update.tx = tx;
+    update.ty = ty;
+    get_next_playing_player_username(room->players, room->current_turn_player_index, update.next_player, MAX_USERNAME_LEN);
+    board_delta_format((const char(*)[9])room->board, changed_cells, update.changes);
+    update.checksum[0] = '\0';
+    if (update.seq % BOARD_DELTA_CHECKSUM_INTERVAL == 0)
+    {
+        board_delta_checksum((const char(*)[9])room->board, update.checksum);
+    }
+
+    char json_update[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_spectate_update(&update, json_update, sizeof(json_update)) >= 0)
+    {
+        broadcast_to_spectators(room, json_update);
+    }
+    else
+    {
+        fprintf(stderr, "Error serializing ServerSpectateUpdatePayload.\n");
+    }
+}
+
+// Function to hand every spectator waiting for a game over to a room that just started
+void bind_idle_watchers_to_room(GameRoom *room)
+{
+    while (idle_watcher_head != -1)
+    {
+        SpectatorState *spectator = &spectators[idle_watcher_head];
+        detach_watcher(spectator);
+        attach_watcher(spectator, room);
+    }
+}
+
+// Subscribes a spectator to the move stream of a room and sends it the current snapshot
+// Without a room id (-1) the most recently started game is watched. A spectator whose room
+// is not running waits and is handed to the next game that starts.
+static void start_spectating(SpectatorState *spectator, int requested_room_id)
+{
+    int room_id = requested_room_id >= 0 ? requested_room_id : last_room_id;
+    if (room_id >= 0 && worker_for_room(room_id) != current_worker->index)
+    {
+        hand_off_spectator(spectator, room_id); // The room runs on another worker
+        return;
+    }
+
+    GameRoom *room = NULL;
+    if (room_id >= 0)
+    {
+        room = find_room_by_id(room_id);
+        if (room == NULL && requested_room_id >= 0)
+        {
+            SERVER_LOG(SERVER_LOG_INFO, "Room %d requested by socket %d is not running. Waiting for the next game.",
+                       requested_room_id, spectator->socket_fd);
+        }
+    }
+
+    if (spectator->state == S_PENDING)
+    {
+        spectator->state = S_WATCHING;
+        num_watching_spectators++;
+        SERVER_LOG(SERVER_LOG_INFO, "Socket %d is now spectating room %d. Watching spectators: %d",
+                   spectator->socket_fd, room ? room->id : -1, num_watching_spectators);
+    }
+    else
+    {
+        detach_watcher(spectator);
+    }
+    attach_watcher(spectator, room);
+
+    ServerSpectateSnapshotPayload snapshot;
+    build_spectator_snapshot(room, &snapshot);
+    char json_snapshot[SERVER_MESSAGE_MAX_LEN];
+    if (write_server_spectate_snapshot(&snapshot, json_snapshot, sizeof(json_snapshot)) < 0)
+    {
+        fprintf(stderr, "Error serializing ServerSpectateSnapshotPayload.\n");
+        return;
+    }
+    char buffer[SPECTATOR_FRAME_BUFFER_LEN];
+    size_t frame_len;
+    char *frame = frame_json_message(json_snapshot, buffer, &frame_len);
+    if (frame)
+    {
+        send_frame_to_spectator(spectator, frame, frame_len);
+        if (frame != buffer)
+        {
+            free(frame);
+        }
+    }
+}
+
+// Moves an unregistered lobby connection into the spectator table
+// Returns the spectator slot, or NULL if the connection stays in the lobby.
+static SpectatorState *move_player_to_spectators(PlayerState *player, int requested_room_id)
+{
+    int client_socket = player->socket_fd;
+    event_loop_remove(&current_worker->loop, client_socket); // Re-registered by add_spectator_connection()
+    if (add_spectator_connection(client_socket) != 0)
+    {
+        fprintf(stderr, "Server: No spectator slot left for socket %d.\n", client_socket);
+        event_loop_add(&current_worker->loop, client_socket);
+        return NULL;
+    }
+
+    SpectatorState *spectator = &spectators[connection_by_fd[client_socket].index];
+    spectator->recv_framer = player->recv_framer; // Keep pipelined bytes
+
+    player->socket_fd = -1;
+    player->state = P_EMPTY;
+    line_framer_init(&player->recv_framer);
+    if (num_clients > 0)
+    {
+        num_clients--;
+    }
+
+    start_spectating(spectator, requested_room_id);
+    return spectator;
+}
+
+// Moves a pending spectator connection into a free lobby slot so it can register
+// Returns the lobby slot, or NULL if the lobby is full.
+static PlayerState *move_spectator_to_lobby(SpectatorState *spectator)
+{
+    if (num_clients >= MAX_LOBBY_CONNECTIONS)
+    {
+        return NULL;
+    }
+
+    int client_socket = spectator->socket_fd;
+    struct sockaddr_storage client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    if (getpeername(client_socket, (struct sockaddr *)&client_addr, &addr_len) == -1)
+    {
+        perror("getpeername");
+        return NULL;
+    }
+
+    LineFramer pending_bytes = spectator->recv_framer;
+    release_spectator_slot(spectator, 0);
+    add_player(client_socket, &client_addr, addr_len);
+    if (connection_by_fd[client_socket].kind != CONN_LOBBY)
+    {
+        return NULL;
+    }
+    PlayerState *player = &lobby[connection_by_fd[client_socket].index];
+    player->recv_framer = pending_bytes;
+    return player;
+}
+
+// Function to process every complete message buffered for a spectator connection
+// Returns 1 if the connection left this spectator slot, 0 once the buffer is drained.
+static int process_buffered_spectator_messages(SpectatorState *spectator)
+{
+    int client_socket = spectator->socket_fd;
+    const char *json_message;
+    size_t message_len;
+    int framer_status;
+    while (spectator->socket_fd == client_socket &&
+           (framer_status = line_framer_next(&spectator->recv_framer, &json_message, &message_len)) != LINE_FRAMER_NONE)
+    {
+        if (framer_status == LINE_FRAMER_OVERSIZED)
+        {
+            fprintf(stderr, "Server: Dropped a message longer than %d bytes from spectator socket %d.\n",
+                    PLAYER_RECV_BUFFER_MAX_LEN - 1, client_socket);
+            continue;
+        }
+
+        MessageType msg_type;
+        const char *msg_type_str;
+        cJSON *message = parse_message_with_type(json_message, message_len, &msg_type, &msg_type_str);
+        if (message == NULL)
+        {
+            fprintf(stderr, "Server: Could not determine message type from spectator socket %d.\n", client_socket);
+            continue;
+        }
+
+        PlayerState *promoted_player = NULL;
+        ClientSpectatePayload spectate_payload;
+        switch (msg_type)
+        {
+        case MSG_SPECTATE:
+            deserialize_client_spectate(message, &spectate_payload);
+            start_spectating(spectator, spectate_payload.room);
+            break;
+        case MSG_STATS:
+            send_stats_report_to_spectator(spectator);
+            break;
+        case MSG_REGISTER:
+            if (spectator->state != S_PENDING)
+            {
+                fprintf(stderr, "Server: Spectator socket %d cannot register.\n", client_socket);
+                break;
+            }
+            promoted_player = move_spectator_to_lobby(spectator);
+            if (promoted_player)
+            {
+                process_registration_request(promoted_player, message);
+            }
+            else
+            {
+                fprintf(stderr, "Server: Lobby full. Rejecting registration from socket %d.\n", client_socket);
+                ServerRegisterNackPayload nack;
+                strcpy(nack.type, "register_nack");
+                strcpy(nack.reason, "Server is full.");
+                char nack_json[SERVER_MESSAGE_MAX_LEN];
+                if (write_server_register_nack(&nack, nack_json, sizeof(nack_json)) >= 0 &&
+                    send_json_line(client_socket, nack_json) == -1)
+                {
+                    perror("send register_nack (server full)");
+                }
+            }
+            break;
+        default:
+            fprintf(stderr, "Server: Ignoring '%s' from spectator socket %d.\n", msg_type_str, client_socket);
+            break;
+        }
+        release_message(message);
+    }
+    return spectator->socket_fd != client_socket;
+}
+
+// Function to handle messages from a spectator connection
+void handle_spectator_message(SpectatorState *spectator)
+{
+    ssize_t nbytes = line_framer_recv(&spectator->recv_framer, spectator->socket_fd);
+
+    if (nbytes <= 0)
+    {
+        if (nbytes == 0)
+        {
+            SERVER_LOG(SERVER_LOG_INFO, "Spectator socket %d hung up.", spectator->socket_fd);
+        }
+        else
+        {
+            perror("recv");
+        }
+        remove_spectator(spectator);
+        return;
+    }
+    server_metrics_add(METRIC_BYTES_IN, (uint64_t)nbytes);
+
+    process_buffered_messages_for_fd(spectator->socket_fd);
+}
+
+// --- End Spectator Stream ---
+
+// --- Server Metrics ---
+
+// Function to answer a 'stats' request from a player connection
+void send_stats_report(const PlayerState *player)
+{
+    ServerMetricsSnapshot snapshot;
+    server_metrics_snapshot(&snapshot);
+    char *json_report = serialize_server_stats_report(&snapshot);
+    if (!json_report)
+    {
+        fprintf(stderr, "Error serializing the stats report.\n");
+        return;
+    }
+    if (send_player_json(player, json_report) == -1)
+    {
+        perror("send stats_report");
+    }
+    cJSON_free(json_report);
+}
+
+// Function to answer a 'stats' request from a spectator connection
+void send_stats_report_to_spectator(SpectatorState *spectator)
+{
+    ServerMetricsSnapshot snapshot;
+    server_metrics_snapshot(&snapshot);
+    char *json_report = serialize_server_stats_report(&snapshot);
+    if (!json_report)
+    {
+        fprintf(stderr, "Error serializing the stats report.\n");
+        return;
+    }
+    char buffer[SPECTATOR_FRAME_BUFFER_LEN];
+    size_t frame_len;
+    char *frame = frame_json_message(json_report, buffer, &frame_len);
+    if (frame)
+    {
+        send_frame_to_spectator(spectator, frame, frame_len);
+        if (frame != buffer)
+        {
+            free(frame);
+        }
+    }
+    cJSON_free(json_report);
+}
+
+// Function to open the local UNIX socket that serves the metrics as text
+// Returns the listening socket, or -1 on failure.
+static int initialize_stats_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Server: Stats socket path '%s' is too long.\n", path);
+        return -1;
+    }
+    int sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd == -1)
+    {
+        perror("socket stats");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+    unlink(path); // Left behind by a previous run
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(sockfd, 16) == -1)
+    {
+        perror("bind/listen stats");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// Function to write the current metrics to one connection of the stats socket and close it
+static void serve_stats_connection(int listener)
+{
+    int client_socket = accept(listener, NULL, NULL);
+    if (client_socket == -1)
+    {
+        perror("accept stats");
+        return;
+    }
+    ServerMetricsSnapshot snapshot;
+    server_metrics_snapshot(&snapshot);
+    char text[8192];
+    size_t text_len = server_metrics_format_text(&snapshot, text, sizeof(text));
+    if (send(client_socket, text, text_len, MSG_NOSIGNAL) == -1)
+    {
+        perror("send stats");
+    }
+    close(client_socket);
+}
+
+// Function to publish the gauges owned by the calling worker
+static void update_worker_gauges(void)
+{
+    server_metrics_set_gauge(METRIC_ACTIVE_ROOMS, num_active_rooms);
+    server_metrics_set_gauge(METRIC_SPECTATORS, num_spectator_connections);
+    if (current_worker->index == 0)
+    {
+        server_metrics_set_gauge(METRIC_LOBBY_CONNECTIONS, num_clients);
+        server_metrics_set_gauge(METRIC_QUEUED_PLAYERS, match_queue.queued);
+    }
+}
+
+// --- End Server Metrics ---
+
+// Function to pass a decoded move (NULL if undecodable) on, if it is the player's turn
+static void dispatch_move_request(GameRoom *room, PlayerState *player, const ClientMovePayload *move_payload)
+{
+    if (room != NULL && player->state == P_PLAYING && room->current_turn_player_index != -1 &&
+        room->players[room->current_turn_player_index].socket_fd == player->socket_fd)
+    {
+        process_move_request(room, player, move_payload);
+    }
+    else
+    {
+        fprintf(stderr, "Server: Move received from %s but not their turn or not playing.\n", player->username);
+    }
+}
+
+// Function to process every complete message buffered for a player connection
+// 'room' is NULL for a lobby connection. Returns 1 if the connection left this slot
+// (disconnect, game over, seated in a room, spectating), 0 once the buffer is drained.
+int process_buffered_client_messages(GameRoom *room, PlayerState *player)
+{
+    int client_socket = player->socket_fd;
+    const char *json_message;
+    size_t message_len;
+    int framer_status;
+
+    // Stop as soon as the slot stops belonging to this socket. The framing is checked for
+    // every message: the bytes after a 'register' asking for frames are already framed.
+    while (player->socket_fd == client_socket &&
+           (framer_status = player->wire_format == WIRE_FORMAT_FRAMES
+                                ? line_framer_next_frame(&player->recv_framer, &json_message, &message_len)
+                                : line_framer_next(&player->recv_framer, &json_message, &message_len)) != LINE_FRAMER_NONE)
+    {
+        if (framer_status == LINE_FRAMER_OVERSIZED)
+        {
+            fprintf(stderr, "Server: Dropped a message longer than %d bytes from %s (socket %d).\n",
+                    PLAYER_RECV_BUFFER_MAX_LEN - 1, player->username[0] ? player->username : "N/A", client_socket);
+            continue;
+        }
+
+        player->last_message_time = time(NULL);
+
+        if (player->wire_format == WIRE_FORMAT_FRAMES)
+        {
+            uint64_t parse_start_ns = server_metrics_now_ns();
+            server_metrics_add(METRIC_MESSAGES_IN, 1);
+            WireMessage frame;
+            if (wire_decode((const unsigned char *)json_message, message_len, &frame) != 0)
+            {
+                fprintf(stderr, "Server: Undecodable frame (type %d, %zu bytes) from %s.\n",
+                        (unsigned char)json_message[0], message_len, player->username);
+                continue;
+            }
+            if (frame.type == WIRE_FRAME_MOVE)
+            {
+                ClientMovePayload move_payload = {.sx = frame.move[0], .sy = frame.move[1], .tx = frame.move[2], .ty = frame.move[3]};
+                server_metrics_observe(METRIC_PARSE_NS, server_metrics_now_ns() - parse_start_ns);
+                dispatch_move_request(room, player, &move_payload);
+                continue;
+            }
+            if (frame.type != WIRE_FRAME_JSON)
+            {
+                fprintf(stderr, "Server: Unexpected frame type %d from %s.\n", frame.type, player->username);
+                continue;
+            }
+            json_message = frame.text; // Any other message is JSON inside a frame
+            message_len = frame.text_len;
+        }
+
+        SERVER_LOG(SERVER_LOG_DEBUG, "Processing message from socket %d: %.*s",
+                   client_socket, (int)message_len, json_message);
+
+        MessageType msg_type;
+        const char *msg_type_str;
+        cJSON *message = parse_message_with_type(json_message, message_len, &msg_type, &msg_type_str);
+        if (message == NULL)
+        {
+            fprintf(stderr, "Server: Could not determine message type from: %.*s. Player: %s\n", (int)message_len, json_message, player->username);
+            continue;
+        }
+
+        ClientSpectatePayload spectate_payload;
+        ClientMovePayload move_payload;
+        switch (msg_type)
+        {
+        case MSG_REGISTER:
+            process_registration_request(player, message);
+            break;
+        case MSG_MOVE:
+            dispatch_move_request(room, player, deserialize_client_move(message, &move_payload) == 0 ? &move_payload : NULL);
+            break;
+        case MSG_STATS:
+            send_stats_report(player);
+            break;
+        case MSG_RESUME:
+            if (room != NULL)
+            {
+                fprintf(stderr, "Server: Player %s is already seated and cannot resume.\n", player->username);
+            }
+            else
+            {
+                process_resume_request(player, message);
+            }
+            break;
+        case MSG_SPECTATE:
+            if (room != NULL || player->state != P_CONNECTED)
+            {
+                fprintf(stderr, "Server: Registered player %s cannot spectate.\n", player->username);
+            }
+            else
+            {
+                deserialize_client_spectate(message, &spectate_payload);
+                move_player_to_spectators(player, spectate_payload.room);
+            }
+            break;
+        default:
+            fprintf(stderr, "Server: Unknown message type '%s' from %s.\n", msg_type_str, player->username);
+            break;
+        }
+        release_message(message);
+    }
+    return player->socket_fd != client_socket;
+}
+
+// Function to process buffered messages wherever the connection currently lives
+// A message can move a connection between the lobby, a room and the spectator table;
+// its buffered bytes move with it and are processed in the new table.
+void process_buffered_messages_for_fd(int client_socket)
+{
+    int moved = 1;
+    while (moved)
+    {
+        ConnectionRef conn = connection_by_fd[client_socket];
+        switch (conn.kind)
+        {
+        case CONN_LOBBY:
+            moved = process_buffered_client_messages(NULL, &lobby[conn.index]);
+            break;
+        case CONN_ROOM:
+            moved = process_buffered_client_messages(&rooms[conn.index], &rooms[conn.index].players[conn.seat]);
+            break;
+        case CONN_SPECTATOR:
+            moved = process_buffered_spectator_messages(&spectators[conn.index]);
+            break;
+        default:
+            moved = 0; // Closed
+            break;
+        }
+    }
+}
+
+// Function to handle messages from a client
+// 'room' is NULL for a lobby connection.
+void handle_client_message(GameRoom *room, PlayerState *player)
+{
+    ssize_t nbytes = line_framer_recv(&player->recv_framer, player->socket_fd);
+
+    if (nbytes <= 0)
+    {
+        if (nbytes == 0)
+        {
+            SERVER_LOG(SERVER_LOG_INFO, "Socket %d (username: %s) hung up.", player->socket_fd, player->username[0] ? player->username : "N/A");
+        }
+        else
+        {
+            perror("recv");
+        }
+        handle_client_disconnection(room, player);
+        return;
+    }
+    server_metrics_add(METRIC_BYTES_IN, (uint64_t)nbytes);
+
+    process_buffered_messages_for_fd(player->socket_fd);
+}
+
+// --- Worker Threads ---
+
+// Function to map a room id to the worker that runs it
+int worker_for_room(int room_id)
+{
+    return room_id % num_workers;
+}
+
+// Function to queue a handoff in the inbox of another worker and wake it up
+void post_handoff(ServerWorker *target, Handoff *handoff)
+{
+    handoff->next = NULL;
+    pthread_mutex_lock(&target->inbox_lock);
+    if (target->inbox_tail)
+    {
+        target->inbox_tail->next = handoff;
+    }
+    else
+    {
+        target->inbox_head = handoff;
+    }
+    target->inbox_tail = handoff;
+    pthread_mutex_unlock(&target->inbox_lock);
+
+    uint64_t one = 1;
+    if (write(target->wake_fd, &one, sizeof(one)) == -1)
+    {
+        perror("write worker wake_fd");
+    }
+}
+
+// Function to pass a spectator connection to the worker that runs a room
+void hand_off_spectator(SpectatorState *spectator, int room_id)
+{
+    Handoff *handoff = malloc(sizeof(Handoff));
+    if (handoff == NULL)
+    {
+        perror("malloc handoff");
+        remove_spectator(spectator);
+        return;
+    }
+    handoff->kind = HANDOFF_SPECTATOR;
+    handoff->room_id = room_id;
+    handoff->spectator_socket = spectator->socket_fd;
+    handoff->spectator_framer = spectator->recv_framer; // Keep pipelined bytes
+    release_spectator_slot(spectator, 0);
+    post_handoff(&workers[worker_for_room(room_id)], handoff);
+}
+
+// Function to take over the connections other workers handed to this one
+// Bytes that arrived before the handoff are processed right away, since the socket
+// may not become readable again.
+static void drain_inbox(void)
+{
+    uint64_t wakeups;
+    if (read(current_worker->wake_fd, &wakeups, sizeof(wakeups)) == -1 && errno != EAGAIN)
+    {
+        perror("read worker wake_fd");
+    }
+
+    pthread_mutex_lock(&current_worker->inbox_lock);
+    Handoff *handoff = current_worker->inbox_head;
+    current_worker->inbox_head = NULL;
+    current_worker->inbox_tail = NULL;
+    pthread_mutex_unlock(&current_worker->inbox_lock);
+
+    while (handoff)
+    {
+        Handoff *next = handoff->next;
+        if (handoff->kind == HANDOFF_PAIR)
+        {
+            int sockets[MAX_CLIENTS];
+            for (int seat = 0; seat < MAX_CLIENTS; seat++)
+            {
+                sockets[seat] = handoff->players[seat].socket_fd;
+                if (event_loop_add(&current_worker->loop, sockets[seat]) == -1)
+                {
+                    perror("event_loop_add handed-off player");
+                }
+            }
+            seat_players_in_room(handoff->room_id, handoff->players);
+            for (int seat = 0; seat < MAX_CLIENTS; seat++)
+            {
+                process_buffered_messages_for_fd(sockets[seat]);
+            }
+        }
+        else if (handoff->kind == HANDOFF_RESUME)
+        {
+            int client_socket = handoff->players[0].socket_fd;
+            if (event_loop_add(&current_worker->loop, client_socket) == -1)
+            {
+                perror("event_loop_add resuming player");
+            }
+            resume_player_in_room(handoff->room_id, &handoff->players[0]);
+            process_buffered_messages_for_fd(client_socket);
+        }
+        else
+        {
+            int client_socket = handoff->spectator_socket;
+            if (add_spectator_connection(client_socket) != 0)
+            {
+                fprintf(stderr, "Server: No spectator slot left for socket %d on worker %d.\n", client_socket, current_worker->index);
+                close(client_socket);
+            }
+            else
+            {
+                SpectatorState *spectator = &spectators[connection_by_fd[client_socket].index];
+                spectator->recv_framer = handoff->spectator_framer;
+                start_spectating(spectator, handoff->room_id);
+                process_buffered_messages_for_fd(client_socket);
+            }
+        }
+        free(handoff);
+        handoff = next;
+    }
+}
+
+// Function to create the mutex and wake-up eventfd of every worker
+// Runs on the main thread before any worker starts, so handoffs can be posted at any time.
+static int initialize_workers(int count)
+{
+    num_workers = count;
+    for (int w = 0; w < count; w++)
+    {
+        workers[w].index = w;
+        workers[w].inbox_head = NULL;
+        workers[w].inbox_tail = NULL;
+        pthread_mutex_init(&workers[w].inbox_lock, NULL);
+        workers[w].wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (workers[w].wake_fd == -1)
+        {
+            perror("eventfd");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to allocate the per-thread tables and the event loop of the calling worker
+static int initialize_worker_state(ServerWorker *worker, EventLoopBackend backend)
+{
+    current_worker = worker;
+    server_metrics_register_thread();
+    rooms = calloc(MAX_ROOMS, sizeof(GameRoom));
+    connection_by_fd = calloc((size_t)max_connection_fds, sizeof(ConnectionRef)); // CONN_NONE
+    if (!rooms || !connection_by_fd)
+    {
+        perror("calloc worker tables");
+        return -1;
+    }
+    initialize_rooms();
+    if (grow_spectator_table() != 0)
+    {
+        return -1;
+    }
+
+    if (event_loop_init(&worker->loop, backend, max_connection_fds) != 0 || event_loop_add(&worker->loop, worker->wake_fd) == -1)
     {
-        if (players[i].socket_fd != -1)
+        perror("event loop setup");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to run the event loop of the calling worker forever
+static void run_worker_loop(void)
+{
+    int ready_fds[EVENT_BATCH_SIZE];
+    time_t last_timeout_check = 0;
+    while (1)
+    {
+        // Wake up at least every second to check for timeouts and widened match windows
+        int num_ready = event_loop_wait(&current_worker->loop, ready_fds, EVENT_BATCH_SIZE, 1000);
+        if (num_ready < 0)
+        {
+            perror("event_loop_wait");
+            exit(4);
+        }
+
+        // Turn timeouts have a one-second resolution, so the rooms are scanned once per second
+        time_t now = time(NULL);
+        if (now != last_timeout_check)
+        {
+            last_timeout_check = now;
+            check_turn_timeouts();
+        }
+        if (current_worker->index == 0)
+        {
+            run_matchmaking();
+        }
+
+        // New sockets (accepted or handed over) are only registered after the batch, so a
+        // recycled socket number cannot pick up a stale readiness event from this batch.
+        int listener_ready = 0;
+        int stats_ready = 0;
+        int inbox_ready = 0;
+        for (int k = 0; k < num_ready; k++)
+        {
+            int fd = ready_fds[k];
+            if (fd == current_worker->wake_fd)
+            {
+                inbox_ready = 1;
+                continue;
+            }
+            if (current_worker->index == 0 && fd == listener_fd)
+            {
+                listener_ready = 1;
+                continue;
+            }
+            if (current_worker->index == 0 && fd == stats_listener_fd)
+            {
+                stats_ready = 1;
+                continue;
+            }
+
+            // Handle data from an existing connection, wherever it currently lives
+            ConnectionRef conn = connection_by_fd[fd];
+            switch (conn.kind)
+            {
+            case CONN_LOBBY:
+                handle_client_message(NULL, &lobby[conn.index]);
+                break;
+            case CONN_ROOM:
+                handle_client_message(&rooms[conn.index], &rooms[conn.index].players[conn.seat]);
+                break;
+            case CONN_SPECTATOR:
+                handle_spectator_message(&spectators[conn.index]);
+                break;
+            default:
+                break; // Closed or handed off earlier in this batch
+            }
+        }
+
+        if (inbox_ready)
+        {
+            drain_inbox();
+        }
+        if (listener_ready)
+        {
+            accept_new_connection(listener_fd);
+        }
+        if (stats_ready)
+        {
+            serve_stats_connection(stats_listener_fd);
+        }
+        update_worker_gauges();
+    }
+}
+
+// Entry point of worker threads 1 .. num_workers - 1
+static void *worker_thread_main(void *arg)
+{
+    ServerWorker *worker = arg;
+    if (initialize_worker_state(worker, event_loop_default_backend()) != 0)
+    {
+        fprintf(stderr, "Failed to initialize worker %d. Exiting.\n", worker->index);
+        exit(1);
+    }
+    restore_snapshot_rooms();
+    run_worker_loop();
+    return NULL;
+}
+
+// Function to raise the open file limit as far as allowed and size the socket tables to it
+static void size_connection_tables(EventLoopBackend backend)
+{
+    struct rlimit limit;
+    max_connection_fds = FD_SETSIZE;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        if (limit.rlim_cur < limit.rlim_max)
+        {
+            limit.rlim_cur = limit.rlim_max;
+            if (setrlimit(RLIMIT_NOFILE, &limit) == -1)
+            {
+                perror("setrlimit RLIMIT_NOFILE");
+                getrlimit(RLIMIT_NOFILE, &limit);
+            }
+        }
+        max_connection_fds = limit.rlim_cur > MAX_CONNECTION_FDS ? MAX_CONNECTION_FDS : (int)limit.rlim_cur;
+    }
+    if (backend == EVENT_LOOP_SELECT && max_connection_fds > FD_SETSIZE)
+    {
+        max_connection_fds = FD_SETSIZE;
+    }
+}
+
+// --- End Worker Threads ---
+
+int main(int argc, char *argv[])
+{
+    const char *port = SERVER_PORT;
+    const char *stats_socket_path = NULL;
+    const char *journal_path = NULL;
+    const char *snapshot_path = NULL;
+    long worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (worker_count < 1)
+    {
+        worker_count = 1;
+    }
+    if (worker_count > MAX_WORKERS)
+    {
+        worker_count = MAX_WORKERS;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-workers") == 0 && i + 1 < argc)
+        {
+            char *end;
+            worker_count = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || worker_count < 1 || worker_count > MAX_WORKERS)
+            {
+                fprintf(stderr, "Invalid worker count '%s' (1-%d).\n", argv[i], MAX_WORKERS);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-stats-socket") == 0 && i + 1 < argc)
+        {
+            stats_socket_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-journal") == 0 && i + 1 < argc)
+        {
+            journal_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-snapshot") == 0 && i + 1 < argc)
+        {
+            snapshot_path = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-workers N] [-stats-socket PATH] [-journal PATH] [-snapshot PATH]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    json_arena_install(); // Messages are parsed in per-thread arenas, see release_message()
+    server_log_init();
+    atexit(server_log_shutdown); // Flush queued records on exit()
+    signal(SIGPIPE, SIG_IGN);    // A peer that vanished must not take every worker down with it
+
+    EventLoopBackend backend = event_loop_default_backend();
+    size_connection_tables(backend);
+    lobby = calloc(MAX_LOBBY_CONNECTIONS, sizeof(PlayerState));
+    if (lobby == NULL || initialize_workers((int)worker_count) != 0 ||
+        initialize_worker_state(&workers[0], backend) != 0)
+    {
+        fprintf(stderr, "Failed to initialize the server state. Exiting.\n");
+        exit(1);
+    }
+    initialize_player_states(lobby, MAX_LOBBY_CONNECTIONS);
+    if (match_queue_init(&match_queue, MAX_LOBBY_CONNECTIONS) != 0 || rating_table_init(&ratings) != 0)
+    {
+        fprintf(stderr, "Failed to allocate the matchmaking queue. Exiting.\n");
+        exit(1);
+    }
+
+    listener_fd = initialize_server_socket(port);
+    if (listener_fd == -1 || event_loop_add(&workers[0].loop, listener_fd) == -1)
+    {
+        fprintf(stderr, "Failed to initialize server socket. Exiting.\n");
+        exit(1);
+    }
+
+    if (journal_path)
+    {
+        if (game_journal_open(journal_path) != 0)
+        {
+            fprintf(stderr, "Failed to open the game journal. Exiting.\n");
+            exit(1);
+        }
+        SERVER_LOG(SERVER_LOG_INFO, "Recording finished games to %s", journal_path);
+    }
+
+    if (snapshot_path)
+    {
+        if (game_snapshot_open(snapshot_path, num_workers * MAX_ROOMS) != 0)
+        {
+            fprintf(stderr, "Failed to open the snapshot file. Exiting.\n");
+            exit(1);
+        }
+        // Reserve the names of restored games for 'resume' and keep new room ids unique
+        for (int i = 0; i < game_snapshot_restored_count(); i++)
+        {
+            const GameSnapshotRoom *saved = game_snapshot_restored(i);
+            for (int seat = 0; seat < MAX_CLIENTS; seat++)
+            {
+                RatingRecord *record = saved->seat_present[seat] ? rating_table_get(&ratings, saved->names[seat]) : NULL;
+                if (record)
+                {
+                    record->resume_room_id = (int)saved->room_id;
+                }
+            }
+            if ((int)saved->room_id >= next_room_id)
+            {
+                next_room_id = (int)saved->room_id + 1;
+            }
+        }
+        SERVER_LOG(SERVER_LOG_INFO, "Snapshotting running games to %s (%d restored)", snapshot_path, game_snapshot_restored_count());
+        restore_snapshot_rooms();
+    }
+
+    if (stats_socket_path)
+    {
+        stats_listener_fd = initialize_stats_socket(stats_socket_path);
+        if (stats_listener_fd == -1 || event_loop_add(&workers[0].loop, stats_listener_fd) == -1)
+        {
+            fprintf(stderr, "Failed to open the stats socket. Exiting.\n");
+            exit(1);
+        }
+        SERVER_LOG(SERVER_LOG_INFO, "Serving metrics on %s", stats_socket_path);
+    }
+
+    for (int w = 1; w < num_workers; w++)
+    {
+        if (pthread_create(&workers[w].thread, NULL, worker_thread_main, &workers[w]) != 0)
         {
-            close(players[i].socket_fd);
+            fprintf(stderr, "Failed to start worker %d. Exiting.\n", w);
+            exit(1);
         }
     }
 
+    SERVER_LOG(SERVER_LOG_INFO, "Listening on port %s with %d worker(s) (%s, up to %d sockets)...",
+               port, num_workers, event_loop_backend_name(workers[0].loop.backend), max_connection_fds);
+
+    run_worker_loop();
+
+    // Cleanup (currently unreachable in this infinite loop)
+    close(listener_fd);
+    match_queue_free(&match_queue);
+    rating_table_free(&ratings);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,379 @@
+#include "server_log.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_MASK (SERVER_LOG_RING_SLOTS - 1)
+
+#if (SERVER_LOG_RING_SLOTS & RING_MASK) != 0
+#error "SERVER_LOG_RING_SLOTS must be a power of two"
+#endif
+
+#define LOG_PLAYER_MAX 32
+#define LOG_STATUS_MAX 32
+#define WRITER_BUFFER_SIZE 65536
+#define WRITER_MAX_IDLE_SLEEP_NS 20000000L // Upper bound on how late an idle writer notices new records
+
+typedef enum
+{
+    RECORD_TEXT,
+    RECORD_MOVE
+} RecordKind;
+
+typedef struct
+{
+    char player[LOG_PLAYER_MAX];
+    char status[LOG_STATUS_MAX];
+    signed char sx, sy, tx, ty;
+    char board[64];
+} MoveRecord;
+
+// One ring slot. 'sequence' tells producers and the writer who owns the slot
+// (bounded MPMC queue by D. Vyukov, used here with a single consumer).
+typedef struct
+{
+    _Atomic size_t sequence;
+    struct timespec timestamp;
+    unsigned char level;
+    unsigned char kind;
+    union
+    {
+        char text[SERVER_LOG_TEXT_MAX];
+        MoveRecord move;
+    } body;
+} LogRecord;
+
+int server_log_level = SERVER_LOG_INFO;
+
+static LogRecord log_ring[SERVER_LOG_RING_SLOTS];
+static _Atomic size_t enqueue_pos;
+static size_t dequeue_pos; // Only touched by the writer thread
+static _Atomic unsigned long dropped_records;
+static _Atomic int writer_running;
+static _Atomic int writer_stop;
+static pthread_t writer_thread;
+
+static const char *level_names[] = {"debug", "info", "warn", "error", "off"};
+
+// Function to map OCTAFLIP_LOG_LEVEL to a level, keeping the default on unknown input
+static int parse_log_level(const char *value, int fallback)
+{
+    if (value == NULL)
+        return fallback;
+    for (int i = SERVER_LOG_DEBUG; i <= SERVER_LOG_OFF; ++i)
+    {
+        if (strcasecmp(value, level_names[i]) == 0)
+            return i;
+    }
+    fprintf(stderr, "Server: Unknown OCTAFLIP_LOG_LEVEL '%s', using '%s'.\n", value, level_names[fallback]);
+    return fallback;
+}
+
+// Function to claim a free slot, or NULL if the ring is full
+static LogRecord *claim_slot(size_t *out_pos)
+{
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    for (;;)
+    {
+        LogRecord *record = &log_ring[pos & RING_MASK];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *out_pos = pos;
+                return record;
+            }
+        }
+        else if (diff < 0)
+        {
+            atomic_fetch_add_explicit(&dropped_records, 1, memory_order_relaxed);
+            return NULL;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Function to hand a filled slot over to the writer
+static void publish_slot(LogRecord *record, size_t pos)
+{
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+}
+
+// Function to append a JSON string literal (with quotes) to the output buffer
+static size_t append_json_string(char *out, size_t out_size, const char *text, size_t text_max)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    size_t used = 0;
+    if (used < out_size)
+        out[used++] = '"';
+    for (size_t i = 0; i < text_max && text[i] != '\0'; ++i)
+    {
+        unsigned char c = (unsigned char)text[i];
+        if (used + 6 >= out_size)
+            break;
+        if (c == '"' || c == '\\')
+        {
+            out[used++] = '\\';
+            out[used++] = (char)c;
+        }
+        else if (c == '\n')
+        {
+            out[used++] = '\\';
+            out[used++] = 'n';
+        }
+        else if (c < 0x20)
+        {
+            memcpy(out + used, "\\u00", 4);
+            out[used + 4] = hex_digits[c >> 4];
+            out[used + 5] = hex_digits[c & 0xF];
+            used += 6;
+        }
+        else
+        {
+            out[used++] = (char)c;
+        }
+    }
+    if (used < out_size)
+        out[used++] = '"';
+    return used;
+}
+
+// Function to render one record as a JSON line. Returns its length.
+static size_t format_record(const LogRecord *record, char *out, size_t out_size)
+{
+    struct tm utc;
+    char time_text[32];
+    gmtime_r(&record->timestamp.tv_sec, &utc);
+    strftime(time_text, sizeof(time_text), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    int written = snprintf(out, out_size, "{\"ts\":\"%s.%06ldZ\",\"level\":\"%s\",",
+                           time_text, record->timestamp.tv_nsec / 1000, level_names[record->level]);
+    size_t used = (size_t)written;
+
+    if (record->kind == RECORD_TEXT)
+    {
+        used += (size_t)snprintf(out + used, out_size - used, "\"msg\":");
+        used += append_json_string(out + used, out_size - used, record->body.text, SERVER_LOG_TEXT_MAX);
+    }
+    else
+    {
+        const MoveRecord *move = &record->body.move;
+        used += (size_t)snprintf(out + used, out_size - used, "\"event\":\"move\",\"player\":");
+        used += append_json_string(out + used, out_size - used, move->player, LOG_PLAYER_MAX);
+        if (move->sx == 0 && move->sy == 0 && move->tx == 0 && move->ty == 0 && strstr(move->status, "Pass") != NULL)
+        {
+            used += (size_t)snprintf(out + used, out_size - used, ",\"move\":\"pass\"");
+        }
+        else if (!(move->sx == -1 && move->sy == -1 && move->tx == -1 && move->ty == -1))
+        {
+            // 1-indexed, like the protocol
+            used += (size_t)snprintf(out + used, out_size - used, ",\"move\":[%d,%d,%d,%d]",
+                                     move->sx + 1, move->sy + 1, move->tx + 1, move->ty + 1);
+        }
+        used += (size_t)snprintf(out + used, out_size - used, ",\"status\":");
+        used += append_json_string(out + used, out_size - used, move->status, LOG_STATUS_MAX);
+        used += (size_t)snprintf(out + used, out_size - used, ",\"board\":\"%.64s\"", move->board);
+    }
+    used += (size_t)snprintf(out + used, out_size - used, "}\n");
+    return used < out_size ? used : out_size - 1;
+}
+
+// Function to write a whole buffer, retrying on short writes
+static void write_fully(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n <= 0)
+            return; // Nothing sensible to do if stdout is gone
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Function to write a record directly when the writer thread is not running
+static void write_record_now(const LogRecord *record)
+{
+    char line[1024];
+    size_t len = format_record(record, line, sizeof(line));
+    write_fully(line, len);
+}
+
+// Background writer: drains the ring in order, batching lines into few write() calls
+static void *writer_main(void *arg)
+{
+    static char out[WRITER_BUFFER_SIZE];
+    size_t out_used = 0;
+    unsigned long reported_drops = 0;
+    long idle_sleep_ns = 1000000L;
+
+    for (;;)
+    {
+        int drained_any = 0;
+        for (;;)
+        {
+            LogRecord *record = &log_ring[dequeue_pos & RING_MASK];
+            size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+            if (sequence != dequeue_pos + 1)
+                break; // Empty, or the producer has not finished filling the slot
+
+            if (WRITER_BUFFER_SIZE - out_used < 1024)
+            {
+                write_fully(out, out_used);
+                out_used = 0;
+            }
+            out_used += format_record(record, out + out_used, WRITER_BUFFER_SIZE - out_used);
+            atomic_store_explicit(&record->sequence, dequeue_pos + SERVER_LOG_RING_SLOTS, memory_order_release);
+            dequeue_pos++;
+            drained_any = 1;
+        }
+
+        unsigned long drops = atomic_load_explicit(&dropped_records, memory_order_relaxed);
+        if (drops != reported_drops)
+        {
+            LogRecord notice;
+            clock_gettime(CLOCK_REALTIME, &notice.timestamp);
+            notice.level = SERVER_LOG_WARN;
+            notice.kind = RECORD_TEXT;
+            snprintf(notice.body.text, sizeof(notice.body.text), "Log ring full: dropped %lu records", drops - reported_drops);
+            reported_drops = drops;
+            out_used += format_record(&notice, out + out_used, WRITER_BUFFER_SIZE - out_used);
+        }
+
+        if (out_used > 0)
+        {
+            write_fully(out, out_used);
+            out_used = 0;
+        }
+
+        if (drained_any)
+        {
+            idle_sleep_ns = 1000000L;
+            continue;
+        }
+        if (atomic_load_explicit(&writer_stop, memory_order_acquire))
+            break;
+
+        struct timespec pause = {0, idle_sleep_ns};
+        nanosleep(&pause, NULL);
+        if (idle_sleep_ns < WRITER_MAX_IDLE_SLEEP_NS)
+            idle_sleep_ns *= 2;
+    }
+    return NULL;
+}
+
+int server_log_init(void)
+{
+    server_log_level = parse_log_level(getenv("OCTAFLIP_LOG_LEVEL"), SERVER_LOG_INFO);
+
+    for (size_t i = 0; i < SERVER_LOG_RING_SLOTS; ++i)
+    {
+        atomic_store_explicit(&log_ring[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store(&enqueue_pos, 0);
+    dequeue_pos = 0;
+    atomic_store(&writer_stop, 0);
+
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0)
+    {
+        fprintf(stderr, "Server: Could not start the log writer thread; logging synchronously.\n");
+        return -1;
+    }
+    atomic_store_explicit(&writer_running, 1, memory_order_release);
+    return 0;
+}
+
+void server_log_shutdown(void)
+{
+    if (!atomic_exchange(&writer_running, 0))
+        return;
+    atomic_store_explicit(&writer_stop, 1, memory_order_release);
+    pthread_join(writer_thread, NULL);
+}
+
+void server_log_text(ServerLogLevel level, const char *format, ...)
+{
+    va_list args;
+    if (!atomic_load_explicit(&writer_running, memory_order_acquire))
+    {
+        LogRecord record;
+        clock_gettime(CLOCK_REALTIME, &record.timestamp);
+        record.level = (unsigned char)level;
+        record.kind = RECORD_TEXT;
+        va_start(args, format);
+        vsnprintf(record.body.text, sizeof(record.body.text), format, args);
+        va_end(args);
+        write_record_now(&record);
+        return;
+    }
+
+    size_t pos;
+    LogRecord *record = claim_slot(&pos);
+    if (record == NULL)
+        return;
+    clock_gettime(CLOCK_REALTIME, &record->timestamp);
+    record->level = (unsigned char)level;
+    record->kind = RECORD_TEXT;
+    va_start(args, format);
+    vsnprintf(record->body.text, sizeof(record->body.text), format, args);
+    va_end(args);
+    publish_slot(record, pos);
+}
+
+// Function to fill the raw fields of a move record
+static void fill_move_record(LogRecord *record, ServerLogLevel level, const char *player_username, int sx, int sy, int tx, int ty, const char *status, char board[8][9])
+{
+    MoveRecord *move = &record->body.move;
+    clock_gettime(CLOCK_REALTIME, &record->timestamp);
+    record->level = (unsigned char)level;
+    record->kind = RECORD_MOVE;
+    snprintf(move->player, sizeof(move->player), "%s", player_username ? player_username : "N/A");
+    snprintf(move->status, sizeof(move->status), "%s", status ? status : "");
+    move->sx = (signed char)sx;
+    move->sy = (signed char)sy;
+    move->tx = (signed char)tx;
+    move->ty = (signed char)ty;
+    for (int i = 0; i < 8; ++i)
+    {
+        memcpy(move->board + i * 8, board[i], 8);
+    }
+}
+
+void server_log_move(ServerLogLevel level, const char *player_username, int sx, int sy, int tx, int ty, const char *status, char board[8][9])
+{
+    if ((int)level < server_log_level)
+        return;
+
+    if (!atomic_load_explicit(&writer_running, memory_order_acquire))
+    {
+        LogRecord record;
+        fill_move_record(&record, level, player_username, sx, sy, tx, ty, status, board);
+        write_record_now(&record);
+        return;
+    }
+
+    size_t pos;
+    LogRecord *record = claim_slot(&pos);
+    if (record == NULL)
+        return;
+    fill_move_record(record, level, player_username, sx, sy, tx, ty, status, board);
+    publish_slot(record, pos);
+}
+
+unsigned long server_log_dropped_count(void)
+{
+    return atomic_load_explicit(&dropped_records, memory_order_relaxed);
+}
@@ -0,0 +1,84 @@
+#ifndef SERVER_LOG_H
+#define SERVER_LOG_H
+
+// Asynchronous structured logger for the server.
+// Callers only format into a slot of a lock-free ring buffer; a background writer thread
+// turns the records into JSON lines and writes them to stdout, so logging never blocks
+// the event loop. When the ring is full, records are dropped and counted instead.
+//
+// Log level is read from the OCTAFLIP_LOG_LEVEL environment variable:
+// debug, info (default), warn, error or off.
+
+// Number of records the ring can hold. Must be a power of two.
+#define SERVER_LOG_RING_SLOTS 4096
+// Longest formatted message kept per record, including the NUL. Longer messages are truncated.
+#define SERVER_LOG_TEXT_MAX 224
+
+typedef enum
+{
+    SERVER_LOG_DEBUG = 0,
+    SERVER_LOG_INFO,
+    SERVER_LOG_WARN,
+    SERVER_LOG_ERROR,
+    SERVER_LOG_OFF
+} ServerLogLevel;
+
+// Records below this level are discarded by SERVER_LOG() before any formatting happens
+extern int server_log_level;
+
+// Logs a printf-style message. Arguments are not evaluated when the level is disabled.
+#define SERVER_LOG(level, ...)                      \
+    do                                              \
+    {                                               \
+        if ((int)(level) >= server_log_level)       \
+            server_log_text((level), __VA_ARGS__);  \
+    } while (0)
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Reads OCTAFLIP_LOG_LEVEL and starts the writer thread.
+ *
+ * Until this is called (or if the thread cannot be started), records are written
+ * synchronously by the calling thread.
+ *
+ * @return int 0 on success, -1 if the writer thread could not be started.
+ */
+int server_log_init(void);
+
+/**
+ * @brief Stops the writer thread after it has written every queued record.
+ */
+void server_log_shutdown(void);
+
+/**
+ * @brief Queues a formatted message. Prefer the SERVER_LOG() macro.
+ *
+ * @param level Level of the record.
+ * @param format printf-style format string.
+ */
+void server_log_text(ServerLogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Queues a move record with a compact 64-character copy of the board.
+ *
+ * Only raw fields are copied on the calling thread; the JSON is produced by the writer.
+ * Coordinates are 0-indexed; all -1 means "no move", all 0 with a pass status means a pass.
+ *
+ * @param level Level of the record.
+ * @param player_username Player who made the move (may be NULL).
+ * @param sx Source row.
+ * @param sy Source column.
+ * @param tx Target row.
+ * @param ty Target column.
+ * @param status Short description of the outcome, e.g. "Valid Move".
+ * @param board The board after the move.
+ */
+void server_log_move(ServerLogLevel level, const char *player_username, int sx, int sy, int tx, int ty, const char *status, char board[8][9]);
+
+/**
+ * @brief Returns how many records were dropped because the ring was full.
+ */
+unsigned long server_log_dropped_count(void);
+
+#endif // SERVER_LOG_H
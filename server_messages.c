@@ -0,0 +1,784 @@
+#include "server_messages.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+// --- Writers ---
+
+// Output of one writer. A write that does not fit sets 'failed'; the rest are then skipped.
+typedef struct
+{
+    char *out;
+    size_t size; // Room for the text and its NUL
+    size_t len;
+    int failed;
+} JsonOut;
+
+static void put_bytes(JsonOut *o, const char *bytes, size_t n)
+{
+    if (o->failed || o->len + n >= o->size)
+    {
+        o->failed = 1;
+        return;
+    }
+    memcpy(o->out + o->len, bytes, n);
+    o->len += n;
+}
+
+// Keys and punctuation are compile-time literals
+#define PUT_LITERAL(o, literal) put_bytes((o), (literal), sizeof(literal) - 1)
+
+// Writes a quoted string, escaped exactly like cJSON's print_string_ptr()
+static void put_string(JsonOut *o, const char *s)
+{
+    PUT_LITERAL(o, "\"");
+    const char *run = s;
+    for (const unsigned char *p = (const unsigned char *)s; *p != '\0'; p++)
+    {
+        if (*p >= 32 && *p != '"' && *p != '\\')
+        {
+            continue;
+        }
+        put_bytes(o, run, (size_t)((const char *)p - run));
+        run = (const char *)p + 1;
+        switch (*p)
+        {
+        case '"':
+            PUT_LITERAL(o, "\\\"");
+            break;
+        case '\\':
+            PUT_LITERAL(o, "\\\\");
+            break;
+        case '\b':
+            PUT_LITERAL(o, "\\b");
+            break;
+        case '\f':
+            PUT_LITERAL(o, "\\f");
+            break;
+        case '\n':
+            PUT_LITERAL(o, "\\n");
+            break;
+        case '\r':
+            PUT_LITERAL(o, "\\r");
+            break;
+        case '\t':
+            PUT_LITERAL(o, "\\t");
+            break;
+        default:
+        {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *p);
+            put_bytes(o, escaped, 6);
+            break;
+        }
+        }
+    }
+    put_bytes(o, run, strlen(run));
+    PUT_LITERAL(o, "\"");
+}
+
+// Writes a number like cJSON's print_number(): integral values (as cJSON stores them in
+// 'valueint') with %d, others with the shortest of %1.15g and %1.17g that reads back.
+static void put_number(JsonOut *o, double d)
+{
+    char digits[26];
+    int n;
+    int as_int = d >= INT_MAX ? INT_MAX : d <= (double)INT_MIN ? INT_MIN : (int)d;
+    if (isnan(d) || isinf(d))
+    {
+        PUT_LITERAL(o, "null");
+        return;
+    }
+    if (d == (double)as_int)
+    {
+        // Hand-rolled: the coordinates, scores and sequence numbers of every turn land here
+        unsigned magnitude = as_int < 0 ? 0u - (unsigned)as_int : (unsigned)as_int;
+        char *end = digits + sizeof(digits);
+        char *p = end;
+        do
+        {
+            *--p = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (as_int < 0)
+        {
+            *--p = '-';
+        }
+        put_bytes(o, p, (size_t)(end - p));
+        return;
+    }
+    n = snprintf(digits, sizeof(digits), "%1.15g", d);
+    double test;
+    if (sscanf(digits, "%lg", &test) != 1 || fabs(test - d) > fmax(fabs(test), fabs(d)) * DBL_EPSILON)
+    {
+        n = snprintf(digits, sizeof(digits), "%1.17g", d);
+    }
+    put_bytes(o, digits, (size_t)n);
+}
+
+static void put_board(JsonOut *o, const char board[8][9])
+{
+    PUT_LITERAL(o, "[");
+    for (int i = 0; i < 8; i++)
+    {
+        if (i > 0)
+        {
+            PUT_LITERAL(o, ",");
+        }
+        put_string(o, board[i]);
+    }
+    PUT_LITERAL(o, "]");
+}
+
+// The board of a turn message: all rows, or only the changed cells for a delta player
+static void put_board_update(JsonOut *o, const char board[8][9], const BoardUpdate *update)
+{
+    if (update->is_delta)
+    {
+        PUT_LITERAL(o, ",\"changes\":");
+        put_string(o, update->changes);
+        if (update->checksum[0] != '\0')
+        {
+            PUT_LITERAL(o, ",\"checksum\":");
+            put_string(o, update->checksum);
+        }
+        return;
+    }
+    PUT_LITERAL(o, ",\"board\":");
+    put_board(o, board);
+}
+
+static int finish(JsonOut *o)
+{
+    if (o->failed)
+    {
+        return -1;
+    }
+    o->out[o->len] = '\0';
+    return (int)o->len;
+}
+
+#define JSON_OUT(out, out_size) {(out), (out_size), 0, (out_size) == 0}
+
+int write_server_your_turn(const ServerYourTurnPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    put_board_update(&o, payload->board, &payload->board_update);
+    PUT_LITERAL(&o, ",\"timeout\":");
+    put_number(&o, payload->timeout);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_move_ok(const ServerMoveOkPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    put_board_update(&o, payload->board, &payload->board_update);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_invalid_move(const ServerInvalidMovePayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    put_board_update(&o, payload->board, &payload->board_update);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_pass(const ServerPassPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_game_over(const ServerGameOverPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"scores\":{");
+    int written = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (payload->scores[i].username[0] == '\0')
+        {
+            continue;
+        }
+        if (written++ > 0)
+        {
+            PUT_LITERAL(&o, ",");
+        }
+        put_string(&o, payload->scores[i].username);
+        PUT_LITERAL(&o, ":");
+        put_number(&o, payload->scores[i].score);
+    }
+    PUT_LITERAL(&o, "}}");
+    return finish(&o);
+}
+
+int write_server_register_ack(const ServerRegisterAckPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"session_token\":");
+    put_string(&o, payload->session_token);
+    if (payload->wire[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"wire\":");
+        put_string(&o, payload->wire);
+    }
+    if (payload->board_updates[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"board_updates\":");
+        put_string(&o, payload->board_updates);
+    }
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_register_nack(const ServerRegisterNackPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"reason\":");
+    put_string(&o, payload->reason);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_game_start(const ServerGameStartPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"players\":[");
+    put_string(&o, payload->players[0]);
+    PUT_LITERAL(&o, ",");
+    put_string(&o, payload->players[1]);
+    PUT_LITERAL(&o, "],\"first_player\":");
+    put_string(&o, payload->first_player);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_resume_ack(const ServerResumeAckPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"room\":");
+    put_number(&o, payload->room);
+    PUT_LITERAL(&o, ",\"players\":[");
+    put_string(&o, payload->players[0]);
+    PUT_LITERAL(&o, ",");
+    put_string(&o, payload->players[1]);
+    PUT_LITERAL(&o, "],\"board\":");
+    put_board(&o, payload->board);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    PUT_LITERAL(&o, ",\"timeout\":");
+    put_number(&o, payload->timeout);
+    if (payload->wire[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"wire\":");
+        put_string(&o, payload->wire);
+    }
+    if (payload->board_updates[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"board_updates\":");
+        put_string(&o, payload->board_updates);
+    }
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_resume_nack(const ServerResumeNackPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"reason\":");
+    put_string(&o, payload->reason);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_spectate_snapshot(const ServerSpectateSnapshotPayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"room\":");
+    put_number(&o, payload->room);
+    PUT_LITERAL(&o, ",\"seq\":");
+    put_number(&o, (double)payload->seq);
+    if (payload->game_active)
+    {
+        PUT_LITERAL(&o, ",\"game_active\":true,\"players\":[");
+    }
+    else
+    {
+        PUT_LITERAL(&o, ",\"game_active\":false,\"players\":[");
+    }
+    int written = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (payload->players[i][0] == '\0')
+        {
+            continue;
+        }
+        if (written++ > 0)
+        {
+            PUT_LITERAL(&o, ",");
+        }
+        put_string(&o, payload->players[i]);
+    }
+    PUT_LITERAL(&o, "],\"board\":");
+    put_board(&o, payload->board);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+int write_server_spectate_update(const ServerSpectateUpdatePayload *payload, char *out, size_t out_size)
+{
+    JsonOut o = JSON_OUT(out, out_size);
+    PUT_LITERAL(&o, "{\"type\":");
+    put_string(&o, payload->type);
+    PUT_LITERAL(&o, ",\"room\":");
+    put_number(&o, payload->room);
+    PUT_LITERAL(&o, ",\"seq\":");
+    put_number(&o, (double)payload->seq);
+    PUT_LITERAL(&o, ",\"event\":");
+    put_string(&o, payload->event);
+    PUT_LITERAL(&o, ",\"player\":");
+    put_string(&o, payload->player);
+    PUT_LITERAL(&o, ",\"sx\":");
+    put_number(&o, payload->sx);
+    PUT_LITERAL(&o, ",\"sy\":");
+    put_number(&o, payload->sy);
+    PUT_LITERAL(&o, ",\"tx\":");
+    put_number(&o, payload->tx);
+    PUT_LITERAL(&o, ",\"ty\":");
+    put_number(&o, payload->ty);
+    PUT_LITERAL(&o, ",\"next_player\":");
+    put_string(&o, payload->next_player);
+    if (payload->changes[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"changes\":");
+        put_string(&o, payload->changes);
+    }
+    if (payload->checksum[0] != '\0')
+    {
+        PUT_LITERAL(&o, ",\"checksum\":");
+        put_string(&o, payload->checksum);
+    }
+    PUT_LITERAL(&o, "}");
+    return finish(&o);
+}
+
+// --- Reference Serializers (cJSON) ---
+
+// Adds the board of a turn message: all rows, or only the changed cells for a delta player
+static int add_board_update_to_json(cJSON *root, const char board[8][9], const BoardUpdate *update)
+{
+    if (update->is_delta)
+    {
+        if (cJSON_AddStringToObject(root, "changes", update->changes) == NULL)
+            return -1;
+        if (update->checksum[0] != '\0' && cJSON_AddStringToObject(root, "checksum", update->checksum) == NULL)
+            return -1;
+        return 0;
+    }
+
+    cJSON *board_array = cJSON_CreateArray();
+    if (board_array == NULL)
+        return -1;
+    for (int i = 0; i < 8; ++i)
+    {
+        cJSON *row_string = cJSON_CreateString(board[i]);
+        if (row_string == NULL)
+        {
+            cJSON_Delete(board_array);
+            return -1;
+        }
+        cJSON_AddItemToArray(board_array, row_string);
+    }
+    cJSON_AddItemToObject(root, "board", board_array);
+    return 0;
+}
+
+// Serialize ServerYourTurnPayload
+char *serialize_server_your_turn(const ServerYourTurnPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL)
+        return NULL;
+
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+        goto error;
+
+    if (add_board_update_to_json(root, payload->board, &payload->board_update) == -1)
+        goto error;
+
+    if (cJSON_AddNumberToObject(root, "timeout", payload->timeout) == NULL)
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerMoveOkPayload
+char *serialize_server_move_ok(const ServerMoveOkPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL)
+        return NULL;
+
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+        goto error;
+
+    if (add_board_update_to_json(root, payload->board, &payload->board_update) == -1)
+        goto error;
+
+    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerInvalidMovePayload
+char *serialize_server_invalid_move(const ServerInvalidMovePayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL)
+        return NULL;
+
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+        goto error;
+
+    if (add_board_update_to_json(root, payload->board, &payload->board_update) == -1)
+        goto error;
+
+    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerPassPayload
+char *serialize_server_pass(const ServerPassPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL)
+        return NULL;
+
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+        goto error;
+    if (cJSON_AddStringToObject(root, "next_player", payload->next_player) == NULL)
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerGameOverPayload
+char *serialize_server_game_over(const ServerGameOverPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL)
+        return NULL;
+
+    if (cJSON_AddStringToObject(root, "type", payload->type) == NULL)
+        goto error;
+
+    cJSON *scores_obj = cJSON_CreateObject();
+    if (scores_obj == NULL)
+        goto error;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (payload->scores[i].username[0] != '\0')
+        {
+            if (cJSON_AddNumberToObject(scores_obj, payload->scores[i].username, payload->scores[i].score) == NULL)
+            {
+                cJSON_Delete(scores_obj);
+                goto error;
+            }
+        }
+    }
+    cJSON_AddItemToObject(root, "scores", scores_obj);
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerRegisterAckPayload
+char *serialize_server_register_ack(const ServerRegisterAckPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddStringToObject(root, "session_token", payload->session_token) ||
+        (payload->wire[0] && !cJSON_AddStringToObject(root, "wire", payload->wire)) ||
+        (payload->board_updates[0] && !cJSON_AddStringToObject(root, "board_updates", payload->board_updates)))
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+}
+
+// Serialize ServerRegisterNackPayload
+char *serialize_server_register_nack(const ServerRegisterNackPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddStringToObject(root, "reason", payload->reason))
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+}
+
+// Serialize ServerGameStartPayload
+char *serialize_server_game_start(const ServerGameStartPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    if (!cJSON_AddStringToObject(root, "type", payload->type))
+        goto error;
+
+    cJSON *players_array = cJSON_CreateArray();
+    if (!players_array)
+        goto error;
+    for (int i = 0; i < 2; ++i)
+    {
+        cJSON *player_name = cJSON_CreateString(payload->players[i]);
+        if (!player_name)
+        {
+            cJSON_Delete(players_array);
+            goto error;
+        }
+        cJSON_AddItemToArray(players_array, player_name);
+    }
+    cJSON_AddItemToObject(root, "players", players_array);
+
+    if (!cJSON_AddStringToObject(root, "first_player", payload->first_player))
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerResumeAckPayload
+char *serialize_server_resume_ack(const ServerResumeAckPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddNumberToObject(root, "room", payload->room))
+        goto error;
+
+    cJSON *players_array = cJSON_CreateArray();
+    if (!players_array)
+        goto error;
+    cJSON_AddItemToObject(root, "players", players_array);
+    for (int i = 0; i < 2; ++i)
+    {
+        cJSON *player_name = cJSON_CreateString(payload->players[i]);
+        if (!player_name)
+            goto error;
+        cJSON_AddItemToArray(players_array, player_name);
+    }
+
+    cJSON *board_array = cJSON_CreateArray();
+    if (!board_array)
+        goto error;
+    cJSON_AddItemToObject(root, "board", board_array);
+    for (int i = 0; i < 8; ++i)
+    {
+        cJSON *row_string = cJSON_CreateString(payload->board[i]);
+        if (!row_string)
+            goto error;
+        cJSON_AddItemToArray(board_array, row_string);
+    }
+
+    if (!cJSON_AddStringToObject(root, "next_player", payload->next_player) ||
+        !cJSON_AddNumberToObject(root, "timeout", payload->timeout) ||
+        (payload->wire[0] && !cJSON_AddStringToObject(root, "wire", payload->wire)) ||
+        (payload->board_updates[0] && !cJSON_AddStringToObject(root, "board_updates", payload->board_updates)))
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerResumeNackPayload
+char *serialize_server_resume_nack(const ServerResumeNackPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddStringToObject(root, "reason", payload->reason))
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+}
+
+// Serialize ServerSpectateSnapshotPayload
+char *serialize_server_spectate_snapshot(const ServerSpectateSnapshotPayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddNumberToObject(root, "room", payload->room) ||
+        !cJSON_AddNumberToObject(root, "seq", (double)payload->seq) ||
+        !cJSON_AddBoolToObject(root, "game_active", payload->game_active))
+        goto error;
+
+    cJSON *players_array = cJSON_CreateArray();
+    if (!players_array)
+        goto error;
+    cJSON_AddItemToObject(root, "players", players_array);
+    for (int i = 0; i < 2; ++i)
+    {
+        if (payload->players[i][0] == '\0')
+            continue;
+        cJSON *player_name = cJSON_CreateString(payload->players[i]);
+        if (!player_name)
+            goto error;
+        cJSON_AddItemToArray(players_array, player_name);
+    }
+
+    cJSON *board_array = cJSON_CreateArray();
+    if (!board_array)
+        goto error;
+    cJSON_AddItemToObject(root, "board", board_array);
+    for (int i = 0; i < 8; ++i)
+    {
+        cJSON *row_string = cJSON_CreateString(payload->board[i]);
+        if (!row_string)
+            goto error;
+        cJSON_AddItemToArray(board_array, row_string);
+    }
+
+    if (!cJSON_AddStringToObject(root, "next_player", payload->next_player))
+        goto error;
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+
+error:
+    cJSON_Delete(root);
+    return NULL;
+}
+
+// Serialize ServerSpectateUpdatePayload
+char *serialize_server_spectate_update(const ServerSpectateUpdatePayload *payload)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    if (!cJSON_AddStringToObject(root, "type", payload->type) ||
+        !cJSON_AddNumberToObject(root, "room", payload->room) ||
+        !cJSON_AddNumberToObject(root, "seq", (double)payload->seq) ||
+        !cJSON_AddStringToObject(root, "event", payload->event) ||
+        !cJSON_AddStringToObject(root, "player", payload->player) ||
+        !cJSON_AddNumberToObject(root, "sx", payload->sx) ||
+        !cJSON_AddNumberToObject(root, "sy", payload->sy) ||
+        !cJSON_AddNumberToObject(root, "tx", payload->tx) ||
+        !cJSON_AddNumberToObject(root, "ty", payload->ty) ||
+        !cJSON_AddStringToObject(root, "next_player", payload->next_player) ||
+        (payload->changes[0] && !cJSON_AddStringToObject(root, "changes", payload->changes)) ||
+        (payload->checksum[0] && !cJSON_AddStringToObject(root, "checksum", payload->checksum)))
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json_string;
+}
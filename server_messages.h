@@ -0,0 +1,55 @@
+#ifndef SERVER_MESSAGES_H
+#define SERVER_MESSAGES_H
+
+#include <stddef.h>
+#include "protocol.h"
+
+// Encoders for the messages the server sends.
+//
+// write_server_*() emit a message straight into a caller-provided buffer, without building
+// a cJSON tree and without touching the heap. They are what the server sends with.
+// serialize_server_*() build the same message as a cJSON tree and print it (malloc'd, the
+// caller frees). They define the format: every writer produces byte for byte what its
+// serializer prints, which json_bench checks.
+
+#define SERVER_MESSAGE_MAX_LEN 2048 // Fits every message below, even with fully escaped names
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Writers: each writes one message and its terminating NUL into 'out'.
+ *
+ * @return int Length of the message without the NUL, or -1 if it does not fit in 'out_size'.
+ */
+int write_server_your_turn(const ServerYourTurnPayload *payload, char *out, size_t out_size);
+int write_server_move_ok(const ServerMoveOkPayload *payload, char *out, size_t out_size);
+int write_server_invalid_move(const ServerInvalidMovePayload *payload, char *out, size_t out_size);
+int write_server_pass(const ServerPassPayload *payload, char *out, size_t out_size);
+int write_server_game_over(const ServerGameOverPayload *payload, char *out, size_t out_size);
+int write_server_register_ack(const ServerRegisterAckPayload *payload, char *out, size_t out_size);
+int write_server_register_nack(const ServerRegisterNackPayload *payload, char *out, size_t out_size);
+int write_server_game_start(const ServerGameStartPayload *payload, char *out, size_t out_size);
+int write_server_resume_ack(const ServerResumeAckPayload *payload, char *out, size_t out_size);
+int write_server_resume_nack(const ServerResumeNackPayload *payload, char *out, size_t out_size);
+int write_server_spectate_snapshot(const ServerSpectateSnapshotPayload *payload, char *out, size_t out_size);
+int write_server_spectate_update(const ServerSpectateUpdatePayload *payload, char *out, size_t out_size);
+
+/**
+ * @brief Reference serializers built on cJSON, one per writer.
+ *
+ * @return char* Malloc'd JSON text (free() it), or NULL if cJSON ran out of memory.
+ */
+char *serialize_server_your_turn(const ServerYourTurnPayload *payload);
+char *serialize_server_move_ok(const ServerMoveOkPayload *payload);
+char *serialize_server_invalid_move(const ServerInvalidMovePayload *payload);
+char *serialize_server_pass(const ServerPassPayload *payload);
+char *serialize_server_game_over(const ServerGameOverPayload *payload);
+char *serialize_server_register_ack(const ServerRegisterAckPayload *payload);
+char *serialize_server_register_nack(const ServerRegisterNackPayload *payload);
+char *serialize_server_game_start(const ServerGameStartPayload *payload);
+char *serialize_server_resume_ack(const ServerResumeAckPayload *payload);
+char *serialize_server_resume_nack(const ServerResumeNackPayload *payload);
+char *serialize_server_spectate_snapshot(const ServerSpectateSnapshotPayload *payload);
+char *serialize_server_spectate_update(const ServerSpectateUpdatePayload *payload);
+
+#endif // SERVER_MESSAGES_H
@@ -0,0 +1,144 @@
+#include "server_metrics.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+__thread ServerMetricsShard *server_metrics_shard;
+
+static ServerMetricsShard shards[SERVER_METRICS_MAX_SHARDS];
+static _Atomic int num_shards;
+
+const char *const server_counter_names[METRIC_COUNTER_COUNT] = {
+    "connections_accepted_total",
+    "messages_in_total",
+    "bytes_in_total",
+    "bytes_out_total",
+    "games_started_total",
+    "games_finished_total",
+    "moves_total",
+    "passes_total",
+    "invalid_moves_total",
+    "timeouts_total",
+    "disconnections_total",
+    "resumes_total",
+};
+
+const char *const server_gauge_names[METRIC_GAUGE_COUNT] = {
+    "active_rooms",
+    "lobby_connections",
+    "queued_players",
+    "spectators",
+};
+
+const char *const server_histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    "parse_ns",
+    "move_validation_ns",
+    "turn_round_trip_ns",
+};
+
+int server_metrics_register_thread(void)
+{
+    if (server_metrics_shard)
+        return 0;
+    int index = atomic_fetch_add(&num_shards, 1);
+    if (index >= SERVER_METRICS_MAX_SHARDS)
+    {
+        fprintf(stderr, "Server: No metrics shard left; this thread's metrics are not recorded.\n");
+        return -1;
+    }
+    server_metrics_shard = &shards[index];
+    return 0;
+}
+
+void server_metrics_snapshot(ServerMetricsSnapshot *out)
+{
+    int count = atomic_load(&num_shards);
+    if (count > SERVER_METRICS_MAX_SHARDS)
+        count = SERVER_METRICS_MAX_SHARDS;
+
+    *out = (ServerMetricsSnapshot){0};
+    out->num_shards = count;
+    for (int s = 0; s < count; s++)
+    {
+        ServerMetricsShard *shard = &shards[s];
+        for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+            out->counters[c] += __atomic_load_n(&shard->counters[c], __ATOMIC_RELAXED);
+        for (int g = 0; g < METRIC_GAUGE_COUNT; g++)
+            out->gauges[g] += __atomic_load_n(&shard->gauges[g], __ATOMIC_RELAXED);
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+        {
+            ServerMetricsHistogram *from = &shard->histograms[h];
+            ServerMetricsHistogram *to = &out->histograms[h];
+            for (int b = 0; b < SERVER_METRICS_BUCKETS; b++)
+                to->buckets[b] += __atomic_load_n(&from->buckets[b], __ATOMIC_RELAXED);
+            to->count += __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+            to->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+            uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+            if (max > to->max)
+                to->max = max;
+        }
+    }
+}
+
+uint64_t server_metrics_quantile(const ServerMetricsHistogram *histogram, double quantile)
+{
+    // Count from the buckets rather than 'count' so a concurrent update cannot push the rank past the end
+    uint64_t total = 0;
+    for (int b = 0; b < SERVER_METRICS_BUCKETS; b++)
+        total += histogram->buckets[b];
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(quantile * (double)total);
+    if (rank >= total)
+        rank = total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < SERVER_METRICS_BUCKETS; b++)
+    {
+        seen += histogram->buckets[b];
+        if (seen > rank)
+        {
+            if (b == 0)
+                return 0;
+            uint64_t upper = (1ull << b) - 1;
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+// Function to append formatted text, keeping track of the length that would be needed
+static void append(char *buffer, size_t size, size_t *length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t room = *length < size ? size - *length : 0;
+    int written = vsnprintf(room ? buffer + *length : NULL, room, format, args);
+    va_end(args);
+    if (written > 0)
+        *length += (size_t)written;
+}
+
+size_t server_metrics_format_text(const ServerMetricsSnapshot *snapshot, char *buffer, size_t size)
+{
+    size_t length = 0;
+    append(buffer, size, &length, "# OctaFlip server metrics, %d thread(s)\n", snapshot->num_shards);
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+        append(buffer, size, &length, "%s %llu\n", server_counter_names[c], (unsigned long long)snapshot->counters[c]);
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++)
+        append(buffer, size, &length, "%s %lld\n", server_gauge_names[g], (long long)snapshot->gauges[g]);
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+    {
+        const ServerMetricsHistogram *histogram = &snapshot->histograms[h];
+        const char *name = server_histogram_names[h];
+        append(buffer, size, &length, "%s_count %llu\n", name, (unsigned long long)histogram->count);
+        append(buffer, size, &length, "%s_sum %llu\n", name, (unsigned long long)histogram->sum);
+        append(buffer, size, &length, "%s_p50 %llu\n", name, (unsigned long long)server_metrics_quantile(histogram, 0.50));
+        append(buffer, size, &length, "%s_p90 %llu\n", name, (unsigned long long)server_metrics_quantile(histogram, 0.90));
+        append(buffer, size, &length, "%s_p99 %llu\n", name, (unsigned long long)server_metrics_quantile(histogram, 0.99));
+        append(buffer, size, &length, "%s_max %llu\n", name, (unsigned long long)histogram->max);
+    }
+    if (size > 0 && length >= size)
+        buffer[size - 1] = '\0';
+    return length < size ? length : (size ? size - 1 : 0);
+}
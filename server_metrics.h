@@ -0,0 +1,151 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// In-process metrics registry for the server.
+// Every thread that records metrics owns one shard and is its only writer, so an update is
+// a plain load and store on a thread-local cache line (no lock, no atomic read-modify-write).
+// Readers sum the shards with relaxed loads; a snapshot may be a few updates behind, never torn.
+
+#define SERVER_METRICS_MAX_SHARDS 80 // Worker threads plus a margin
+#define SERVER_METRICS_BUCKETS 64    // Histogram bucket b counts values below 2^b (bucket 0: zero)
+
+typedef enum
+{
+    METRIC_CONNECTIONS_ACCEPTED,
+    METRIC_MESSAGES_IN,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_GAMES_STARTED,
+    METRIC_GAMES_FINISHED,
+    METRIC_MOVES,         // Accepted moves, passes excluded
+    METRIC_PASSES,        // Passes sent by clients
+    METRIC_INVALID_MOVES, // Includes moves out of turn and unparsable moves
+    METRIC_TIMEOUTS,
+    METRIC_DISCONNECTIONS, // Player connections that hung up or failed
+    METRIC_RESUMES,        // Players that took their seat back with 'resume'
+    METRIC_COUNTER_COUNT
+} ServerCounter;
+
+// Gauges are set by the thread that owns the value and summed over threads when read
+typedef enum
+{
+    METRIC_ACTIVE_ROOMS,
+    METRIC_LOBBY_CONNECTIONS,
+    METRIC_QUEUED_PLAYERS,
+    METRIC_SPECTATORS,
+    METRIC_GAUGE_COUNT
+} ServerGauge;
+
+typedef enum
+{
+    METRIC_PARSE_NS,           // Parsing one received message
+    METRIC_MOVE_VALIDATION_NS, // Validating and applying one move
+    METRIC_TURN_ROUND_TRIP_NS, // From 'your_turn' being sent to the player's move arriving
+    METRIC_HISTOGRAM_COUNT
+} ServerHistogram;
+
+typedef struct
+{
+    uint64_t buckets[SERVER_METRICS_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} ServerMetricsHistogram;
+
+typedef struct
+{
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    int64_t gauges[METRIC_GAUGE_COUNT];
+    ServerMetricsHistogram histograms[METRIC_HISTOGRAM_COUNT];
+} __attribute__((aligned(64))) ServerMetricsShard;
+
+// Totals over every shard at one point in time
+typedef struct
+{
+    int num_shards;
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    int64_t gauges[METRIC_GAUGE_COUNT];
+    ServerMetricsHistogram histograms[METRIC_HISTOGRAM_COUNT];
+} ServerMetricsSnapshot;
+
+// Shard of the calling thread, NULL until server_metrics_register_thread() (updates are then dropped)
+extern __thread ServerMetricsShard *server_metrics_shard;
+
+extern const char *const server_counter_names[METRIC_COUNTER_COUNT];
+extern const char *const server_gauge_names[METRIC_GAUGE_COUNT];
+extern const char *const server_histogram_names[METRIC_HISTOGRAM_COUNT];
+
+// Adds to a counter of the calling thread
+static inline void server_metrics_add(ServerCounter counter, uint64_t amount)
+{
+    ServerMetricsShard *shard = server_metrics_shard;
+    if (shard)
+        __atomic_store_n(&shard->counters[counter], shard->counters[counter] + amount, __ATOMIC_RELAXED);
+}
+
+// Sets the calling thread's share of a gauge
+static inline void server_metrics_set_gauge(ServerGauge gauge, int64_t value)
+{
+    ServerMetricsShard *shard = server_metrics_shard;
+    if (shard)
+        __atomic_store_n(&shard->gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+// Records one value (in nanoseconds for the *_NS histograms)
+static inline void server_metrics_observe(ServerHistogram histogram, uint64_t value)
+{
+    ServerMetricsShard *shard = server_metrics_shard;
+    if (!shard)
+        return;
+    ServerMetricsHistogram *h = &shard->histograms[histogram];
+    int bucket = value ? 64 - __builtin_clzll(value) : 0;
+    if (bucket >= SERVER_METRICS_BUCKETS)
+        bucket = SERVER_METRICS_BUCKETS - 1;
+    __atomic_store_n(&h->buckets[bucket], h->buckets[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sum, h->sum + value, __ATOMIC_RELAXED);
+    if (value > h->max)
+        __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+}
+
+// Monotonic clock in nanoseconds, for timing histogram samples
+static inline uint64_t server_metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Gives the calling thread its own shard. Call once per thread before recording.
+ *
+ * @return int 0 on success, -1 if every shard is taken (the thread's updates are then dropped).
+ */
+int server_metrics_register_thread(void);
+
+/**
+ * @brief Sums every shard into a snapshot.
+ */
+void server_metrics_snapshot(ServerMetricsSnapshot *out);
+
+/**
+ * @brief Returns the upper bound of the bucket holding the given quantile (0.0 - 1.0).
+ *
+ * @return uint64_t 0 if the histogram is empty.
+ */
+uint64_t server_metrics_quantile(const ServerMetricsHistogram *histogram, double quantile);
+
+/**
+ * @brief Formats a snapshot as "name value" text lines.
+ *
+ * @return size_t Length of the text (truncated to size - 1 if the buffer is too small).
+ */
+size_t server_metrics_format_text(const ServerMetricsSnapshot *snapshot, char *buffer, size_t size);
+
+#endif // SERVER_METRICS_H
@@ -0,0 +1,141 @@
+#include "wire_protocol.h"
+#include <string.h>
+
+static const char cell_chars[4] = {'.', 'R', 'B', '#'};
+
+static unsigned cell_code(char cell)
+{
+    switch (cell)
+    {
+    case 'R':
+        return 1;
+    case 'B':
+        return 2;
+    case '#':
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+void wire_pack_board(const char board[8][9], unsigned char out[WIRE_BOARD_SIZE])
+{
+    memset(out, 0, WIRE_BOARD_SIZE);
+    for (int i = 0; i < 64; i++)
+    {
+        out[i / 4] |= (unsigned char)(cell_code(board[i / 8][i % 8]) << (2 * (i % 4)));
+    }
+}
+
+void wire_unpack_board(const unsigned char in[WIRE_BOARD_SIZE], char board[8][9])
+{
+    for (int i = 0; i < 64; i++)
+    {
+        board[i / 8][i % 8] = cell_chars[(in[i / 4] >> (2 * (i % 4))) & 3];
+    }
+    for (int r = 0; r < 8; r++)
+    {
+        board[r][8] = '\0';
+    }
+}
+
+size_t wire_encode(const WireMessage *msg, unsigned char *out, size_t out_size)
+{
+    unsigned char payload[3 + WIRE_BOARD_SIZE];
+    size_t fixed_len = 0;
+    size_t text_len = 0;
+
+    switch (msg->type)
+    {
+    case WIRE_FRAME_JSON:
+        text_len = msg->text_len;
+        break;
+    case WIRE_FRAME_YOUR_TURN:
+    {
+        wire_pack_board(msg->board, payload);
+        double ms = msg->timeout * 1000.0;
+        unsigned timeout_ms = ms <= 0 ? 0 : ms >= 65535 ? 65535 : (unsigned)ms;
+        payload[WIRE_BOARD_SIZE] = (unsigned char)timeout_ms;
+        payload[WIRE_BOARD_SIZE + 1] = (unsigned char)(timeout_ms >> 8);
+        fixed_len = WIRE_BOARD_SIZE + 2;
+        break;
+    }
+    case WIRE_FRAME_MOVE_OK:
+    case WIRE_FRAME_INVALID_MOVE:
+        wire_pack_board(msg->board, payload);
+        payload[WIRE_BOARD_SIZE] = (unsigned char)msg->next_seat;
+        fixed_len = WIRE_BOARD_SIZE + 1;
+        if (msg->type == WIRE_FRAME_INVALID_MOVE)
+            text_len = msg->text_len;
+        break;
+    case WIRE_FRAME_PASS:
+        payload[0] = (unsigned char)msg->next_seat;
+        fixed_len = 1;
+        break;
+    case WIRE_FRAME_MOVE:
+        for (int i = 0; i < 4; i++)
+            payload[i] = (unsigned char)msg->move[i];
+        fixed_len = 4;
+        break;
+    default:
+        return 0;
+    }
+
+    size_t body_len = 1 + fixed_len + text_len;
+    if (body_len > WIRE_MAX_FRAME || WIRE_FRAME_HEADER_SIZE + body_len > out_size)
+        return 0;
+    out[0] = (unsigned char)body_len;
+    out[1] = (unsigned char)(body_len >> 8);
+    out[2] = (unsigned char)msg->type;
+    memcpy(out + 3, payload, fixed_len);
+    if (text_len > 0)
+        memcpy(out + 3 + fixed_len, msg->text, text_len);
+    return WIRE_FRAME_HEADER_SIZE + body_len;
+}
+
+int wire_decode(const unsigned char *frame, size_t frame_len, WireMessage *out)
+{
+    if (frame_len < 1)
+        return -1;
+    const unsigned char *payload = frame + 1;
+    size_t payload_len = frame_len - 1;
+    out->type = (WireFrameType)frame[0];
+    out->text = NULL;
+    out->text_len = 0;
+
+    switch (out->type)
+    {
+    case WIRE_FRAME_JSON:
+        out->text = (const char *)payload;
+        out->text_len = payload_len;
+        return 0;
+    case WIRE_FRAME_YOUR_TURN:
+        if (payload_len != WIRE_BOARD_SIZE + 2)
+            return -1;
+        wire_unpack_board(payload, out->board);
+        out->timeout = (payload[WIRE_BOARD_SIZE] | payload[WIRE_BOARD_SIZE + 1] << 8) / 1000.0;
+        return 0;
+    case WIRE_FRAME_MOVE_OK:
+    case WIRE_FRAME_INVALID_MOVE:
+        if (payload_len < WIRE_BOARD_SIZE + 1 || (out->type == WIRE_FRAME_MOVE_OK && payload_len != WIRE_BOARD_SIZE + 1))
+            return -1;
+        wire_unpack_board(payload, out->board);
+        out->next_seat = payload[WIRE_BOARD_SIZE];
+        out->text = (const char *)payload + WIRE_BOARD_SIZE + 1;
+        out->text_len = payload_len - (WIRE_BOARD_SIZE + 1);
+        return 0;
+    case WIRE_FRAME_PASS:
+        if (payload_len != 1)
+            return -1;
+        out->next_seat = payload[0];
+        return 0;
+    case WIRE_FRAME_MOVE:
+        if (payload_len != 4)
+            return -1;
+        for (int i = 0; i < 4; i++)
+            out->move[i] = payload[i];
+        return 0;
+    default:
+        return -1;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef WIRE_PROTOCOL_H
+#define WIRE_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary framing, an alternative to the newline-delimited JSON of protocol.h.
+// A client asks for it with "wire":"binary" in 'register' (or 'resume'); the server
+// confirms with "wire":"binary" in its 'register_ack' ('resume_ack'). That ack is the last
+// JSON line: from the next message on, both directions use frames.
+//
+// Frame layout:
+//   0  u16  length of what follows (type and payload), little-endian
+//   2  u8   frame type (WireFrameType)
+//   3       payload
+//
+// The messages of every turn have fixed binary payloads; all others travel unchanged as
+// WIRE_FRAME_JSON, whose payload is the JSON text without the newline.
+//
+// Board: 16 bytes, 2 bits per cell in row-major order, cell i in bits 2*(i%4) of byte i/4
+// (0 '.', 1 'R', 2 'B', 3 '#'). Seat: 0 for 'R', 1 for 'B', WIRE_NO_SEAT for nobody.
+
+#define WIRE_FORMAT_BINARY "binary"
+#define WIRE_FRAME_HEADER_SIZE 2
+#define WIRE_MAX_FRAME 4094 // Type and payload; with its header a frame fills at most a LineFramer ring
+#define WIRE_BOARD_SIZE 16
+#define WIRE_NO_SEAT 0xff
+
+typedef enum
+{
+    WIRE_FORMAT_JSON = 0,
+    WIRE_FORMAT_FRAMES
+} WireFormat;
+
+typedef enum
+{
+    WIRE_FRAME_JSON = 0,         // Any message as JSON text
+    WIRE_FRAME_YOUR_TURN = 1,    // board, u16 timeout in milliseconds
+    WIRE_FRAME_MOVE_OK = 2,      // board, u8 next seat
+    WIRE_FRAME_INVALID_MOVE = 3, // board, u8 next seat, optional reason text up to the end of the frame
+    WIRE_FRAME_PASS = 4,         // u8 next seat
+    WIRE_FRAME_MOVE = 16         // Client: u8 sx, sy, tx, ty, 1-indexed, all 0 to pass
+} WireFrameType;
+
+// One decoded frame, or the contents of one to encode. Only the fields of 'type' are used.
+typedef struct
+{
+    WireFrameType type;
+    char board[8][9];
+    int next_seat;      // WIRE_NO_SEAT if nobody is to move
+    double timeout;     // Seconds
+    int move[4];        // sx, sy, tx, ty
+    const char *text;   // JSON text or reason, not NUL-terminated; points into the frame
+    size_t text_len;
+} WireMessage;
+
+// --- Public Function Prototypes ---
+
+/**
+ * @brief Encodes one message as a complete frame, header included.
+ *
+ * @return size_t Frame length, or 0 if 'out_size' is too small or the text too long.
+ */
+size_t wire_encode(const WireMessage *msg, unsigned char *out, size_t out_size);
+
+/**
+ * @brief Decodes one frame as returned by line_framer_next_frame() (type and payload).
+ *
+ * @return int 0 on success, -1 if the type is unknown or the payload has the wrong size.
+ */
+int wire_decode(const unsigned char *frame, size_t frame_len, WireMessage *out);
+
+/**
+ * @brief Packs a board of '.', 'R', 'B' and '#' rows into WIRE_BOARD_SIZE bytes.
+ */
+void wire_pack_board(const char board[8][9], unsigned char out[WIRE_BOARD_SIZE]);
+
+/**
+ * @brief Unpacks a board into NUL-terminated rows.
+ */
+void wire_unpack_board(const unsigned char in[WIRE_BOARD_SIZE], char board[8][9]);
+
+#endif // WIRE_PROTOCOL_H